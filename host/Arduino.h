@@ -0,0 +1,93 @@
+#pragma once
+// ホストビルド用のArduino.h代わり（描画コードとホストテストが使う分だけ）
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#if !defined(__APPLE__) && !(defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 38)))
+// ESP32のnewlibにはあるがglibc 2.38未満には無い
+inline size_t strlcpy(char* dst, const char* src, size_t size) {
+    size_t len = strlen(src);
+    if (size > 0) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#endif
+
+// ESP-IDFのエラーコードとログ（実機ではArduino.hから読み込まれる）
+typedef int esp_err_t;
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_NO_MEM          0x101
+#define ESP_ERR_INVALID_ARG     0x102
+#define ESP_ERR_INVALID_STATE   0x103
+#define ESP_ERR_INVALID_SIZE    0x104
+#define ESP_ERR_NOT_FOUND       0x105
+#define ESP_ERR_TIMEOUT         0x107
+#define ESP_ERR_NOT_FINISHED    0x10C
+#define ESP_INTR_FLAG_LEVEL1    (1 << 1)
+
+// ログはhostLogEnabled()をtrueにした時だけ標準エラーへ出す
+inline bool& hostLogEnabled() {
+    static bool enabled = false;
+    return enabled;
+}
+#define ESP_LOGI(tag, format, ...) \
+    do { if (hostLogEnabled()) fprintf(stderr, "[%s] " format "\n", tag, ##__VA_ARGS__); } while (0)
+
+#ifdef HOST_VIRTUAL_CLOCK
+// テストが進める仮想時計（millis()・esp_timer_get_time()・delay()はこれを使う）
+inline int64_t& hostClockUs() {
+    static int64_t now = 0;
+    return now;
+}
+inline void hostAdvanceUs(int64_t us) { hostClockUs() += us; }
+inline int64_t esp_timer_get_time() { return hostClockUs(); }
+inline unsigned long millis() { return (unsigned long)(hostClockUs() / 1000); }
+inline void delay(unsigned long ms) { hostAdvanceUs((int64_t)ms * 1000); }
+#else
+inline int64_t esp_timer_get_time() {
+    static const auto start = std::chrono::steady_clock::now();
+    return (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+inline unsigned long millis() {
+    return (unsigned long)(esp_timer_get_time() / 1000);
+}
+
+inline void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+#endif
+
+// ArduinoのString（使っている分だけ）
+#define HEX 16
+class String {
+public:
+    String(const char* s = "") : str(s ? s : "") {}
+    String(char c) : str(1, c) {}
+    String(unsigned char value, int base = 10) {
+        char buf[8];
+        snprintf(buf, sizeof(buf), base == HEX ? "%x" : "%u", value);
+        str = buf;
+    }
+    String& operator+=(const String& other) { str += other.str; return *this; }
+    String& operator+=(const char* s) { str += s; return *this; }
+    String& operator+=(char c) { str += c; return *this; }
+    friend String operator+(String a, const String& b) { a += b; return a; }
+    friend String operator+(String a, const char* b) { a += b; return a; }
+    bool operator==(const char* s) const { return str == s; }
+    const char* c_str() const { return str.c_str(); }
+    unsigned int length() const { return (unsigned int)str.size(); }
+
+private:
+    std::string str;
+};
@@ -0,0 +1,179 @@
+#pragma once
+// ホストビルド用のU8G2代わり
+//
+// 実機のSSD1306と同じ128x64のタイル形式バッファ（8ページ x 128列、1バイト=縦8ドット）を持ち、
+// 描画呼び出し数・I2Cに流れるバイト数・画面外への描画を数える。
+// フォントは実物のグリフを持たず、BDFヘッダ相当の寸法（送り幅・アセント・ディセント）だけを持つ。
+// 文字は枠で描くので、画像は見た目の確認用ではなく配置の確認用。
+#include <Arduino.h>
+#include <string>
+#include <vector>
+
+#define U8G2_R0 0
+#define U8X8_PIN_NONE 255
+
+// フォント寸法 {送り幅, アセント, -ディセント, プロポーショナルなら1}
+const uint8_t u8g2_font_6x10_tr[]  = { 6,  7, 2, 0 };
+const uint8_t u8g2_font_7x13_tr[]  = { 7,  9, 2, 0 };
+const uint8_t u8g2_font_fub14_tr[] = { 11, 14, 4, 1 };
+const uint8_t u8g2_font_fub25_tr[] = { 19, 25, 7, 1 };
+
+// DisplayFlushと同じ送り方（ページごとに [addr,0x00,B0|p,0x00,0x10] と [addr,0x40,64バイト] x 2）
+#define FAKE_U8G2_I2C_BYTES_PER_FRAME (8 * (5 + 2 * (2 + 64)))
+
+class U8G2 {
+public:
+    static const int WIDTH = 128;
+    static const int HEIGHT = 64;
+
+    // 計測用カウンタ（resetCounters()で0に戻す）
+    struct Counters {
+        uint32_t drawCalls = 0;     // drawStr/drawXBMP/drawBox/drawPixel/print
+        uint32_t glyphs = 0;        // 描いた文字数
+        uint32_t flushes = 0;       // sendBuffer回数
+        uint32_t i2cBytes = 0;      // 送出されるはずのバイト数
+        uint32_t clipped = 0;       // 一部が画面外にはみ出した描画
+        uint32_t offscreen = 0;     // 画面外で見えない描画（文字列は本体が欠けるもの）
+    };
+    Counters counters;
+    std::vector<std::string> offscreenLog;  // 画面外描画の内容（"drawStr(0,70) \"...\""）
+
+    void begin() {}
+    void resetCounters() { counters = Counters(); offscreenLog.clear(); }
+
+    void clearBuffer() { memset(buffer, 0, sizeof(buffer)); }
+    void sendBuffer() {
+        counters.flushes++;
+        counters.i2cBytes += FAKE_U8G2_I2C_BYTES_PER_FRAME;
+    }
+    uint8_t* getBufferPtr() { return buffer; }
+    int getDisplayWidth() { return WIDTH; }
+    int getDisplayHeight() { return HEIGHT; }
+
+    void setFont(const uint8_t* f) { font = f ? f : u8g2_font_6x10_tr; }
+    int getFontAscent() { return font[1]; }
+    int getFontDescent() { return -(int)font[2]; }
+    int getStrWidth(const char* s) {
+        int w = 0;
+        for (; s && *s; s++) w += glyphWidth(*s);
+        return w;
+    }
+
+    int drawStr(int x, int y, const char* s) {
+        counters.drawCalls++;
+        int w = getStrWidth(s);
+        if (w > 0) checkText("drawStr", x, y, w, s);
+        int cx = x;
+        for (; s && *s; s++) cx += drawGlyphBox(cx, y, *s);
+        return w;
+    }
+
+    void drawXBMP(int x, int y, int w, int h, const uint8_t* bitmap) {
+        counters.drawCalls++;
+        checkBounds("drawXBMP", x, y, w, h);
+        int stride = (w + 7) / 8;
+        for (int j = 0; j < h; j++) {
+            for (int i = 0; i < w; i++) {
+                if (bitmap[j * stride + i / 8] & (1 << (i % 8))) setPixel(x + i, y + j);
+            }
+        }
+    }
+
+    void setDrawColor(int c) { drawColor = c; }
+
+    void drawBox(int x, int y, int w, int h) {
+        counters.drawCalls++;
+        checkBounds("drawBox", x, y, w, h);
+        for (int j = 0; j < h; j++)
+            for (int i = 0; i < w; i++) setPixel(x + i, y + j);
+    }
+
+    void drawPixel(int x, int y) {
+        counters.drawCalls++;
+        checkBounds("drawPixel", x, y, 1, 1);
+        setPixel(x, y);
+    }
+
+    // Printの代わり（setCursor()の位置に描く。drawStr()はカーソルを動かさない）
+    void setCursor(int x, int y) { tx = x; ty = y; }
+    void print(const char* s) {
+        counters.drawCalls++;
+        int w = getStrWidth(s);
+        if (w > 0) checkText("print", tx, ty, w, s);
+        for (; s && *s; s++) tx += drawGlyphBox(tx, ty, *s);
+    }
+    void print(int v) { char b[16]; snprintf(b, sizeof(b), "%d", v); print(b); }
+    void println(const char* s) { print(s); }
+    void println() {}
+
+    bool getPixel(int x, int y) const {
+        if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT) return false;
+        return buffer[(y / 8) * WIDTH + x] & (1 << (y % 8));
+    }
+
+private:
+    uint8_t buffer[WIDTH * HEIGHT / 8] = {0};
+    const uint8_t* font = u8g2_font_6x10_tr;
+    int tx = 0, ty = 0;
+    int drawColor = 1;
+
+    int glyphWidth(char c) const {
+        int adv = font[0];
+        if (!font[3]) return adv;
+        // プロポーショナルフォントはおおよその字幅
+        if (strchr(" .,:;!|'iIl1", c)) return adv / 2;
+        if (strchr("MWmw@", c)) return adv * 3 / 2;
+        return adv;
+    }
+
+    void setPixel(int x, int y) {
+        if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT) return;
+        if (drawColor) buffer[(y / 8) * WIDTH + x] |= (uint8_t)(1 << (y % 8));
+        else buffer[(y / 8) * WIDTH + x] &= (uint8_t)~(1 << (y % 8));
+    }
+
+    // 文字の代わりに枠を描く（空白は描かない）。戻り値は送り幅
+    int drawGlyphBox(int x, int baseline, char c) {
+        int w = glyphWidth(c);
+        counters.glyphs++;
+        if (c == ' ') return w;
+        int top = baseline - getFontAscent();
+        int bottom = baseline - 1;
+        int right = x + w - 2;
+        for (int i = x; i <= right; i++) { setPixel(i, top); setPixel(i, bottom); }
+        for (int j = top; j <= bottom; j++) { setPixel(x, j); setPixel(right, j); }
+        return w;
+    }
+
+    // 文字列は本体（ベースラインからアセントまで）が欠けたら読めないので画面外として扱い、
+    // ディセントや左右のはみ出しだけならclippedとする
+    void checkText(const char* what, int x, int baseline, int w, const char* s) {
+        int top = baseline - getFontAscent();
+        int bottom = baseline - getFontDescent();
+        if (top < 0 || baseline > HEIGHT || x >= WIDTH || x + w <= 0) {
+            recordOffscreen(what, x, baseline, s);
+        } else if (x < 0 || x + w > WIDTH || bottom > HEIGHT) {
+            counters.clipped++;
+        }
+    }
+
+    void recordOffscreen(const char* what, int x, int y, const char* s) {
+        counters.offscreen++;
+        char line[96];
+        snprintf(line, sizeof(line), "%s(%d,%d) \"%s\"", what, x, y, s);
+        offscreenLog.push_back(line);
+    }
+
+    void checkBounds(const char* what, int x, int y, int w, int h) {
+        if (x >= WIDTH || y >= HEIGHT || x + w <= 0 || y + h <= 0) {
+            recordOffscreen(what, x, y, "");
+        } else if (x < 0 || y < 0 || x + w > WIDTH || y + h > HEIGHT) {
+            counters.clipped++;
+        }
+    }
+};
+
+class U8G2_SSD1306_128X64_NONAME_F_HW_I2C : public U8G2 {
+public:
+    U8G2_SSD1306_128X64_NONAME_F_HW_I2C(int rotation, int reset) { (void)rotation; (void)reset; }
+};
@@ -0,0 +1,23 @@
+#pragma once
+// ホストビルド用のTinyUSB class/hid/hid.h代わり（EspUsbHostが使う分だけ）
+#include <stdint.h>
+
+typedef struct __attribute__((packed)) {
+    uint8_t modifier;
+    uint8_t reserved;
+    uint8_t keycode[6];
+} hid_keyboard_report_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t buttons;
+    int8_t x;
+    int8_t y;
+    int8_t wheel;
+    int8_t pan;
+} hid_mouse_report_t;
+
+typedef enum {
+    HID_LOCAL_NotSupported = 0,
+    HID_LOCAL_Japan = 15,
+    HID_LOCAL_US = 33,
+} hid_local_enum_t;
@@ -0,0 +1,100 @@
+#pragma once
+// ホストビルド用のesp_timer.h代わり（仮想時計で動く。HOST_VIRTUAL_CLOCKでビルドする）
+//
+// タイマーはhostAdvanceTimers()で時計を進めた時に、期限の順にその時刻へ時計を合わせてコールバックを呼ぶ
+// （実機のESP_TIMER_TASKと同じく、呼ぶのは時計を進めた側の1スレッド）。
+#include <Arduino.h>
+#include <vector>
+
+#ifndef HOST_VIRTUAL_CLOCK
+#error "host/esp_timer.h needs -DHOST_VIRTUAL_CLOCK"
+#endif
+
+typedef void (*esp_timer_cb_t)(void* arg);
+
+typedef enum {
+    ESP_TIMER_TASK,
+} esp_timer_dispatch_t;
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void* arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char* name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void* arg;
+    bool armed;
+    int64_t expireUs;
+    uint64_t periodUs;          // 0なら1回だけ
+};
+typedef struct esp_timer* esp_timer_handle_t;
+
+inline std::vector<esp_timer_handle_t>& hostTimers() {
+    static std::vector<esp_timer_handle_t> timers;
+    return timers;
+}
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out) {
+    esp_timer_handle_t t = new esp_timer{ args->callback, args->arg, false, 0, 0 };
+    hostTimers().push_back(t);
+    *out = t;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t timeoutUs) {
+    if (t->armed) return ESP_ERR_INVALID_STATE;
+    t->armed = true;
+    t->expireUs = esp_timer_get_time() + (int64_t)timeoutUs;
+    t->periodUs = 0;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start_periodic(esp_timer_handle_t t, uint64_t periodUs) {
+    if (t->armed) return ESP_ERR_INVALID_STATE;
+    t->armed = true;
+    t->expireUs = esp_timer_get_time() + (int64_t)periodUs;
+    t->periodUs = periodUs;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_stop(esp_timer_handle_t t) {
+    if (!t->armed) return ESP_ERR_INVALID_STATE;
+    t->armed = false;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_delete(esp_timer_handle_t t) {
+    std::vector<esp_timer_handle_t>& timers = hostTimers();
+    for (size_t i = 0; i < timers.size(); i++) {
+        if (timers[i] == t) {
+            timers.erase(timers.begin() + i);
+            break;
+        }
+    }
+    delete t;
+    return ESP_OK;
+}
+
+// 仮想時計をusだけ進め、その間に期限が来たタイマーを順に呼ぶ
+inline void hostAdvanceTimers(int64_t us) {
+    const int64_t end = esp_timer_get_time() + us;
+    for (;;) {
+        esp_timer_handle_t next = nullptr;
+        for (esp_timer_handle_t t : hostTimers()) {
+            if (t->armed && t->expireUs <= end && (!next || t->expireUs < next->expireUs)) next = t;
+        }
+        if (!next) break;
+        if (next->expireUs > esp_timer_get_time()) hostClockUs() = next->expireUs;
+        if (next->periodUs) {
+            next->expireUs += (int64_t)next->periodUs;
+        } else {
+            next->armed = false;
+        }
+        next->callback(next->arg);
+    }
+    hostClockUs() = end;
+}
@@ -0,0 +1,14 @@
+#pragma once
+// ホストビルド用のFreeRTOS.h代わり（ホストテストは1スレッドなので排他は何もしない）
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  1
+
+typedef struct { int count; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+#define portENTER_CRITICAL(mux) ((mux)->count++)
+#define portEXIT_CRITICAL(mux)  ((mux)->count--)
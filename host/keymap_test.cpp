@@ -0,0 +1,191 @@
+// ホスト側のキーマップ（レイヤー・タップ/ホールド）テスト
+//
+// 実機のsrc/KeyLayers.cppを、仮想時計で動く偽のesp_timer（host/esp_timer.h）の上で動かす。
+// 押下・リリース・時間切れを決まった時刻で流し、出てくるキーの変化とレイヤーを確かめる。
+//
+// ビルドと実行は python/host_tests.py から行う。
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <string>
+#include <vector>
+#include "KeyLayers.h"
+
+static int failures = 0;
+static int checks = 0;
+
+#define CHECK(cond) do { \
+    checks++; \
+    if (!(cond)) { failures++; fprintf(stderr, "  NG %s:%d: %s\n", __FILE__, __LINE__, #cond); } \
+} while (0)
+
+// 押す・離す・時間を進める（タイマーは期限の時刻に呼ばれる）
+static void press(uint8_t keycode) { keyLayers.press(keycode, millis()); }
+static void release(uint8_t keycode) { keyLayers.release(keycode, millis()); }
+static void advance(uint32_t ms) { hostAdvanceTimers((int64_t)ms * 1000); }
+
+// 出たキーの変化を "+3E -3E" のような文字列にする（マクロは "+M0"）
+static std::string drain() {
+    std::string out;
+    KeyEvent e;
+    while (keyLayers.pollEvent(e)) {
+        char buf[8];
+        snprintf(buf, sizeof(buf), "%c%s%02X", e.down ? '+' : '-', e.macro ? "M" : "", e.keycode);
+        if (!out.empty()) out += ' ';
+        out += buf;
+    }
+    return out;
+}
+
+static void begin() {
+    keyLayers.compile(KB16_KEYMAP, KB16_KEYMAP_SIZE);
+    drain();
+}
+
+// 期限内に離せばタップ（キーコードの押下とリリース）。後でタイマーが来てもホールドにしない
+static void scenarioTap() {
+    begin();
+    uint32_t holds = keyLayers.getHolds();
+    uint32_t taps = keyLayers.getTaps();
+    press(0x4A);
+    advance(KEYMAP_TAPPING_TERM_MS - 1);
+    CHECK(drain() == "");
+    release(0x4A);
+    CHECK(drain() == "+4A -4A");
+    advance(2 * KEYMAP_TAPPING_TERM_MS);
+    CHECK(keyLayers.getTaps() == taps + 1);
+    CHECK(keyLayers.getHolds() == holds);
+    CHECK(keyLayers.getActiveLayer() == 0);
+}
+
+// 期限まで押し続ければホールド（レイヤー1）。離すと戻り、PrintScreenは出ない
+static void scenarioHoldOnTimeout() {
+    begin();
+    uint32_t holds = keyLayers.getHolds();
+    press(0x4A);
+    advance(KEYMAP_TAPPING_TERM_MS - 1);
+    CHECK(keyLayers.getActiveLayer() == 0);
+    uint32_t deadline = 0;
+    CHECK(keyLayers.getDeadline(deadline));
+    advance(1);
+    CHECK(keyLayers.getHolds() == holds + 1);
+    CHECK(keyLayers.getActiveLayer() == 1);
+    CHECK(!keyLayers.getDeadline(deadline));
+
+    press(0x22);
+    release(0x22);
+    CHECK(drain() == "+3E -3E");            // 1 -> F1
+    release(0x4A);
+    CHECK(drain() == "");
+    CHECK(keyLayers.getActiveLayer() == 0);
+}
+
+// 判定中に他のキーを押せば、期限前でもホールドにしてから次のキーを引く
+static void scenarioHoldOnOtherKey() {
+    begin();
+    uint32_t holds = keyLayers.getHolds();
+    press(0x4A);
+    advance(KEYMAP_TAPPING_TERM_MS / 4);
+    press(0x23);
+    CHECK(keyLayers.getHolds() == holds + 1);
+    CHECK(keyLayers.getActiveLayer() == 1);
+    CHECK(drain() == "+3F");                // 2 -> F2
+    release(0x23);
+    release(0x4A);
+    CHECK(drain() == "-3F");
+    // 残っていたタイマーが来ても何も起きない
+    advance(2 * KEYMAP_TAPPING_TERM_MS);
+    CHECK(keyLayers.getHolds() == holds + 1);
+    CHECK(drain() == "");
+}
+
+// TG(1)はレイヤー1を固定し、もう一度押すと解除する
+static void scenarioToggle() {
+    begin();
+    press(0x4A);
+    advance(KEYMAP_TAPPING_TERM_MS);
+    press(0x2D);                            // Esc -> TG(1)
+    release(0x2D);
+    release(0x4A);
+    CHECK(keyLayers.getActiveLayer() == 1);
+    CHECK(drain() == "");
+
+    press(0x56);
+    release(0x56);
+    CHECK(drain() == "+4F -4F");            // Up -> PageUp
+    press(0x1A);
+    release(0x1A);
+    CHECK(drain() == "+M00 -M00");          // S -> マクロ0
+
+    press(0x2D);                            // 固定中のレイヤー1でもTG(1)
+    release(0x2D);
+    CHECK(keyLayers.getActiveLayer() == 0);
+    press(0x56);
+    release(0x56);
+    CHECK(drain() == "+56 -56");
+}
+
+// 離す時は押した時の動作を使う（押している間にレイヤーが変わっても押したキーが離れる）
+static void scenarioReleaseAfterLayerChange() {
+    begin();
+    // レイヤー1で押して、レイヤー0に戻ってから離す
+    press(0x4A);
+    advance(KEYMAP_TAPPING_TERM_MS);
+    press(0x56);
+    release(0x4A);
+    CHECK(keyLayers.getActiveLayer() == 0);
+    release(0x56);
+    CHECK(drain() == "+4F -4F");
+
+    // レイヤー0で押して、レイヤー1になってから離す
+    press(0x55);
+    press(0x4A);
+    advance(KEYMAP_TAPPING_TERM_MS);
+    CHECK(keyLayers.getActiveLayer() == 1);
+    release(0x55);
+    release(0x4A);
+    CHECK(drain() == "+55 -55");
+}
+
+// 出力待ちがあふれたら捨てて数える（古い方は残る）
+static void scenarioOverflow() {
+    begin();
+    uint32_t dropped = keyLayers.getDroppedEvents();
+    const int extra = 8;
+    for (int i = 0; i < KEYMAP_EVENT_QUEUE + extra; i++) press(0x04 + i);
+    CHECK(keyLayers.getDroppedEvents() == dropped + extra);
+    int n = 0;
+    bool inOrder = true;
+    KeyEvent e;
+    while (keyLayers.pollEvent(e)) {
+        inOrder &= e.down && e.keycode == 0x04 + n;
+        n++;
+    }
+    CHECK(n == KEYMAP_EVENT_QUEUE);
+    CHECK(inOrder);
+    // 空いたらまた入る
+    release(0x04);
+    CHECK(drain() == "-04");
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) hostLogEnabled() = true;
+    }
+    keyLayers.begin();
+
+    struct { const char* name; void (*run)(); } scenarios[] = {
+        { "タップ", scenarioTap },
+        { "時間切れでホールド", scenarioHoldOnTimeout },
+        { "他のキーでホールド", scenarioHoldOnOtherKey },
+        { "TG(1)", scenarioToggle },
+        { "レイヤーが変わってから離す", scenarioReleaseAfterLayerChange },
+        { "出力待ちのあふれ", scenarioOverflow },
+    };
+    for (auto& s : scenarios) {
+        int before = failures;
+        s.run();
+        printf("%-24s %s\n", s.name, failures == before ? "OK" : "NG");
+    }
+    printf("%d / %d 件の確認に失敗\n", failures, checks);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,268 @@
+// ホスト側の描画ツール
+//
+// 実機の描画コード（src/DisplayRender.cpp, src/StartupAnimation.h）をホストの偽U8G2（host/U8g2lib.h）で動かし、
+// 表示要求の種類ごとに描画コスト・描画呼び出し数・I2Cバイト数を表示し、各フレームを画像として書き出す。
+// 画面外への描画があれば終了コード1で終わるので、CIで配置の崩れを検出できる。
+//
+// ビルドと実行は python/render_frames.py から行う。
+#include <Arduino.h>
+#include <U8g2lib.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include "DisplayRender.h"
+#include "RleBitmap.h"
+#include "StartupAnimation.h"
+#include "BitmapImagesRle.h"
+
+struct RenderCase {
+    std::string name;
+    std::function<void(U8G2&)> render;   // バッファに描く（sendBufferはこちらで呼ぶ）
+};
+
+// PBM（P4）。点灯ドットを黒で書く
+static bool writePbm(const std::string& path, const U8G2& d) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    fprintf(f, "P4\n%d %d\n", U8G2::WIDTH, U8G2::HEIGHT);
+    for (int y = 0; y < U8G2::HEIGHT; y++) {
+        for (int xb = 0; xb < U8G2::WIDTH / 8; xb++) {
+            uint8_t b = 0;
+            for (int i = 0; i < 8; i++) {
+                if (d.getPixel(xb * 8 + i, y)) b |= 0x80 >> i;
+            }
+            fputc(b, f);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+static uint32_t crc32(const uint8_t* p, size_t n, uint32_t crc = 0) {
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++) {
+        crc ^= p[i];
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+static void putBe32(std::vector<uint8_t>& v, uint32_t x) {
+    v.push_back(x >> 24); v.push_back(x >> 16); v.push_back(x >> 8); v.push_back(x);
+}
+
+static void putChunk(FILE* f, const char* type, const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> buf;
+    putBe32(buf, data.size());
+    buf.insert(buf.end(), type, type + 4);
+    buf.insert(buf.end(), data.begin(), data.end());
+    uint32_t crc = crc32(buf.data() + 4, buf.size() - 4);
+    putBe32(buf, crc);
+    fwrite(buf.data(), 1, buf.size(), f);
+}
+
+// 1ビットグレースケールPNG（無圧縮deflate）。点灯ドットを白で書く（実機の見た目に合わせる）
+static bool writePng(const std::string& path, const U8G2& d) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    static const uint8_t sig[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    fwrite(sig, 1, sizeof(sig), f);
+
+    std::vector<uint8_t> ihdr;
+    putBe32(ihdr, U8G2::WIDTH);
+    putBe32(ihdr, U8G2::HEIGHT);
+    ihdr.push_back(1);  // ビット深度
+    ihdr.push_back(0);  // グレースケール
+    ihdr.push_back(0); ihdr.push_back(0); ihdr.push_back(0);
+    putChunk(f, "IHDR", ihdr);
+
+    std::vector<uint8_t> raw;
+    for (int y = 0; y < U8G2::HEIGHT; y++) {
+        raw.push_back(0);  // フィルタなし
+        for (int xb = 0; xb < U8G2::WIDTH / 8; xb++) {
+            uint8_t b = 0;
+            for (int i = 0; i < 8; i++) {
+                if (d.getPixel(xb * 8 + i, y)) b |= 0x80 >> i;
+            }
+            raw.push_back(b);
+        }
+    }
+    // zlibヘッダ + 無圧縮ブロック1つ + Adler-32
+    std::vector<uint8_t> z = { 0x78, 0x01, 0x01 };
+    uint16_t len = raw.size();
+    z.push_back(len & 0xFF); z.push_back(len >> 8);
+    z.push_back(~len & 0xFF); z.push_back((~len >> 8) & 0xFF);
+    z.insert(z.end(), raw.begin(), raw.end());
+    uint32_t a = 1, b = 0;
+    for (uint8_t c : raw) { a = (a + c) % 65521; b = (b + a) % 65521; }
+    putBe32(z, (b << 16) | a);
+    putChunk(f, "IDAT", z);
+    putChunk(f, "IEND", std::vector<uint8_t>());
+    fclose(f);
+    return true;
+}
+
+static std::vector<RenderCase> buildCases(U8G2* display) {
+    std::vector<RenderCase> cases;
+
+    // ステータスバー用の状態（KB16接続・BLE接続・左Shift押下）
+    StatusSnapshot st;
+    st.bleConnected = true;
+    st.usbDevice = USB_DEVICE_KB16;
+    st.modifiers = 0x02;
+
+    // 通常表示
+    cases.push_back({ "normal", [display, st](U8G2&) {
+        DisplayRequest req;
+        req.display = display;
+        req.font = u8g2_font_fub25_tr;
+        req.setText1("a");
+        req.setText2("0x08");
+        drawNormalScreen(req);
+        drawStatusBar(display, st);
+    } });
+
+    // 特別キーの文字表示（SPECIAL_KEY_TABLEの代表）
+    struct { const char* name; const char* t1; const char* t2; } texts[] = {
+        { "text_move_fwd", "MOVE FWD", "" },
+        { "text_turn_right", "TURN RIGHT", "" },
+        { "text_intro", "INTRO", "Japanese or English" },
+        { "text_stop_angular", "STOP", "ANGULAR SPEED" },
+        { "text_wait", "WAIT", "" },
+    };
+    for (auto& t : texts) {
+        std::string t1 = t.t1, t2 = t.t2;
+        cases.push_back({ t.name, [display, t1, t2](U8G2&) {
+            DisplayRequest req;
+            req.display = display;
+            req.type = DISPLAY_TEXT;
+            req.font = u8g2_font_fub14_tr;
+            req.setText1(t1.c_str());
+            req.setText2(t2.c_str());
+            drawTextScreen(req);
+        } });
+    }
+
+    // USB接続・切断画面（PythonStyleAnalyzer::updateDisplayForDevice / onGone）
+    cases.push_back({ "device", [display, st](U8G2&) {
+        DisplayRequest req;
+        req.display = display;
+        req.type = DISPLAY_DEVICE;
+        req.setText1("KEYBOARD");
+        drawDeviceScreen(req);
+        drawStatusBar(display, st);
+    } });
+    cases.push_back({ "gone", [display](U8G2&) {
+        DisplayRequest req;
+        req.display = display;
+        req.type = DISPLAY_GONE;
+        drawGoneScreen(req);
+    } });
+
+    // ステータスバーだけの描き直し（状態が変わった時のコスト）
+    cases.push_back({ "status_bar", [display, st](U8G2&) {
+        drawStatusBar(display, st);
+    } });
+
+    // "READY"ホップ（各フレーム + 静止）
+    for (int i = 0; i <= 5; i++) {
+        int idx = (i == 5) ? -1 : i;
+        cases.push_back({ "ready_hop_" + std::to_string(i), [display, idx, st](U8G2&) {
+            renderHopFrame(display, "READY", u8g2_font_fub14_tr, 8, idx);
+            drawStatusBar(display, st);
+        } });
+    }
+
+    // 起動画面（1周分 + 最後の静止）
+    for (int i = 0; i <= 7; i++) {
+        int idx = (i == 7) ? -1 : i;
+        int sec = (i == 7) ? 0 : 5;
+        cases.push_back({ "startup_" + std::to_string(i), [display, idx, sec](U8G2&) {
+            StartupAnimation(display).renderFrame(idx, sec);
+        } });
+    }
+
+    // 顔ビットマップ（RLE展開 + 跳ねた位置）
+    struct { const char* name; const RleBitmap* bmp; } faces[] = {
+        { "face_1", &rle_bitmap_faces_1 },
+        { "face_2", &rle_bitmap_faces_2 },
+        { "face_3", &rle_bitmap_faces_3 },
+        { "face_3_5", &rle_bitmap_faces_3_5 },
+        { "face_4", &rle_bitmap_faces_4 },
+    };
+    for (auto& fc : faces) {
+        const RleBitmap* bmp = fc.bmp;
+        cases.push_back({ fc.name, [bmp](U8G2& d) {
+            rleDecodeTiles(*bmp, d.getBufferPtr());
+        } });
+        cases.push_back({ std::string(fc.name) + "_hop", [bmp](U8G2& d) {
+            rleDecodeTiles(*bmp, d.getBufferPtr());
+            shiftTiles(d.getBufferPtr(), -4);
+        } });
+    }
+    return cases;
+}
+
+int main(int argc, char** argv) {
+    std::string outDir;
+    bool png = false;
+    int iterations = 1000;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--out" && i + 1 < argc) outDir = argv[++i];
+        else if (a == "--png") png = true;
+        else if (a == "--iterations" && i + 1 < argc) iterations = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--out DIR] [--png] [--iterations N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (iterations < 1) iterations = 1;
+
+    U8G2_SSD1306_128X64_NONAME_F_HW_I2C display(U8G2_R0, U8X8_PIN_NONE);
+    display.begin();
+    std::vector<RenderCase> cases = buildCases(&display);
+
+    int failures = 0;
+    printf("%-20s %8s %6s %6s %8s %7s %9s\n", "case", "us/frame", "calls", "glyphs", "i2c B", "clipped", "offscreen");
+    for (const RenderCase& c : cases) {
+        // 1回目で描画内容と呼び出し数を記録
+        display.resetCounters();
+        c.render(display);
+        display.sendBuffer();
+        U8G2::Counters once = display.counters;
+        std::vector<std::string> offscreen = display.offscreenLog;
+
+        if (!outDir.empty()) {
+            std::string base = outDir + "/" + c.name;
+            bool ok = png ? writePng(base + ".png", display) : writePbm(base + ".pbm", display);
+            if (!ok) {
+                fprintf(stderr, "cannot write %s\n", base.c_str());
+                return 2;
+            }
+        }
+
+        // 描画コスト（sendBufferは偽物なので描画側のみの時間）
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            c.render(display);
+            display.sendBuffer();
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        double us = std::chrono::duration<double, std::micro>(t1 - t0).count() / iterations;
+
+        printf("%-20s %8.2f %6u %6u %8u %7u %9u\n", c.name.c_str(), us,
+               once.drawCalls, once.glyphs, once.i2cBytes, once.clipped, once.offscreen);
+        for (const std::string& s : offscreen) {
+            printf("    off-screen: %s\n", s.c_str());
+        }
+        if (once.offscreen > 0) failures++;
+    }
+
+    if (failures > 0) {
+        printf("%d case(s) draw outside the 128x64 screen\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,3 @@
+#pragma once
+// ホストビルド用のrom/usb/usb_common.h代わり（使う定義はusb/usb_host.hにある）
+#include <usb/usb_host.h>
@@ -0,0 +1,173 @@
+#pragma once
+// ホストビルド用のESP-IDF USBホストライブラリ代わり（EspUsbHostが使う分だけ）
+//
+// 型と関数の形はESP-IDF 4.4のusb/usb_host.h・usb/usb_types_ch9.hに合わせる。
+// 関数の中身はテスト側（host/usb_replay.cpp）の偽バスが持ち、転送の完了とクライアントイベントは
+// usb_host_client_handle_events()の中からコールバックで届ける（実機と同じくUSBタスクの中）。
+#include <Arduino.h>
+
+// 第9章の記述子と要求
+#define USB_SETUP_PACKET_SIZE                   8
+#define USB_BM_ATTRIBUTES_XFERTYPE_MASK         0x03
+#define USB_BM_ATTRIBUTES_XFER_INT              0x03
+#define USB_B_ENDPOINT_ADDRESS_EP_DIR_MASK      0x80
+
+typedef struct __attribute__((packed)) {
+    uint8_t bmRequestType;
+    uint8_t bRequest;
+    uint16_t wValue;
+    uint16_t wIndex;
+    uint16_t wLength;
+} usb_setup_packet_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint16_t bcdUSB;
+    uint8_t bDeviceClass;
+    uint8_t bDeviceSubClass;
+    uint8_t bDeviceProtocol;
+    uint8_t bMaxPacketSize0;
+    uint16_t idVendor;
+    uint16_t idProduct;
+    uint16_t bcdDevice;
+    uint8_t iManufacturer;
+    uint8_t iProduct;
+    uint8_t iSerialNumber;
+    uint8_t bNumConfigurations;
+} usb_device_desc_t;
+
+// コンフィグ記述子（valから続く記述子をwTotalLengthバイト分たどる）
+typedef union {
+    struct __attribute__((packed)) {
+        uint8_t bLength;
+        uint8_t bDescriptorType;
+        uint16_t wTotalLength;
+        uint8_t bNumInterfaces;
+        uint8_t bConfigurationValue;
+        uint8_t iConfiguration;
+        uint8_t bmAttributes;
+        uint8_t bMaxPower;
+    };
+    uint8_t val[9];
+} usb_config_desc_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bInterfaceNumber;
+    uint8_t bAlternateSetting;
+    uint8_t bNumEndpoints;
+    uint8_t bInterfaceClass;
+    uint8_t bInterfaceSubClass;
+    uint8_t bInterfaceProtocol;
+    uint8_t iInterface;
+} usb_intf_desc_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bEndpointAddress;
+    uint8_t bmAttributes;
+    uint16_t wMaxPacketSize;
+    uint8_t bInterval;
+} usb_ep_desc_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint16_t wData[1];
+} usb_str_desc_t;
+
+// ハンドル（偽バスのデバイス・クライアントを指す）
+typedef struct usb_device_s* usb_device_handle_t;
+typedef struct usb_host_client_s* usb_host_client_handle_t;
+
+typedef struct {
+    int speed;
+    uint8_t dev_addr;
+    uint8_t bMaxPacketSize0;
+    uint8_t bConfigurationValue;
+    const usb_str_desc_t* str_desc_manufacturer;
+    const usb_str_desc_t* str_desc_product;
+    const usb_str_desc_t* str_desc_serial_num;
+} usb_device_info_t;
+
+// 転送
+typedef enum {
+    USB_TRANSFER_STATUS_COMPLETED,
+    USB_TRANSFER_STATUS_ERROR,
+    USB_TRANSFER_STATUS_TIMED_OUT,
+    USB_TRANSFER_STATUS_CANCELED,
+    USB_TRANSFER_STATUS_STALL,
+    USB_TRANSFER_STATUS_OVERFLOW,
+    USB_TRANSFER_STATUS_SKIPPED,
+    USB_TRANSFER_STATUS_NO_DEVICE,
+} usb_transfer_status_t;
+
+struct usb_transfer_s;
+typedef void (*usb_transfer_cb_t)(struct usb_transfer_s* transfer);
+
+typedef struct usb_transfer_s {
+    uint8_t* data_buffer;
+    size_t data_buffer_size;
+    int num_bytes;
+    int actual_num_bytes;
+    uint32_t flags;
+    usb_device_handle_t device_handle;
+    uint8_t bEndpointAddress;
+    usb_transfer_status_t status;
+    uint32_t timeout_ms;
+    usb_transfer_cb_t callback;
+    void* context;
+} usb_transfer_t;
+
+// ライブラリとクライアント
+typedef struct {
+    bool skip_phy_setup;
+    int intr_flags;
+} usb_host_config_t;
+
+typedef enum {
+    USB_HOST_CLIENT_EVENT_NEW_DEV,
+    USB_HOST_CLIENT_EVENT_DEV_GONE,
+} usb_host_client_event_t;
+
+typedef struct {
+    usb_host_client_event_t event;
+    struct { uint8_t address; } new_dev;
+    struct { usb_device_handle_t dev_hdl; } dev_gone;
+} usb_host_client_event_msg_t;
+
+typedef void (*usb_host_client_event_cb_t)(const usb_host_client_event_msg_t* event_msg, void* arg);
+
+typedef struct {
+    bool is_synchronous;
+    int max_num_event_msg;
+    struct {
+        usb_host_client_event_cb_t client_event_callback;
+        void* callback_arg;
+    } async;
+} usb_host_client_config_t;
+
+esp_err_t usb_host_install(const usb_host_config_t* config);
+esp_err_t usb_host_lib_handle_events(uint32_t timeout_ticks, uint32_t* event_flags_ret);
+esp_err_t usb_host_client_register(const usb_host_client_config_t* client_config, usb_host_client_handle_t* client_hdl_ret);
+esp_err_t usb_host_client_handle_events(usb_host_client_handle_t client_hdl, uint32_t timeout_ticks);
+
+esp_err_t usb_host_device_open(usb_host_client_handle_t client_hdl, uint8_t dev_addr, usb_device_handle_t* dev_hdl_ret);
+esp_err_t usb_host_device_close(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl);
+esp_err_t usb_host_device_addr(usb_device_handle_t dev_hdl, uint8_t* dev_addr);
+esp_err_t usb_host_device_info(usb_device_handle_t dev_hdl, usb_device_info_t* dev_info);
+esp_err_t usb_host_get_device_descriptor(usb_device_handle_t dev_hdl, const usb_device_desc_t** device_desc);
+esp_err_t usb_host_get_active_config_descriptor(usb_device_handle_t dev_hdl, const usb_config_desc_t** config_desc);
+
+esp_err_t usb_host_interface_claim(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl, uint8_t bInterfaceNumber, uint8_t bAlternateSetting);
+esp_err_t usb_host_interface_release(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl, uint8_t bInterfaceNumber);
+esp_err_t usb_host_endpoint_halt(usb_device_handle_t dev_hdl, uint8_t bEndpointAddress);
+esp_err_t usb_host_endpoint_flush(usb_device_handle_t dev_hdl, uint8_t bEndpointAddress);
+
+esp_err_t usb_host_transfer_alloc(size_t data_buffer_size, int num_isoc_packets, usb_transfer_t** transfer);
+esp_err_t usb_host_transfer_free(usb_transfer_t* transfer);
+esp_err_t usb_host_transfer_submit(usb_transfer_t* transfer);
+esp_err_t usb_host_transfer_submit_control(usb_host_client_handle_t client_hdl, usb_transfer_t* transfer);
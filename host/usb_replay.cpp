@@ -0,0 +1,736 @@
+// ホスト側のUSB抜き差しリプレイテスト
+//
+// 実機のsrc/EspUsbHost.cppを、ここで実装する偽のUSBホストライブラリ（host/usb/usb_host.h）の上で動かす。
+// 接続（NEW_DEV）・切断（DEV_GONE）・遅れて戻る転送の完了を決まった順に流し、
+// DRAININGの後始末（送信中の転送を解放しない・スロットの再利用・待っていた接続・onGoneの順番）を確かめる。
+// 偽バスは転送の二重送信・送信中の解放・クレームしたままのクローズを違反として数える。
+//
+// ビルドと実行は python/host_tests.py から行う。
+#include <Arduino.h>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "EspUsbHost.h"
+#include "UsbProfileCache.h"
+
+// 転送が全部戻ってから閉じ終わるまでのtask()の回数の上限
+#define REPLAY_CLOSE_BOUND 2
+// 接続からACTIVEになるまでのtask()の回数の上限
+#define REPLAY_OPEN_BOUND  20
+
+// ---------------------------------------------------------------------------
+// 偽のUSBバス
+// ---------------------------------------------------------------------------
+
+struct usb_device_s {
+    uint8_t address = 0;
+    bool attached = true;       // 挿さっている（DEV_GONEの後はfalse）
+    bool open = false;
+    bool closed = false;        // 一度閉じた（以後ハンドルを使うのは違反）
+    uint32_t claimed = 0;       // クレーム中のインターフェース（ビット）
+    usb_device_desc_t desc = {};
+    std::vector<uint8_t> config;
+    std::vector<uint8_t> reportDesc;   // GET_DESCRIPTOR(レポート)で返す
+};
+
+struct FakeBus {
+    std::vector<usb_device_s*> devices;
+    std::set<usb_transfer_t*> allocated;
+    std::set<usb_transfer_t*> inFlight;
+    std::deque<usb_transfer_t*> completions;      // 次のusb_host_client_handle_events()で戻す
+    std::deque<usb_host_client_event_msg_t> events;
+    bool holdCompletions = false;                 // halt/flush・コントロール転送をすぐには戻さない
+    int reportDescStalls = 0;                     // レポート記述子の読み出しをこの回数だけSTALLさせる
+    int reportDescRequests = 0;
+    std::map<uint8_t, int> submits;               // 割り込み転送を送った回数（エンドポイントごと）
+    usb_host_client_event_cb_t callback = nullptr;
+    void* callbackArg = nullptr;
+    std::vector<std::string> violations;
+
+    void violation(const std::string& what) {
+        violations.push_back(what);
+        fprintf(stderr, "  違反: %s\n", what.c_str());
+    }
+
+    bool queued(usb_transfer_t* t) const {
+        for (usb_transfer_t* q : completions) {
+            if (q == t) return true;
+        }
+        return false;
+    }
+
+    // 送信中の転送を完了させる（次のhandle_eventsでコールバックへ戻る）
+    void complete(usb_transfer_t* t, usb_transfer_status_t status, const uint8_t* data = nullptr, int length = 0) {
+        if (!inFlight.count(t) || queued(t)) return;
+        t->status = status;
+        t->actual_num_bytes = length;
+        if (data && length > 0) memcpy(t->data_buffer, data, length);
+        completions.push_back(t);
+    }
+
+    // デバイスの送信中の転送（endpoint=0xFFなら全部）
+    std::vector<usb_transfer_t*> pending(usb_device_s* dev, uint8_t endpoint = 0xFF) const {
+        std::vector<usb_transfer_t*> out;
+        for (usb_transfer_t* t : inFlight) {
+            if ((usb_device_s*)t->device_handle == dev && (endpoint == 0xFF || t->bEndpointAddress == endpoint)) {
+                out.push_back(t);
+            }
+        }
+        return out;
+    }
+
+    void reset() {
+        for (usb_transfer_t* t : allocated) {
+            delete[] t->data_buffer;
+            delete t;
+        }
+        for (usb_device_s* d : devices) delete d;
+        *this = FakeBus();
+    }
+};
+
+static FakeBus bus;
+
+static usb_device_s* lookup(usb_device_handle_t handle, const char* caller) {
+    usb_device_s* dev = (usb_device_s*)handle;
+    for (usb_device_s* d : bus.devices) {
+        if (d == dev) {
+            if (!d->open) bus.violation(std::string(caller) + ": 閉じたデバイスのハンドル");
+            return d;
+        }
+    }
+    bus.violation(std::string(caller) + ": 知らないハンドル");
+    return nullptr;
+}
+
+esp_err_t usb_host_install(const usb_host_config_t*) { return ESP_OK; }
+
+esp_err_t usb_host_lib_handle_events(uint32_t, uint32_t* flags) {
+    if (flags) *flags = 0;
+    return ESP_ERR_TIMEOUT;
+}
+
+esp_err_t usb_host_client_register(const usb_host_client_config_t* config, usb_host_client_handle_t* ret) {
+    bus.callback = config->async.client_event_callback;
+    bus.callbackArg = config->async.callback_arg;
+    *ret = (usb_host_client_handle_t)&bus;
+    return ESP_OK;
+}
+
+// 実機と同じく、転送の完了とクライアントイベントはここからコールバックで届く
+esp_err_t usb_host_client_handle_events(usb_host_client_handle_t, uint32_t) {
+    // コールバックの中で積まれた完了は次の呼び出しで戻す
+    size_t n = bus.completions.size();
+    for (size_t i = 0; i < n; i++) {
+        usb_transfer_t* t = bus.completions.front();
+        bus.completions.pop_front();
+        bus.inFlight.erase(t);
+        t->callback(t);
+    }
+    while (!bus.events.empty()) {
+        usb_host_client_event_msg_t msg = bus.events.front();
+        bus.events.pop_front();
+        bus.callback(&msg, bus.callbackArg);
+    }
+    return ESP_OK;
+}
+
+esp_err_t usb_host_device_open(usb_host_client_handle_t, uint8_t address, usb_device_handle_t* ret) {
+    for (usb_device_s* d : bus.devices) {
+        if (d->address == address && d->attached && !d->closed) {
+            if (d->open) {
+                bus.violation("同じデバイスを2回開いた");
+                return ESP_ERR_INVALID_STATE;
+            }
+            d->open = true;
+            *ret = (usb_device_handle_t)d;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t usb_host_device_close(usb_host_client_handle_t, usb_device_handle_t handle) {
+    usb_device_s* dev = lookup(handle, "device_close");
+    if (!dev || !dev->open) return ESP_ERR_INVALID_STATE;
+    if (dev->claimed) {
+        bus.violation("インターフェースをクレームしたまま閉じた");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!bus.pending(dev).empty()) {
+        bus.violation("送信中の転送を残して閉じた");
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (usb_transfer_t* t : bus.allocated) {
+        if ((usb_device_s*)t->device_handle == dev) {
+            bus.violation("転送を解放せずに閉じた");
+            break;
+        }
+    }
+    dev->open = false;
+    dev->closed = true;
+    return ESP_OK;
+}
+
+esp_err_t usb_host_device_addr(usb_device_handle_t handle, uint8_t* address) {
+    usb_device_s* dev = (usb_device_s*)handle;
+    // スロット待ちでまだ開いていないデバイスのDEV_GONEでも引ける（閉じた後は違反）
+    if (!dev->open && !dev->closed) {
+        *address = dev->address;
+        return ESP_OK;
+    }
+    dev = lookup(handle, "device_addr");
+    if (!dev) return ESP_ERR_INVALID_ARG;
+    *address = dev->address;
+    return ESP_OK;
+}
+
+esp_err_t usb_host_device_info(usb_device_handle_t handle, usb_device_info_t* info) {
+    usb_device_s* dev = lookup(handle, "device_info");
+    memset(info, 0, sizeof(*info));
+    if (dev) info->dev_addr = dev->address;
+    return ESP_OK;
+}
+
+esp_err_t usb_host_get_device_descriptor(usb_device_handle_t handle, const usb_device_desc_t** desc) {
+    usb_device_s* dev = lookup(handle, "get_device_descriptor");
+    if (!dev) return ESP_ERR_INVALID_ARG;
+    *desc = &dev->desc;
+    return ESP_OK;
+}
+
+esp_err_t usb_host_get_active_config_descriptor(usb_device_handle_t handle, const usb_config_desc_t** desc) {
+    usb_device_s* dev = lookup(handle, "get_active_config_descriptor");
+    if (!dev) return ESP_ERR_INVALID_ARG;
+    *desc = (const usb_config_desc_t*)dev->config.data();
+    return ESP_OK;
+}
+
+esp_err_t usb_host_interface_claim(usb_host_client_handle_t, usb_device_handle_t handle, uint8_t number, uint8_t) {
+    usb_device_s* dev = lookup(handle, "interface_claim");
+    if (!dev) return ESP_ERR_INVALID_ARG;
+    if (!dev->attached) return ESP_ERR_INVALID_STATE;
+    if (dev->claimed & (1u << number)) {
+        bus.violation("同じインターフェースを2回クレームした");
+        return ESP_ERR_INVALID_STATE;
+    }
+    dev->claimed |= 1u << number;
+    return ESP_OK;
+}
+
+esp_err_t usb_host_interface_release(usb_host_client_handle_t, usb_device_handle_t handle, uint8_t number) {
+    usb_device_s* dev = lookup(handle, "interface_release");
+    if (!dev) return ESP_ERR_INVALID_ARG;
+    if (!(dev->claimed & (1u << number))) {
+        bus.violation("クレームしていないインターフェースを解放した");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!bus.pending(dev, 0x81).empty()) {
+        // 実機ではエンドポイントが送信中だと解放できない（テストのキーボードは0x81だけ）
+        bus.violation("送信中のエンドポイントのインターフェースを解放した");
+        return ESP_ERR_INVALID_STATE;
+    }
+    dev->claimed &= ~(1u << number);
+    return ESP_OK;
+}
+
+esp_err_t usb_host_endpoint_halt(usb_device_handle_t handle, uint8_t) {
+    return lookup(handle, "endpoint_halt") ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+// 送信中の転送をキャンセルして戻す（holdCompletionsの間は戻さない＝遅れて戻る）
+esp_err_t usb_host_endpoint_flush(usb_device_handle_t handle, uint8_t endpoint) {
+    usb_device_s* dev = lookup(handle, "endpoint_flush");
+    if (!dev) return ESP_ERR_INVALID_ARG;
+    if (!bus.holdCompletions) {
+        for (usb_transfer_t* t : bus.pending(dev, endpoint)) {
+            bus.complete(t, USB_TRANSFER_STATUS_CANCELED);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t usb_host_transfer_alloc(size_t size, int, usb_transfer_t** ret) {
+    usb_transfer_t* t = new usb_transfer_t();
+    t->data_buffer = new uint8_t[size]();
+    t->data_buffer_size = size;
+    bus.allocated.insert(t);
+    *ret = t;
+    return ESP_OK;
+}
+
+esp_err_t usb_host_transfer_free(usb_transfer_t* t) {
+    if (!bus.allocated.count(t)) {
+        bus.violation("確保していない転送を解放した");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (bus.inFlight.count(t)) {
+        bus.violation("送信中の転送を解放した");
+        return ESP_ERR_NOT_FINISHED;
+    }
+    bus.allocated.erase(t);
+    delete[] t->data_buffer;
+    delete t;
+    return ESP_OK;
+}
+
+static esp_err_t submit(usb_transfer_t* t, const char* caller) {
+    if (!bus.allocated.count(t)) {
+        bus.violation(std::string(caller) + ": 確保していない転送");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (bus.inFlight.count(t)) {
+        bus.violation(std::string(caller) + ": 送信中の転送をもう一度送った");
+        return ESP_ERR_NOT_FINISHED;
+    }
+    usb_device_s* dev = lookup(t->device_handle, caller);
+    if (!dev || !dev->attached) return ESP_ERR_INVALID_STATE;
+    bus.inFlight.insert(t);
+    return ESP_OK;
+}
+
+// 割り込み転送はデバイスがレポートを送るまで戻らない
+esp_err_t usb_host_transfer_submit(usb_transfer_t* t) {
+    esp_err_t err = submit(t, "transfer_submit");
+    if (err == ESP_OK) bus.submits[t->bEndpointAddress]++;
+    return err;
+}
+
+// コントロール転送はすぐ成功する（holdCompletionsの間は戻さない）
+// レポート記述子の読み出しはデバイスの記述子を返す（reportDescStallsの間はSTALL）
+esp_err_t usb_host_transfer_submit_control(usb_host_client_handle_t, usb_transfer_t* t) {
+    esp_err_t err = submit(t, "transfer_submit_control");
+    if (err != ESP_OK || bus.holdCompletions) return err;
+    const usb_setup_packet_t* setup = (const usb_setup_packet_t*)t->data_buffer;
+    if (setup->bRequest == 0x06 && (setup->wValue >> 8) == USB_HID_REPORT_DESC) {
+        bus.reportDescRequests++;
+        if (bus.reportDescStalls > 0) {
+            bus.reportDescStalls--;
+            bus.complete(t, USB_TRANSFER_STATUS_STALL);
+            return err;
+        }
+        usb_device_s* dev = (usb_device_s*)t->device_handle;
+        std::vector<uint8_t> data(t->data_buffer, t->data_buffer + USB_SETUP_PACKET_SIZE);
+        data.insert(data.end(), dev->reportDesc.begin(), dev->reportDesc.end());
+        bus.complete(t, USB_TRANSFER_STATUS_COMPLETED, data.data(), (int)data.size());
+        return err;
+    }
+    bus.complete(t, USB_TRANSFER_STATUS_COMPLETED, nullptr, t->num_bytes);
+    return err;
+}
+
+// 保存した解析結果（NVSの代わりにメモリへ）
+namespace UsbProfileCache {
+    static std::map<uint64_t, UsbDeviceProfile> store;
+    static uint64_t key(uint16_t vid, uint16_t pid, uint16_t bcd) { return ((uint64_t)vid << 32) | ((uint64_t)pid << 16) | bcd; }
+    bool load(uint16_t vid, uint16_t pid, uint16_t bcd, UsbDeviceProfile& profile) {
+        auto it = store.find(key(vid, pid, bcd));
+        if (it == store.end()) return false;
+        profile = it->second;
+        return true;
+    }
+    bool save(const UsbDeviceProfile& profile) {
+        store[key(profile.vendorId, profile.productId, profile.bcdDevice)] = profile;
+        return true;
+    }
+    void erase(uint16_t vid, uint16_t pid, uint16_t bcd) { store.erase(key(vid, pid, bcd)); }
+}
+
+// ---------------------------------------------------------------------------
+// テスト用のホストと操作
+// ---------------------------------------------------------------------------
+
+class ReplayHost final : public EspUsbHost {
+public:
+    int gone = 0;
+    int keys = 0;
+    int goneWithLiveDevice = 0;     // 閉じる前にonGoneが呼ばれた
+
+    void onGone(const UsbDeviceContext& dev) override {
+        gone++;
+        usb_device_s* d = (usb_device_s*)dev.handle;
+        if (d->open || !bus.pending(d).empty()) goneWithLiveDevice++;
+    }
+    void onKeyboardKey(uint8_t, uint8_t, uint8_t) override { keys++; }
+};
+
+static ReplayHost* host = nullptr;
+
+// 標準のブートキーボード（インターフェース0、割り込みIN 0x81、8バイト、10ms）
+static usb_device_s* plug(uint8_t address, uint16_t productId = 0x0001) {
+    usb_device_s* dev = new usb_device_s();
+    dev->address = address;
+    dev->desc.bLength = sizeof(usb_device_desc_t);
+    dev->desc.bDescriptorType = USB_DEVICE_DESC;
+    dev->desc.idVendor = 0x1234;
+    dev->desc.idProduct = productId;
+    dev->desc.bcdDevice = 0x0100;
+    dev->config = {
+        9, USB_CONFIGURATION_DESC, 34, 0, 1, 1, 0, 0xA0, 50,
+        9, USB_INTERFACE_DESC, 0, 0, 1, USB_CLASS_HID, HID_SUBCLASS_BOOT, HID_ITF_PROTOCOL_KEYBOARD, 0,
+        9, USB_HID_DESC, 0x11, 0x01, 0, 1, USB_HID_REPORT_DESC, 63, 0,
+        7, USB_ENDPOINT_DESC, 0x81, USB_BM_ATTRIBUTES_XFER_INT, 8, 0, 10,
+    };
+    bus.devices.push_back(dev);
+    usb_host_client_event_msg_t msg = {};
+    msg.event = USB_HOST_CLIENT_EVENT_NEW_DEV;
+    msg.new_dev.address = address;
+    bus.events.push_back(msg);
+    return dev;
+}
+
+// ブート以外のHIDインターフェースのゲームパッド（レポート記述子を読んでから決まる。X/Y 8ビットとボタン8つ）
+static usb_device_s* plugGamepad(uint8_t address) {
+    usb_device_s* dev = plug(address, 0x0100);
+    dev->reportDesc = {
+        0x05, 0x01, 0x09, 0x05, 0xA1, 0x01,         // Generic Desktop / Gamepad / Application
+        0x09, 0x30, 0x09, 0x31, 0x15, 0x81, 0x25, 0x7F, 0x75, 0x08, 0x95, 0x02, 0x81, 0x02,   // X, Y
+        0x05, 0x09, 0x19, 0x01, 0x29, 0x08, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02,   // ボタン1〜8
+        0xC0,
+    };
+    dev->config[15] = 0;                            // bInterfaceSubClass: ブートではない
+    dev->config[16] = 0;                            // bInterfaceProtocol
+    dev->config[25] = (uint8_t)dev->reportDesc.size();
+    return dev;
+}
+
+// キーボード（0x81、10ms）とマウス（0x82、1ms）の複合デバイス
+static usb_device_s* plugComposite(uint8_t address) {
+    usb_device_s* dev = plug(address, 0x0200);
+    dev->config[2] = 59;
+    dev->config[4] = 2;
+    const uint8_t mouse[] = {
+        9, USB_INTERFACE_DESC, 1, 0, 1, USB_CLASS_HID, HID_SUBCLASS_BOOT, HID_ITF_PROTOCOL_MOUSE, 0,
+        9, USB_HID_DESC, 0x11, 0x01, 0, 1, USB_HID_REPORT_DESC, 52, 0,
+        7, USB_ENDPOINT_DESC, 0x82, USB_BM_ATTRIBUTES_XFER_INT, 8, 0, 1,
+    };
+    dev->config.insert(dev->config.end(), mouse, mouse + sizeof(mouse));
+    return dev;
+}
+
+// 抜く（送信中の転送はそのまま。戻すのはhalt/flushか遅れて来る完了）
+static void unplug(usb_device_s* dev) {
+    dev->attached = false;
+    usb_host_client_event_msg_t msg = {};
+    msg.event = USB_HOST_CLIENT_EVENT_DEV_GONE;
+    msg.dev_gone.dev_hdl = (usb_device_handle_t)dev;
+    bus.events.push_back(msg);
+}
+
+// キーを押したレポートを送信中の割り込み転送へ返す
+static bool sendKey(usb_device_s* dev, uint8_t keycode) {
+    std::vector<usb_transfer_t*> pending = bus.pending(dev, 0x81);
+    if (pending.empty()) return false;
+    const uint8_t report[8] = { 0, 0, keycode, 0, 0, 0, 0, 0 };
+    bus.complete(pending[0], USB_TRANSFER_STATUS_COMPLETED, report, sizeof(report));
+    return true;
+}
+
+// 止めていた転送を全部戻す（抜けたデバイスの転送は遅れて戻る完了、挿さっている方のコントロール転送は成功）
+static void releaseHeld(usb_transfer_status_t goneStatus) {
+    bus.holdCompletions = false;
+    std::vector<usb_transfer_t*> all(bus.inFlight.begin(), bus.inFlight.end());
+    for (usb_transfer_t* t : all) {
+        usb_device_s* dev = (usb_device_s*)t->device_handle;
+        if (!dev->attached) {
+            const uint8_t report[8] = { 0, 0, 0x04, 0, 0, 0, 0, 0 };
+            bool data = goneStatus == USB_TRANSFER_STATUS_COMPLETED;
+            bus.complete(t, goneStatus, data ? report : nullptr, data ? (t->bEndpointAddress ? 8 : t->num_bytes) : 0);
+        } else if (t->bEndpointAddress == 0) {
+            bus.complete(t, USB_TRANSFER_STATUS_COMPLETED, nullptr, t->num_bytes);
+        }
+    }
+}
+
+// 仮想時計を1ms進めてtask()を1回
+static void step(int n = 1) {
+    for (int i = 0; i < n; i++) {
+        hostAdvanceUs(1000);
+        host->task();
+    }
+}
+
+// 条件を満たすまでtask()を回し、回数を返す（上限を超えたら-1）
+template <typename F>
+static int stepUntil(F done, int bound) {
+    for (int i = 1; i <= bound; i++) {
+        step();
+        if (done()) return i;
+    }
+    return -1;
+}
+
+static UsbDeviceContext* slotOf(uint8_t address) { return host->findDevice(address); }
+
+static int slotsInUse() {
+    int n = 0;
+    for (int i = 0; i < USB_HOST_MAX_DEVICES; i++) {
+        if (host->devices[i].inUse()) n++;
+    }
+    return n;
+}
+
+// ---------------------------------------------------------------------------
+// シナリオ
+// ---------------------------------------------------------------------------
+
+static int failures = 0;
+static int checks = 0;
+
+#define CHECK(cond) do { \
+    checks++; \
+    if (!(cond)) { failures++; fprintf(stderr, "  NG %s:%d: %s\n", __FILE__, __LINE__, #cond); } \
+} while (0)
+
+static void begin() {
+    bus.reset();
+    UsbProfileCache::store.clear();
+    delete host;
+    host = new ReplayHost();
+    host->begin();
+}
+
+// 挿して打って抜く：転送が戻ったら1〜2回のtask()で閉じ、onGoneは閉じてから
+static void scenarioPlugUnplug() {
+    begin();
+    usb_device_s* kb = plug(1);
+    CHECK(stepUntil([] { return slotOf(1) && slotOf(1)->state == USB_DEVICE_ACTIVE && !bus.pending(bus.devices[0], 0x81).empty(); },
+                    REPLAY_OPEN_BOUND) > 0);
+    CHECK(host->getLiveTransfers() == 2);      // 割り込み1つ + コントロール1つ
+    CHECK(sendKey(kb, 0x04));
+    step(20);
+    CHECK(host->keys == 1);
+
+    unplug(kb);
+    int n = stepUntil([] { return slotsInUse() == 0; }, REPLAY_CLOSE_BOUND + 1);
+    CHECK(n > 0 && n <= REPLAY_CLOSE_BOUND + 1);   // DEV_GONEを受けるtask()の分だけ1回多い
+    CHECK(host->getLiveTransfers() == 0);
+    CHECK(bus.allocated.empty());
+    CHECK(host->gone == 1);
+    CHECK(host->goneWithLiveDevice == 0);
+    CHECK(kb->closed && kb->claimed == 0);
+}
+
+// 遅れて戻る完了：DRAININGの間は解放せず、戻ってから決まった回数で閉じる。戻ったレポートは処理しない
+static void scenarioLateCompletions() {
+    begin();
+    bus.holdCompletions = true;
+    usb_device_s* kb = plug(1);
+    step(20);
+    // SET_IDLEが戻らないのでENUMERATINGのまま、割り込み転送も送信中
+    CHECK(slotOf(1) && slotOf(1)->state == USB_DEVICE_ENUMERATING);
+    CHECK(bus.pending(kb, 0x81).size() == 1);
+    CHECK(bus.pending(kb, 0x00).size() == 1);
+
+    unplug(kb);
+    step(3 * USB_HOST_DRAIN_TIMEOUT_MS);
+    UsbDeviceContext& dev = host->devices[0];
+    CHECK(dev.state == USB_DEVICE_DRAINING);
+    CHECK(host->getDrainTimeouts() >= 2);      // 待ちすぎたらhalt/flushをやり直すだけ
+    CHECK(host->getLiveTransfers() == 2);
+    CHECK(host->gone == 0);
+
+    // 割り込み転送がデータ付きで、コントロール転送が成功で遅れて戻る
+    releaseHeld(USB_TRANSFER_STATUS_COMPLETED);
+    int n = stepUntil([] { return slotsInUse() == 0; }, REPLAY_CLOSE_BOUND);
+    CHECK(n > 0 && n <= REPLAY_CLOSE_BOUND);
+    CHECK(host->keys == 0);
+    CHECK(host->getLiveTransfers() == 0);
+    CHECK(bus.allocated.empty());
+    CHECK(host->gone == 1);
+    CHECK(host->goneWithLiveDevice == 0);
+}
+
+// 全スロットがDRAININGの時のNEW_DEV：空いたスロットで開く（同じアドレスの挿し直しも）
+static void scenarioPendingOpens() {
+    begin();
+    bus.holdCompletions = true;
+    std::vector<usb_device_s*> kbs;
+    for (uint8_t a = 1; a <= USB_HOST_MAX_DEVICES; a++) kbs.push_back(plug(a));
+    step(20);
+    CHECK(slotsInUse() == USB_HOST_MAX_DEVICES);
+    for (usb_device_s* kb : kbs) unplug(kb);
+    step(5);
+    for (int i = 0; i < USB_HOST_MAX_DEVICES; i++) CHECK(host->devices[i].state == USB_DEVICE_DRAINING);
+
+    usb_device_s* fresh = plug(USB_HOST_MAX_DEVICES + 1);
+    usb_device_s* again = plug(1);             // 抜いたばかりのアドレスに別のデバイス
+    step(5);
+    CHECK(host->pendingOpenCount == 2);
+    CHECK(slotOf(USB_HOST_MAX_DEVICES + 1) == nullptr);
+    CHECK(slotOf(1) == nullptr);
+
+    releaseHeld(USB_TRANSFER_STATUS_CANCELED);
+    int n = stepUntil([] {
+        return slotOf(USB_HOST_MAX_DEVICES + 1) && slotOf(USB_HOST_MAX_DEVICES + 1)->state == USB_DEVICE_ACTIVE &&
+               slotOf(1) && slotOf(1)->state == USB_DEVICE_ACTIVE;
+    }, REPLAY_OPEN_BOUND);
+    CHECK(n > 0);
+    CHECK(host->gone == USB_HOST_MAX_DEVICES);
+    CHECK(host->goneWithLiveDevice == 0);
+    CHECK(host->pendingOpenCount == 0);
+    CHECK(slotsInUse() == 2);
+    for (usb_device_s* kb : kbs) CHECK(kb->closed);
+    // 新しい2台の分（割り込み + コントロール）だけが残る
+    CHECK(host->getLiveTransfers() == 4);
+
+    step(20);
+    CHECK(sendKey(fresh, 0x05));
+    CHECK(sendKey(again, 0x06));
+    step(20);
+    CHECK(host->keys == 2);
+
+    unplug(fresh);
+    unplug(again);
+    CHECK(stepUntil([] { return slotsInUse() == 0; }, REPLAY_CLOSE_BOUND + 1) > 0);
+    CHECK(host->getLiveTransfers() == 0);
+    CHECK(bus.allocated.empty());
+}
+
+// スロットが空く前に、待っていたデバイスが抜かれる。空いたスロットで古いアドレスを開かない
+static void scenarioPendingOpenGone() {
+    begin();
+    bus.holdCompletions = true;
+    std::vector<usb_device_s*> kbs;
+    for (uint8_t a = 1; a <= USB_HOST_MAX_DEVICES; a++) kbs.push_back(plug(a));
+    step(20);
+    for (usb_device_s* kb : kbs) unplug(kb);
+    step(5);
+
+    const uint8_t address = USB_HOST_MAX_DEVICES + 1;
+    usb_device_s* queued = plug(address);
+    step(5);
+    CHECK(host->pendingOpenCount == 1);
+    unplug(queued);
+    step(2);
+    CHECK(host->pendingOpenCount == 0);
+
+    releaseHeld(USB_TRANSFER_STATUS_CANCELED);
+    CHECK(stepUntil([] { return slotsInUse() == 0; }, REPLAY_CLOSE_BOUND + 1) > 0);
+    CHECK(slotOf(address) == nullptr);
+    CHECK(!queued->open && !queued->closed);
+
+    // 同じアドレスに挿し直せば普通に開く
+    usb_device_s* replug = plug(address);
+    CHECK(stepUntil([address] { return slotOf(address) && slotOf(address)->state == USB_DEVICE_ACTIVE; }, REPLAY_OPEN_BOUND) > 0);
+    unplug(replug);
+    CHECK(stepUntil([] { return slotsInUse() == 0; }, REPLAY_CLOSE_BOUND + 1) > 0);
+    CHECK(host->getLiveTransfers() == 0);
+    CHECK(bus.allocated.empty());
+}
+
+// 抜き差しを繰り返す（完了が遅れる時・すぐ戻る時・キーを打つ時を混ぜる）。最後に転送が残らない
+static void scenarioPlugCycles() {
+    begin();
+    uint32_t seed = 12345;
+    auto rnd = [&seed](uint32_t n) { seed = seed * 1103515245 + 12345; return (seed >> 16) % n; };
+    int worst = 0;
+    for (int cycle = 0; cycle < 200; cycle++) {
+        bool late = rnd(2);
+        bus.holdCompletions = late;
+        uint8_t address = 1 + rnd(8);
+        usb_device_s* kb = plug(address, 1 + rnd(2));
+        step(1 + rnd(30));
+        if (!late && rnd(2)) sendKey(kb, 0x04 + rnd(20));
+        step(rnd(5));
+        unplug(kb);
+        step(rnd(3 * USB_HOST_DRAIN_TIMEOUT_MS / 2));
+        if (late) releaseHeld(rnd(2) ? USB_TRANSFER_STATUS_COMPLETED : USB_TRANSFER_STATUS_NO_DEVICE);
+        int n = stepUntil([] { return slotsInUse() == 0; }, REPLAY_CLOSE_BOUND + 1);
+        CHECK(n > 0);
+        if (n > worst) worst = n;
+    }
+    CHECK(worst <= REPLAY_CLOSE_BOUND + 1);
+    CHECK(host->gone == 200);
+    CHECK(host->goneWithLiveDevice == 0);
+    CHECK(host->getLiveTransfers() == 0);
+    CHECK(bus.allocated.empty());
+}
+
+// レポート記述子の読み出しが一度失敗しても、標準キーボード扱いを保存しない。挿し直せばもう一度読んでゲームパッドになる
+static void scenarioReportDescFailure() {
+    begin();
+    auto active = [] { return slotOf(1) && slotOf(1)->state == USB_DEVICE_ACTIVE; };
+    auto decoder = [] { return slotOf(1)->endpoint_data_list[1].decoder; };
+
+    bus.reportDescStalls = 1;
+    usb_device_s* pad = plugGamepad(1);
+    CHECK(stepUntil(active, REPLAY_OPEN_BOUND) > 0);
+    CHECK(bus.reportDescRequests == 1);
+    CHECK(decoder() == USB_DECODER_KEYBOARD);
+    CHECK(UsbProfileCache::store.empty());
+    unplug(pad);
+    CHECK(stepUntil([] { return slotsInUse() == 0; }, REPLAY_CLOSE_BOUND + 1) > 0);
+
+    pad = plugGamepad(1);
+    CHECK(stepUntil(active, REPLAY_OPEN_BOUND) > 0);
+    CHECK(bus.reportDescRequests == 2);
+    CHECK(decoder() == USB_DECODER_GAMEPAD);
+    CHECK(!slotOf(1)->profileFromCache);
+    CHECK(UsbProfileCache::store.size() == 1);
+    unplug(pad);
+    CHECK(stepUntil([] { return slotsInUse() == 0; }, REPLAY_CLOSE_BOUND + 1) > 0);
+
+    // 読めた結果は保存済みなので、次からは読まずにゲームパッドで開く
+    pad = plugGamepad(1);
+    CHECK(stepUntil(active, REPLAY_OPEN_BOUND) > 0);
+    CHECK(bus.reportDescRequests == 2);
+    CHECK(slotOf(1)->profileFromCache);
+    CHECK(decoder() == USB_DECODER_GAMEPAD);
+    unplug(pad);
+    CHECK(stepUntil([] { return slotsInUse() == 0; }, REPLAY_CLOSE_BOUND + 1) > 0);
+    CHECK(host->getLiveTransfers() == 0);
+}
+
+// ポーリング間隔はエンドポイントごと（最後のエンドポイントのbIntervalで全部を出さない）
+static void scenarioEndpointIntervals() {
+    begin();
+    usb_device_s* dev = plugComposite(1);
+    CHECK(stepUntil([] { return slotOf(1) && slotOf(1)->state == USB_DEVICE_ACTIVE; }, REPLAY_OPEN_BOUND) > 0);
+    bus.submits.clear();
+    const uint8_t idle[8] = {};
+    const int ms = 200;
+    for (int i = 0; i < ms; i++) {
+        step();
+        // デバイスはすぐに変化の無いレポートを返す
+        for (usb_transfer_t* t : bus.pending(dev)) {
+            if (t->bEndpointAddress != 0) bus.complete(t, USB_TRANSFER_STATUS_COMPLETED, idle, sizeof(idle));
+        }
+    }
+    int keyboard = bus.submits[0x81];
+    int mouse = bus.submits[0x82];
+    CHECK(keyboard > 0 && keyboard <= ms / 10);
+    CHECK(mouse >= ms / 3);
+    unplug(dev);
+    CHECK(stepUntil([] { return slotsInUse() == 0; }, REPLAY_CLOSE_BOUND + 1) > 0);
+    CHECK(host->getLiveTransfers() == 0);
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) hostLogEnabled() = true;
+    }
+
+    struct { const char* name; void (*run)(); } scenarios[] = {
+        { "抜き差し", scenarioPlugUnplug },
+        { "遅れて戻る転送", scenarioLateCompletions },
+        { "DRAINING中の接続", scenarioPendingOpens },
+        { "待っている間に抜かれた接続", scenarioPendingOpenGone },
+        { "抜き差しの繰り返し", scenarioPlugCycles },
+        { "レポート記述子の読み出し失敗", scenarioReportDescFailure },
+        { "エンドポイントごとの間隔", scenarioEndpointIntervals },
+    };
+    for (auto& s : scenarios) {
+        int before = failures;
+        s.run();
+        size_t violations = bus.violations.size();
+        CHECK(violations == 0);
+        printf("%-24s %s (違反 %u)\n", s.name, failures == before ? "OK" : "NG", (unsigned)violations);
+    }
+    bus.reset();
+    delete host;
+    printf("%d / %d 件の確認に失敗\n", failures, checks);
+    return failures == 0 ? 0 : 1;
+}
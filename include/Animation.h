@@ -0,0 +1,61 @@
+#pragma once
+#include <Arduino.h>
+#include "DisplayRequest.h"
+
+// フレーム送出の下限間隔（ms）。どのアニメーションもこの予算を超えて描画しない
+#ifndef ANIMATION_FRAME_BUDGET_MS
+#define ANIMATION_FRAME_BUDGET_MS 20
+#endif
+
+// アニメーションの種類（描画方法の違い）
+enum AnimationKind : uint8_t {
+    ANIM_BITMAP_BOUNCE,   // ビットマップ全体を上下させる（pose × jumpHeight だけ上へ）
+    ANIM_HOP_TEXT,        // 1文字ずつホップ（pose = ホップする文字位置、-1で全て通常高さ）
+    ANIM_STARTUP          // 起動画面（HOP_TEXTと同じ + カウントダウン）
+};
+
+// キーフレーム1枚（フラッシュ上のテーブルとして定義する）
+struct Keyframe {
+    int8_t pose;          // 種類ごとの姿勢パラメータ
+    uint16_t durationMs;  // このフレームを表示しておく時間
+};
+
+// キーフレーム列。frames[0..count) をloops回繰り返し、最後にlastを表示して終わる
+struct AnimationClip {
+    AnimationKind kind;
+    const char* text;         // HOP_TEXT / STARTUP の表示文字列（フレームキャッシュのキーも兼ねる）
+    const Keyframe* frames;
+    uint8_t count;
+    uint8_t loops;
+    Keyframe last;
+};
+
+extern const AnimationClip CLIP_BITMAP_BOUNCE;  // 特別キーの顔アニメーション
+extern const AnimationClip CLIP_READY_HOP;      // アイドル時の"READY"
+extern const AnimationClip CLIP_STARTUP;        // 起動画面の"KOTACON"
+
+// キーフレーム再生器
+// tick()は期限が来たフレームを1枚描くだけで、内部で待つことはない。
+// 呼び出し側はmsUntilNextFrame()の間だけキュー待ちなどで眠り、新しい要求が来たらstop()で即中断する。
+class Animator {
+public:
+    // 再生開始（最初のフレームは次のtick()ですぐ描かれる）
+    void start(const DisplayRequest& req, uint32_t now);
+    void stop() { running = false; }
+    bool isActive() const { return running; }
+
+    // 次のフレームまでの残り時間（再生中でなければ0）
+    uint32_t msUntilNextFrame(uint32_t now) const;
+
+    // 期限が来ていれば1フレーム描いて次の期限を決める
+    void tick(uint32_t now);
+
+private:
+    DisplayRequest req;
+    const AnimationClip* clip = nullptr;
+    uint8_t index = 0;       // frames内の位置
+    uint8_t loop = 0;        // 何周目か
+    bool inLast = false;     // 最終フレームを表示中
+    bool running = false;
+    uint32_t nextFrameAt = 0;
+};
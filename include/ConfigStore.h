@@ -0,0 +1,121 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <Arduino.h>
+#include "KeyLayers.h"
+
+// 設定ファイル（LittleFS）。python/compile_config.py で作る
+#define CONFIG_FILE_PATH "/config.bin"
+#define CONFIG_BLOB_MAGIC 0x4643424B   // "KBCF"（リトルエンディアン）
+#define CONFIG_BLOB_VERSION 1
+// 受け付ける設定の大きさの上限（オフセットは16ビット）
+#define CONFIG_BLOB_MAX_SIZE 65535
+// シリアルで送られてくる設定を待つ時間（ms）
+#define CONFIG_UPLOAD_TIMEOUT_MS 3000
+// 文字列・索引で「無し」を表す値
+#define CONFIG_NONE 0xFFFF
+
+// 設定の形式（固定レイアウト・リトルエンディアン。オフセットは先頭から、各セクションは4バイト境界）
+// 読み込み時はCRCと範囲を確かめるだけで、この構造体をそのまま参照する（テキストの解析はしない）。
+// 文字列はstringsOffsetからのオフセットで、末尾は0。
+struct ConfigHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t totalSize;
+    uint32_t crc32;             // headerSizeから末尾まで
+    uint16_t repeatDelayMs;     // 長押し開始までの遅延（0なら既定値）
+    uint16_t repeatRateMs;      // リピート間隔（0なら既定値）
+    uint16_t namesOffset;       // ConfigKeyName[256]（CONFIG_NONEなら無し）
+    uint16_t keymapOffset;      // KeymapEntry[keymapCount]
+    uint16_t keymapCount;       // 0ならKB16_KEYMAPを使う
+    uint16_t textIndexOffset;   // uint8_t[256]: キーコード -> 表示の番号+1（0は無し）
+    uint16_t textOffset;        // ConfigDisplayText[textCount]
+    uint16_t textCount;
+    uint16_t stringsOffset;
+    uint16_t reserved;
+};
+
+// キーの名前（KEYCODE_MAPの上書き。CONFIG_NONEならKEYCODE_MAPのまま）
+struct ConfigKeyName {
+    uint16_t normal;
+    uint16_t shifted;
+};
+
+// キーごとの文字表示（特別表示テーブルの上書き）
+#define CONFIG_TEXT_SHIFT_INVARIANT 0x01
+struct ConfigDisplayText {
+    uint8_t keycode;
+    uint8_t flags;
+    uint16_t text1;
+    uint16_t text2;             // CONFIG_NONEならサブ表示無し
+};
+
+static_assert(sizeof(ConfigHeader) == 36, "ConfigHeader layout");
+static_assert(sizeof(ConfigKeyName) == 4, "ConfigKeyName layout");
+static_assert(sizeof(ConfigDisplayText) == 6, "ConfigDisplayText layout");
+static_assert(sizeof(KeymapEntry) == 4, "KeymapEntry layout");
+
+// 設定の読み込みと切り替え
+// ファイルを1回で読んで確かめた設定は「次の設定」として置いておき、キーが全部離れている時に
+// apply()でポインタを差し替える（キーの処理の途中で設定が変わらない）。
+// 他のタスク（表示・フィードバック）は値・文字列をロックの中でコピーして使い、設定の中を指すポインタは持たない。
+// 差し替えもロックの中なので、前の設定は差し替えたらすぐ解放できる。
+// シリアルのコマンド:
+//   config reload       LittleFSの設定を読み直す
+//   config upload <n>   続くnバイトを設定として受け取り、LittleFSに保存して読み込む
+//   config info         今の設定を表示
+class ConfigStore {
+public:
+    // LittleFSを開いて設定を読み、そのまま使い始める（setup()で一度だけ）
+    void begin();
+    // シリアルのコマンドを処理する（loop()から呼ぶ。待たない）
+    void pollSerial(Stream& stream);
+    // 次の設定があれば差し替える（キーが全部離れている時に呼ぶ）
+    bool hasPending() const { return pending != nullptr; }
+    void apply();
+
+    // 設定の値（設定が無い・値が無ければ既定値）
+    uint16_t getRepeatDelayMs(uint16_t fallback) const;
+    uint16_t getRepeatRateMs(uint16_t fallback) const;
+    // キーの名前をoutにコピーする（無ければfalse）
+    bool getKeyName(uint8_t keycode, bool shift, char* out, size_t outSize) const;
+    // キーの文字表示をtext1・text2にコピーする（無ければfalse。サブ表示が無ければtext2は空）
+    bool getDisplayText(uint8_t keycode, char* text1, size_t text1Size, char* text2, size_t text2Size, bool& shiftInvariant) const;
+    // 今の設定のキーマップをkeyLayersに入れる（設定に無ければKB16_KEYMAP）
+    void compileKeymap();
+
+    uint32_t getGeneration() const { return generation; }
+    uint32_t getRejected() const { return rejected; }
+
+private:
+    bool loadFile(const char* path);
+    // 確かめて次の設定にする（だめならfreeする）
+    bool stage(uint8_t* blob, size_t size);
+    static bool validate(const uint8_t* blob, size_t size);
+    void handleCommand(Stream& stream, const char* line);
+    void finishUpload(Stream& stream);
+    const char* string(const uint8_t* blob, uint16_t offset) const;
+    void printInfo(Stream& stream) const;
+
+    bool mounted = false;
+    // activeの差し替えと、他のタスクが読む間（コピーするだけ）を守る
+    mutable portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    uint8_t* volatile active = nullptr;
+    uint8_t* pending = nullptr;
+    uint32_t generation = 0;
+    uint32_t rejected = 0;
+
+    // シリアルのコマンド行・受信中の設定
+    char line[48];
+    uint8_t lineLength = 0;
+    uint8_t* upload = nullptr;
+    size_t uploadSize = 0;
+    size_t uploadReceived = 0;
+    uint32_t uploadStartMs = 0;
+};
+
+// グローバルインスタンス
+extern ConfigStore configStore;
+
+#endif // CONFIG_STORE_H
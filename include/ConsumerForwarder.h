@@ -0,0 +1,68 @@
+#ifndef CONSUMER_FORWARDER_H
+#define CONSUMER_FORWARDER_H
+
+#include <Arduino.h>
+#include <BleKeyboard.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// まとめて送る間隔（ms、BLEの接続間隔に合わせる）
+#ifndef CONSUMER_FLUSH_INTERVAL_MS
+#define CONSUMER_FLUSH_INTERVAL_MS 15
+#endif
+
+// 1回のまとめ送信で送るステップ数の上限（1ステップ = 押下+リリースの2通知）
+#ifndef CONSUMER_MAX_STEPS_PER_FLUSH
+#define CONSUMER_MAX_STEPS_PER_FLUSH 4
+#endif
+
+// 送信待ちにしておけるステップ数の上限（超えた分は捨てる。速く回しすぎた分を後から送り続けない）
+#ifndef CONSUMER_MAX_PENDING_STEPS
+#define CONSUMER_MAX_PENDING_STEPS 16
+#endif
+
+// BLEのメディアキーレポートのビット数（BleKeyboardのレポートマップの順）
+#define CONSUMER_USAGE_COUNT 16
+
+// コンシューマーコントロール（ノブの音量・曲送りなど）のBLE転送
+// USB側はstep()で押下1回分を積むだけで、送信は専用タスクが接続間隔ごとにまとめて行う。
+// 最初の1ステップはすぐ送り、間隔内に来た分は次の送信にまとめる。
+// 音量の上げ下げ・曲送りと曲戻しのような逆向きのステップは送る前に打ち消し合う。
+class ConsumerForwarder {
+public:
+    // 送信タスクを開始する
+    bool begin(BleKeyboard* keyboard, BaseType_t core);
+
+    // 押下1回分を積む（USBタスクから呼ぶ。転送できない使用法ならfalse）
+    bool step(uint16_t usage);
+
+    // 統計
+    uint32_t getReceived() const { return received; }
+    uint32_t getCancelled() const { return cancelled; }
+    uint32_t getDropped() const { return dropped; }
+    uint32_t getSentSteps() const { return sentSteps; }
+    uint32_t getFlushes() const { return flushes; }
+
+private:
+    static void consumerTask(void* pvParameters);
+    void run();
+    // 1回分を取り出して送る。何か送ったらtrue（次の間隔まで待ってもう一度呼ぶ）
+    bool flush();
+
+    BleKeyboard* keyboard = nullptr;
+    TaskHandle_t task = nullptr;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    uint8_t pending[CONSUMER_USAGE_COUNT] = {};
+    uint16_t pendingTotal = 0;
+
+    volatile uint32_t received = 0;
+    volatile uint32_t cancelled = 0;   // 逆向きのステップと打ち消し合った数
+    volatile uint32_t dropped = 0;     // 上限超え・BLE未接続で捨てた数
+    volatile uint32_t sentSteps = 0;
+    volatile uint32_t flushes = 0;
+};
+
+// グローバルインスタンス
+extern ConsumerForwarder consumerForwarder;
+
+#endif // CONSUMER_FORWARDER_H
@@ -0,0 +1,78 @@
+#ifndef DISPLAY_FLUSH_H
+#define DISPLAY_FLUSH_H
+
+#include <Arduino.h>
+#include <U8g2lib.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// ディスプレイ転送設定
+#define DISPLAY_FLUSH_FRAME_BYTES 1024      // 128x64 / 8（SSD1306 8ページ x 128列）
+#define DISPLAY_I2C_CLOCK         400000    // 標準のI2Cクロック（Fast-mode）
+#define DISPLAY_I2C_CLOCK_FMP     1000000   // Fast-mode Plus
+#define DISPLAY_FLUSH_VALIDATE_FRAMES 8     // FM+検証で連続成功させる転送回数
+#define DISPLAY_FLUSH_FALLBACK_RETRIES 3    // FM+検証に失敗した後、400kHzで送り直す回数
+#define DISPLAY_FLUSH_DATA_CHUNK  64        // 1回のWire転送で送るデータ（制御バイトと合わせてWireの128バイトに収める）
+
+// Fast-mode Plus(1MHz)を試すか（SSD1306の規格外なので検証に通った場合のみ使う）
+#ifndef DISPLAY_I2C_FAST_MODE_PLUS
+#define DISPLAY_I2C_FAST_MODE_PLUS 0
+#endif
+
+// SSD1306へのフレーム転送を専用タスクで行う非同期フラッシュ
+// submit()はU8G2バッファを書き込み用バッファへコピーして即座に戻るので、
+// displayTaskは前フレームの転送中に次のフレームを組み立てられる。
+// 転送中に複数回submitされた場合は最新のフレームだけを送る。
+// submit()はdisplayTaskだけが呼ぶ（書き込み用バッファの持ち主は1つ）。
+class DisplayFlush {
+public:
+    // 転送タスクを開始する（display.begin()の後に呼ぶ）
+    bool begin(uint8_t address, BaseType_t core);
+
+    // 現在のU8G2バッファを転送予約する（begin前はsendBuffer()で同期転送）
+    void submit(U8G2* display);
+
+    // 1MHzで転送を試し、全て成功すれば採用する。失敗したら400kHzへ戻して送り直し、false
+    bool enableFastModePlus();
+
+    // 転送時間の計測値（マイクロ秒）
+    uint32_t getLastFlushUs() const { return lastFlushUs; }
+    uint32_t getMaxFlushUs() const { return maxFlushUs; }
+    uint32_t getAvgFlushUs() const { return flushCount ? (uint32_t)(totalFlushUs / flushCount) : 0; }
+    uint32_t getFlushCount() const { return flushCount; }
+    uint32_t getErrorCount() const { return errorCount; }
+    uint32_t getSkippedFrames() const { return skippedFrames; }
+    uint32_t getBusClock() const { return busClock; }
+
+private:
+    static void flushTask(void* pvParameters);
+    bool transfer(const uint8_t* frame);   // 成功したらtrue
+
+    uint8_t address = 0x3C;
+    uint32_t busClock = DISPLAY_I2C_CLOCK;
+    TaskHandle_t taskHandle = nullptr;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    // トリプルバッファ：backはsubmit側、activeは転送タスク側が所有し、
+    // pendingは受け渡し用。ロック中はポインタの入れ替えだけを行う
+    uint8_t bufferA[DISPLAY_FLUSH_FRAME_BYTES];
+    uint8_t bufferB[DISPLAY_FLUSH_FRAME_BYTES];
+    uint8_t bufferC[DISPLAY_FLUSH_FRAME_BYTES];
+    uint8_t* back = bufferA;
+    uint8_t* pending = bufferB;
+    uint8_t* active = bufferC;
+    bool pendingValid = false;
+
+    // 計測値
+    volatile uint32_t lastFlushUs = 0;
+    volatile uint32_t maxFlushUs = 0;
+    uint64_t totalFlushUs = 0;
+    volatile uint32_t flushCount = 0;
+    volatile uint32_t errorCount = 0;
+    volatile uint32_t skippedFrames = 0;
+};
+
+// グローバルインスタンス
+extern DisplayFlush displayFlush;
+
+#endif // DISPLAY_FLUSH_H
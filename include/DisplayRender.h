@@ -0,0 +1,23 @@
+#pragma once
+#include "DisplayRequest.h"
+#include "SystemStatus.h"
+
+// ステータスバーの上端（最下行、6x10フォントで1行）
+#define STATUS_BAR_TOP 54
+
+// 画面ごとの描画処理（U8G2のバッファに描くだけで、送出は呼び出し側が行う）
+// FreeRTOSなどに依存しないので、ホスト側の描画ツール（host/）からもそのままビルドできる
+
+void drawNormalScreen(const DisplayRequest& req);   // 通常表示（押下キー＋下部情報）
+void drawTextScreen(const DisplayRequest& req);     // 特別キーの文字表示
+void drawDeviceScreen(const DisplayRequest& req);   // USBデバイス接続画面
+void drawGoneScreen(const DisplayRequest& req);     // USBデバイス切断画面
+
+// ステータスバーを描く（NORMAL/DEVICE/READYの画面で使う）
+void drawStatusBar(U8G2* display, const StatusSnapshot& st);
+
+// ホップアニメーションの1フレーム（hopIdxが範囲外なら全文字通常高さ）
+void renderHopFrame(U8G2* display, const char* text, const uint8_t* font, int hopHeight, int hopIdx);
+
+// 画面中央にテキストを表示する
+void drawCenteredText(U8G2* display, const char* text, const uint8_t* font);
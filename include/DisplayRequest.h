@@ -0,0 +1,44 @@
+#pragma once
+#include <U8g2lib.h>
+#include <Arduino.h>
+#include "RleBitmap.h"
+
+// 表示要求の定義（描画コードとホスト側の描画ツールから共通で使うため分離）
+
+struct AnimationClip;
+
+// 画面表示タイプ
+enum DisplayType {
+    DISPLAY_NORMAL,
+    DISPLAY_ANIMATION,
+    DISPLAY_TEXT,
+    DISPLAY_DEVICE,   // USBデバイス接続画面（text1 = デバイス種別）
+    DISPLAY_GONE      // USBデバイス切断画面
+};
+
+// 表示文字列の最大長（終端含む）
+#define DISPLAY_TEXT_MAX 32
+
+// 画面表示要求構造体
+// キューへはmemcpyで渡されるため、Stringを持たない固定長の構造体にする
+struct DisplayRequest {
+    DisplayType type = DISPLAY_NORMAL;
+    U8G2* display = nullptr;
+    char text1[DISPLAY_TEXT_MAX] = {0}; // メイン表示
+    char text2[DISPLAY_TEXT_MAX] = {0}; // サブ表示（例：バイトキー名）
+    const unsigned char* bitmap = nullptr;  // XBM（bmp_w x bmp_h）
+    const RleBitmap* rle = nullptr;         // 圧縮済み128x64（設定時はbitmapより優先）
+    int bmp_w = 0;
+    int bmp_h = 0;
+    int jumpHeight = 0;
+    const AnimationClip* clip = nullptr;    // DISPLAY_ANIMATIONで再生するキーフレーム列
+    const uint8_t* font = nullptr;
+    // 事前計算済みの描画位置（hasLayoutがtrueの場合のみ有効）
+    bool hasLayout = false;
+    int16_t x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+    // 要求の通し番号（requestDisplay()が付ける。表示タスクが上書きされた要求を数えるのに使う）
+    uint32_t seq = 0;
+
+    void setText1(const char* s) { strlcpy(text1, s ? s : "", sizeof(text1)); }
+    void setText2(const char* s) { strlcpy(text2, s ? s : "", sizeof(text2)); }
+};
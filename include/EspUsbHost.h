@@ -5,6 +5,7 @@
 #include <usb/usb_host.h>
 #include <class/hid/hid.h>
 #include <rom/usb/usb_common.h>
+#include "HidReportDescriptor.h"
 
 // USB記述子タイプ定義
 #define USB_DEVICE_DESC         0x01
@@ -14,6 +15,7 @@
 #define USB_ENDPOINT_DESC       0x05
 #define USB_INTERFACE_ASSOC_DESC 0x0B
 #define USB_HID_DESC            0x21
+#define USB_HID_REPORT_DESC     0x22
 
 // USB クラス定義
 #define USB_CLASS_HID           0x03
@@ -36,76 +38,315 @@
 // HID キーコード定義
 #define HID_KEY_NUM_LOCK        0x53
 
+// 同時に扱うUSBデバイス数（ハブ経由）と、1台あたりのインターフェース・転送数
+#define USB_HOST_MAX_DEVICES        4
+#define USB_HOST_MAX_INTERFACES     4
+#define USB_HOST_MAX_TRANSFERS      4
+#define USB_HOST_MAX_ADDRESS        128   // USBアドレスは1〜127
+#define USB_HOST_REPORT_MAX         64    // 保存する前回レポートの最大長（フルスピードのMaxPacket）
+#define USB_HOST_MAX_ENDPOINTS      17    // エンドポイント番号0〜16
+#define USB_HOST_MAX_REPORT_ID      16    // 振り分け表で扱うレポートIDの上限（0〜15）
+#define USB_HOST_CONTROL_MAX        512   // コントロール転送で受け取る最大長（レポート記述子）
+#define USB_HOST_CONTROL_QUEUE      12    // 1台あたりの送信待ちコントロール要求の数
+#define USB_HOST_CONTROL_DATA_MAX   8     // ホスト→デバイスの要求に付けるデータの最大長
+
+// 接続時にSET_IDLE(0)を送る（0にすると送らない。送らない時と送った時のレポート数を比べる用）
+#ifndef USB_HOST_SET_IDLE
+#define USB_HOST_SET_IDLE           1
+#endif
+
+// 接続時の解析結果（インターフェース・エンドポイント・デコード方法）をVID/PID/bcdDeviceごとにNVSへ保存し、
+// 2回目以降はコンフィグ記述子の走査とレポート記述子の読み出しを省く（0で無効）
+#ifndef USB_HOST_PROFILE_CACHE
+#define USB_HOST_PROFILE_CACHE      1
+#endif
+
+// 外れたデバイスの転送が戻るのを待つ時間（ms）。過ぎたらhalt/flushをやり直して待ち続ける
+#ifndef USB_HOST_DRAIN_TIMEOUT_MS
+#define USB_HOST_DRAIN_TIMEOUT_MS   100
+#endif
+// スロットが空くのを待つ接続（NEW_DEV）の数
+#define USB_HOST_PENDING_OPENS      4
+
+// HIDクラス要求（HID 1.11 7.2）
+#define HID_REQ_SET_REPORT          0x09
+#define HID_REQ_SET_IDLE            0x0A
+#define HID_REQ_SET_PROTOCOL        0x0B
+#define HID_REPORT_TYPE_OUTPUT      0x02
+#define HID_PROTOCOL_BOOT           0
+#define HID_PROTOCOL_REPORT         1
+
+// レポートの振り分け先（1つのレポートはどれか1つのデコーダだけが処理する）
+enum UsbReportDecoder : uint8_t {
+  USB_DECODER_NONE = 0,     // 処理しない（onReceiveへ生データのまま渡す）
+  USB_DECODER_KEYBOARD,     // ブートキーボード形式 [修飾, 予約, キー x6]
+  USB_DECODER_NKRO,         // DOIO KB16のNKRO形式 [ID, 修飾, ビットマップ...]（先頭も含めて渡す）
+  USB_DECODER_CONSUMER,     // コンシューマーコントロール [使用法(16bit LE)]
+  USB_DECODER_MOUSE,        // ブートマウス形式 [ボタン, X, Y, ホイール]
+  USB_DECODER_GAMEPAD       // レポート記述子から読んだゲームパッド（gamepadLayoutでデコード）
+};
+
+// QMK系ファーム（DOIO KB16）の共有エンドポイントのレポートID
+#define QMK_REPORT_ID_KEYBOARD  1
+#define QMK_REPORT_ID_MOUSE     2
+#define QMK_REPORT_ID_SYSTEM    3
+#define QMK_REPORT_ID_CONSUMER  4
+#define QMK_REPORT_ID_NKRO      6
+
+class EspUsbHost;
+
+// デバイスの状態遷移
+//   CLOSED → ENUMERATING（NEW_DEVで開く。コントロール要求を送っている間）→ ACTIVE
+//   ENUMERATING/ACTIVE → DRAINING（DEV_GONE。halt/flushして転送が戻るのを待つ）→ CLOSED（転送を解放して閉じる）
+// 転送の解放・インターフェースの解放・onGoneはDRAININGが終わってからtask()で行う。
+enum UsbDeviceState : uint8_t {
+  USB_DEVICE_CLOSED = 0,
+  USB_DEVICE_ENUMERATING,
+  USB_DEVICE_ACTIVE,
+  USB_DEVICE_DRAINING
+};
+
+// 入力エンドポイント1つ分の情報（onConfigで記録し、受信時にエンドポイント番号で直接引く）
+struct endpoint_data_t {
+  uint8_t bInterfaceNumber;
+  uint8_t bInterfaceClass;
+  uint8_t bInterfaceSubClass;
+  uint8_t bInterfaceProtocol;
+  uint8_t bCountryCode;
+  uint8_t transferIndex;            // transfers[]での位置（前回レポート・振り分け表の添字）
+  bool hasReportId;                 // レポートの先頭バイトがレポートID
+  UsbReportDecoder decoder;         // レポートIDが無い場合の振り分け先
+  uint8_t interval;                 // ポーリング間隔（ms、このエンドポイントのbInterval）
+};
+
+// クレームしたHIDインターフェース（レポート記述子はブート以外のものだけ読む）
+struct UsbHidInterface {
+  uint8_t number;
+  uint8_t protocol;
+  uint8_t endpoint;                 // 入力エンドポイントのアドレス（0なら無し）
+  uint16_t reportDescLength;        // HID記述子にあるレポート記述子の長さ
+};
+
+// 保存する解析結果のバージョン（デコード方法や構造体を変えたら上げる。違えば読み捨てる）
+#define USB_PROFILE_VERSION 2
+
+// 入力エンドポイント1つ分の解析結果（transfers[]の順）
+struct UsbEndpointProfile {
+  uint8_t address;
+  uint16_t maxPacket;
+  endpoint_data_t data;
+};
+
+// デバイス1種類分の解析結果（NVSにそのまま保存する）
+// キー配置の読み替え（KB16のNKRO・16バイト形式）はVID/PIDで決まるので持たない
+struct UsbDeviceProfile {
+  uint16_t version;
+  uint16_t vendorId;
+  uint16_t productId;
+  uint16_t bcdDevice;
+  uint16_t configTotalLength;       // コンフィグ記述子の長さ（ファームが変わっていないかの確認用）
+  uint8_t interfaceCount;
+  UsbHidInterface interfaces[USB_HOST_MAX_INTERFACES];
+  uint8_t endpointCount;
+  UsbEndpointProfile endpoints[USB_HOST_MAX_TRANSFERS];
+  UsbReportDecoder reportRoutes[USB_HOST_MAX_TRANSFERS][USB_HOST_MAX_REPORT_ID];
+  HidGamepadLayout gamepadLayout[USB_HOST_MAX_TRANSFERS];
+};
+
+// コントロール要求の種類（完了時の処理を決める）
+enum UsbControlKind : uint8_t {
+  USB_CONTROL_GET_REPORT_DESC = 0,  // レポート記述子を読む（読めたらonReportDescriptor）
+  USB_CONTROL_SET_IDLE,             // 変化が無い間はレポートを送らせない
+  USB_CONTROL_SET_PROTOCOL,         // ブート/レポートプロトコルを決める
+  USB_CONTROL_SET_REPORT            // 出力レポート（キーボードのLED）
+};
+
+// 送信待ちのコントロール要求1件
+struct UsbControlRequest {
+  UsbControlKind kind;
+  uint8_t interfaceIndex;           // interfaces[]での位置
+  usb_setup_packet_t setup;
+  uint8_t data[USB_HOST_CONTROL_DATA_MAX];   // ホスト→デバイスのデータ（wLengthバイト）
+};
+
+// 接続中のUSBデバイス1台分の状態
+// ハンドル・転送・インターフェース・デコード方法・前回レポートをデバイスごとに持ち、
+// 転送のcontextにこの構造体を入れるので、受信コールバックは探索せずに自分のデバイスへ届く。
+struct UsbDeviceContext {
+  EspUsbHost *host = nullptr;
+  uint8_t slot = 0;                 // devices[]での位置（継承クラスがデバイスごとの状態を持つ時の添字）
+  UsbDeviceState state = USB_DEVICE_CLOSED;
+  bool isReady = false;             // 入力エンドポイントの転送が用意できた
+  uint8_t address = 0;
+  usb_device_handle_t handle = nullptr;
+  uint16_t vendorId = 0;
+  uint16_t productId = 0;
+  uint16_t bcdDevice = 0;
+  uint16_t configTotalLength = 0;
+
+  // 接続から最初のレポートまでの計測と、解析結果の保存状況
+  int64_t openedUs = 0;             // NEW_DEVを受けた時刻
+  bool firstReportSeen = false;
+  bool profileFromCache = false;    // 保存済みの解析結果で開いた
+  bool profilePending = false;      // 解析が終わったら保存する
+
+  usb_transfer_t *transfers[USB_HOST_MAX_TRANSFERS] = {};
+  uint8_t transferCount = 0;
+  uint8_t inFlight = 0;             // 送信中の転送（transfers[]の添字のビット）。戻るまで解放しない
+  unsigned long drainStart = 0;     // DRAININGに入った時刻（ms）
+  UsbHidInterface interfaces[USB_HOST_MAX_INTERFACES] = {};
+  uint8_t interfaceCount = 0;
+  unsigned long lastCheck[USB_HOST_MAX_TRANSFERS] = {};   // 転送ごとに最後に送った時刻（ms。間隔はendpoint_data_t::interval）
+
+  // コンフィグ記述子の解析中の状態（直前のインターフェース記述子）
+  uint8_t curInterfaceNumber = 0;
+  uint8_t curInterfaceClass = 0;
+  uint8_t curInterfaceSubClass = 0;
+  uint8_t curInterfaceProtocol = 0;
+  uint8_t curCountryCode = 0;
+  esp_err_t claimErr = ESP_FAIL;
+
+  // エンドポイント番号ごとの情報とデコード方法（使っていないエンドポイントはdecoder=NONE・hasReportId=false）
+  endpoint_data_t endpoint_data_list[USB_HOST_MAX_ENDPOINTS] = {};
+  // レポートID付きエンドポイントの振り分け表（transferIndex x レポートID）
+  UsbReportDecoder reportRoutes[USB_HOST_MAX_TRANSFERS][USB_HOST_MAX_REPORT_ID] = {};
+
+  // キーボード系デコーダの前回レポート（変化した時だけ処理する。エンドポイントごと）
+  uint8_t lastReport[USB_HOST_MAX_TRANSFERS][USB_HOST_REPORT_MAX] = {};
+  uint8_t lastReportLength[USB_HOST_MAX_TRANSFERS] = {};
+  uint8_t lastMouseButtons = 0;
+
+  // コントロール転送（1台につき同時に1つだけ。残りは待ち行列で順に送る）
+  usb_transfer_t *ctrlTransfer = nullptr;
+  bool ctrlBusy = false;
+  UsbControlRequest ctrlQueue[USB_HOST_CONTROL_QUEUE] = {};
+  uint8_t ctrlHead = 0;
+  uint8_t ctrlCount = 0;
+  // ゲームパッドのレイアウト（エンドポイントごと）
+  HidGamepadLayout gamepadLayout[USB_HOST_MAX_TRANSFERS] = {};
+
+  // スロットを使っている（DRAININGも含む）
+  bool inUse() const { return state != USB_DEVICE_CLOSED; }
+  // レポートを受け付ける
+  bool isOpen() const { return state == USB_DEVICE_ENUMERATING || state == USB_DEVICE_ACTIVE; }
+  bool isKB16() const { return vendorId == 0xD010 && productId == 0x1601; }
+};
+
 class EspUsbHost {
 public:
-  bool isReady = false;
-  uint8_t interval;
-  unsigned long lastCheck;
-
-  struct endpoint_data_t {
-    uint8_t bInterfaceNumber;
-    uint8_t bInterfaceClass;
-    uint8_t bInterfaceSubClass;
-    uint8_t bInterfaceProtocol;
-    uint8_t bCountryCode;    
-  };
-  endpoint_data_t endpoint_data_list[17];
-  uint8_t _bInterfaceNumber;
-  uint8_t _bInterfaceClass;
-  uint8_t _bInterfaceSubClass;
-  uint8_t _bInterfaceProtocol;
-  uint8_t _bCountryCode;
-  esp_err_t claim_err;
-  
-  // デバイス識別用
-  uint16_t device_vendor_id;
-  uint16_t device_product_id;
-  
   // DOIO KB16用キーマトリックスの状態管理
   bool kb16_key_states[4][4];   // 4x4マトリックス
 
   usb_host_client_handle_t clientHandle;
-  usb_device_handle_t deviceHandle;
   uint32_t eventFlags;
-  usb_transfer_t *usbTransfer[16];
-  uint8_t usbTransferSize;
-  uint8_t usbInterface[16];
-  uint8_t usbInterfaceSize;
+
+  // デバイスごとの状態（アドレスからslot+1を引く表。0は未接続）
+  UsbDeviceContext devices[USB_HOST_MAX_DEVICES];
+  uint8_t slotByAddress[USB_HOST_MAX_ADDRESS];
 
   hid_local_enum_t hidLocal;
 
+  // キーボードのLED状態（接続時にSET_REPORTで送る）
+  uint8_t keyboardLeds = 0;
+
+  // レポート数の集計（USBタスクだけが書く）
+  uint32_t reportCount = 0;
+  uint32_t unchangedCount = 0;
+  uint32_t reportsPerSecond = 0;
+  uint32_t unchangedPerSecond = 0;
+  unsigned long reportWindowStart = 0;
+
+  uint32_t lastEnumerationUs = 0;
+  bool lastEnumerationCached = false;
+
+  // スロットが空くのを待っている接続のアドレス（全スロットがDRAININGの時）
+  uint8_t pendingOpens[USB_HOST_PENDING_OPENS] = {};
+  uint8_t pendingOpenCount = 0;
+  // 抜き差しの統計（USBタスクだけが書く）
+  uint32_t drainTimeouts = 0;
+  int32_t liveTransfers = 0;        // 確保して未解放の転送（全デバイスが閉じていれば0）
+
   void begin(void);
   void task(void);
 
+  // アドレスからデバイスを引く（未接続ならnullptr）
+  UsbDeviceContext *findDevice(uint8_t address);
+  uint8_t getDeviceCount() const;
+
   static void _clientEventCallback(const usb_host_client_event_msg_t *eventMsg, void *arg);
-  void _configCallback(const usb_config_desc_t *config_desc);
-  void onConfig(const uint8_t bDescriptorType, const uint8_t *p);
+  // 開けたらtrue（スロットが無ければ待ちに入れてfalse）
+  bool _openDevice(uint8_t address);
+  void _forgetPendingOpen(uint8_t address);
+  // DEV_GONE: 転送を止めてDRAININGにする（解放はしない）
+  void _drainDevice(usb_device_handle_t handle);
+  // DRAININGの転送が全部戻っていれば、解放して閉じる（task()から呼ぶ）
+  bool _closeDevice(UsbDeviceContext &dev);
+  void _haltTransfers(UsbDeviceContext &dev);
+  void _freeTransfers(UsbDeviceContext &dev);
+  void _configCallback(UsbDeviceContext &dev, const usb_config_desc_t *config_desc);
+  void onConfig(UsbDeviceContext &dev, const uint8_t bDescriptorType, const uint8_t *p);
   static String getUsbDescString(const usb_str_desc_t *str_desc);
   static void _onReceive(usb_transfer_t *transfer);
+  void _dispatchReport(UsbDeviceContext &dev, const endpoint_data_t &ep, UsbReportDecoder decoder, const uint8_t *data, int length);
+
+  // レポートIDの振り分け先を設定する（レポートID付きのエンドポイントになる）
+  void setReportRoute(UsbDeviceContext &dev, uint8_t bEndpointAddress, uint8_t reportId, UsbReportDecoder decoder);
 
   static void _printPcapText(const char* title, uint16_t function, uint8_t direction, uint8_t endpoint, uint8_t type, uint8_t size, uint8_t stage, const uint8_t *data);
-  esp_err_t submitControl(const uint8_t bmRequestType, const uint8_t bDescriptorIndex, const uint8_t bDescriptorType, const uint16_t wInterfaceNumber, const uint16_t wDescriptorLength);
+  // コントロール要求を待ち行列に積む（非同期。完了は_onReceiveControlから種類ごとに処理する）
+  esp_err_t submitControl(UsbDeviceContext &dev, const UsbControlRequest &request);
+  void _startNextControl(UsbDeviceContext &dev);
   static void _onReceiveControl(usb_transfer_t *transfer);
+  // 接続時のHIDクラス要求（SET_IDLE・SET_PROTOCOL・LEDのSET_REPORT）とレポート記述子の読み出しを積む
+  // （保存済みの解析結果で開いた時はレポート記述子は読まない）
+  void _configureInterfaces(UsbDeviceContext &dev);
+  // 保存済みの解析結果でインターフェースのクレームと転送の用意をする（失敗したらfalse）
+  bool _applyProfile(UsbDeviceContext &dev, const UsbDeviceProfile &profile);
+  // コントロール要求が全部終わったらACTIVEにし、解析結果を保存する
+  void _finishEnumeration(UsbDeviceContext &dev);
+  // 受信用の転送を1つ用意する
+  bool _addTransfer(UsbDeviceContext &dev, uint8_t bEndpointAddress, uint16_t maxPacket, uint8_t bInterval);
+  // 接続中のキーボードのLED（NumLock=0x01, CapsLock=0x02, ScrollLock=0x04）を設定する（USBタスクから呼ぶ）
+  void setKeyboardLeds(uint8_t leds);
+  uint8_t getKeyboardLeds() const { return keyboardLeds; }
+
+  // デコーダに届いたレポート数（1秒ごとに集計）と、前回と同じで捨てたレポート数
+  uint32_t getReportsPerSecond() const { return reportsPerSecond; }
+  uint32_t getUnchangedPerSecond() const { return unchangedPerSecond; }
+
+  // 直近の接続で最初のレポートが届くまでの時間（us）と、保存済みの解析結果を使ったか
+  uint32_t getLastEnumerationUs() const { return lastEnumerationUs; }
+  bool wasLastEnumerationCached() const { return lastEnumerationCached; }
+
+  // DRAININGの待ち時間を超えた回数と、確保して未解放の転送の数（抜き差しでのリーク確認用）
+  uint32_t getDrainTimeouts() const { return drainTimeouts; }
+  int32_t getLiveTransfers() const { return liveTransfers; }
   
-  virtual void onReceive(const usb_transfer_t *transfer){};
-  virtual void onGone(const usb_host_client_event_msg_t *eventMsg){};
-  virtual void onNewDevice(const usb_device_info_t &dev_info){};
+  // どのデコーダにも振り分けられなかったレポート（生データ）
+  virtual void onReceive(const UsbDeviceContext &dev, const usb_transfer_t *transfer){};
+  // 外れたデバイスの転送を解放し終えてから、task()から呼ばれる
+  virtual void onGone(const UsbDeviceContext &dev){};
+  virtual void onNewDevice(const UsbDeviceContext &dev, const usb_device_info_t &dev_info){};
   
   // DOIO KB16用メソッド
   void updateKB16KeyState(uint8_t row, uint8_t col, bool pressed);
   bool getKB16KeyState(uint8_t row, uint8_t col);
   virtual void onKB16KeyStateChanged(uint8_t row, uint8_t col, bool pressed){};
-  virtual void processRawReport16Bytes(const uint8_t* data);
+  virtual void onNkroReport(const UsbDeviceContext &dev, const uint8_t* data, int length);
+  virtual void onConsumer(const UsbDeviceContext &dev, uint16_t usage){};
+  // レポート記述子を読めた時（既定の実装はゲームパッドを探してデコーダを切り替える）
+  virtual void onReportDescriptor(UsbDeviceContext &dev, const UsbHidInterface &intf, const uint8_t *desc, int length);
+  virtual void onGamepad(const UsbDeviceContext &dev, const GamepadState &state){};
 
   virtual uint8_t getKeycodeToAscii(uint8_t keycode, uint8_t shift);
-  virtual void onKeyboard(hid_keyboard_report_t report, hid_keyboard_report_t last_report);
+  virtual void onKeyboard(const UsbDeviceContext &dev, hid_keyboard_report_t report, hid_keyboard_report_t last_report);
   virtual void onKeyboardKey(uint8_t ascii, uint8_t keycode, uint8_t modifier);
 
   virtual void onMouse(hid_mouse_report_t report, uint8_t last_buttons);
   virtual void onMouseButtons(hid_mouse_report_t report, uint8_t last_buttons);
   virtual void onMouseMove(hid_mouse_report_t report);
 
-  void _onDataGamepad();
+  void _onDataGamepad(UsbDeviceContext &dev, const endpoint_data_t &ep, const uint8_t *data, int length);
   void setHIDLocal(hid_local_enum_t code);
 
   static uint8_t getItem(uint8_t val){
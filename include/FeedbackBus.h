@@ -0,0 +1,107 @@
+#ifndef FEEDBACK_BUS_H
+#define FEEDBACK_BUS_H
+
+#include <Arduino.h>
+#include <U8g2lib.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "DisplayRequest.h"
+
+// フィードバックイベントのキュー長（あふれたイベントは捨てて数える）
+#define FEEDBACK_QUEUE_LENGTH 16
+
+// チャンネルごとの最小間隔（ms、0で制限なし）
+#ifndef FEEDBACK_LED_MIN_INTERVAL_MS
+#define FEEDBACK_LED_MIN_INTERVAL_MS 0
+#endif
+#ifndef FEEDBACK_SOUND_MIN_INTERVAL_MS
+#define FEEDBACK_SOUND_MIN_INTERVAL_MS 0
+#endif
+#ifndef FEEDBACK_DISPLAY_MIN_INTERVAL_MS
+#define FEEDBACK_DISPLAY_MIN_INTERVAL_MS 0
+#endif
+
+// フィードバックの出力先
+enum FeedbackChannel : uint8_t {
+    FEEDBACK_LED = 0,
+    FEEDBACK_SOUND,
+    FEEDBACK_DISPLAY,
+    FEEDBACK_CHANNEL_COUNT
+};
+
+// イベントの内容（ビットの組み合わせ）
+#define FEEDBACK_KEY_PRESS    0x01  // 新しいキー押下（LED点灯・キー音）
+#define FEEDBACK_KEY_REPEAT   0x02  // 長押しリピート（キー音）
+#define FEEDBACK_KEYS_CHANGED 0x04  // 押下状態の変化（画面更新）
+
+// キーの変化1回分のフィードバック
+struct FeedbackEvent {
+    uint8_t flags = 0;
+    uint8_t keycode = 0;                    // 単独押下時のキーコード（複数押下・リリースは0）
+    bool shift = false;
+    char characters[DISPLAY_TEXT_MAX] = ""; // 文字表現（"None"ならリリース）
+    char keyNames[DISPLAY_TEXT_MAX] = "";   // キーコード表記
+
+    void setCharacters(const char* s) { strlcpy(characters, s ? s : "", sizeof(characters)); }
+    void setKeyNames(const char* s) { strlcpy(keyNames, s ? s : "", sizeof(keyNames)); }
+};
+
+// キー入力のフィードバック（LED・ブザー・画面）をまとめて受け持つイベントバス
+// USB→BLEの経路はpublish()でイベントを1件キューに積むだけで、出力は低優先度の専用タスクが行う。
+// チャンネルごとに有効・無効と最小間隔を設定できる。
+// 画面は間隔内に来たイベントを最新の1件にまとめ、間隔が明けた時点で描く（途中の状態は飛ばす）。
+class FeedbackBus {
+public:
+    // 処理タスクを開始する（表示キュー作成後に呼ぶ）
+    bool begin(U8G2* display, BaseType_t core);
+
+    // イベントを積む（待たない。キューが満杯なら捨ててfalse）
+    bool publish(const FeedbackEvent& event);
+
+    // チャンネル設定（どのタスクから呼んでもよい）
+    void setChannelEnabled(FeedbackChannel channel, bool enabled);
+    void setChannelMinInterval(FeedbackChannel channel, uint16_t intervalMs);
+    bool isChannelEnabled(FeedbackChannel channel) const { return channels[channel].enabled; }
+
+    // 統計
+    uint32_t getPublished() const { return published; }
+    uint32_t getDropped() const { return dropped; }
+    uint32_t getSuppressed(FeedbackChannel channel) const { return channels[channel].suppressed; }
+
+private:
+    struct ChannelState {
+        volatile bool enabled = true;
+        volatile uint16_t minIntervalMs = 0;
+        uint32_t lastOutputMs = 0;
+        bool hasOutput = false;
+        volatile uint32_t suppressed = 0;   // 無効・間隔制限で出さなかった数
+    };
+
+    static void feedbackTask(void* pvParameters);
+    void run();
+    void dispatch(const FeedbackEvent& event, uint32_t now);
+    bool admit(FeedbackChannel channel, uint32_t now);
+    uint32_t msUntilDisplayDue(uint32_t now) const;
+    void showKeys(const FeedbackEvent& event, uint8_t prevKeycode);
+
+    U8G2* display = nullptr;
+    QueueHandle_t queue = nullptr;
+    ChannelState channels[FEEDBACK_CHANNEL_COUNT];
+
+    // 特別表示の連続ルール用（直前に単独で押されたキーコード）
+    uint8_t lastSingleKeycode = 0;
+
+    // 間隔制限中にまとめた画面更新
+    FeedbackEvent pendingDisplay;
+    uint8_t pendingPrevKeycode = 0;
+    bool displayPending = false;
+
+    volatile uint32_t published = 0;
+    volatile uint32_t dropped = 0;
+};
+
+// グローバルインスタンス
+extern FeedbackBus feedbackBus;
+
+#endif // FEEDBACK_BUS_H
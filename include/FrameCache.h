@@ -0,0 +1,46 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include <Arduino.h>
+#include <U8g2lib.h>
+
+// フレームキャッシュ設定
+#define FRAME_CACHE_FRAME_BYTES 1024   // 128x64 / 8（U8G2フルバッファ1枚分）
+#define FRAME_CACHE_CAPACITY    32     // キャッシュできるフレーム数（PSRAM 32KB）
+
+// 描画済みフレームをPSRAMに保持し、再生時はU8G2バッファへmemcpyするだけにするキャッシュ
+// owner（ビットマップや文字列のアドレス）とvariant（フレーム番号やオフセット）の組で識別する
+// displayTaskからのみ使用すること（U8G2バッファを直接読み書きするため）
+class FrameCache {
+public:
+    // キャッシュ済みならU8G2バッファへ転送してtrueを返す
+    bool blit(U8G2* display, const void* owner, int32_t variant);
+
+    // 現在のU8G2バッファ内容をキャッシュに登録する（満杯・PSRAM無しの場合は何もしない）
+    void store(U8G2* display, const void* owner, int32_t variant);
+
+    // 統計
+    uint32_t getHits() const { return hits; }
+    uint32_t getMisses() const { return misses; }
+
+private:
+    struct Entry {
+        const void* owner;
+        int32_t variant;
+    };
+
+    bool allocate();
+    int find(const void* owner, int32_t variant) const;
+
+    uint8_t* frames = nullptr;   // FRAME_CACHE_CAPACITY * FRAME_CACHE_FRAME_BYTES（PSRAM）
+    Entry entries[FRAME_CACHE_CAPACITY];
+    int count = 0;
+    bool allocFailed = false;
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+};
+
+// グローバルインスタンス
+extern FrameCache frameCache;
+
+#endif // FRAME_CACHE_H
@@ -0,0 +1,76 @@
+#ifndef GAMEPAD_FORWARDER_H
+#define GAMEPAD_FORWARDER_H
+
+#include <Arduino.h>
+#include <BleKeyboard.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "HidReportDescriptor.h"
+
+// 軸の不感帯（-127〜127のうち、この値未満は0として扱う）
+#ifndef GAMEPAD_DEADBAND
+#define GAMEPAD_DEADBAND 10
+#endif
+
+// 軸がこれ以上変わった時だけ送る（ボタン・ハット・中立への復帰は必ず送る）
+#ifndef GAMEPAD_CHANGE_THRESHOLD
+#define GAMEPAD_CHANGE_THRESHOLD 3
+#endif
+
+// 送信の最小間隔（ms、既定は50Hz）
+#ifndef GAMEPAD_MIN_INTERVAL_MS
+#define GAMEPAD_MIN_INTERVAL_MS 20
+#endif
+
+// ゲームパッドのBLE転送（ロボット操縦用）
+// USB側はupdate()で最新の状態を置くだけで、送信は専用タスクが最小間隔を守って行う。
+// 間隔内に来た状態は最新の1件にまとめ、不感帯・変化量のしきい値で細かいノイズは送らない。
+class GamepadForwarder {
+public:
+    // 送信タスクを開始する
+    bool begin(BleKeyboard* keyboard, BaseType_t core);
+
+    // 最新の状態を置く（USBタスクから呼ぶ）
+    void update(const GamepadState& state);
+    // 切断時などに中立を送る
+    void reset();
+
+    // 設定（どのタスクから呼んでもよい）
+    void setDeadband(uint8_t value) { deadband = value; }
+    void setChangeThreshold(uint8_t value) { changeThreshold = value; }
+    void setMinInterval(uint16_t ms) { minIntervalMs = ms; }
+
+    // 統計
+    uint32_t getReceived() const { return received; }
+    uint32_t getSent() const { return sent; }
+    uint32_t getFiltered() const { return filtered; }
+
+private:
+    static void gamepadTask(void* pvParameters);
+    void run();
+    // 不感帯を当てる
+    void applyDeadband(GamepadState& state) const;
+    // 前回送った状態と比べて送る価値があるか
+    bool isSignificant(const GamepadState& next, const GamepadState& last) const;
+
+    BleKeyboard* keyboard = nullptr;
+    TaskHandle_t task = nullptr;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    GamepadState latest = {};       // USB側が置いた最新（不感帯適用済み）
+    GamepadState lastSent = {};
+    bool dirty = false;
+
+    volatile uint8_t deadband = GAMEPAD_DEADBAND;
+    volatile uint8_t changeThreshold = GAMEPAD_CHANGE_THRESHOLD;
+    volatile uint16_t minIntervalMs = GAMEPAD_MIN_INTERVAL_MS;
+
+    volatile uint32_t received = 0;
+    volatile uint32_t sent = 0;
+    volatile uint32_t filtered = 0;   // 不感帯・しきい値・間隔で送らなかった状態の数
+};
+
+// グローバルインスタンス
+extern GamepadForwarder gamepadForwarder;
+
+#endif // GAMEPAD_FORWARDER_H
@@ -0,0 +1,52 @@
+#ifndef HID_REPORT_DESCRIPTOR_H
+#define HID_REPORT_DESCRIPTOR_H
+
+#include <stdint.h>
+
+// ゲームパッドの軸（BLEのゲームパッドレポートと同じ順）
+enum GamepadAxis : uint8_t {
+  GAMEPAD_AXIS_X = 0,
+  GAMEPAD_AXIS_Y,
+  GAMEPAD_AXIS_Z,
+  GAMEPAD_AXIS_RZ,
+  GAMEPAD_AXIS_RX,
+  GAMEPAD_AXIS_RY,
+  GAMEPAD_AXIS_COUNT
+};
+
+#define GAMEPAD_MAX_BUTTONS 16
+#define GAMEPAD_HAT_CENTER  0     // ハットスイッチの中立（1〜8が上から時計回り）
+
+// レポートの中の1フィールドの位置と範囲
+struct HidReportField {
+  bool present;
+  uint16_t bitOffset;               // レポートIDを除いた先頭からのビット位置
+  uint8_t bitSize;
+  int32_t logicalMin;
+  int32_t logicalMax;
+};
+
+// レポート記述子から読み取ったゲームパッド（Generic DesktopのJoystick/Gamepad）のレイアウト
+struct HidGamepadLayout {
+  bool valid;
+  uint8_t reportId;                 // 0ならレポートIDなし
+  HidReportField axes[GAMEPAD_AXIS_COUNT];
+  HidReportField hat;
+  uint16_t buttonOffset;
+  uint8_t buttonCount;
+};
+
+// デコード済みのゲームパッドの状態（軸は-127〜127に正規化）
+struct GamepadState {
+  int8_t axes[GAMEPAD_AXIS_COUNT];
+  uint8_t hat;
+  uint16_t buttons;
+};
+
+// レポート記述子からゲームパッドのレイアウトを探す（最初のJoystick/Gamepadコレクションだけ）
+bool hidParseGamepadLayout(const uint8_t *desc, int length, HidGamepadLayout &layout);
+
+// レイアウトに従ってレポート（レポートIDを除いたもの）をデコードする
+bool hidDecodeGamepad(const HidGamepadLayout &layout, const uint8_t *data, int length, GamepadState &state);
+
+#endif // HID_REPORT_DESCRIPTOR_H
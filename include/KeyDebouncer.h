@@ -0,0 +1,71 @@
+#ifndef KEY_DEBOUNCER_H
+#define KEY_DEBOUNCER_H
+
+#include <Arduino.h>
+
+// チャタリング除去の時間窓（ms、0で無効）
+#ifndef KEY_DEBOUNCE_MS
+#define KEY_DEBOUNCE_MS 5
+#endif
+
+// 既定の方式（KEY_DEBOUNCE_EAGER / KEY_DEBOUNCE_DEFERRED）
+#ifndef KEY_DEBOUNCE_MODE
+#define KEY_DEBOUNCE_MODE KEY_DEBOUNCE_EAGER
+#endif
+
+// 1台分のキー状態（HIDキーコード0〜255のビット。修飾キーは0xE0〜0xE7）
+#define KEY_BITMAP_BYTES 32
+
+enum KeyDebounceMode : uint8_t {
+    // 変化はすぐ通し、その後の時間窓の間は同じキーの変化を止める（遅延なし）
+    KEY_DEBOUNCE_EAGER = 0,
+    // 変化が時間窓の間続いてから通す（窓の分だけ遅れるが、短いパルスは出さない）
+    KEY_DEBOUNCE_DEFERRED
+};
+
+// キーごとのチャタリング除去
+// USBのレポートから作ったキーのビット列を受け取り、キーごとの変化（押下・リリース）に時間窓を当てる。
+// 時刻はキーごとに16ビットのmsで持ち、窓の判定中のキーだけ参照する（窓はloop()のpoll()で閉じる）。
+// 窓の中で止めた変化はキーごとのチャタリング回数として数える。
+class KeyDebouncer {
+public:
+    // 生のキー状態を入れ、除去後の状態をoutに返す（除去後の状態が変わったらtrue）
+    bool filter(const uint8_t raw[KEY_BITMAP_BYTES], uint32_t nowMs, uint8_t out[KEY_BITMAP_BYTES]);
+    // 時間窓が過ぎたキーを確定させる（除去後の状態が変わったらtrue）
+    bool poll(uint32_t nowMs, uint8_t out[KEY_BITMAP_BYTES]);
+    // 時間窓の判定中のキーがある
+    bool isPending() const { return pendingCount > 0; }
+    void reset();
+
+    void setWindow(uint16_t ms) { windowMs = ms; }
+    void setMode(KeyDebounceMode m) { mode = m; }
+
+    // 統計
+    uint16_t getChatter(uint8_t keycode) const { return chatter[keycode]; }
+    uint32_t getTotalChatter() const { return totalChatter; }
+    // チャタリングの最も多いキー（無ければ0を返す）
+    uint8_t getWorstKey() const;
+
+private:
+    static bool getBit(const uint8_t* bits, int key) { return bits[key >> 3] & (1 << (key & 7)); }
+    static void setBit(uint8_t* bits, int key, bool on) {
+        if (on) bits[key >> 3] |= 1 << (key & 7);
+        else bits[key >> 3] &= ~(1 << (key & 7));
+    }
+    void countChatter(int key);
+    // 窓が過ぎたキーを確定させる
+    bool settle(uint16_t now);
+
+    uint8_t raw[KEY_BITMAP_BYTES] = {};       // 最後に受けた生の状態
+    uint8_t stable[KEY_BITMAP_BYTES] = {};    // 除去後の状態
+    uint8_t pending[KEY_BITMAP_BYTES] = {};   // 時間窓の判定中のキー
+    uint16_t edgeMs[256] = {};                // 判定中のキーの窓の開始時刻（msの下位16ビット）
+    uint16_t chatter[256] = {};               // キーごとのチャタリング回数（飽和）
+    uint16_t pendingCount = 0;
+    uint32_t totalChatter = 0;
+
+    uint16_t windowMs = KEY_DEBOUNCE_MS;
+    KeyDebounceMode mode = KEY_DEBOUNCE_MODE;
+};
+
+#endif // KEY_DEBOUNCER_H
@@ -0,0 +1,138 @@
+#ifndef KEY_LAYERS_H
+#define KEY_LAYERS_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+// KB16にレイヤーとタップ/ホールドのキーマップを当てる（0で無効。KEYCODE_MAPのまま）
+#ifndef KEYMAP_ENABLED
+#define KEYMAP_ENABLED 1
+#endif
+
+// レイヤー数（0が基本レイヤー）
+#define KEYMAP_LAYERS 4
+
+// タップとホールドを分ける時間（ms）。押してからこの時間内に離せばタップ
+#ifndef KEYMAP_TAPPING_TERM_MS
+#define KEYMAP_TAPPING_TERM_MS 200
+#endif
+
+// 出力待ちのキーの変化（タップは押下・リリースの2件）
+#define KEYMAP_EVENT_QUEUE 32
+
+// キーの動作（16ビット: 種類4 | 引数4 | キーコード8）
+enum KeyActionKind : uint8_t {
+    KA_KEY = 0,         // キーコードを押す（0なら何もしない）
+    KA_TRANSPARENT,     // 下のレイヤーの動作を使う
+    KA_LAYER_HOLD,      // 押している間レイヤーを有効にする
+    KA_LAYER_TOGGLE,    // 押すたびにレイヤーを切り替える
+    KA_LAYER_TAP,       // タップでキーコード、ホールドでレイヤー
+    KA_MOD_TAP,         // タップでキーコード、ホールドで修飾キー（引数は0xE0からの番号）
+    KA_MACRO            // マクロを再生する（キーコードの位置にマクロ番号）
+};
+typedef uint16_t KeyAction;
+
+#define KEY_ACTION(kind, arg, keycode) ((KeyAction)(((kind) << 12) | (((arg) & 0x0F) << 8) | ((keycode) & 0xFF)))
+#define KC(keycode)          KEY_ACTION(KA_KEY, 0, keycode)
+#define KC_NO                KEY_ACTION(KA_KEY, 0, 0)
+#define KC_TRANS             KEY_ACTION(KA_TRANSPARENT, 0, 0)
+#define MO(layer)            KEY_ACTION(KA_LAYER_HOLD, layer, 0)
+#define TG(layer)            KEY_ACTION(KA_LAYER_TOGGLE, layer, 0)
+#define LT(layer, keycode)   KEY_ACTION(KA_LAYER_TAP, layer, keycode)
+#define MT(mod, keycode)     KEY_ACTION(KA_MOD_TAP, mod, keycode)
+#define MC(index)            KEY_ACTION(KA_MACRO, 0, index)
+#define MC_STOP              MC(0xFF)
+
+#define KEY_ACTION_KIND(a)    ((KeyActionKind)((a) >> 12))
+#define KEY_ACTION_ARG(a)     (((a) >> 8) & 0x0F)
+#define KEY_ACTION_KEYCODE(a) ((uint8_t)((a) & 0xFF))
+
+// 読みやすい形のキーマップ（レイヤー・物理キーコード・動作）。compile()で平らな表にする
+struct KeymapEntry {
+    uint8_t layer;
+    uint8_t keycode;
+    KeyAction action;
+};
+
+// 出力するキーの変化（キーコードはKEYCODE_MAPと同じKB16基準、修飾キーは0xE0〜0xE7）
+// macroの時はkeycodeがマクロ番号で、downは起動したキーの押下/リリース
+struct KeyEvent {
+    uint8_t keycode;
+    bool down;
+    bool macro;
+};
+
+// レイヤー付きキーマップ
+// キーマップはレイヤーごとの256要素の表に展開し、透過は下のレイヤーの動作で埋めておく。
+// 押下時は有効な最上位レイヤーの表を1回引くだけで動作が決まり、離す時は押した時の動作を使う。
+// タップ/ホールドは押下時にesp_timerを仕掛け、時間切れ（ホールド）か離した時（タップ）で決める。
+// 他のキーが押された時もホールドに決める。キーのイベントでメモリは確保しない。
+// 時刻は引数で渡すので、ホストでは仮想時刻でpress/release/timeoutを呼べば同じ動きを再現できる。
+class KeyLayers {
+public:
+    // キーマップを平らな表にする（表に無い基本レイヤーのキーはそのまま）
+    void compile(const KeymapEntry* entries, int count);
+    // タップ/ホールド用のタイマーを作る
+    bool begin();
+    // 押しているキー・レイヤー・判定中のタップを捨てる（デバイスが外れた時）
+    void reset();
+
+    // 物理キーの変化（USBタスクから呼ぶ）
+    void press(uint8_t keycode, uint32_t nowMs);
+    void release(uint8_t keycode, uint32_t nowMs);
+    // タップ/ホールドの判定時刻が来た（タイマーから呼ばれる）
+    void timeout(uint32_t nowMs);
+    // 判定中のタップ/ホールドがあればその期限（ms）
+    bool getDeadline(uint32_t& deadlineMs) const;
+
+    // 出力するキーの変化を1件取り出す（無ければfalse）
+    bool pollEvent(KeyEvent& event);
+    bool hasEvents() const { return eventCount > 0; }
+
+    uint8_t getActiveLayer() const;
+    // 統計
+    uint32_t getTaps() const { return taps; }
+    uint32_t getHolds() const { return holds; }
+    uint32_t getDroppedEvents() const { return droppedEvents; }
+
+private:
+    static void onTimer(void* arg);
+    // ロックを取った状態で呼ぶ
+    void pressLocked(uint8_t keycode, uint32_t nowMs);
+    void decideHoldLocked();
+    void emit(uint8_t keycode, bool down, bool macro = false);
+    uint8_t activeLayerLocked() const;
+    void armTimer(uint32_t delayMs);
+
+    KeyAction table[KEYMAP_LAYERS][256];    // 透過を展開済みの動作
+    KeyAction pressedAction[256];           // 押した時の動作（離す時に使う）
+    uint8_t pressed[32] = {};
+    uint8_t layerHeld[KEYMAP_LAYERS] = {};  // レイヤーを押さえているキーの数
+    uint8_t layerToggled = 0;               // 切り替えで有効なレイヤー（ビット）
+
+    // 判定中のタップ/ホールド（同時に1つ）
+    bool tapPending = false;
+    uint8_t tapKey = 0;
+    uint32_t tapDeadline = 0;
+
+    KeyEvent events[KEYMAP_EVENT_QUEUE];
+    uint8_t eventHead = 0;
+    volatile uint8_t eventCount = 0;
+
+    esp_timer_handle_t timer = nullptr;
+    mutable portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    volatile uint32_t taps = 0;
+    volatile uint32_t holds = 0;
+    volatile uint32_t droppedEvents = 0;
+};
+
+// KB16の既定のキーマップ
+extern const KeymapEntry KB16_KEYMAP[];
+extern const int KB16_KEYMAP_SIZE;
+
+// グローバルインスタンス
+extern KeyLayers keyLayers;
+
+#endif // KEY_LAYERS_H
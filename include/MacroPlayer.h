@@ -0,0 +1,106 @@
+#ifndef MACRO_PLAYER_H
+#define MACRO_PLAYER_H
+
+#include <Arduino.h>
+#include <BleKeyboard.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// 1レポートごとに空ける時間（us、BLEの最短の接続間隔。1回の接続イベントに詰め込みすぎない）
+#ifndef MACRO_REPORT_GAP_US
+#define MACRO_REPORT_GAP_US 7500
+#endif
+
+// マクロのバイトコード（キーはBleKeyboard::press()と同じ: ASCII・KEY_*）
+#define MACRO_END      0x00   // 終わり
+#define MACRO_PRESS    0x01   // [キー] 押す
+#define MACRO_RELEASE  0x02   // [キー] 離す
+#define MACRO_TAP      0x03   // [キー] 押して離す（それぞれ別のレポート）
+#define MACRO_WAIT_US  0x04   // [us 24ビットLE] 待つ
+#define MACRO_MODS     0x05   // [修飾キーのビット] 修飾キーをこの状態にする
+
+// マクロを書くための補助
+#define M_PRESS(k)     MACRO_PRESS, (uint8_t)(k)
+#define M_RELEASE(k)   MACRO_RELEASE, (uint8_t)(k)
+#define M_TAP(k)       MACRO_TAP, (uint8_t)(k)
+#define M_WAIT_US(us)  MACRO_WAIT_US, (uint8_t)((us) & 0xFF), (uint8_t)(((us) >> 8) & 0xFF), (uint8_t)(((us) >> 16) & 0xFF)
+#define M_WAIT_MS(ms)  M_WAIT_US((ms) * 1000UL)
+#define M_MODS(m)      MACRO_MODS, (uint8_t)(m)
+
+// 起動したキーを離したら止める（押している間だけ動くマクロ）
+#define MACRO_FLAG_HOLD 0x01
+
+// キーマップのMC_STOPが出すマクロ番号
+#define MACRO_STOP_INDEX 0xFF
+
+struct MacroDef {
+    const char* name;
+    const uint8_t* code;
+    uint8_t flags;
+};
+
+// マクロの再生
+// play()は再生要求を置くだけで戻り、再生は専用タスクがバイトコードを1ステップずつ進める。
+// 待ち時間はesp_timerで起こしてもらうまでタスクを止めるので、長いマクロでも待っている間はCPUを使わない。
+// stop()・起動キーのリリース（MACRO_FLAG_HOLD）で途中で止め、マクロが押したままのキーは離す。
+// キーはBleKeyboard::press()/release()で共有のレポートに足し引きする（BleKeyboardがロックするので、他のタスクのキーと混ざっても消し合わない）。
+class MacroPlayer {
+public:
+    // 再生タスクとタイマーを用意する
+    bool begin(BleKeyboard* keyboard, BaseType_t core);
+
+    // マクロを再生する（再生中なら止めてから次を始める）
+    bool play(uint8_t index);
+    // 起動したキーが離された（MACRO_FLAG_HOLDのマクロは止める）
+    void triggerReleased(uint8_t index);
+    // 再生中のマクロを止める
+    void stop();
+    bool isPlaying() const { return playing >= 0; }
+
+    // 統計
+    uint32_t getPlayed() const { return played; }
+    uint32_t getCompleted() const { return completed; }
+    uint32_t getInterrupted() const { return interrupted; }
+
+private:
+    static void macroTask(void* pvParameters);
+    static void onTimer(void* arg);
+    void run();
+    // マクロ1つを最後まで（または止められるまで）進める
+    bool runMacro(const uint8_t* pc);
+    // 指定時間待つ（止められたらfalse）
+    bool waitUs(uint32_t us);
+    bool pressKey(uint8_t key);
+    bool releaseKey(uint8_t key);
+    bool setMods(uint8_t mods);
+    // マクロが押したままのキー・修飾キーを離す
+    void releaseHeld();
+
+    BleKeyboard* keyboard = nullptr;
+    TaskHandle_t task = nullptr;
+    esp_timer_handle_t timer = nullptr;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    int16_t requested = -1;           // 次に再生するマクロ
+    volatile int16_t playing = -1;    // 再生中のマクロ
+    volatile bool abortRequested = false;
+
+    // マクロが押しているキー（止めた時に離す）
+    uint8_t held[6] = {};
+    uint8_t heldCount = 0;
+    uint8_t heldMods = 0;
+
+    volatile uint32_t played = 0;
+    volatile uint32_t completed = 0;
+    volatile uint32_t interrupted = 0;
+};
+
+// マクロの一覧（番号はキーマップのMC(n)）
+extern const MacroDef MACROS[];
+extern const int MACRO_COUNT;
+
+// グローバルインスタンス
+extern MacroPlayer macroPlayer;
+
+#endif // MACRO_PLAYER_H
@@ -0,0 +1,74 @@
+#ifndef MOUSE_FORWARDER_H
+#define MOUSE_FORWARDER_H
+
+#include <Arduino.h>
+#include <BleKeyboard.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// 移動量をまとめて送る間隔（ms、BLEの接続間隔に合わせる）
+#ifndef MOUSE_FLUSH_INTERVAL_MS
+#define MOUSE_FLUSH_INTERVAL_MS 15
+#endif
+
+// 1回のまとめ送信で送るレポート数の上限（1レポートの移動量は±127まで。残りは次の間隔へ持ち越す）
+#ifndef MOUSE_MAX_REPORTS_PER_FLUSH
+#define MOUSE_MAX_REPORTS_PER_FLUSH 4
+#endif
+
+// 送信待ちにしておけるボタン変化の数（クリックを取りこぼさないよう、変化の前後は別のレポートで送る）
+#define MOUSE_SEGMENT_QUEUE_SIZE 8
+
+// マウスのBLE転送
+// USB側はadd()でレポートを積むだけで、送信は専用タスクが接続間隔ごとにまとめて行う。
+// 1000Hzのマウスでも移動量・ホイールは合計して1レポートにし、総移動量は変えない。
+// ボタンが変わった時はそれまでの移動を前のボタン状態で区切り、押下・リリースを必ずそれぞれ送る。
+class MouseForwarder {
+public:
+    // 送信タスクを開始する
+    bool begin(BleKeyboard* keyboard, BaseType_t core);
+
+    // USBのマウスレポート1件分を積む（USBタスクから呼ぶ）
+    void add(uint8_t buttons, int8_t x, int8_t y, int8_t wheel, int8_t pan);
+    // 切断時などにボタンを全部離す（押したまま抜かれてもBLE側で押されたままにしない）
+    void reset();
+
+    // 統計
+    uint32_t getReceived() const { return received; }
+    uint32_t getSent() const { return sent; }
+    uint32_t getDropped() const { return dropped; }
+
+private:
+    // ボタン状態が同じ間の移動量の合計
+    struct Segment {
+        uint8_t buttons;
+        int32_t x, y, wheel, pan;
+        bool hasMotion() const { return x || y || wheel || pan; }
+    };
+
+    static void mouseTask(void* pvParameters);
+    void run();
+    // 1回分を取り出して送る。何か送ったらtrue（次の間隔まで待ってもう一度呼ぶ）
+    bool flush();
+    // 1区切り分を±127ずつに分けて送る。送ったレポート数を返す（maxReportsで打ち切ると残りがsegに残る。0なら送り切る）
+    int sendSegment(Segment& seg, int maxReports);
+
+    BleKeyboard* keyboard = nullptr;
+    TaskHandle_t task = nullptr;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    Segment closed[MOUSE_SEGMENT_QUEUE_SIZE];   // ボタン変化で区切り済みの分
+    uint8_t closedCount = 0;
+    Segment open = {};                          // 現在のボタン状態で積んでいる分
+    uint8_t sentButtons = 0;                    // 最後に送ったボタン状態（BLEで実際に送れた時だけ更新する）
+    bool pending = false;
+
+    volatile uint32_t received = 0;
+    volatile uint32_t sent = 0;       // 送ったBLEレポート数
+    volatile uint32_t dropped = 0;    // 区切りがあふれて前の区切りにまとめた数・BLE未接続で捨てた数
+};
+
+// グローバルインスタンス
+extern MouseForwarder mouseForwarder;
+
+#endif // MOUSE_FORWARDER_H
@@ -2,6 +2,8 @@
 #define PERIPHERALS_H
 
 #include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
 
 // GPIOピンの設定
 #define INTERNAL_LED_PIN 21    // 内蔵LED（キー入力表示用）
@@ -20,51 +22,154 @@
 // LED点滅設定
 #define BLE_BLINK_INTERVAL 500 // BLE未接続時のLED点滅間隔 (ms)
 
+// LEDのLEDCチャネル（チャネル0/1はブザーと同じタイマーで周波数が変わるので使わない）
+#define KEY_LED_LEDC_CHANNEL 2
+#define STATUS_LED_LEDC_CHANNEL 3
+#define LED_LEDC_FREQ 5000
+#define LED_LEDC_BITS 8
+#define LED_DUTY_MAX 255
+
+// BLE送信がこれより遅いと遅延アラーム（半分を下回ったら解除）
+#define LED_LATENCY_ALARM_US 20000
+
+// ブザーのLEDCチャネル（起動時に一度だけ設定し、以降は周波数とデューティだけ変える）
+#define BUZZER_LEDC_CHANNEL 0
+#define BUZZER_LEDC_BITS 8
+
+// 発音待ちノートの最大数
+#define SPEAKER_QUEUE_SIZE 16
+
 // 起動音階のノート定義
 #define NOTE_C5  523
 #define NOTE_E5  659
 #define NOTE_G5  784
 #define NOTE_C6  1047
 
+// LEDエフェクトの1ステップ（dutyまでfadeMsかけてハードウェアでフェードし、holdMs保持する）
+struct LedStep {
+    uint8_t duty;
+    uint16_t fadeMs;
+    uint16_t holdMs;
+};
+
+// LEDエフェクト（ステップ表。loopなら最後まで行ったら先頭へ戻る）
+struct LedEffect {
+    const LedStep* steps;
+    uint8_t count;
+    bool loop;
+};
+
+// 定義済みエフェクト
+extern const LedEffect LED_EFFECT_OFF;
+extern const LedEffect LED_EFFECT_ON;
+extern const LedEffect LED_EFFECT_BLINK;            // BLE未接続
+extern const LedEffect LED_EFFECT_BREATHE;          // BLEスタック停止中（Ctrl+Alt+Bで再開待ち）
+extern const LedEffect LED_EFFECT_FLASH;            // キー押下
+extern const LedEffect LED_EFFECT_ERROR_OVERFLOW;   // 送信キューあふれ（短く3回）
+extern const LedEffect LED_EFFECT_ERROR_LATENCY;    // BLE送信の遅延（長く2回）
+
+// ステータスLEDのアラーム（ビットの組み合わせ。値の小さい方が優先）
+enum LedAlarm : uint8_t {
+    LED_ALARM_QUEUE_OVERFLOW = 0x01,
+    LED_ALARM_HIGH_LATENCY   = 0x02
+};
+
+// LED1つ分のエフェクト再生
+// 基本エフェクトの上に1回だけのエフェクト（キー押下のフラッシュなど）を重ねられる。
+// ステップの切り替えはesp_timerのコールバックで行い、明るさの変化はLEDCのハードウェアフェードに任せる。
+// LEDCを触るのはタイマー側だけ（呼び出し側は状態を書き換えてタイマーを起こすだけ）。
+class LedChannel {
+public:
+    // タイマーを用意できなければfalse（エフェクトは動かさず、基本エフェクトの最初の明るさだけ出す）
+    bool begin(uint8_t pin, uint8_t ledcChannel, const char* name);
+
+    // 基本エフェクトを切り替える（immediate=falseなら再生中の1周が終わってから）
+    void setBase(const LedEffect* effect, bool immediate = true);
+    // 1回だけ重ねて再生し、終わったら基本エフェクトの先頭へ戻る
+    void play(const LedEffect* effect);
+
+private:
+    static void onTimer(void* arg);
+    void advance();
+    void kick();
+
+    esp_timer_handle_t timer = nullptr;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    uint8_t channel = 0;
+    const LedEffect* base = &LED_EFFECT_OFF;
+    const LedEffect* nextBase = nullptr;    // 1周後に切り替える基本エフェクト
+    const LedEffect* overlay = nullptr;
+    uint8_t step = 0;
+    bool running = false;                   // タイマー動作中
+};
+
 // LED制御クラス
+// 内蔵LEDはキー押下でフラッシュし、ステータスLEDはアラーム > BLEスタック停止 > BLE接続状態の順で表示を選ぶ。
+// どれも表示の選択を変えるだけなので、loop()から定期的に呼ぶ必要はない。
 class LEDController {
 public:
-    // 初期化
-    void begin();
+    // 初期化（LEDのタイマーを用意できなければfalse）
+    bool begin();
     
     // キー入力表示用LED制御
     void keyPressed();
-    void updateKeyLED();
     
     // ステータスLED制御
-    void setStatusLED(bool on);
-    void updateStatusLED();
     void setBleConnected(bool connected);
+    void setBleStopped(bool stopped);
+    // アラームの発生・解除（状態が変わらなければ何もしない）
+    void setAlarm(LedAlarm alarm, bool active);
     
 private:
-    unsigned long lastKeyPressTime = 0;
-    const unsigned long keyLedDuration = 100;  // キー入力LEDの点灯時間(ms)
-    
-    bool bleConnected = false;
-    unsigned long lastBlinkTime = 0;
-    bool blinkState = false;
+    void updateStatusEffect(bool immediate);
+
+    LedChannel keyLed;
+    LedChannel statusLed;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    volatile bool bleConnected = false;
+    volatile bool bleStopped = false;
+    volatile uint8_t alarms = 0;
+};
+
+// ノート1つ（frequency 0は休符）
+struct SpeakerNote {
+    uint16_t frequency;
+    uint16_t durationMs;
 };
 
 // スピーカー制御クラス
+// 呼び出し側はノートをキューに積むだけで戻り、発音と次のノートへの切り替えはesp_timerのコールバックで行う。
+// LEDCチャネルはbegin()で設定したままにし、無音はデューティ0で表す。
 class SpeakerController {
 public:
-    // 初期化
-    void begin();
+    // 初期化（タイマーを用意できなければfalse。音は鳴らさない）
+    bool begin();
     
-    // サウンド再生
-    void playKeySound();
+    // サウンド再生（いずれも待たずに戻る）
+    void playKeySound();            // 他の音が鳴っている間は捨てる
     void playStartupMelody();
     void playConnectedSound();
     void playDisconnectedSound();
+
+    // 統計
+    uint32_t getDroppedClicks() const { return droppedClicks; }
+    uint32_t getDroppedNotes() const { return droppedNotes; }
     
 private:
-    void tone(unsigned int frequency, unsigned long duration);
-    void noTone();
+    // ノートを積む（droppable: 発音中なら積まずに捨てる）。積めたらtrue
+    bool enqueue(const SpeakerNote* notes, int count, bool droppable);
+    // タイマーから呼ばれ、次のノートを鳴らす（無ければ消音して停止）
+    static void onTimer(void* arg);
+    void advance();
+
+    esp_timer_handle_t timer = nullptr;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    SpeakerNote queue[SPEAKER_QUEUE_SIZE];
+    uint8_t head = 0;       // 次に鳴らす位置
+    uint8_t count = 0;      // 待ちノート数
+    bool busy = false;      // 発音中（タイマー動作中）
+    volatile uint32_t droppedClicks = 0;
+    volatile uint32_t droppedNotes = 0;
 };
 
 // グローバルインスタンス
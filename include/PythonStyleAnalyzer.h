@@ -26,6 +26,11 @@
 
 #include "EspUsbHost.h"
 #include "Peripherals.h"
+#include "KeyDebouncer.h"
+#include "KeyLayers.h"
+#include "MacroPlayer.h"
+#include "ConfigStore.h"
+#include "TeleopStreamer.h"
 
 // DOIO KB16デバイス情報
 #define DOIO_VID 0xD010
@@ -61,27 +66,54 @@ struct ReportFormat {
     String format;
 };
 
-// PythonアナライザーのUSBホストクラス（KB16認識対応修正版）
-class PythonStyleAnalyzer : public EspUsbHost {
-private:
-    U8G2* display;
-    BleKeyboard* bleKeyboard;
-    
+// 接続中のUSBデバイスごとの解析状態（UsbDeviceContext::slotで引く）
+struct AnalyzerDevice {
     // Pythonアナライザーの状態変数（完全一致）
     uint8_t last_report[32] = {0};
     bool has_last_report = false;
     int report_size = 16;  // DOIO KB16は16バイト
     ReportFormat report_format;
     bool report_format_initialized = false;
-    
+
     // デバイス情報
     bool is_doio_kb16 = false;
-    bool isConnected = false;
+    bool connected = false;
+
+    // このデバイスで押されているキー（BLEへは全デバイス分をまとめて送る）
+    String pressed_chars = "";
+    uint8_t modifier = 0;
+
+    // 直前のコンシューマーコントロールの使用法（押下の立ち上がりだけ転送する）
+    uint16_t consumer_usage = 0;
+
+    // キーごとのチャタリング除去と、除去後のレポートを作り直すための最後の生レポート
+    KeyDebouncer debouncer;
+    uint8_t raw_report[32] = {0};
+    int raw_length = 0;
+
+    // キーマップ（KB16のみ）: 除去後の物理キーと、キーマップが出したキー
+    uint8_t physical_keys[KEY_BITMAP_BYTES] = {0};
+    uint8_t keymap_keys[KEY_BITMAP_BYTES] = {0};
+
+    // テレオペ: このデバイスで押されている移動キー・停止キーと、それ以外のキーがあるか
+    uint8_t teleop_moves = 0;
+    uint8_t teleop_stops = 0;
+    bool teleop_other = false;
+};
+
+// PythonアナライザーのUSBホストクラス（KB16認識対応修正版）
+class PythonStyleAnalyzer : public EspUsbHost {
+private:
+    U8G2* display;
+    BleKeyboard* bleKeyboard;
+    
+    // デバイスごとの解析状態と、いま処理中のデバイス（USBコールバックはloop()のタスクからのみ呼ばれる）
+    AnalyzerDevice analyzerDevices[USB_HOST_MAX_DEVICES] = {};  // 値初期化（ReportFormatも0）
+    AnalyzerDevice* current = &analyzerDevices[0];
+    bool isConnected = false;   // いずれかのデバイスが接続中
+    uint8_t keymapSlot = 0;     // キーマップに入力しているデバイス（KB16）
     
     // OLED表示用データ
-    String lastHexData = "";
-    String lastKeyPresses = "";
-    String lastCharacters = "";
     bool displayNeedsUpdate = false;
     unsigned long lastDisplayUpdate = 0;
     unsigned long lastKeyEventTime = 0;
@@ -105,8 +137,8 @@ private:
     unsigned long keyPressStartTime = 0;
     unsigned long lastRepeatTime = 0;
     bool isRepeating = false;
-    static const unsigned long REPEAT_DELAY = 250;   // 長押し開始までの遅延（ms）- 極限高速化
-    static const unsigned long REPEAT_RATE = 50;     // リピート間隔（ms）- 極限高速化
+    static const unsigned long REPEAT_DELAY = 250;   // 長押し開始までの遅延（ms）- 極限高速化（設定で上書き）
+    static const unsigned long REPEAT_RATE = 50;     // リピート間隔（ms）- 極限高速化（設定で上書き）
 
 
 public:
@@ -121,6 +153,18 @@ public:
     
     // 長押しリピート処理（publicメソッド）
     void handleKeyRepeat();
+
+    // チャタリング除去の時間窓が過ぎたキーを確定させる（loop()から呼ぶ）
+    void handleDebounce();
+
+    // タイマーで決まったタップ/ホールドの出力を処理する（loop()から呼ぶ）
+    void handleKeymap();
+
+    // BLEホストが書いたLED（NumLock・CapsLock・ScrollLock）をUSBキーボードへ送る（loop()から呼ぶ）
+    void handleHostLeds();
+
+    // 全デバイスでキーが離れているか（設定の切り替えはこの間だけ）
+    bool keysReleased() const;
     
     // 複数文字を効率的に送信
     void sendString(const String& chars);  // 複数文字を効率的に送信
@@ -130,8 +174,9 @@ private:
     // ディスプレイ更新用のヘルパー関数
     void updateDisplayForDevice(const String& deviceType);
     
-    // キー押下時のディスプレイ更新
-    void updateDisplayWithKeys(const String& hexData, const String& keyNames, const String& characters, bool shiftPressed = false);
+    // キーの変化をフィードバックイベントとして積む（LED・音・画面はfeedbackBusが出す）
+    void publishKeyFeedback(const String& keyNames, const String& characters, bool shiftPressed, uint8_t keycode, bool newPress);
+    void publishRepeatFeedback();
     
     // Pythonのkeycode_to_string関数を完全移植
     String keycodeToString(uint8_t keycode, bool shift = false);
@@ -141,6 +186,24 @@ private:
     
     // Pythonのpretty_print_report関数を完全移植
     void prettyPrintReport(const uint8_t* report_data, int data_size);
+
+    // レポートのキーにチャタリング除去を当て、除去後のキー状態をkeysに返す（キーが変わらなければfalse）
+    bool debounceReport(const uint8_t* report_data, int data_size, uint8_t keys[KEY_BITMAP_BYTES]);
+    // 除去後のキー状態をレポートにして処理する（KB16はキーマップを通す）
+    void processKeys(const uint8_t keys[KEY_BITMAP_BYTES]);
+    void drainKeymap();
+    // 除去後のキー状態を最後の生レポートと同じ形式のレポートに戻す
+    void buildDebouncedReport(const uint8_t keys[KEY_BITMAP_BYTES], uint8_t* filtered);
+
+    // 処理対象のデバイスを切り替える
+    void selectDevice(const UsbDeviceContext& dev) { current = &analyzerDevices[dev.slot]; }
+    // 全デバイスで押されているキーをまとめる
+    String combinedPressedChars() const;
+    uint8_t combinedModifiers() const;
+    // 全デバイスの移動キーをteleopStreamerに渡す。移動キー・停止キーだけならtrue（通常の送信には回さない）
+    bool updateTeleop(bool& newPress);
+    // 接続中のデバイスから状態表示のデバイス種別を決める
+    void updateUsbDeviceStatus();
     
     // BLE送信用のヘルパー関数
     void sendSingleCharacter(const String& character);
@@ -148,14 +211,16 @@ private:
     void sendSpecialKey(uint8_t keycode, const String& keyName);  // 特殊キー送信用（press+release方式）
     
     // 長押し処理用
-    void processKeyPress(const String& pressed_chars);  // キー押下処理（長押し対応）
+    bool processKeyPress(const String& pressed_chars);  // キー押下処理（長押し対応）。新しい押下ならtrue
     
     // EspUsbHostからの継承メソッド
-    void onNewDevice(const usb_device_info_t &dev_info) override;
-    void onGone(const usb_host_client_event_msg_t *eventMsg) override;
-    void onKeyboard(hid_keyboard_report_t report, hid_keyboard_report_t last_report) override;
-    void onReceive(const usb_transfer_t *transfer) override;
-    void processRawReport16Bytes(const uint8_t* data) override;
+    void onNewDevice(const UsbDeviceContext &dev, const usb_device_info_t &dev_info) override;
+    void onGone(const UsbDeviceContext &dev) override;
+    void onKeyboard(const UsbDeviceContext &dev, hid_keyboard_report_t report, hid_keyboard_report_t last_report) override;
+    void onNkroReport(const UsbDeviceContext &dev, const uint8_t* data, int length) override;
+    void onConsumer(const UsbDeviceContext &dev, uint16_t usage) override;
+    void onMouse(hid_mouse_report_t report, uint8_t last_buttons) override;
+    void onGamepad(const UsbDeviceContext &dev, const GamepadState &state) override;
 };
 
 // BLE送信キュー（他ファイルから参照可能に）
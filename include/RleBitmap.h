@@ -0,0 +1,63 @@
+#ifndef RLE_BITMAP_H
+#define RLE_BITMAP_H
+
+#include <stdint.h>
+#include <string.h>
+
+// 128x64の全画面ビットマップをU8G2のタイル形式（8ページ x 128列、1バイト=縦8ドット）で
+// 並べ替えた上でランレングス圧縮したもの。python/compress_bitmaps.pyで生成する。
+//
+// 圧縮形式（制御バイト + データ）:
+//   0x80 | (n-1), v      : 値vをn回（n=1..128）
+//   0x00 | (n-1), v0..   : 続くnバイトをそのまま（n=1..128）
+#define RLE_BITMAP_FRAME_BYTES 1024
+
+struct RleBitmap {
+    const uint8_t* data;
+    uint16_t size;
+};
+
+// U8G2のタイルバッファ(1024バイト)へ直接展開する
+inline void rleDecodeTiles(const RleBitmap& bmp, uint8_t* dst) {
+    const uint8_t* p = bmp.data;
+    const uint8_t* end = bmp.data + bmp.size;
+    uint8_t* out = dst;
+    uint8_t* outEnd = dst + RLE_BITMAP_FRAME_BYTES;
+    while (p < end && out < outEnd) {
+        uint8_t ctrl = *p++;
+        int n = (ctrl & 0x7F) + 1;
+        if (out + n > outEnd) n = outEnd - out;
+        if (ctrl & 0x80) {
+            if (p >= end) break;            // 値のバイトが切れている
+            memset(out, *p++, n);
+        } else {
+            if (n > end - p) n = end - p;   // 途中で切れたデータは読める分だけ
+            memcpy(out, p, n);
+            p += n;
+        }
+        out += n;
+    }
+    // 壊れたデータでも残りは必ず消去しておく
+    if (out < outEnd) memset(out, 0, outEnd - out);
+}
+
+// タイルバッファ全体を縦にdyドットずらす（dy<0で上、dy>0で下。はみ出た分は消える）
+inline void shiftTiles(uint8_t* buf, int dy) {
+    if (dy == 0) return;
+    for (int x = 0; x < 128; x++) {
+        uint64_t col = 0;
+        for (int page = 0; page < 8; page++) {
+            col |= (uint64_t)buf[page * 128 + x] << (page * 8);
+        }
+        if (dy <= -64 || dy >= 64) {
+            col = 0;
+        } else {
+            col = (dy < 0) ? (col >> -dy) : (col << dy);
+        }
+        for (int page = 0; page < 8; page++) {
+            buf[page * 128 + x] = (uint8_t)(col >> (page * 8));
+        }
+    }
+}
+
+#endif // RLE_BITMAP_H
@@ -4,38 +4,41 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
 #include <freertos/task.h>
+#include "DisplayRequest.h"
 
-// 画面表示タイプ
-enum DisplayType {
-    DISPLAY_NORMAL,
-    DISPLAY_ANIMATION,
-    DISPLAY_TEXT
+// 特別表示テーブルの要素（キーコードで索引する）
+struct SpecialKeyEntry {
+    uint8_t keycode;
+    DisplayType type;                 // DISPLAY_ANIMATION または DISPLAY_TEXT
+    const RleBitmap* bitmap;          // アニメーション用ビットマップ（圧縮済み）
+    const char* text1;                // メイン表示
+    const char* text2;                // サブ表示（nullptrなら無し）
+    const uint8_t* font;
+    bool shiftInvariant;              // Shift押下中も表示するか
+    uint8_t seqPrev;                  // 直前キーがこれなら…
+    const RleBitmap* seqBitmap;       // …このビットマップに差し替える
 };
 
-// 画面表示要求構造体
-struct DisplayRequest {
-    DisplayType type;
-    U8G2* display;
-    String text1; // メイン表示
-    String text2; // サブ表示（例：バイトキー名）
-    const unsigned char* bitmap;
-    int bmp_w;
-    int bmp_h;
-    int jumpHeight;
-    int frames;
-    int frameDelay;
-    const uint8_t* font;
+// 特別表示の描画位置（起動時に計算）
+struct SpecialKeyLayout {
+    int16_t x1, y1, x2, y2;
 };
 
-// 画面表示要求をキューに入れる関数
+// 画面表示要求をメールボックスに入れる関数
+// 1スロットの上書きキューなので、描画前に置き換えられた要求は破棄される（呼び出し側は待たない）
 void requestDisplay(DisplayRequest& req);
 
+// 描画されずに上書きされた表示要求の累計
+uint32_t getDisplayDroppedCount();
+
 // ディスプレイ専用タスク
 void displayTask(void* pvParameters);
 
 void drawCenteredBitmap(U8G2* display, int bmp_w, int bmp_h, const unsigned char* bitmap);
-// 前回のキーも渡す
-bool handleSpecialKeyDisplay(U8G2* display, const String& characters, const String& prevCharacters);
-void jumpBitmapAnimation(U8G2* display, const unsigned char* bitmap, int bmp_w, int bmp_h, int jumpHeight, int frames, int frameDelay);
-void drawCenteredText(U8G2* display, const char* text, const uint8_t* font);
-void showHoppingTextAnimation(U8G2* display, const char* text, const uint8_t* font, int hopHeight, int frameDelay);
\ No newline at end of file
+// 特別表示テーブルの索引と描画位置を事前計算する（displayTask開始前に一度だけ呼ぶ）
+void initSpecialKeyLayouts(U8G2* display);
+// 前回のキーも渡す（keycodeは単独押下時のみ、0なら特別表示なし）
+bool handleSpecialKeyDisplay(U8G2* display, uint8_t keycode, bool shift, uint8_t prevKeycode);
+// アニメーションの1フレームを描いて送出する（Animatorから呼ばれる。待ちは含まない）
+// loopsLeft: 残り周回数（起動画面のカウントダウン表示に使う）
+void renderAnimationFrame(const DisplayRequest& req, const AnimationClip& clip, int8_t pose, uint8_t loopsLeft);
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+// 接続中のUSBデバイスの種類
+enum UsbDeviceKind : uint8_t {
+    USB_DEVICE_NONE = 0,
+    USB_DEVICE_KB16,        // DOIO KB16
+    USB_DEVICE_KEYBOARD     // 標準キーボード
+};
+
+// 読み出し側が受け取る状態のコピー
+struct StatusSnapshot {
+    uint32_t version = 0;
+    bool bleConnected = false;
+    UsbDeviceKind usbDevice = USB_DEVICE_NONE;
+    uint8_t modifiers = 0;          // HIDの修飾キーバイト（bit1/bit5がShift）
+    uint8_t queueDepth = 0;         // BLE送信キューの滞留数
+    uint32_t lastLatencyUs = 0;     // 直近のBLE送信にかかった時間
+
+    bool shift() const { return (modifiers & 0x22) != 0; }
+};
+
+// システム状態の共有スナップショット
+// 書き込み側（USBコールバック・loop・BLE送信タスク）は各項目をアトミックにストアし、値が変わった時だけ
+// バージョンを進める。読み出し側（表示タスク）はバージョンを見て、変わった時だけ描き直す。
+// ロックは使わない（各項目が独立した値なので、read()はバージョンが前後で一致するまで読み直すだけ）。
+class SystemStatus {
+public:
+    void setBleConnected(bool connected) { update(bleConnected, connected); }
+    void setUsbDevice(UsbDeviceKind kind) { update(usbDevice, (uint8_t)kind); }
+    void setModifiers(uint8_t mods) { update(modifiers, mods); }
+    // キューの滞留数と遅延はキー入力のたびに変わり、ステータスバーにも出さないのでバージョンは進めない
+    void setQueueDepth(uint8_t depth) { queueDepth.store(depth, std::memory_order_relaxed); }
+    void setLastLatencyUs(uint32_t us) { lastLatencyUs.store(us, std::memory_order_relaxed); }
+
+    uint32_t getVersion() const { return version.load(std::memory_order_acquire); }
+
+    // 一貫したコピーを取り出す
+    StatusSnapshot read() const;
+
+private:
+    template <typename T, typename V>
+    void update(std::atomic<T>& field, V value) {
+        if (field.load(std::memory_order_relaxed) == (T)value) return;
+        field.store((T)value, std::memory_order_relaxed);
+        version.fetch_add(1, std::memory_order_release);
+    }
+
+    std::atomic<uint32_t> version{0};
+    std::atomic<bool> bleConnected{false};
+    std::atomic<uint8_t> usbDevice{USB_DEVICE_NONE};
+    std::atomic<uint8_t> modifiers{0};
+    std::atomic<uint8_t> queueDepth{0};
+    std::atomic<uint32_t> lastLatencyUs{0};
+};
+
+extern SystemStatus systemStatus;
@@ -0,0 +1,98 @@
+#ifndef TELEOP_STREAMER_H
+#define TELEOP_STREAMER_H
+
+#include <Arduino.h>
+#include <BleKeyboard.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// 移動キー（矢印）を一定周期で送るテレオペモード（0で無効。長押しリピートのまま）
+#ifndef TELEOP_ENABLED
+#define TELEOP_ENABLED 1
+#endif
+
+// 押している移動キーを送る周期（Hz）
+#ifndef TELEOP_RATE_HZ
+#define TELEOP_RATE_HZ 50
+#endif
+
+// 送信タスクの優先度（loop()より上にして、周期の遅れを減らす）
+#ifndef TELEOP_TASK_PRIORITY
+#define TELEOP_TASK_PRIORITY 2
+#endif
+
+// 移動キー（ビット）: KB16基準のキーコード
+#define TELEOP_MOVE_UP    0x01   // 0x56
+#define TELEOP_MOVE_DOWN  0x02   // 0x55
+#define TELEOP_MOVE_LEFT  0x04   // 0x54
+#define TELEOP_MOVE_RIGHT 0x08   // 0x53
+// 停止キー（ビット）
+#define TELEOP_STOP_LINEAR  0x01 // ,（0x3A）
+#define TELEOP_STOP_ANGULAR 0x02 // .（0x3B）
+
+// 移動キーのテレオペ送信（ロボット操縦用）
+// 移動キーだけが押されている間、押している組み合わせを周期タイマー（esp_timer）ごとに1回タップとして送る。
+// 押した瞬間・組み合わせが変わった瞬間はすぐ送り、そこから周期を数え直す（初回の遅延なし）。
+// リリースと停止キー（, .）は優先の通知ですぐ処理し、待っている周期の送信より先に送る。
+// 停止キーを押したら、移動キーを全部離すまで送らない。
+// 送るキーはBleKeyboardの共有のレポートに足し引きする（他のタスクが押しているキーと混ざっても消さない）。
+// タスクが前の周期をまだ送っていないうちに次の周期が来たら、期限超過として数える。
+class TeleopStreamer {
+public:
+    // 送信タスクと周期タイマーを用意する（用意できなければfalse）
+    bool begin(BleKeyboard* keyboard, BaseType_t core);
+    // begin()が成功した（falseなら矢印は長押しリピートのまま送る）
+    bool isAvailable() const { return task != nullptr; }
+
+    // キーの状態（ビット列）から移動キー・停止キー・それ以外のキーを分ける
+    static void classify(const uint8_t* keys, uint8_t& moves, uint8_t& stops, bool& other);
+    // 押している移動キー・停止キーを置く（USBタスクから呼ぶ）。新しく押したキーがあればtrue
+    bool update(uint8_t moves, uint8_t stops);
+
+    // 送る周期（どのタスクから呼んでもよい。次に送り始める時から）
+    void setRate(uint16_t hz) { if (hz > 0) periodUs = 1000000UL / hz; }
+    bool isStreaming() const { return streaming; }
+
+    // 統計
+    uint32_t getSent() const { return sent; }
+    uint32_t getStops() const { return stopsSent; }
+    uint32_t getMissedDeadlines() const { return missedDeadlines; }
+    uint32_t getMaxLatencyUs() const { return maxLatencyUs; }
+
+private:
+    static void teleopTask(void* pvParameters);
+    static void onTimer(void* arg);
+    void run();
+    // 移動キーの組み合わせを1回タップとして送る
+    void sendMoves(uint8_t moves);
+    // 停止キーを1回タップとして送る（キーはBleKeyboard::press()と同じ）
+    void sendTap(uint8_t key);
+
+    BleKeyboard* keyboard = nullptr;
+    TaskHandle_t task = nullptr;
+    esp_timer_handle_t timer = nullptr;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    // USBタスクが置いた状態
+    uint8_t moves = 0;
+    uint8_t stops = 0;
+    bool halted = false;            // 停止キーを押した（移動キーを全部離すまで送らない）
+    uint8_t pendingStops = 0;       // まだ送っていない停止キー
+    volatile bool streaming = false;
+
+    // 周期の送信
+    volatile bool tickPending = false;
+    volatile int64_t tickUs = 0;
+    volatile uint32_t periodUs = 1000000UL / TELEOP_RATE_HZ;
+
+    volatile uint32_t sent = 0;
+    volatile uint32_t stopsSent = 0;
+    volatile uint32_t missedDeadlines = 0;
+    volatile uint32_t maxLatencyUs = 0;
+};
+
+// グローバルインスタンス
+extern TeleopStreamer teleopStreamer;
+
+#endif // TELEOP_STREAMER_H
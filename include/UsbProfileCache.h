@@ -0,0 +1,16 @@
+#ifndef USB_PROFILE_CACHE_H
+#define USB_PROFILE_CACHE_H
+
+#include "EspUsbHost.h"
+
+// USBデバイスの解析結果をNVSに保存する（キーはVID/PID/bcdDevice）
+// 読み書きはUSBタスクからだけ行う。保存は初めて見たデバイスの解析が終わった時に1回だけ。
+namespace UsbProfileCache {
+  // 保存済みの解析結果を読む（無い・バージョン違い・壊れていればfalse）
+  bool load(uint16_t vendorId, uint16_t productId, uint16_t bcdDevice, UsbDeviceProfile &profile);
+  bool save(const UsbDeviceProfile &profile);
+  // 使えなかった解析結果を消す（次の接続で解析し直す）
+  void erase(uint16_t vendorId, uint16_t productId, uint16_t bcdDevice);
+}
+
+#endif // USB_PROFILE_CACHE_H
@@ -29,6 +29,8 @@
 // Report IDs:
 #define KEYBOARD_ID 0x01
 #define MEDIA_KEYS_ID 0x02
+#define MOUSE_ID 0x03
+#define GAMEPAD_ID 0x04
 
 static const uint8_t _hidReportDescriptor[] = {
   USAGE_PAGE(1),      0x01,          // USAGE_PAGE (Generic Desktop Ctrls)
@@ -92,9 +94,93 @@ static const uint8_t _hidReportDescriptor[] = {
   USAGE(2),           0x83, 0x01,    //   Usage (Media sel)   ; bit 6: 64
   USAGE(2),           0x8A, 0x01,    //   Usage (Mail)        ; bit 7: 128
   HIDINPUT(1),        0x02,          //   INPUT (Data,Var,Abs,No Wrap,Linear,Preferred State,No Null Position)
+  END_COLLECTION(0),                 // END_COLLECTION
+  // ------------------------------------------------- Mouse
+  USAGE_PAGE(1),      0x01,          // USAGE_PAGE (Generic Desktop)
+  USAGE(1),           0x02,          // USAGE (Mouse)
+  COLLECTION(1),      0x01,          // COLLECTION (Application)
+  REPORT_ID(1),       MOUSE_ID,      //   REPORT_ID (3)
+  USAGE(1),           0x01,          //   USAGE (Pointer)
+  COLLECTION(1),      0x00,          //   COLLECTION (Physical)
+  USAGE_PAGE(1),      0x09,          //     USAGE_PAGE (Button)
+  USAGE_MINIMUM(1),   0x01,          //     USAGE_MINIMUM (Button 1)
+  USAGE_MAXIMUM(1),   0x05,          //     USAGE_MAXIMUM (Button 5)
+  LOGICAL_MINIMUM(1), 0x00,          //     LOGICAL_MINIMUM (0)
+  LOGICAL_MAXIMUM(1), 0x01,          //     LOGICAL_MAXIMUM (1)
+  REPORT_SIZE(1),     0x01,          //     REPORT_SIZE (1)
+  REPORT_COUNT(1),    0x05,          //     REPORT_COUNT (5) ; 5 buttons
+  HIDINPUT(1),        0x02,          //     INPUT (Data,Var,Abs)
+  REPORT_SIZE(1),     0x03,          //     REPORT_SIZE (3) ; 3 bits (Padding)
+  REPORT_COUNT(1),    0x01,          //     REPORT_COUNT (1)
+  HIDINPUT(1),        0x03,          //     INPUT (Const,Var,Abs)
+  USAGE_PAGE(1),      0x01,          //     USAGE_PAGE (Generic Desktop)
+  USAGE(1),           0x30,          //     USAGE (X)
+  USAGE(1),           0x31,          //     USAGE (Y)
+  USAGE(1),           0x38,          //     USAGE (Wheel)
+  LOGICAL_MINIMUM(1), 0x81,          //     LOGICAL_MINIMUM (-127)
+  LOGICAL_MAXIMUM(1), 0x7f,          //     LOGICAL_MAXIMUM (127)
+  REPORT_SIZE(1),     0x08,          //     REPORT_SIZE (8)
+  REPORT_COUNT(1),    0x03,          //     REPORT_COUNT (3)
+  HIDINPUT(1),        0x06,          //     INPUT (Data,Var,Rel)
+  USAGE_PAGE(1),      0x0C,          //     USAGE_PAGE (Consumer)
+  USAGE(2),           0x38, 0x02,    //     USAGE (AC Pan)
+  LOGICAL_MINIMUM(1), 0x81,          //     LOGICAL_MINIMUM (-127)
+  LOGICAL_MAXIMUM(1), 0x7f,          //     LOGICAL_MAXIMUM (127)
+  REPORT_SIZE(1),     0x08,          //     REPORT_SIZE (8)
+  REPORT_COUNT(1),    0x01,          //     REPORT_COUNT (1)
+  HIDINPUT(1),        0x06,          //     INPUT (Data,Var,Rel)
+  END_COLLECTION(0),                 //   END_COLLECTION
+  END_COLLECTION(0),                 // END_COLLECTION
+  // ------------------------------------------------- Gamepad
+  USAGE_PAGE(1),      0x01,          // USAGE_PAGE (Generic Desktop)
+  USAGE(1),           0x05,          // USAGE (Gamepad)
+  COLLECTION(1),      0x01,          // COLLECTION (Application)
+  REPORT_ID(1),       GAMEPAD_ID,    //   REPORT_ID (4)
+  USAGE_PAGE(1),      0x09,          //   USAGE_PAGE (Button)
+  USAGE_MINIMUM(1),   0x01,          //   USAGE_MINIMUM (Button 1)
+  USAGE_MAXIMUM(1),   0x10,          //   USAGE_MAXIMUM (Button 16)
+  LOGICAL_MINIMUM(1), 0x00,          //   LOGICAL_MINIMUM (0)
+  LOGICAL_MAXIMUM(1), 0x01,          //   LOGICAL_MAXIMUM (1)
+  REPORT_SIZE(1),     0x01,          //   REPORT_SIZE (1)
+  REPORT_COUNT(1),    0x10,          //   REPORT_COUNT (16) ; 16 buttons
+  HIDINPUT(1),        0x02,          //   INPUT (Data,Var,Abs)
+  USAGE_PAGE(1),      0x01,          //   USAGE_PAGE (Generic Desktop)
+  USAGE(1),           0x39,          //   USAGE (Hat switch)
+  LOGICAL_MINIMUM(1), 0x01,          //   LOGICAL_MINIMUM (1)
+  LOGICAL_MAXIMUM(1), 0x08,          //   LOGICAL_MAXIMUM (8)
+  REPORT_SIZE(1),     0x04,          //   REPORT_SIZE (4)
+  REPORT_COUNT(1),    0x01,          //   REPORT_COUNT (1)
+  HIDINPUT(1),        0x42,          //   INPUT (Data,Var,Abs,Null State) ; 0 = centered
+  REPORT_SIZE(1),     0x04,          //   REPORT_SIZE (4) ; 4 bits (Padding)
+  REPORT_COUNT(1),    0x01,          //   REPORT_COUNT (1)
+  HIDINPUT(1),        0x03,          //   INPUT (Const,Var,Abs)
+  USAGE(1),           0x30,          //   USAGE (X)
+  USAGE(1),           0x31,          //   USAGE (Y)
+  USAGE(1),           0x32,          //   USAGE (Z)
+  USAGE(1),           0x35,          //   USAGE (Rz)
+  USAGE(1),           0x33,          //   USAGE (Rx)
+  USAGE(1),           0x34,          //   USAGE (Ry)
+  LOGICAL_MINIMUM(1), 0x81,          //   LOGICAL_MINIMUM (-127)
+  LOGICAL_MAXIMUM(1), 0x7f,          //   LOGICAL_MAXIMUM (127)
+  REPORT_SIZE(1),     0x08,          //   REPORT_SIZE (8)
+  REPORT_COUNT(1),    0x06,          //   REPORT_COUNT (6)
+  HIDINPUT(1),        0x02,          //   INPUT (Data,Var,Abs)
   END_COLLECTION(0)                  // END_COLLECTION
 };
 
+// Holds the report lock for the current scope (no-op before begin())
+class ReportLock {
+public:
+  explicit ReportLock(SemaphoreHandle_t mutex) : mutex(mutex) {
+    if (mutex) xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+  }
+  ~ReportLock() {
+    if (mutex) xSemaphoreGiveRecursive(mutex);
+  }
+private:
+  SemaphoreHandle_t mutex;
+};
+
 BleKeyboard::BleKeyboard(std::string deviceName, std::string deviceManufacturer, uint8_t batteryLevel) 
     : hid(0)
     , deviceName(std::string(deviceName).substr(0, 15))
@@ -103,6 +189,8 @@ BleKeyboard::BleKeyboard(std::string deviceName, std::string deviceManufacturer,
 
 void BleKeyboard::begin(void)
 {
+  if (reportLock == nullptr) reportLock = xSemaphoreCreateRecursiveMutex();
+
   BLEDevice::init(deviceName);
   BLEServer* pServer = BLEDevice::createServer();
   pServer->setCallbacks(this);
@@ -111,6 +199,8 @@ void BleKeyboard::begin(void)
   inputKeyboard = hid->inputReport(KEYBOARD_ID);  // <-- input REPORTID from report map
   outputKeyboard = hid->outputReport(KEYBOARD_ID);
   inputMediaKeys = hid->inputReport(MEDIA_KEYS_ID);
+  inputMouse = hid->inputReport(MOUSE_ID);
+  inputGamepad = hid->inputReport(GAMEPAD_ID);
 
   outputKeyboard->setCallbacks(this);
 
@@ -188,6 +278,7 @@ void BleKeyboard::set_version(uint16_t version) {
 
 void BleKeyboard::sendReport(BLEKeyReport* keys)
 {
+  ReportLock lock(reportLock);
   if (this->isConnected())
   {
     this->inputKeyboard->setValue((uint8_t*)keys, sizeof(BLEKeyReport));
@@ -201,6 +292,7 @@ void BleKeyboard::sendReport(BLEKeyReport* keys)
 
 void BleKeyboard::sendReport(MediaKeyReport* keys)
 {
+  ReportLock lock(reportLock);
   if (this->isConnected())
   {
     this->inputMediaKeys->setValue((uint8_t*)keys, sizeof(MediaKeyReport));
@@ -212,6 +304,30 @@ void BleKeyboard::sendReport(MediaKeyReport* keys)
   }	
 }
 
+void BleKeyboard::sendReport(BLEGamepadReport* gamepad)
+{
+  if (this->isConnected())
+  {
+    this->inputGamepad->setValue((uint8_t*)gamepad, sizeof(BLEGamepadReport));
+    this->inputGamepad->notify();
+#if defined(USE_NIMBLE)
+    this->delay_ms(_delay_ms);
+#endif // USE_NIMBLE
+  }
+}
+
+void BleKeyboard::sendReport(BLEMouseReport* mouse)
+{
+  if (this->isConnected())
+  {
+    this->inputMouse->setValue((uint8_t*)mouse, sizeof(BLEMouseReport));
+    this->inputMouse->notify();
+#if defined(USE_NIMBLE)
+    this->delay_ms(_delay_ms);
+#endif // USE_NIMBLE
+  }
+}
+
 extern
 const uint8_t _asciimap[128] PROGMEM;
 
@@ -357,6 +473,18 @@ uint8_t USBPutChar(uint8_t c);
 // USB HID works, the host acts like the key remains pressed until we
 // call release(), releaseAll(), or otherwise clear the report and resend.
 size_t BleKeyboard::press(uint8_t k)
+{
+	ReportLock lock(reportLock);
+	if (!addKey(k)) {
+		setWriteError();
+		return 0;
+	}
+	sendReport(&_keyReport);
+	return 1;
+}
+
+// Adds k to _keyReport without sending (call with reportLock held)
+bool BleKeyboard::addKey(uint8_t k)
 {
 	uint8_t i;
 	if (k >= 136) {			// it's a non-printing key (not a modifier)
@@ -367,8 +495,7 @@ size_t BleKeyboard::press(uint8_t k)
 	} else {				// it's a printing key
 		k = pgm_read_byte(_asciimap + k);
 		if (!k) {
-			setWriteError();
-			return 0;
+			return false;
 		}
 		if (k & 0x80) {						// it's a capital letter or other character reached with shift
 			_keyReport.modifiers |= 0x02;	// the left shift modifier
@@ -389,16 +516,15 @@ size_t BleKeyboard::press(uint8_t k)
 			}
 		}
 		if (i == 6) {
-			setWriteError();
-			return 0;
+			return false;
 		}
 	}
-	sendReport(&_keyReport);
-	return 1;
+	return true;
 }
 
 size_t BleKeyboard::press(const MediaKeyReport k)
 {
+    ReportLock lock(reportLock);
     uint16_t k_16 = k[1] | (k[0] << 8);
     uint16_t mediaKeyReport_16 = _mediaKeyReport[1] | (_mediaKeyReport[0] << 8);
 
@@ -414,6 +540,17 @@ size_t BleKeyboard::press(const MediaKeyReport k)
 // sends the report.  This tells the OS the key is no longer pressed and that
 // it shouldn't be repeated any more.
 size_t BleKeyboard::release(uint8_t k)
+{
+	ReportLock lock(reportLock);
+	if (!removeKey(k)) {
+		return 0;
+	}
+	sendReport(&_keyReport);
+	return 1;
+}
+
+// Removes k from _keyReport without sending (call with reportLock held)
+bool BleKeyboard::removeKey(uint8_t k)
 {
 	uint8_t i;
 	if (k >= 136) {			// it's a non-printing key (not a modifier)
@@ -424,7 +561,7 @@ size_t BleKeyboard::release(uint8_t k)
 	} else {				// it's a printing key
 		k = pgm_read_byte(_asciimap + k);
 		if (!k) {
-			return 0;
+			return false;
 		}
 		if (k & 0x80) {							// it's a capital letter or other character reached with shift
 			_keyReport.modifiers &= ~(0x02);	// the left shift modifier
@@ -439,13 +576,12 @@ size_t BleKeyboard::release(uint8_t k)
 			_keyReport.keys[i] = 0x00;
 		}
 	}
-
-	sendReport(&_keyReport);
-	return 1;
+	return true;
 }
 
 size_t BleKeyboard::release(const MediaKeyReport k)
 {
+    ReportLock lock(reportLock);
     uint16_t k_16 = k[1] | (k[0] << 8);
     uint16_t mediaKeyReport_16 = _mediaKeyReport[1] | (_mediaKeyReport[0] << 8);
     mediaKeyReport_16 &= ~k_16;
@@ -456,8 +592,34 @@ size_t BleKeyboard::release(const MediaKeyReport k)
 	return 1;
 }
 
+// pressKeys()/releaseKeys() change several keys in the shared report and send it once,
+// so keys held by other callers stay pressed.
+size_t BleKeyboard::pressKeys(const uint8_t* keys, size_t count)
+{
+	ReportLock lock(reportLock);
+	size_t n = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (addKey(keys[i])) n++;
+	}
+	if (n < count) setWriteError();
+	if (n > 0) sendReport(&_keyReport);
+	return n;
+}
+
+size_t BleKeyboard::releaseKeys(const uint8_t* keys, size_t count)
+{
+	ReportLock lock(reportLock);
+	size_t n = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (removeKey(keys[i])) n++;
+	}
+	sendReport(&_keyReport);
+	return n;
+}
+
 void BleKeyboard::releaseAll(void)
 {
+	ReportLock lock(reportLock);
 	_keyReport.keys[0] = 0;
 	_keyReport.keys[1] = 0;
 	_keyReport.keys[2] = 0;
@@ -473,6 +635,7 @@ void BleKeyboard::releaseAll(void)
 
 size_t BleKeyboard::write(uint8_t c)
 {
+	ReportLock lock(reportLock);	// keep the keydown/keyup pair together
 	uint8_t p = press(c);  // Keydown
 	release(c);            // Keyup
 	return p;              // just return the result of press() since release() almost always returns 1
@@ -480,6 +643,7 @@ size_t BleKeyboard::write(uint8_t c)
 
 size_t BleKeyboard::write(const MediaKeyReport c)
 {
+	ReportLock lock(reportLock);
 	uint16_t p = press(c);  // Keydown
 	release(c);            // Keyup
 	return p;              // just return the result of press() since release() almost always returns 1
@@ -509,6 +673,10 @@ void BleKeyboard::onConnect(BLEServer* pServer) {
   desc->setNotifications(true);
   desc = (BLE2902*)this->inputMediaKeys->getDescriptorByUUID(BLEUUID((uint16_t)0x2902));
   desc->setNotifications(true);
+  desc = (BLE2902*)this->inputMouse->getDescriptorByUUID(BLEUUID((uint16_t)0x2902));
+  desc->setNotifications(true);
+  desc = (BLE2902*)this->inputGamepad->getDescriptorByUUID(BLEUUID((uint16_t)0x2902));
+  desc->setNotifications(true);
 
 #endif // !USE_NIMBLE
 
@@ -523,6 +691,10 @@ void BleKeyboard::onDisconnect(BLEServer* pServer) {
   desc->setNotifications(false);
   desc = (BLE2902*)this->inputMediaKeys->getDescriptorByUUID(BLEUUID((uint16_t)0x2902));
   desc->setNotifications(false);
+  desc = (BLE2902*)this->inputMouse->getDescriptorByUUID(BLEUUID((uint16_t)0x2902));
+  desc->setNotifications(false);
+  desc = (BLE2902*)this->inputGamepad->getDescriptorByUUID(BLEUUID((uint16_t)0x2902));
+  desc->setNotifications(false);
 
   advertising->start();
 
@@ -530,9 +702,10 @@ void BleKeyboard::onDisconnect(BLEServer* pServer) {
 }
 
 void BleKeyboard::onWrite(BLECharacteristic* me) {
-  uint8_t* value = (uint8_t*)(me->getValue().c_str());
-  (void)value;
-  ESP_LOGI(LOG_TAG, "special keys: %d", *value);
+  std::string value = me->getValue();
+  if (value.empty()) return;
+  _ledState = (uint8_t)value[0];
+  ESP_LOGI(LOG_TAG, "special keys: %d", _ledState);
 }
 
 void BleKeyboard::delay_ms(uint64_t ms) {
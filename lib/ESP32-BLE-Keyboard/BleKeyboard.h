@@ -27,6 +27,8 @@
 #endif // USE_NIMBLE
 
 #include "Print.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 #define BLE_KEYBOARD_VERSION "0.0.4"
 #define BLE_KEYBOARD_VERSION_MAJOR 0
@@ -128,6 +130,24 @@ typedef struct
   uint8_t keys[6];
 } BLEKeyReport;
 
+//  Mouse report: 5 buttons, relative X/Y, wheel and horizontal pan
+typedef struct
+{
+  uint8_t buttons;
+  int8_t x;
+  int8_t y;
+  int8_t wheel;
+  int8_t pan;
+} BLEMouseReport;
+
+//  Gamepad report: 16 buttons, hat switch (0 = centered, 1-8 clockwise from up), 6 axes (X, Y, Z, Rz, Rx, Ry)
+typedef struct __attribute__((packed))
+{
+  uint16_t buttons;
+  uint8_t hat;
+  int8_t axes[6];
+} BLEGamepadReport;
+
 class BleKeyboard : public Print, public BLEServerCallbacks, public BLECharacteristicCallbacks
 {
 private:
@@ -135,6 +155,8 @@ private:
   BLECharacteristic* inputKeyboard;
   BLECharacteristic* outputKeyboard;
   BLECharacteristic* inputMediaKeys;
+  BLECharacteristic* inputMouse;
+  BLECharacteristic* inputGamepad;
   BLEAdvertising*    advertising;
   BLEKeyReport          _keyReport;
   MediaKeyReport     _mediaKeyReport;
@@ -143,7 +165,12 @@ private:
   uint8_t            batteryLevel;
   bool               connected = false;
   uint32_t           _delay_ms = 7;
+  volatile uint8_t   _ledState = 0;   // last LED output report from the host (NumLock=0x01, CapsLock=0x02, ScrollLock=0x04)
+  // Serializes _keyReport/_mediaKeyReport updates and sends from several tasks (recursive: write() nests press()/release())
+  SemaphoreHandle_t  reportLock = nullptr;
   void delay_ms(uint64_t ms);
+  bool addKey(uint8_t k);
+  bool removeKey(uint8_t k);
 
   uint16_t vid       = 0x05ac;
   uint16_t pid       = 0x820a;
@@ -155,15 +182,22 @@ public:
   void end(void);
   void sendReport(BLEKeyReport* keys);
   void sendReport(MediaKeyReport* keys);
+  void sendReport(BLEMouseReport* mouse);
+  void sendReport(BLEGamepadReport* gamepad);
   size_t press(uint8_t k);
   size_t press(const MediaKeyReport k);
   size_t release(uint8_t k);
   size_t release(const MediaKeyReport k);
+  // Press/release several keys (same codes as press()) and send a single report
+  size_t pressKeys(const uint8_t* keys, size_t count);
+  size_t releaseKeys(const uint8_t* keys, size_t count);
   size_t write(uint8_t c);
   size_t write(const MediaKeyReport c);
   size_t write(const uint8_t *buffer, size_t size);
   void releaseAll(void);
   bool isConnected(void);
+  // LED state written by the host (updated from the BLE stack's task; poll it)
+  uint8_t getLedState(void) const { return _ledState; }
   void setBatteryLevel(uint8_t level);
   void setName(std::string deviceName);  
   void setDelay(uint32_t ms);
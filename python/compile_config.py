@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+"""
+設定コンパイラ
+
+読みやすいJSONの設定（キーマップ・長押しリピート・キーの名前・文字表示）を、
+ファームウェアがそのまま参照できる固定レイアウトのバイナリに変換します。
+形式は include/ConfigStore.h の ConfigHeader を参照してください（両方を合わせて変更すること）。
+
+使い方:
+    python3 python/compile_config.py                          # data/config.bin を作る（pio run -t uploadfs で書き込み）
+    python3 python/compile_config.py -i my.json -o my.bin     # 入力・出力を指定
+    python3 python/compile_config.py --upload /dev/ttyACM0    # シリアルで送って、その場で切り替える（pyserialが必要）
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+import time
+import zlib
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+DEFAULT_SOURCE = os.path.join(ROOT, "python", "kb16_config.json")
+DEFAULT_OUTPUT = os.path.join(ROOT, "data", "config.bin")
+
+MAGIC = 0x4643424B  # "KBCF"
+VERSION = 1
+NONE = 0xFFFF
+MAX_SIZE = 65535
+KEYMAP_LAYERS = 4
+TEXT_SHIFT_INVARIANT = 0x01
+
+# ConfigHeader: magic, version, headerSize, totalSize, crc32, repeatDelayMs, repeatRateMs,
+# namesOffset, keymapOffset, keymapCount, textIndexOffset, textOffset, textCount, stringsOffset, reserved
+HEADER = struct.Struct("<IHHIIHHHHHHHHHH")
+KEY_NAME = struct.Struct("<HH")        # ConfigKeyName
+KEYMAP_ENTRY = struct.Struct("<BBH")   # KeymapEntry
+DISPLAY_TEXT = struct.Struct("<BBHH")  # ConfigDisplayText
+
+# include/KeyLayers.h の KeyActionKind と同じ順
+ACTIONS = {
+    "KC": (0, 1),       # KC(keycode)
+    "MO": (2, 1),       # MO(layer)
+    "TG": (3, 1),       # TG(layer)
+    "LT": (4, 2),       # LT(layer, keycode)
+    "MT": (5, 2),       # MT(mod, keycode)
+    "MC": (6, 1),       # MC(index)
+}
+ACTION_RE = re.compile(r"^\s*(\w+)\s*(?:\((.*)\))?\s*$")
+
+
+def parse_int(value, what):
+    """数値か "0x4A" のような文字列"""
+    try:
+        return value if isinstance(value, int) else int(str(value), 0)
+    except ValueError:
+        sys.exit(f"{what}: 数値ではありません: {value!r}")
+
+
+def key_action(kind, arg, keycode):
+    return (kind << 12) | ((arg & 0x0F) << 8) | (keycode & 0xFF)
+
+
+def parse_action(text):
+    """"LT(1, 0x4A)" などをKeyActionの16ビット値にする"""
+    m = ACTION_RE.match(text)
+    if not m:
+        sys.exit(f"動作を読めません: {text!r}")
+    name, args = m.group(1), m.group(2)
+    if name == "KC_NO":
+        return key_action(0, 0, 0)
+    if name == "KC_TRANS":
+        return key_action(1, 0, 0)
+    if name == "MC_STOP":
+        return key_action(6, 0, 0xFF)
+    if name not in ACTIONS:
+        sys.exit(f"知らない動作です: {text!r}")
+    kind, argc = ACTIONS[name]
+    values = [parse_int(a.strip(), text) for a in args.split(",")] if args else []
+    if len(values) != argc:
+        sys.exit(f"{name}の引数は{argc}個です: {text!r}")
+    if argc == 2:
+        return key_action(kind, values[0], values[1])
+    if kind in (2, 3):
+        return key_action(kind, values[0], 0)
+    return key_action(kind, 0, values[0])
+
+
+class Strings:
+    """文字列領域（同じ文字列は1つにまとめる）"""
+
+    def __init__(self):
+        self.data = bytearray()
+        self.offsets = {}
+
+    def add(self, text):
+        if text is None:
+            return NONE
+        if text not in self.offsets:
+            self.offsets[text] = len(self.data)
+            self.data += text.encode("utf-8") + b"\0"
+        return self.offsets[text]
+
+
+def align(blob):
+    while len(blob) % 4:
+        blob.append(0)
+    return len(blob)
+
+
+def compile_config(source):
+    strings = Strings()
+    body = bytearray(HEADER.size)
+
+    names_offset = NONE
+    key_names = source.get("key_names", {})
+    if key_names:
+        names_offset = align(body)
+        table = [(NONE, NONE)] * 256
+        for key, names in key_names.items():
+            normal, shifted = (names, names) if isinstance(names, str) else names
+            table[parse_int(key, "key_names")] = (strings.add(normal), strings.add(shifted))
+        for normal, shifted in table:
+            body += KEY_NAME.pack(normal, shifted)
+
+    keymap = source.get("keymap", [])
+    keymap_offset = align(body)
+    for entry in keymap:
+        layer = parse_int(entry["layer"], "layer")
+        if not 0 <= layer < KEYMAP_LAYERS:
+            sys.exit(f"レイヤーは0〜{KEYMAP_LAYERS - 1}です: {entry}")
+        body += KEYMAP_ENTRY.pack(layer, parse_int(entry["key"], "key"), parse_action(entry["action"]))
+
+    texts = source.get("display_texts", [])
+    text_index_offset = align(body)
+    text_offset = text_index_offset
+    if texts:
+        if len(texts) > 255:
+            sys.exit("文字表示は255個までです")
+        index = bytearray(256)
+        for i, t in enumerate(texts):
+            index[parse_int(t["key"], "key")] = i + 1
+        body += index
+        text_offset = align(body)
+        for t in texts:
+            flags = TEXT_SHIFT_INVARIANT if t.get("shift_invariant") else 0
+            body += DISPLAY_TEXT.pack(parse_int(t["key"], "key"), flags,
+                                      strings.add(t["text1"]), strings.add(t.get("text2")))
+
+    strings_offset = align(body)
+    if not strings.data:
+        strings.data = bytearray(b"\0")   # ファームウェアは末尾が0であることを確かめる
+    body += strings.data
+    if len(body) > MAX_SIZE:
+        sys.exit(f"設定が大きすぎます ({len(body)} バイト)")
+
+    crc = zlib.crc32(bytes(body[HEADER.size:])) & 0xFFFFFFFF
+    repeat = source.get("repeat", {})
+    HEADER.pack_into(body, 0, MAGIC, VERSION, HEADER.size, len(body), crc,
+                     parse_int(repeat.get("delay_ms", 0), "delay_ms"),
+                     parse_int(repeat.get("rate_ms", 0), "rate_ms"),
+                     names_offset, keymap_offset, len(keymap),
+                     text_index_offset, text_offset, len(texts), strings_offset, 0)
+    return bytes(body)
+
+
+def upload(port, blob, baud):
+    """シリアルで送る（ファームウェアはキーが全部離れた時に切り替える）"""
+    try:
+        import serial
+    except ImportError:
+        sys.exit("--upload には pyserial が必要です (pip install pyserial)")
+    with serial.Serial(port, baud, timeout=0.2) as ser:
+        ser.write(f"config upload {len(blob)}\n".encode("ascii"))
+        ser.flush()
+        time.sleep(0.05)
+        ser.write(blob)
+        ser.flush()
+        deadline = time.time() + 4.0
+        while time.time() < deadline:
+            line = ser.readline().decode("utf-8", "replace").strip()
+            if line.startswith("設定:"):
+                print(line)
+                return
+
+
+def main():
+    parser = argparse.ArgumentParser(description="設定のJSONをファームウェア用のバイナリにする")
+    parser.add_argument("-i", "--input", default=DEFAULT_SOURCE, help="設定のJSON")
+    parser.add_argument("-o", "--output", default=DEFAULT_OUTPUT, help="出力するバイナリ")
+    parser.add_argument("--upload", metavar="PORT", help="シリアルで送ってその場で切り替える")
+    parser.add_argument("--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    with open(args.input, encoding="utf-8") as f:
+        blob = compile_config(json.load(f))
+    os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+    with open(args.output, "wb") as f:
+        f.write(blob)
+    print(f"{os.path.relpath(args.output, ROOT)}: {len(blob)} バイト")
+
+    if args.upload:
+        upload(args.upload, blob, args.baud)
+
+
+if __name__ == "__main__":
+    main()
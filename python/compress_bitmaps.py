@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+"""
+ビットマップ圧縮ツール
+
+src/BitmapImages.h の128x64 XBM配列を読み込み、U8G2のタイル形式に並べ替えてから
+ランレングス圧縮した配列を src/BitmapImagesRle.h に出力します。
+圧縮形式と展開処理は include/RleBitmap.h を参照してください。
+
+使い方:
+    python3 python/compress_bitmaps.py           # src/BitmapImagesRle.h を再生成
+    python3 python/compress_bitmaps.py --bench   # ホストで展開時間をdrawXBMP相当と比較
+"""
+
+import argparse
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SRC_HEADER = os.path.join(ROOT, "src", "BitmapImages.h")
+OUT_HEADER = os.path.join(ROOT, "src", "BitmapImagesRle.h")
+
+WIDTH = 128
+HEIGHT = 64
+FRAME_BYTES = WIDTH * HEIGHT // 8
+
+ARRAY_RE = re.compile(r"const\s+unsigned\s+char\s+(\w+)\s*\[\]\s*PROGMEM\s*=\s*\{(.*?)\};", re.S)
+
+
+def load_xbm_arrays(path):
+    """BitmapImages.h から (名前, バイト列) のリストを取り出す"""
+    with open(path, encoding="utf-8") as f:
+        text = f.read()
+    images = []
+    for name, body in ARRAY_RE.findall(text):
+        data = bytes(int(v, 16) for v in re.findall(r"0x[0-9a-fA-F]{2}", body))
+        if len(data) != FRAME_BYTES:
+            sys.exit(f"{name}: {len(data)}バイト（128x64の{FRAME_BYTES}バイトではありません）")
+        images.append((name, data))
+    return images
+
+
+def xbm_to_tiles(xbm):
+    """XBM（行優先、LSBが左）をU8G2タイル形式（ページ優先、LSBが上）へ変換"""
+    tiles = bytearray(FRAME_BYTES)
+    row_bytes = WIDTH // 8
+    for y in range(HEIGHT):
+        for x in range(WIDTH):
+            if xbm[y * row_bytes + x // 8] & (1 << (x % 8)):
+                tiles[(y // 8) * WIDTH + x] |= 1 << (y % 8)
+    return bytes(tiles)
+
+
+def rle_encode(data):
+    """0x80|(n-1),v の連続 / (n-1),v0.. のリテラル で符号化"""
+    out = bytearray()
+    literal = bytearray()
+    i = 0
+
+    def flush_literal():
+        while literal:
+            chunk = literal[:128]
+            out.append(len(chunk) - 1)
+            out.extend(chunk)
+            del literal[:128]
+
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and data[i + run] == data[i] and run < 128:
+            run += 1
+        # 2バイト以下の連続はリテラルに含めたほうが短い
+        if run >= 3:
+            flush_literal()
+            out.append(0x80 | (run - 1))
+            out.append(data[i])
+            i += run
+        else:
+            literal.extend(data[i:i + run])
+            i += run
+    flush_literal()
+    return bytes(out)
+
+
+def rle_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        ctrl = data[i]
+        n = (ctrl & 0x7F) + 1
+        if ctrl & 0x80:
+            out.extend(bytes([data[i + 1]]) * n)
+            i += 2
+        else:
+            out.extend(data[i + 1:i + 1 + n])
+            i += 1 + n
+    return bytes(out)
+
+
+def rle_name(name):
+    return name.replace("epd_bitmap_", "rle_bitmap_")
+
+
+def format_array(data, indent="\t", per_line=16):
+    lines = []
+    for i in range(0, len(data), per_line):
+        lines.append(indent + ", ".join(f"0x{b:02x}" for b in data[i:i + per_line]) + ",")
+    return "\n".join(lines)
+
+
+def generate(images):
+    parts = [
+        "// このファイルは python/compress_bitmaps.py により自動生成されます。直接編集しないでください。",
+        "// 元データ: src/BitmapImages.h（128x64 XBM）",
+        "#pragma once",
+        '#include "RleBitmap.h"',
+        "",
+    ]
+    total_raw = 0
+    total_rle = 0
+    for name, xbm in images:
+        tiles = xbm_to_tiles(xbm)
+        rle = rle_encode(tiles)
+        assert rle_decode(rle) == tiles, name
+        total_raw += len(xbm)
+        total_rle += len(rle)
+        rname = rle_name(name)
+        parts.append(f"// {name}: {len(xbm)} -> {len(rle)} バイト")
+        parts.append(f"static const uint8_t {rname}_data[] = {{")
+        parts.append(format_array(rle))
+        parts.append("};")
+        parts.append(f"static const RleBitmap {rname} = {{ {rname}_data, sizeof({rname}_data) }};")
+        parts.append("")
+    parts.append(f"// 合計: {total_raw} -> {total_rle} バイト")
+    parts.append("")
+    return "\n".join(parts), total_raw, total_rle
+
+
+BENCH_SOURCE = r"""
+#include <chrono>
+#include <cstdio>
+#include "RleBitmap.h"
+#include "BitmapImagesRle.h"
+
+// drawXBMP相当：XBMの各ドットを1つずつU8G2タイルバッファへ書き込む
+static void drawXbmpReference(const uint8_t* xbm, uint8_t* buf) {
+    memset(buf, 0, 1024);
+    for (int y = 0; y < 64; y++) {
+        for (int x = 0; x < 128; x++) {
+            if (xbm[y * 16 + x / 8] & (1 << (x % 8))) {
+                buf[(y / 8) * 128 + x] |= (uint8_t)(1 << (y % 8));
+            }
+        }
+    }
+}
+
+@RAW_ARRAYS@
+
+int main() {
+    const int iterations = 20000;
+    static uint8_t buf[1024];
+    volatile uint8_t sink = 0;
+    struct Item { const char* name; const uint8_t* xbm; const RleBitmap* rle; } items[] = {
+@ITEMS@
+    };
+    for (const Item& it : items) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) { drawXbmpReference(it.xbm, buf); sink ^= buf[i & 1023]; }
+        auto t1 = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) { rleDecodeTiles(*it.rle, buf); sink ^= buf[i & 1023]; }
+        auto t2 = std::chrono::steady_clock::now();
+        double xbmNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+        double rleNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / iterations;
+        printf("%-24s drawXBMP相当 %8.0f ns  RLE展開 %8.0f ns  (x%.1f)\n", it.name, xbmNs, rleNs, xbmNs / rleNs);
+    }
+    return sink == 0x5a ? 1 : 0;
+}
+"""
+
+
+def bench(images):
+    cxx = shutil.which("c++") or shutil.which("g++") or shutil.which("clang++")
+    if not cxx:
+        sys.exit("C++コンパイラが見つかりません")
+    raw_arrays = []
+    items = []
+    for name, xbm in images:
+        raw_arrays.append(f"static const uint8_t {name}[] = {{\n{format_array(xbm)}\n}};")
+        items.append(f'        {{ "{name}", {name}, &{rle_name(name)} }},')
+    source = BENCH_SOURCE.replace("@RAW_ARRAYS@", "\n".join(raw_arrays)).replace("@ITEMS@", "\n".join(items))
+    with tempfile.TemporaryDirectory() as tmp:
+        src = os.path.join(tmp, "bench.cpp")
+        exe = os.path.join(tmp, "bench")
+        with open(src, "w", encoding="utf-8") as f:
+            f.write(source)
+        subprocess.check_call([cxx, "-O2", "-std=c++11", "-I", os.path.join(ROOT, "include"),
+                               "-I", os.path.join(ROOT, "src"), src, "-o", exe])
+        subprocess.check_call([exe])
+
+
+def main():
+    parser = argparse.ArgumentParser(description="128x64ビットマップのRLE圧縮")
+    parser.add_argument("--bench", action="store_true", help="ホストで展開時間を計測する")
+    parser.add_argument("--check", action="store_true", help="生成済みヘッダが最新か確認する")
+    args = parser.parse_args()
+
+    images = load_xbm_arrays(SRC_HEADER)
+    text, total_raw, total_rle = generate(images)
+
+    if args.check:
+        with open(OUT_HEADER, encoding="utf-8") as f:
+            if f.read() != text:
+                sys.exit("src/BitmapImagesRle.h が古くなっています。再生成してください。")
+        print("src/BitmapImagesRle.h は最新です")
+    else:
+        current = None
+        if os.path.exists(OUT_HEADER):
+            with open(OUT_HEADER, encoding="utf-8") as f:
+                current = f.read()
+        # 内容が変わらない場合は書き込まない（毎ビルドの再コンパイルを避ける）
+        if current != text:
+            with open(OUT_HEADER, "w", encoding="utf-8") as f:
+                f.write(text)
+        print(f"{len(images)}枚: {total_raw} -> {total_rle} バイト ({OUT_HEADER})")
+
+    if args.bench:
+        bench(images)
+
+
+if __name__ == "__main__":
+    main()
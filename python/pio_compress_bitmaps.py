@@ -0,0 +1,10 @@
+# PlatformIOのビルド前スクリプト：src/BitmapImagesRle.h を src/BitmapImages.h から再生成する
+Import("env")
+
+import os
+import subprocess
+
+subprocess.check_call([
+    env.subst("$PYTHONEXE"),
+    os.path.join(env.subst("$PROJECT_DIR"), "python", "compress_bitmaps.py"),
+])
@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+"""
+ホスト描画ツール
+
+host/U8g2lib.h の偽U8G2で実機の描画コード（src/DisplayRender.cpp, src/StartupAnimation.h など）を
+ホスト向けにビルドし、表示要求の種類ごとの描画コスト・描画呼び出し数・I2Cバイト数を表示します。
+各フレームはPBM（--pngでPNG）として書き出します。
+画面外への描画があると終了コード1を返すので、CIでのレイアウト崩れ検出に使えます。
+
+使い方:
+    python3 python/render_frames.py                    # .pio/render/ にPBMを書き出す
+    python3 python/render_frames.py --png --out frames # frames/ にPNGを書き出す
+    python3 python/render_frames.py --iterations 10000 # 計測回数を増やす
+"""
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SOURCES = [
+    os.path.join(ROOT, "host", "render_frames.cpp"),
+    os.path.join(ROOT, "src", "DisplayRender.cpp"),
+]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="ホストで画面描画を確認・計測する")
+    parser.add_argument("--out", default=os.path.join(ROOT, ".pio", "render"), help="画像の出力先")
+    parser.add_argument("--png", action="store_true", help="PBMの代わりにPNGで書き出す")
+    parser.add_argument("--iterations", type=int, default=1000, help="1ケースあたりの計測回数")
+    args = parser.parse_args()
+
+    cxx = shutil.which("c++") or shutil.which("g++") or shutil.which("clang++")
+    if not cxx:
+        sys.exit("C++コンパイラが見つかりません")
+    os.makedirs(args.out, exist_ok=True)
+
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = os.path.join(tmp, "render_frames")
+        # host/ を先に探させ、Arduino.h・U8g2lib.hを偽物に差し替える
+        subprocess.check_call([cxx, "-O2", "-std=c++11", "-Wall",
+                               "-I", os.path.join(ROOT, "host"),
+                               "-I", os.path.join(ROOT, "include"),
+                               "-I", os.path.join(ROOT, "src"),
+                               *SOURCES, "-o", exe])
+        cmd = [exe, "--out", args.out, "--iterations", str(args.iterations)]
+        if args.png:
+            cmd.append("--png")
+        ret = subprocess.call(cmd)
+    print(f"画像: {args.out}")
+    sys.exit(ret)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,79 @@
+#include "Animation.h"
+#include "SpecialKeyHandler.h"
+
+// キーフレームテーブル（constなのでフラッシュに置かれる）
+
+// 顔アニメーション：上下に3回弾んで元の位置で止まる
+static const Keyframe BOUNCE_FRAMES[] = {
+    {0, 60}, {1, 60}, {0, 60}, {1, 60}, {0, 60}, {1, 60},
+};
+const AnimationClip CLIP_BITMAP_BOUNCE = {
+    ANIM_BITMAP_BOUNCE, nullptr, BOUNCE_FRAMES, sizeof(BOUNCE_FRAMES) / sizeof(Keyframe), 1, {0, 0}
+};
+
+// "READY"：1文字ずつホップし、最後に全て通常高さで少し止める
+static const Keyframe READY_FRAMES[] = {
+    {0, 120}, {1, 120}, {2, 120}, {3, 120}, {4, 120},
+};
+const AnimationClip CLIP_READY_HOP = {
+    ANIM_HOP_TEXT, "READY", READY_FRAMES, sizeof(READY_FRAMES) / sizeof(Keyframe), 1, {-1, 400}
+};
+
+// "KOTACON"：1周ごとにカウントダウンを1つ減らして5周
+static const Keyframe STARTUP_FRAMES[] = {
+    {0, 120}, {1, 120}, {2, 120}, {3, 120}, {4, 120}, {5, 120}, {6, 120},
+};
+const AnimationClip CLIP_STARTUP = {
+    ANIM_STARTUP, "KOTACON", STARTUP_FRAMES, sizeof(STARTUP_FRAMES) / sizeof(Keyframe), 5, {-1, 400}
+};
+
+void Animator::start(const DisplayRequest& r, uint32_t now) {
+    req = r;
+    clip = r.clip;
+    index = 0;
+    loop = 0;
+    inLast = false;
+    running = (clip != nullptr && r.display != nullptr);
+    nextFrameAt = now;
+}
+
+uint32_t Animator::msUntilNextFrame(uint32_t now) const {
+    if (!running) return 0;
+    int32_t remain = (int32_t)(nextFrameAt - now);
+    return remain > 0 ? (uint32_t)remain : 0;
+}
+
+void Animator::tick(uint32_t now) {
+    if (!running) return;
+    if ((int32_t)(now - nextFrameAt) < 0) return;
+
+    // 最終フレームの表示時間が終わった
+    if (inLast) {
+        running = false;
+        return;
+    }
+
+    const Keyframe* kf;
+    uint8_t loopsLeft;
+    if (loop < clip->loops && clip->count > 0) {
+        kf = &clip->frames[index];
+        loopsLeft = clip->loops - loop;
+        if (++index >= clip->count) {
+            index = 0;
+            loop++;
+        }
+    } else {
+        kf = &clip->last;
+        loopsLeft = 0;
+        inLast = true;
+    }
+
+    renderAnimationFrame(req, *clip, kf->pose, loopsLeft);
+
+    if (inLast && kf->durationMs == 0) {
+        running = false;
+        return;
+    }
+    uint32_t wait = kf->durationMs > ANIMATION_FRAME_BUDGET_MS ? kf->durationMs : ANIMATION_FRAME_BUDGET_MS;
+    nextFrameAt = now + wait;
+}
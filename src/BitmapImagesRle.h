@@ -0,0 +1,99 @@
+// このファイルは python/compress_bitmaps.py により自動生成されます。直接編集しないでください。
+// 元データ: src/BitmapImages.h（128x64 XBM）
+#pragma once
+#include "RleBitmap.h"
+
+// epd_bitmap_faces_1: 1024 -> 221 バイト
+static const uint8_t rle_bitmap_faces_1_data[] = {
+	0xff, 0x00, 0x9b, 0x00, 0x06, 0x80, 0x80, 0xc0, 0xe0, 0xe0, 0x70, 0x70, 0x86, 0x38, 0x06, 0x70,
+	0x70, 0xf0, 0xe0, 0xe0, 0xc0, 0x80, 0x9d, 0x00, 0x06, 0x80, 0xc0, 0xe0, 0xe0, 0x70, 0x70, 0x30,
+	0x85, 0x38, 0x06, 0x78, 0x70, 0xf0, 0xe0, 0xe0, 0xc0, 0x80, 0xb5, 0x00, 0x06, 0xf0, 0xfc, 0xfe,
+	0x7f, 0x07, 0x03, 0x01, 0x8c, 0x00, 0x07, 0x01, 0x03, 0x0f, 0xff, 0xff, 0xfe, 0xf8, 0xc0, 0x95,
+	0x00, 0x06, 0xe0, 0xf8, 0xfe, 0xff, 0x0f, 0x03, 0x01, 0x8c, 0x00, 0x07, 0x01, 0x03, 0x07, 0x7f,
+	0xff, 0xfe, 0xfc, 0xf0, 0xb1, 0x00, 0x00, 0x3f, 0x82, 0xff, 0x02, 0xf0, 0xc0, 0x80, 0x8b, 0x00,
+	0x03, 0x80, 0x80, 0xe0, 0xf8, 0x83, 0xff, 0x00, 0x1f, 0x95, 0x00, 0x00, 0x1f, 0x82, 0xff, 0x03,
+	0xf8, 0xe0, 0x80, 0x80, 0x8b, 0x00, 0x03, 0x80, 0xc0, 0xf0, 0xfe, 0x82, 0xff, 0x00, 0x3f, 0xb2,
+	0x00, 0x0a, 0x01, 0x03, 0x07, 0x0f, 0x1f, 0x3f, 0x3f, 0x7f, 0x7e, 0x7e, 0x7c, 0x82, 0xfc, 0x82,
+	0x7e, 0x07, 0x7f, 0x3f, 0x3f, 0x1f, 0x1f, 0x0f, 0x07, 0x01, 0x99, 0x00, 0x06, 0x01, 0x07, 0x0f,
+	0x1f, 0x1f, 0x3f, 0x3f, 0x82, 0x7e, 0x00, 0x7c, 0x82, 0xfc, 0x09, 0x7e, 0x7e, 0x7f, 0x7f, 0x3f,
+	0x3f, 0x1f, 0x0f, 0x07, 0x03, 0xc7, 0x00, 0x06, 0x1c, 0x1c, 0x38, 0x30, 0x70, 0x60, 0xe0, 0x82,
+	0xc0, 0x85, 0x80, 0x84, 0x00, 0x86, 0x80, 0x82, 0xc0, 0x06, 0xe0, 0x60, 0x70, 0x30, 0x38, 0x1c,
+	0x0c, 0xe2, 0x00, 0x83, 0x01, 0x8b, 0x03, 0x83, 0x01, 0xff, 0x00, 0xb5, 0x00,
+};
+static const RleBitmap rle_bitmap_faces_1 = { rle_bitmap_faces_1_data, sizeof(rle_bitmap_faces_1_data) };
+
+// epd_bitmap_faces_2: 1024 -> 182 バイト
+static const uint8_t rle_bitmap_faces_2_data[] = {
+	0xff, 0x00, 0x9c, 0x00, 0x03, 0x80, 0x80, 0xc0, 0xc0, 0x8a, 0xe0, 0x02, 0xc0, 0xc0, 0x80, 0xa0,
+	0x00, 0x02, 0x80, 0xc0, 0xc0, 0x8a, 0xe0, 0x03, 0xc0, 0xc0, 0x80, 0x80, 0xb5, 0x00, 0x08, 0xc0,
+	0xf0, 0xfc, 0xfe, 0xff, 0x3f, 0x0f, 0x0f, 0x07, 0x82, 0x03, 0x83, 0x01, 0x82, 0x03, 0x08, 0x07,
+	0x07, 0x0f, 0x3f, 0xff, 0xff, 0xfe, 0xf8, 0xe0, 0x96, 0x00, 0x0a, 0xe0, 0xf8, 0xfc, 0xfe, 0x7f,
+	0x1f, 0x0f, 0x07, 0x07, 0x03, 0x03, 0x84, 0x01, 0x0b, 0x03, 0x03, 0x07, 0x07, 0x0f, 0x1f, 0x3f,
+	0xff, 0xfe, 0xfc, 0xf8, 0xe0, 0xb0, 0x00, 0x00, 0x1f, 0x82, 0xff, 0x02, 0xe0, 0xc0, 0xc0, 0x87,
+	0x40, 0x86, 0x60, 0x01, 0x20, 0x20, 0x83, 0x3f, 0x96, 0x00, 0x00, 0x1f, 0x82, 0x3f, 0x82, 0x20,
+	0x85, 0x60, 0x87, 0x40, 0x02, 0xc0, 0xc0, 0xf9, 0x82, 0xff, 0x00, 0x3f, 0xc4, 0x00, 0x03, 0x60,
+	0xe0, 0xe0, 0x80, 0x9e, 0x00, 0x03, 0x80, 0xc0, 0xe0, 0x60, 0xda, 0x00, 0x08, 0x01, 0x07, 0x0f,
+	0x0e, 0x1c, 0x38, 0x70, 0x60, 0xe0, 0x82, 0xc0, 0x84, 0x80, 0x00, 0x00, 0x85, 0x80, 0x0a, 0xc0,
+	0xc0, 0xe0, 0x60, 0x70, 0x38, 0x1c, 0x1e, 0x0f, 0x07, 0x03, 0xe6, 0x00, 0x83, 0x01, 0x87, 0x03,
+	0x82, 0x01, 0xff, 0x00, 0xb8, 0x00,
+};
+static const RleBitmap rle_bitmap_faces_2 = { rle_bitmap_faces_2_data, sizeof(rle_bitmap_faces_2_data) };
+
+// epd_bitmap_faces_3: 1024 -> 210 バイト
+static const uint8_t rle_bitmap_faces_3_data[] = {
+	0xff, 0x00, 0xff, 0x00, 0xa9, 0x00, 0x83, 0x80, 0x84, 0xc0, 0x00, 0x80, 0x97, 0x00, 0x00, 0x80,
+	0x84, 0xc0, 0x83, 0x80, 0xc2, 0x00, 0x00, 0xe0, 0x83, 0xf8, 0x09, 0xfc, 0xcc, 0x04, 0x04, 0x06,
+	0x06, 0x02, 0x02, 0x03, 0x03, 0x83, 0x01, 0x04, 0x00, 0x00, 0x80, 0xc0, 0xf1, 0x82, 0xff, 0x00,
+	0x3e, 0x95, 0x00, 0x00, 0x3e, 0x85, 0xff, 0x01, 0xe1, 0x80, 0x83, 0x01, 0x0a, 0x03, 0x03, 0x02,
+	0x02, 0x06, 0x06, 0x04, 0x04, 0x0c, 0x0c, 0x08, 0x82, 0xf8, 0x00, 0xe0, 0xb1, 0x00, 0x04, 0x03,
+	0x07, 0x0f, 0x1f, 0xbf, 0x83, 0x1f, 0x0b, 0x0e, 0x0e, 0x0c, 0x0c, 0x04, 0x04, 0x06, 0x06, 0x02,
+	0x02, 0x03, 0x03, 0x82, 0x01, 0x9d, 0x00, 0x82, 0x01, 0x82, 0x03, 0x08, 0x02, 0x06, 0x06, 0x04,
+	0x04, 0x0c, 0x0c, 0x08, 0x08, 0x82, 0x1c, 0x05, 0x1e, 0xbf, 0x1f, 0x0f, 0x07, 0x01, 0xb4, 0x00,
+	0x03, 0xfc, 0xff, 0xfe, 0x70, 0x8d, 0x00, 0x09, 0x60, 0x70, 0x30, 0x38, 0x18, 0x1c, 0x0c, 0x0c,
+	0x0e, 0x0e, 0x82, 0x06, 0x89, 0x07, 0x82, 0x06, 0x09, 0x0e, 0x0e, 0x0c, 0x0c, 0x1c, 0x18, 0x38,
+	0x30, 0x70, 0x60, 0x87, 0x00, 0x0e, 0x80, 0xf0, 0xfc, 0xc0, 0x00, 0x00, 0xf8, 0xff, 0xff, 0xfc,
+	0x60, 0x00, 0x00, 0x80, 0xe0, 0xb9, 0x00, 0x01, 0xe0, 0xc0, 0xb4, 0x00, 0x83, 0x0f, 0x00, 0x06,
+	0x86, 0x00, 0x04, 0x7c, 0x7f, 0xff, 0x7f, 0x38, 0xb5, 0x00, 0x00, 0x18, 0x82, 0x7f, 0x00, 0x3e,
+	0xd9, 0x00,
+};
+static const RleBitmap rle_bitmap_faces_3 = { rle_bitmap_faces_3_data, sizeof(rle_bitmap_faces_3_data) };
+
+// epd_bitmap_faces_3_5: 1024 -> 167 バイト
+static const uint8_t rle_bitmap_faces_3_5_data[] = {
+	0xff, 0x00, 0xff, 0x00, 0x9c, 0x00, 0x82, 0x80, 0x83, 0xc0, 0x82, 0x40, 0x85, 0x60, 0x00, 0xe0,
+	0x82, 0xf0, 0x02, 0xe0, 0xc0, 0x80, 0x98, 0x00, 0x02, 0x80, 0xc0, 0xe0, 0x82, 0xf0, 0x00, 0xe0,
+	0x85, 0x60, 0x82, 0x40, 0x83, 0xc0, 0x82, 0x80, 0xb6, 0x00, 0x00, 0xfc, 0x82, 0xff, 0x03, 0x1f,
+	0x07, 0x01, 0x01, 0x8b, 0x00, 0x02, 0x01, 0x03, 0x0f, 0x82, 0xff, 0x00, 0xf8, 0x94, 0x00, 0x00,
+	0xf8, 0x82, 0xff, 0x02, 0x1f, 0x03, 0x01, 0x8c, 0x00, 0x06, 0x01, 0x03, 0x0f, 0xff, 0xff, 0xfe,
+	0xfc, 0xb4, 0x00, 0x00, 0x07, 0x82, 0x1f, 0x00, 0x1c, 0x82, 0x18, 0x83, 0x08, 0x01, 0x0c, 0x0c,
+	0x83, 0x04, 0x82, 0x06, 0x01, 0x02, 0x02, 0x82, 0x03, 0x00, 0x01, 0x94, 0x00, 0x00, 0x01, 0x82,
+	0x03, 0x01, 0x02, 0x02, 0x82, 0x06, 0x83, 0x04, 0x01, 0x0c, 0x0c, 0x83, 0x08, 0x82, 0x18, 0x00,
+	0x1c, 0x82, 0x1f, 0x00, 0x07, 0xc8, 0x00, 0x08, 0x60, 0x70, 0x30, 0x38, 0x18, 0x1c, 0x0c, 0x0c,
+	0x0e, 0x83, 0x06, 0x88, 0x07, 0x83, 0x06, 0x08, 0x0e, 0x0c, 0x0c, 0x1c, 0x18, 0x38, 0x30, 0x70,
+	0x60, 0xff, 0x00, 0xff, 0x00, 0xad, 0x00,
+};
+static const RleBitmap rle_bitmap_faces_3_5 = { rle_bitmap_faces_3_5_data, sizeof(rle_bitmap_faces_3_5_data) };
+
+// epd_bitmap_faces_4: 1024 -> 259 バイト
+static const uint8_t rle_bitmap_faces_4_data[] = {
+	0x9b, 0x00, 0x01, 0x80, 0xc0, 0x82, 0xe0, 0x8a, 0xf0, 0x04, 0xe0, 0xe0, 0xc0, 0x80, 0x80, 0x9c,
+	0x00, 0x04, 0x80, 0x80, 0xc0, 0xe0, 0xe0, 0x8a, 0xf0, 0x82, 0xe0, 0x01, 0xc0, 0x80, 0xb2, 0x00,
+	0x03, 0x80, 0xe0, 0xf8, 0xfc, 0x88, 0xff, 0x82, 0x7f, 0x83, 0x3f, 0x01, 0x7f, 0x7f, 0x85, 0xff,
+	0x03, 0xfe, 0xfc, 0xf0, 0xc0, 0x92, 0x00, 0x03, 0xc0, 0xf0, 0xf8, 0xfe, 0x88, 0xff, 0x01, 0x7f,
+	0x7f, 0x83, 0x3f, 0x82, 0x7f, 0x85, 0xff, 0x03, 0xfc, 0xf8, 0xf0, 0xc0, 0xab, 0x00, 0x00, 0xfc,
+	0x88, 0xff, 0x02, 0x07, 0x03, 0x01, 0x8a, 0x00, 0x02, 0x01, 0x03, 0x07, 0x85, 0xff, 0x00, 0xfe,
+	0x90, 0x00, 0x00, 0xfe, 0x87, 0xff, 0x02, 0x3f, 0x07, 0x01, 0x8b, 0x00, 0x02, 0x01, 0x03, 0x0f,
+	0x85, 0xff, 0x00, 0xfc, 0xaa, 0x00, 0x01, 0x07, 0x3f, 0x87, 0xff, 0x04, 0xf8, 0xe0, 0xc0, 0x80,
+	0x80, 0x86, 0x00, 0x04, 0x80, 0x80, 0xc0, 0xe0, 0xf8, 0x84, 0xff, 0x01, 0x7f, 0x0f, 0x90, 0x00,
+	0x01, 0x0f, 0x7f, 0x86, 0xff, 0x05, 0xfe, 0xf0, 0xe0, 0xc0, 0x80, 0x80, 0x86, 0x00, 0x04, 0x80,
+	0x80, 0xc0, 0xe0, 0xf8, 0x84, 0xff, 0x01, 0x3f, 0x07, 0xad, 0x00, 0x06, 0x03, 0x07, 0x0f, 0x1f,
+	0x3f, 0x3f, 0x7f, 0x8d, 0xff, 0x07, 0x7f, 0x7f, 0x3f, 0x1f, 0x0f, 0x07, 0x03, 0x01, 0x86, 0x00,
+	0x82, 0x80, 0x00, 0xc0, 0x82, 0x80, 0x86, 0x00, 0x07, 0x01, 0x03, 0x07, 0x0f, 0x1f, 0x3f, 0x7f,
+	0x7f, 0x8d, 0xff, 0x06, 0x7f, 0x7f, 0x3f, 0x1f, 0x0f, 0x07, 0x03, 0xba, 0x00, 0x87, 0x01, 0x8d,
+	0x00, 0x02, 0xf0, 0xfc, 0xfe, 0x88, 0xff, 0x02, 0xfe, 0xfc, 0xf0, 0x8d, 0x00, 0x87, 0x01, 0xda,
+	0x00, 0x8e, 0xff, 0x00, 0x06, 0xf0, 0x00, 0x02, 0x03, 0x07, 0x0f, 0x86, 0x1f, 0x02, 0x0f, 0x07,
+	0x03, 0xb9, 0x00,
+};
+static const RleBitmap rle_bitmap_faces_4 = { rle_bitmap_faces_4_data, sizeof(rle_bitmap_faces_4_data) };
+
+// 合計: 5120 -> 1039 バイト
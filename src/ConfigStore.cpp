@@ -0,0 +1,294 @@
+#include "ConfigStore.h"
+#include <LittleFS.h>
+#include <esp_rom_crc.h>
+
+// グローバルインスタンスの定義
+ConfigStore configStore;
+
+#define CONFIG_TEMP_PATH "/config.tmp"
+
+static inline const ConfigHeader* header(const uint8_t* blob) {
+    return reinterpret_cast<const ConfigHeader*>(blob);
+}
+
+void ConfigStore::begin() {
+    // 起動を待たせないよう、ここではフォーマットしない（初めての保存の時にする）
+    mounted = LittleFS.begin(false);
+    if (!mounted) {
+        ESP_LOGI("ConfigStore", "LittleFS not mounted, using built-in config");
+        return;
+    }
+    // 起動時はまだキーが押されていないので、すぐに使い始める（キーマップはsetup()でcompileKeymap()）
+    if (loadFile(CONFIG_FILE_PATH)) {
+        active = pending;
+        pending = nullptr;
+        generation++;
+    }
+}
+
+bool ConfigStore::loadFile(const char* path) {
+    File file = LittleFS.open(path, "r");
+    if (!file) return false;
+    size_t size = file.size();
+    if (size < sizeof(ConfigHeader) || size > CONFIG_BLOB_MAX_SIZE) {
+        file.close();
+        rejected++;
+        ESP_LOGI("ConfigStore", "%s: bad size %u", path, (unsigned)size);
+        return false;
+    }
+    uint8_t* blob = (uint8_t*)malloc(size);
+    if (!blob) {
+        file.close();
+        return false;
+    }
+    size_t got = file.read(blob, size);
+    file.close();
+    if (got != size) {
+        free(blob);
+        return false;
+    }
+    return stage(blob, size);
+}
+
+bool ConfigStore::stage(uint8_t* blob, size_t size) {
+    if (!validate(blob, size)) {
+        free(blob);
+        rejected++;
+        return false;
+    }
+    // まだ切り替えていない設定は新しい方で置き換える
+    free(pending);
+    pending = blob;
+    return true;
+}
+
+// 範囲とCRCだけ確かめる（ここを通った設定は、参照する時にもう一度確かめなくてよい）
+bool ConfigStore::validate(const uint8_t* blob, size_t size) {
+    if (size < sizeof(ConfigHeader) || size > CONFIG_BLOB_MAX_SIZE) return false;
+    const ConfigHeader* h = header(blob);
+    if (h->magic != CONFIG_BLOB_MAGIC || h->version != CONFIG_BLOB_VERSION ||
+        h->headerSize != sizeof(ConfigHeader) || h->totalSize != size) {
+        ESP_LOGI("ConfigStore", "bad header (magic=%08x version=%u)", h->magic, h->version);
+        return false;
+    }
+    if (esp_rom_crc32_le(0, blob + h->headerSize, size - h->headerSize) != h->crc32) {
+        ESP_LOGI("ConfigStore", "crc mismatch");
+        return false;
+    }
+
+    // 文字列は末尾が0なので、文字列領域の中を指していれば読み過ぎない
+    if (h->stringsOffset < h->headerSize || h->stringsOffset >= size || blob[size - 1] != 0) return false;
+    size_t stringsSize = size - h->stringsOffset;
+    auto section = [&](uint16_t offset, size_t bytes) {
+        return offset % 4 == 0 && offset >= h->headerSize && offset + bytes <= h->stringsOffset;
+    };
+    auto text = [&](uint16_t offset) { return offset < stringsSize; };
+
+    if (h->namesOffset != CONFIG_NONE) {
+        if (!section(h->namesOffset, 256 * sizeof(ConfigKeyName))) return false;
+        const ConfigKeyName* names = reinterpret_cast<const ConfigKeyName*>(blob + h->namesOffset);
+        for (int k = 0; k < 256; k++) {
+            if ((names[k].normal != CONFIG_NONE && !text(names[k].normal)) ||
+                (names[k].shifted != CONFIG_NONE && !text(names[k].shifted))) return false;
+        }
+    }
+    if (h->keymapCount > 0 && !section(h->keymapOffset, h->keymapCount * sizeof(KeymapEntry))) return false;
+    if (h->textCount > 0) {
+        if (!section(h->textIndexOffset, 256) || !section(h->textOffset, h->textCount * sizeof(ConfigDisplayText))) return false;
+        const uint8_t* index = blob + h->textIndexOffset;
+        for (int k = 0; k < 256; k++) {
+            if (index[k] > h->textCount) return false;
+        }
+        const ConfigDisplayText* texts = reinterpret_cast<const ConfigDisplayText*>(blob + h->textOffset);
+        for (int i = 0; i < h->textCount; i++) {
+            if (!text(texts[i].text1) || (texts[i].text2 != CONFIG_NONE && !text(texts[i].text2))) return false;
+        }
+    }
+    return true;
+}
+
+void ConfigStore::apply() {
+    if (!pending) return;
+    portENTER_CRITICAL(&lock);
+    uint8_t* previous = active;
+    active = pending;
+    portEXIT_CRITICAL(&lock);
+    pending = nullptr;
+    // 読んでいるタスクはロックの中でコピーし終えているので、前の設定はもう誰も読んでいない
+    free(previous);
+    generation++;
+#if KEYMAP_ENABLED
+    compileKeymap();
+#endif
+    const ConfigHeader* h = header(active);
+    ESP_LOGI("ConfigStore", "config #%lu applied (%lu bytes, keymap %u, texts %u)",
+             (unsigned long)generation, (unsigned long)h->totalSize, h->keymapCount, h->textCount);
+}
+
+void ConfigStore::compileKeymap() {
+    const uint8_t* blob = active;
+    if (blob && header(blob)->keymapCount > 0) {
+        const ConfigHeader* h = header(blob);
+        keyLayers.compile(reinterpret_cast<const KeymapEntry*>(blob + h->keymapOffset), h->keymapCount);
+    } else {
+        keyLayers.compile(KB16_KEYMAP, KB16_KEYMAP_SIZE);
+    }
+}
+
+const char* ConfigStore::string(const uint8_t* blob, uint16_t offset) const {
+    return reinterpret_cast<const char*>(blob + header(blob)->stringsOffset + offset);
+}
+
+uint16_t ConfigStore::getRepeatDelayMs(uint16_t fallback) const {
+    portENTER_CRITICAL(&lock);
+    const uint8_t* blob = active;
+    uint16_t value = blob ? header(blob)->repeatDelayMs : 0;
+    portEXIT_CRITICAL(&lock);
+    return value ? value : fallback;
+}
+
+uint16_t ConfigStore::getRepeatRateMs(uint16_t fallback) const {
+    portENTER_CRITICAL(&lock);
+    const uint8_t* blob = active;
+    uint16_t value = blob ? header(blob)->repeatRateMs : 0;
+    portEXIT_CRITICAL(&lock);
+    return value ? value : fallback;
+}
+
+bool ConfigStore::getKeyName(uint8_t keycode, bool shift, char* out, size_t outSize) const {
+    bool found = false;
+    portENTER_CRITICAL(&lock);
+    const uint8_t* blob = active;
+    if (blob && header(blob)->namesOffset != CONFIG_NONE) {
+        const ConfigKeyName& name = reinterpret_cast<const ConfigKeyName*>(blob + header(blob)->namesOffset)[keycode];
+        uint16_t offset = shift ? name.shifted : name.normal;
+        if (offset != CONFIG_NONE) {
+            strlcpy(out, string(blob, offset), outSize);
+            found = true;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    return found;
+}
+
+bool ConfigStore::getDisplayText(uint8_t keycode, char* text1, size_t text1Size, char* text2, size_t text2Size, bool& shiftInvariant) const {
+    bool found = false;
+    portENTER_CRITICAL(&lock);
+    const uint8_t* blob = active;
+    if (blob && header(blob)->textCount > 0) {
+        const ConfigHeader* h = header(blob);
+        uint8_t idx = blob[h->textIndexOffset + keycode];
+        if (idx != 0) {
+            const ConfigDisplayText& t = reinterpret_cast<const ConfigDisplayText*>(blob + h->textOffset)[idx - 1];
+            strlcpy(text1, string(blob, t.text1), text1Size);
+            strlcpy(text2, t.text2 == CONFIG_NONE ? "" : string(blob, t.text2), text2Size);
+            shiftInvariant = t.flags & CONFIG_TEXT_SHIFT_INVARIANT;
+            found = true;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    return found;
+}
+
+void ConfigStore::pollSerial(Stream& stream) {
+    if (upload) {
+        // 設定の受信中（来た分だけ読む）
+        int available = stream.available();
+        if (available > 0) {
+            size_t n = min((size_t)available, uploadSize - uploadReceived);
+            uploadReceived += stream.readBytes((char*)upload + uploadReceived, n);
+        }
+        if (uploadReceived == uploadSize) {
+            finishUpload(stream);
+        } else if (millis() - uploadStartMs > CONFIG_UPLOAD_TIMEOUT_MS) {
+            stream.printf("設定: 受信がタイムアウトしました (%u / %u バイト)\n", (unsigned)uploadReceived, (unsigned)uploadSize);
+            free(upload);
+            upload = nullptr;
+        }
+        return;
+    }
+
+    while (stream.available() > 0) {
+        int c = stream.read();
+        if (c == '\r') continue;
+        if (c != '\n') {
+            if (lineLength < sizeof(line) - 1) line[lineLength++] = (char)c;
+            continue;
+        }
+        line[lineLength] = 0;
+        lineLength = 0;
+        handleCommand(stream, line);
+        if (upload) return;   // 続くバイトは設定
+    }
+}
+
+void ConfigStore::handleCommand(Stream& stream, const char* cmd) {
+    if (strncmp(cmd, "config ", 7) != 0) return;
+    cmd += 7;
+
+    if (strcmp(cmd, "reload") == 0) {
+        if (!mounted || !loadFile(CONFIG_FILE_PATH)) {
+            stream.println("設定: 読み込めませんでした（組み込みの設定のまま）");
+            return;
+        }
+        stream.println("設定: 読み込みました。キーが全部離れたら切り替えます");
+    } else if (strncmp(cmd, "upload ", 7) == 0) {
+        unsigned long size = strtoul(cmd + 7, nullptr, 10);
+        if (size < sizeof(ConfigHeader) || size > CONFIG_BLOB_MAX_SIZE) {
+            stream.printf("設定: 大きさが不正です (%lu バイト)\n", size);
+            return;
+        }
+        upload = (uint8_t*)malloc(size);
+        if (!upload) {
+            stream.println("設定: メモリが足りません");
+            return;
+        }
+        uploadSize = size;
+        uploadReceived = 0;
+        uploadStartMs = millis();
+    } else if (strcmp(cmd, "info") == 0) {
+        printInfo(stream);
+    }
+}
+
+void ConfigStore::finishUpload(Stream& stream) {
+    uint8_t* blob = upload;
+    size_t size = uploadSize;
+    upload = nullptr;
+    if (!validate(blob, size)) {
+        free(blob);
+        rejected++;
+        stream.println("設定: 形式が不正です（切り替えません）");
+        return;
+    }
+
+    // 一時ファイルに書き切ってから置き換える（途中で電源が切れても前の設定が残る）
+    if (!mounted) mounted = LittleFS.begin(true);
+    bool saved = false;
+    if (mounted) {
+        File file = LittleFS.open(CONFIG_TEMP_PATH, "w");
+        if (file) {
+            saved = file.write(blob, size) == size;
+            file.close();
+        }
+        if (saved) {
+            LittleFS.remove(CONFIG_FILE_PATH);
+            saved = LittleFS.rename(CONFIG_TEMP_PATH, CONFIG_FILE_PATH);
+        }
+    }
+    stage(blob, size);
+    stream.printf("設定: %u バイトを受信しました（%s）。キーが全部離れたら切り替えます\n",
+                  (unsigned)size, saved ? "保存済み" : "保存できず、再起動で元に戻ります");
+}
+
+void ConfigStore::printInfo(Stream& stream) const {
+    const uint8_t* blob = active;
+    if (!blob) {
+        stream.println("設定: 組み込みの設定を使っています");
+        return;
+    }
+    const ConfigHeader* h = header(blob);
+    stream.printf("設定: #%lu / %lu バイト / リピート %u ms・%u ms / キー名 %s / キーマップ %u / 文字表示 %u / 不正 %lu\n",
+                  (unsigned long)generation, (unsigned long)h->totalSize, h->repeatDelayMs, h->repeatRateMs,
+                  h->namesOffset == CONFIG_NONE ? "なし" : "あり", h->keymapCount, h->textCount, (unsigned long)rejected);
+}
@@ -0,0 +1,130 @@
+#include "ConsumerForwarder.h"
+
+// グローバルインスタンスの定義
+ConsumerForwarder consumerForwarder;
+
+// HIDの使用法（Consumerページ）とBLEメディアキーレポートのビット位置（添字）の対応
+// oppositeは逆向きの操作の添字（なければ-1）。積む時に打ち消し合う
+struct ConsumerUsageMap {
+    uint16_t usage;
+    int8_t opposite;
+};
+
+static const ConsumerUsageMap CONSUMER_USAGE_MAP[CONSUMER_USAGE_COUNT] = {
+    { 0x00B5,  1 },  // 次の曲
+    { 0x00B6,  0 },  // 前の曲
+    { 0x00B7, -1 },  // 停止
+    { 0x00CD, -1 },  // 再生/一時停止
+    { 0x00E2, -1 },  // ミュート
+    { 0x00E9,  6 },  // 音量+
+    { 0x00EA,  5 },  // 音量-
+    { 0x0223, -1 },  // WWWホーム
+    { 0x0194, -1 },  // マイコンピュータ
+    { 0x0192, -1 },  // 電卓
+    { 0x022A, -1 },  // WWWお気に入り
+    { 0x0221, -1 },  // WWW検索
+    { 0x0226, -1 },  // WWW停止
+    { 0x0224, -1 },  // WWW戻る
+    { 0x0183, -1 },  // メディア選択
+    { 0x018A, -1 },  // メール
+};
+
+static int findUsageIndex(uint16_t usage) {
+    for (int i = 0; i < CONSUMER_USAGE_COUNT; i++) {
+        if (CONSUMER_USAGE_MAP[i].usage == usage) return i;
+    }
+    return -1;
+}
+
+bool ConsumerForwarder::begin(BleKeyboard* kbd, BaseType_t core) {
+    keyboard = kbd;
+    // キー入力の送信と同じ優先度（bleSendTaskと交互に動く）
+    BaseType_t ok = xTaskCreatePinnedToCore(consumerTask, "consumerTask", 3072, this, 1, &task, core);
+    if (ok != pdPASS) {
+        task = nullptr;
+        ESP_LOGI("ConsumerForwarder", "consumer task create failed, media keys disabled");
+        return false;
+    }
+    return true;
+}
+
+bool ConsumerForwarder::step(uint16_t usage) {
+    int index = findUsageIndex(usage);
+    if (index < 0 || task == nullptr) return false;
+    received++;
+
+    bool wake = false;
+    portENTER_CRITICAL(&lock);
+    int opposite = CONSUMER_USAGE_MAP[index].opposite;
+    if (opposite >= 0 && pending[opposite] > 0) {
+        // 逆向きの未送信ステップと打ち消す（両方送らない）
+        pending[opposite]--;
+        pendingTotal--;
+        cancelled += 2;
+    } else if (pendingTotal >= CONSUMER_MAX_PENDING_STEPS) {
+        dropped++;
+    } else {
+        pending[index]++;
+        wake = (pendingTotal == 0);
+        pendingTotal++;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    // 送信待ちが空だった時だけ起こす（送信中なら次の間隔でまとめて送られる）
+    if (wake) xTaskNotifyGive(task);
+    return true;
+}
+
+void ConsumerForwarder::consumerTask(void* pvParameters) {
+    static_cast<ConsumerForwarder*>(pvParameters)->run();
+}
+
+void ConsumerForwarder::run() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        // 最初の1回はすぐ送り、以降は接続間隔ごとに溜まった分を送る
+        while (flush()) {
+            vTaskDelay(pdMS_TO_TICKS(CONSUMER_FLUSH_INTERVAL_MS));
+        }
+    }
+}
+
+bool ConsumerForwarder::flush() {
+    // 取り出す。1回の送信（ラウンド）で、待ちのある使用法をすべて同じレポートで押す
+    uint16_t rounds[CONSUMER_MAX_STEPS_PER_FLUSH];
+    int roundCount = 0;
+    uint32_t steps = 0;
+    bool connected = keyboard && keyboard->isConnected();
+
+    portENTER_CRITICAL(&lock);
+    if (!connected) {
+        // つながっていない間の操作は後から送らない
+        dropped += pendingTotal;
+        memset(pending, 0, sizeof(pending));
+        pendingTotal = 0;
+    }
+    while (pendingTotal > 0 && roundCount < CONSUMER_MAX_STEPS_PER_FLUSH) {
+        uint16_t mask = 0;
+        for (int i = 0; i < CONSUMER_USAGE_COUNT; i++) {
+            if (pending[i] > 0) {
+                pending[i]--;
+                pendingTotal--;
+                mask |= (uint16_t)(1u << i);
+                steps++;
+            }
+        }
+        rounds[roundCount++] = mask;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if (roundCount == 0) return false;
+
+    for (int r = 0; r < roundCount; r++) {
+        MediaKeyReport report = { (uint8_t)(rounds[r] & 0xFF), (uint8_t)(rounds[r] >> 8) };
+        keyboard->press(report);
+        keyboard->release(report);
+    }
+    sentSteps += steps;
+    flushes++;
+    return true;
+}
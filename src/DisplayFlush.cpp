@@ -0,0 +1,126 @@
+#include "DisplayFlush.h"
+#include <Wire.h>
+#include <esp_timer.h>
+
+// グローバルインスタンスの定義
+DisplayFlush displayFlush;
+
+bool DisplayFlush::begin(uint8_t addr, BaseType_t core) {
+    address = addr;
+
+    #if DISPLAY_I2C_FAST_MODE_PLUS
+    enableFastModePlus();
+    #endif
+
+    BaseType_t ok = xTaskCreatePinnedToCore(flushTask, "displayFlush", 3072, this, 1, &taskHandle, core);
+    if (ok != pdPASS) {
+        taskHandle = nullptr;
+        ESP_LOGI("DisplayFlush", "flush task create failed, using blocking sendBuffer()");
+        return false;
+    }
+    return true;
+}
+
+void DisplayFlush::submit(U8G2* display) {
+    if (taskHandle == nullptr) {
+        display->sendBuffer();
+        return;
+    }
+
+    // コピーはロックの外で行う（backはsubmit側だけが触る）
+    memcpy(back, display->getBufferPtr(), DISPLAY_FLUSH_FRAME_BYTES);
+
+    portENTER_CRITICAL(&lock);
+    if (pendingValid) {
+        // まだ転送されていないフレームは上書きする（最新のみ送る）
+        skippedFrames++;
+    }
+    uint8_t* tmp = pending;
+    pending = back;
+    back = tmp;
+    pendingValid = true;
+    portEXIT_CRITICAL(&lock);
+
+    xTaskNotifyGive(taskHandle);
+}
+
+bool DisplayFlush::enableFastModePlus() {
+    Wire.setClock(DISPLAY_I2C_CLOCK_FMP);
+    busClock = DISPLAY_I2C_CLOCK_FMP;
+
+    // 全消去フレームを連続転送し、1回でもNACK/タイムアウトがあれば不採用
+    memset(active, 0, DISPLAY_FLUSH_FRAME_BYTES);
+    for (int i = 0; i < DISPLAY_FLUSH_VALIDATE_FRAMES; i++) {
+        if (!transfer(active)) {
+            ESP_LOGI("DisplayFlush", "1MHz validation failed at frame %d, falling back to 400kHz", i);
+            Wire.setClock(DISPLAY_I2C_CLOCK);
+            busClock = DISPLAY_I2C_CLOCK;
+            // 途中で切れた転送のままにしないよう、400kHzで1フレーム送り直す
+            for (int retry = 0; retry < DISPLAY_FLUSH_FALLBACK_RETRIES; retry++) {
+                if (transfer(active)) {
+                    return false;
+                }
+            }
+            ESP_LOGI("DisplayFlush", "400kHz retry failed too (errors=%lu)", (unsigned long)errorCount);
+            return false;
+        }
+    }
+    ESP_LOGI("DisplayFlush", "I2C fast-mode plus enabled (%lu us/frame)", (unsigned long)lastFlushUs);
+    return true;
+}
+
+// SSD1306へ8ページ分をWire経由で転送する（U8g2のSSD1306ドライバと同じページ指定）
+// 各ページ: [0x00, B0|page, 列下位=0, 列上位=0] のコマンド → [0x40, 64バイト] のデータ x 2
+// データはWireの送信バッファに収まるよう分けて送る（列アドレスは自動で進む）。
+// バスの持ち主はWireだけにして、U8g2や他のデバイスとはWireのロックで順番に使う。
+bool DisplayFlush::transfer(const uint8_t* frame) {
+    int64_t start = esp_timer_get_time();
+
+    uint8_t err = 0;
+    for (uint8_t page = 0; page < 8 && err == 0; page++) {
+        const uint8_t pageCmd[4] = { 0x00, (uint8_t)(0xB0 | page), 0x00, 0x10 };
+        Wire.beginTransmission(address);
+        Wire.write(pageCmd, sizeof(pageCmd));
+        err = Wire.endTransmission();
+
+        for (int col = 0; col < 128 && err == 0; col += DISPLAY_FLUSH_DATA_CHUNK) {
+            Wire.beginTransmission(address);
+            Wire.write((uint8_t)0x40);
+            Wire.write(frame + page * 128 + col, DISPLAY_FLUSH_DATA_CHUNK);
+            err = Wire.endTransmission();
+        }
+    }
+
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+    if (err == 0) {
+        lastFlushUs = elapsed;
+        if (elapsed > maxFlushUs) maxFlushUs = elapsed;
+        totalFlushUs += elapsed;
+        flushCount++;
+    } else {
+        errorCount++;
+    }
+    return err == 0;
+}
+
+// 転送専用タスク：通知を受けたら最新フレームを取り出して転送する
+void DisplayFlush::flushTask(void* pvParameters) {
+    DisplayFlush* self = (DisplayFlush*)pvParameters;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        portENTER_CRITICAL(&self->lock);
+        bool hasFrame = self->pendingValid;
+        if (hasFrame) {
+            uint8_t* tmp = self->active;
+            self->active = self->pending;
+            self->pending = tmp;
+            self->pendingValid = false;
+        }
+        portEXIT_CRITICAL(&self->lock);
+
+        if (hasFrame) {
+            self->transfer(self->active);
+        }
+    }
+}
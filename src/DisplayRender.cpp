@@ -0,0 +1,141 @@
+#include "DisplayRender.h"
+
+// 通常表示（2行：メイン＋サブ）
+void drawNormalScreen(const DisplayRequest& req) {
+    U8G2* display = req.display;
+    display->clearBuffer();
+    display->setFont(req.font);
+    // メイン文字（中央上部）
+    int textWidth1 = display->getStrWidth(req.text1);
+    int xPos1 = (128 - textWidth1) / 2;
+    int fontHeight1 = display->getFontAscent() - display->getFontDescent();
+    int yPos1 = 16 + fontHeight1 / 2;
+    display->drawStr(xPos1, yPos1, req.text1);
+    display->setFont(u8g2_font_6x10_tr);
+    // 下部情報（Key名。その下はステータスバー）
+    display->drawStr(0, 50, "Key:");
+    display->drawStr(30, 50, req.text2);
+}
+
+// 特別キーの文字表示
+void drawTextScreen(const DisplayRequest& req) {
+    U8G2* display = req.display;
+    display->clearBuffer();
+    if (req.hasLayout) {
+        // 特別表示テーブルの事前計算済み位置をそのまま使う
+        display->setFont(req.font);
+        display->drawStr(req.x1, req.y1, req.text1);
+        if (req.text2[0] != '\0') {
+            display->setFont(u8g2_font_6x10_tr);
+            display->drawStr(req.x2, req.y2, req.text2);
+        }
+    } else {
+        drawCenteredText(display, req.text1, req.font);
+        if (req.text2[0] != '\0') {
+            display->setFont(u8g2_font_6x10_tr);
+            int textWidth2 = display->getStrWidth(req.text2);
+            int xPos2 = (128 - textWidth2) / 2;
+            int fontHeight2 = display->getFontAscent() - display->getFontDescent();
+            int yPos2 = 52 + fontHeight2 / 1.5; // 少し下に配置
+            display->drawStr(xPos2, yPos2, req.text2);
+        }
+    }
+}
+
+// USB接続画面
+void drawDeviceScreen(const DisplayRequest& req) {
+    U8G2* display = req.display;
+    display->clearBuffer();
+
+    // 中央に大きく接続表示（左右中央に配置）
+    const char* displayText = "CONNECT";
+    display->setFont(u8g2_font_fub14_tr);
+    int totalWidth = display->getStrWidth(displayText);
+    int xPos = (128 - totalWidth) / 2;
+    int yPos = 64 / 2; // 画面の縦中央
+    display->drawStr(xPos, yPos, displayText);
+
+    // 接続したデバイス名（BLEなどの状態はステータスバー）
+    display->setFont(u8g2_font_6x10_tr);
+    display->drawStr(0, 46, "USB:");
+    display->drawStr(30, 46, req.text1);
+}
+
+// USB切断画面（6x10フォントで5行、ベースライン62までに収める）
+void drawGoneScreen(const DisplayRequest& req) {
+    U8G2* display = req.display;
+    display->clearBuffer();
+    display->setFont(u8g2_font_6x10_tr);
+    display->drawStr(0, 10, "USB->BLE Bridge");
+    display->drawStr(0, 24, "Device DISCONNECTED");
+    display->drawStr(0, 38, "BLE still active");
+    display->drawStr(0, 50, "Waiting for USB");
+    display->drawStr(0, 62, "device...");
+}
+
+// ステータスバー（最下行 "BLE:OK USB:KB16 CSAG"）
+// 領域を消してから描くので、描画済みの画面に重ねて何度でも描き直せる
+void drawStatusBar(U8G2* display, const StatusSnapshot& st) {
+    display->setDrawColor(0);
+    display->drawBox(0, STATUS_BAR_TOP, 128, 64 - STATUS_BAR_TOP);
+    display->setDrawColor(1);
+
+    const char* usb = "--";
+    if (st.usbDevice == USB_DEVICE_KB16) usb = "KB16";
+    else if (st.usbDevice == USB_DEVICE_KEYBOARD) usb = "KBD";
+
+    // 修飾キーは左右をまとめて Ctrl/Shift/Alt/GUI の順に1文字ずつ
+    char mods[5] = {
+        (st.modifiers & 0x11) ? 'C' : '-',
+        (st.modifiers & 0x22) ? 'S' : '-',
+        (st.modifiers & 0x44) ? 'A' : '-',
+        (st.modifiers & 0x88) ? 'G' : '-',
+        '\0'
+    };
+
+    char line[32];
+    snprintf(line, sizeof(line), "BLE:%s USB:%s", st.bleConnected ? "OK" : "--", usb);
+    display->setFont(u8g2_font_6x10_tr);
+    display->drawStr(0, 62, line);
+    display->drawStr(128 - display->getStrWidth(mods), 62, mods);
+}
+
+// ホップアニメーションの1フレーム
+// フレームキャッシュに無い場合のみ呼ばれるので、文字幅はここで測る
+void renderHopFrame(U8G2* display, const char* text, const uint8_t* font, int hopHeight, int hopIdx) {
+    const int titleLen = strlen(text);
+    const int normalY = 32;
+    const int hopY = normalY - hopHeight;
+
+    // 文字ごとの幅を計算
+    int charWidths[16] = {0};
+    int totalWidth = 0;
+    display->setFont(font);
+    for (int i = 0; i < titleLen && i < 16; i++) {
+        char c[2] = { text[i], '\0' };
+        charWidths[i] = display->getStrWidth(c);
+        totalWidth += charWidths[i];
+    }
+    int x = (128 - totalWidth) / 2;
+
+    display->clearBuffer();
+    int charX = x;
+    for (int i = 0; i < titleLen && i < 16; i++) {
+        int y = (i == hopIdx) ? hopY : normalY;
+        char c[2] = { text[i], '\0' };
+        display->drawStr(charX, y, c);
+        charX += charWidths[i];
+    }
+    // 下部はステータスバー（状態が変わるのでキャッシュするフレームには含めない）
+}
+
+
+// 画面中央にテキストを表示する関数
+void drawCenteredText(U8G2* display, const char* text, const uint8_t* font) {
+    display->setFont(font);
+    int textWidth = display->getStrWidth(text);
+    int xPos = (128 - textWidth) / 2;
+    int fontHeight = display->getFontAscent() - display->getFontDescent();
+    int yPos = (64 + fontHeight) / 2.4 - display->getFontDescent();
+    display->drawStr(xPos, yPos, text);
+}
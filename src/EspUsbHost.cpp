@@ -1,12 +1,14 @@
 #include "EspUsbHost.h"
+#include "UsbProfileCache.h"
 
 void EspUsbHost::begin(void) {
-  usbTransferSize = 0;
-  usbInterfaceSize = 0;
-  isReady = false;
-  interval = 10; // 10ms間隔（応答性重視）
-  lastCheck = 0;
-  claim_err = ESP_FAIL;
+  // デバイスごとの状態を初期化
+  for (int i = 0; i < USB_HOST_MAX_DEVICES; i++) {
+    devices[i] = UsbDeviceContext();
+    devices[i].host = this;
+    devices[i].slot = i;
+  }
+  memset(slotByAddress, 0, sizeof(slotByAddress));
   
   // キーマトリックス初期化
   for (int i = 0; i < 4; i++) {
@@ -45,86 +47,368 @@ void EspUsbHost::begin(void) {
 void EspUsbHost::_clientEventCallback(const usb_host_client_event_msg_t *eventMsg, void *arg) {
   EspUsbHost *usbHost = (EspUsbHost *)arg;
 
-  esp_err_t err;
   switch (eventMsg->event) {
     case USB_HOST_CLIENT_EVENT_NEW_DEV:
       ESP_LOGI("EspUsbHost", "USB_HOST_CLIENT_EVENT_NEW_DEV new_dev.address=%d", eventMsg->new_dev.address);
-      err = usb_host_device_open(usbHost->clientHandle, eventMsg->new_dev.address, &usbHost->deviceHandle);
-      if (err != ESP_OK) {
-        ESP_LOGI("EspUsbHost", "usb_host_device_open() err=%x", err);
-      } else {
-        ESP_LOGI("EspUsbHost", "usb_host_device_open() ESP_OK");
-      }
+      usbHost->_openDevice(eventMsg->new_dev.address);
+      break;
 
-      usb_device_info_t dev_info;
-      err = usb_host_device_info(usbHost->deviceHandle, &dev_info);
-      if (err != ESP_OK) {
-        ESP_LOGI("EspUsbHost", "usb_host_device_info() err=%x", err);
-      } else {
-        ESP_LOGI("EspUsbHost", "usb_host_device_info() ESP_OK");
-      }
+    case USB_HOST_CLIENT_EVENT_DEV_GONE:
+      ESP_LOGI("EspUsbHost", "USB_HOST_CLIENT_EVENT_DEV_GONE");
+      usbHost->_drainDevice(eventMsg->dev_gone.dev_hdl);
+      break;
 
-      const usb_device_desc_t *dev_desc;
-      err = usb_host_get_device_descriptor(usbHost->deviceHandle, &dev_desc);
-      if (err != ESP_OK) {
-        ESP_LOGI("EspUsbHost", "usb_host_get_device_descriptor() err=%x", err);
-      } else {
-        usbHost->device_vendor_id = dev_desc->idVendor;
-        usbHost->device_product_id = dev_desc->idProduct;
-        ESP_LOGI("EspUsbHost", "Device Info: VID=0x%04X, PID=0x%04X, Class=0x%02X, SubClass=0x%02X", 
-                 usbHost->device_vendor_id, usbHost->device_product_id, 
-                 dev_desc->bDeviceClass, dev_desc->bDeviceSubClass);
-        
-        // DOIO KB16の特別なチェック
-        if (usbHost->device_vendor_id == 0xD010 && usbHost->device_product_id == 0x1601) {
-          ESP_LOGI("EspUsbHost", "*** DOIO KB16 DETECTED! ***");
-        } else {
-          ESP_LOGI("EspUsbHost", "Standard HID device detected");
-        }
-      }
+    default:
+      ESP_LOGI("EspUsbHost", "Unknown event: %d", eventMsg->event);
+      break;
+  }
+}
 
-      // デバイス情報を通知
-      usbHost->onNewDevice(dev_info);
-      
-      // コンフィグレーション処理
-      const usb_config_desc_t *config_desc;
-      err = usb_host_get_active_config_descriptor(usbHost->deviceHandle, &config_desc);
-      if (err != ESP_OK) {
-        ESP_LOGI("EspUsbHost", "usb_host_get_active_config_descriptor() err=%x", err);
+UsbDeviceContext *EspUsbHost::findDevice(uint8_t address) {
+  if (address >= USB_HOST_MAX_ADDRESS || slotByAddress[address] == 0) {
+    return nullptr;
+  }
+  return &devices[slotByAddress[address] - 1];
+}
+
+uint8_t EspUsbHost::getDeviceCount() const {
+  uint8_t n = 0;
+  for (int i = 0; i < USB_HOST_MAX_DEVICES; i++) {
+    if (devices[i].isOpen()) n++;
+  }
+  return n;
+}
+
+// 新しいデバイスを空きスロットで開き、コンフィグ記述子からHIDインターフェースと転送を用意する
+bool EspUsbHost::_openDevice(uint8_t address) {
+  if (address >= USB_HOST_MAX_ADDRESS || slotByAddress[address] != 0) {
+    ESP_LOGI("EspUsbHost", "address %d is invalid or already open", address);
+    return false;
+  }
+  UsbDeviceContext *dev = nullptr;
+  bool draining = false;
+  for (int i = 0; i < USB_HOST_MAX_DEVICES; i++) {
+    if (!devices[i].inUse()) {
+      dev = &devices[i];
+      break;
+    }
+    draining |= devices[i].state == USB_DEVICE_DRAINING;
+  }
+  if (dev == nullptr) {
+    // 抜き差しが速くて前のデバイスがまだDRAININGなら、スロットが空いた時に開く
+    _forgetPendingOpen(address);
+    if (draining && pendingOpenCount < USB_HOST_PENDING_OPENS) {
+      pendingOpens[pendingOpenCount++] = address;
+      ESP_LOGI("EspUsbHost", "address %d waits for a draining slot", address);
+    } else {
+      ESP_LOGI("EspUsbHost", "no free device slot for address %d (max %d)", address, USB_HOST_MAX_DEVICES);
+    }
+    return false;
+  }
+
+  uint8_t slot = dev->slot;
+  *dev = UsbDeviceContext();
+  dev->host = this;
+  dev->slot = slot;
+  dev->address = address;
+  dev->openedUs = esp_timer_get_time();
+
+  esp_err_t err = usb_host_device_open(this->clientHandle, address, &dev->handle);
+  if (err != ESP_OK) {
+    ESP_LOGI("EspUsbHost", "usb_host_device_open() err=%x", err);
+    return false;
+  } else {
+    ESP_LOGI("EspUsbHost", "usb_host_device_open() ESP_OK slot=%d", slot);
+  }
+  dev->state = USB_DEVICE_ENUMERATING;
+  slotByAddress[address] = slot + 1;
+
+  usb_device_info_t dev_info;
+  err = usb_host_device_info(dev->handle, &dev_info);
+  if (err != ESP_OK) {
+    ESP_LOGI("EspUsbHost", "usb_host_device_info() err=%x", err);
+  } else {
+    ESP_LOGI("EspUsbHost", "usb_host_device_info() ESP_OK");
+  }
+
+  const usb_device_desc_t *dev_desc;
+  err = usb_host_get_device_descriptor(dev->handle, &dev_desc);
+  if (err != ESP_OK) {
+    ESP_LOGI("EspUsbHost", "usb_host_get_device_descriptor() err=%x", err);
+  } else {
+    dev->vendorId = dev_desc->idVendor;
+    dev->productId = dev_desc->idProduct;
+    dev->bcdDevice = dev_desc->bcdDevice;
+    ESP_LOGI("EspUsbHost", "Device Info: VID=0x%04X, PID=0x%04X, Class=0x%02X, SubClass=0x%02X", 
+             dev->vendorId, dev->productId, 
+             dev_desc->bDeviceClass, dev_desc->bDeviceSubClass);
+    
+    // DOIO KB16の特別なチェック
+    if (dev->isKB16()) {
+      ESP_LOGI("EspUsbHost", "*** DOIO KB16 DETECTED! ***");
+    } else {
+      ESP_LOGI("EspUsbHost", "Standard HID device detected");
+    }
+  }
+
+  // デバイス情報を通知
+  onNewDevice(*dev, dev_info);
+  
+  // コンフィグレーション処理
+  const usb_config_desc_t *config_desc;
+  err = usb_host_get_active_config_descriptor(dev->handle, &config_desc);
+  if (err != ESP_OK) {
+    ESP_LOGI("EspUsbHost", "usb_host_get_active_config_descriptor() err=%x", err);
+  } else {
+    dev->configTotalLength = config_desc->wTotalLength;
+
+#if USB_HOST_PROFILE_CACHE
+    // 知っているデバイスは保存済みの解析結果でそのままクレームして受信を始める
+    UsbDeviceProfile profile;
+    if (UsbProfileCache::load(dev->vendorId, dev->productId, dev->bcdDevice, profile)) {
+      if (profile.configTotalLength == dev->configTotalLength && _applyProfile(*dev, profile)) {
+        dev->profileFromCache = true;
+        ESP_LOGI("EspUsbHost", "profile cache hit VID=0x%04X PID=0x%04X bcdDevice=0x%04X",
+                 dev->vendorId, dev->productId, dev->bcdDevice);
       } else {
-        ESP_LOGI("EspUsbHost", "usb_host_get_active_config_descriptor() ESP_OK");
-        usbHost->_configCallback(config_desc);
+        ESP_LOGI("EspUsbHost", "profile cache mismatch, walking the configuration");
+        UsbProfileCache::erase(dev->vendorId, dev->productId, dev->bcdDevice);
       }
+    }
+#endif
+
+    if (!dev->profileFromCache) {
+      ESP_LOGI("EspUsbHost", "usb_host_get_active_config_descriptor() ESP_OK");
+      _configCallback(*dev, config_desc);
+#if USB_HOST_PROFILE_CACHE
+      dev->profilePending = dev->interfaceCount > 0;
+#endif
+    }
+  }
+
+  // HIDクラス要求とレポート記述子の読み出し（非同期で順に送る）
+  _configureInterfaces(*dev);
+  _finishEnumeration(*dev);
+  return true;
+}
+
+// スロット待ちの接続からアドレスを外す（抜かれた・もう一度NEW_DEVが来た時）
+void EspUsbHost::_forgetPendingOpen(uint8_t address) {
+  uint8_t kept = 0;
+  for (uint8_t i = 0; i < pendingOpenCount; i++) {
+    if (pendingOpens[i] != address) {
+      pendingOpens[kept++] = pendingOpens[i];
+    }
+  }
+  if (kept != pendingOpenCount) {
+    ESP_LOGI("EspUsbHost", "address %d no longer waits for a slot", address);
+  }
+  pendingOpenCount = kept;
+}
+
+// 受信用の転送を1つ用意する（contextはデバイスの状態。受信時にそのまま使う）
+bool EspUsbHost::_addTransfer(UsbDeviceContext &dev, uint8_t bEndpointAddress, uint16_t maxPacket, uint8_t bInterval) {
+  if (dev.transferCount >= USB_HOST_MAX_TRANSFERS) {
+    return false;
+  }
+  usb_transfer_t *transfer = NULL;
+  esp_err_t err = usb_host_transfer_alloc(maxPacket + 1, 0, &transfer);
+  if (err != ESP_OK) {
+    ESP_LOGI("EspUsbHost", "usb_host_transfer_alloc() FAILED err=%x", err);
+    return false;
+  }
+  transfer->device_handle = dev.handle;
+  transfer->bEndpointAddress = bEndpointAddress;
+  transfer->callback = this->_onReceive;
+  transfer->context = &dev;
+  transfer->num_bytes = maxPacket;
+  dev.transfers[dev.transferCount++] = transfer;
+  liveTransfers++;
+  // 間隔はエンドポイントごと（1つのデバイスでもキーボードとマウスで違うことがある）
+  dev.endpoint_data_list[bEndpointAddress & 0x0F].interval = bInterval > 0 ? bInterval : 1;
+  dev.isReady = true;
+  return true;
+}
+
+// 保存済みの解析結果でクレームと転送の用意をする（記述子の走査・ログは省く）
+bool EspUsbHost::_applyProfile(UsbDeviceContext &dev, const UsbDeviceProfile &profile) {
+  for (uint8_t i = 0; i < profile.interfaceCount; i++) {
+    esp_err_t err = usb_host_interface_claim(this->clientHandle, dev.handle, profile.interfaces[i].number, 0);
+    if (err != ESP_OK) {
+      ESP_LOGI("EspUsbHost", "usb_host_interface_claim() FAILED Interface=%d err=%x", profile.interfaces[i].number, err);
       break;
+    }
+    dev.interfaces[dev.interfaceCount++] = profile.interfaces[i];
+  }
 
-    case USB_HOST_CLIENT_EVENT_DEV_GONE:
-      ESP_LOGI("EspUsbHost", "USB_HOST_CLIENT_EVENT_DEV_GONE");
-      
-      // 転送とインターフェースをクリーンアップ
-      for (int i = 0; i < usbHost->usbTransferSize; i++) {
-        if (usbHost->usbTransfer[i] != NULL) {
-          usb_host_transfer_free(usbHost->usbTransfer[i]);
-          usbHost->usbTransfer[i] = NULL;
-        }
-      }
-      usbHost->usbTransferSize = 0;
+  bool ok = dev.interfaceCount == profile.interfaceCount;
+  for (uint8_t i = 0; ok && i < profile.endpointCount; i++) {
+    const UsbEndpointProfile &ep = profile.endpoints[i];
+    ok = _addTransfer(dev, ep.address, ep.maxPacket, ep.data.interval);
+    if (ok) {
+      dev.endpoint_data_list[ep.address & 0x0F] = ep.data;
+    }
+  }
+
+  if (!ok) {
+    // 途中まで用意した分を戻して、記述子の走査からやり直す（まだ送信していない）
+    _freeTransfers(dev);
+    for (int i = 0; i < dev.interfaceCount; i++) {
+      usb_host_interface_release(this->clientHandle, dev.handle, dev.interfaces[i].number);
+    }
+    dev.interfaceCount = 0;
+    dev.isReady = false;
+    memset(dev.endpoint_data_list, 0, sizeof(dev.endpoint_data_list));
+    return false;
+  }
+
+  memcpy(dev.reportRoutes, profile.reportRoutes, sizeof(dev.reportRoutes));
+  memcpy(dev.gamepadLayout, profile.gamepadLayout, sizeof(dev.gamepadLayout));
+  return true;
+}
+
+// 接続時のコントロール要求が全部終わったらACTIVEにする
+// 初めて見たデバイスなら、解析（レポート記述子の読み出しまで）の結果をここで保存する
+void EspUsbHost::_finishEnumeration(UsbDeviceContext &dev) {
+  if (dev.state != USB_DEVICE_ENUMERATING || dev.ctrlBusy || dev.ctrlCount > 0) {
+    return;
+  }
+  dev.state = USB_DEVICE_ACTIVE;
+  ESP_LOGI("EspUsbHost", "device active addr=%d slot=%d", dev.address, dev.slot);
 
-      for (int i = 0; i < usbHost->usbInterfaceSize; i++) {
-        usb_host_interface_release(usbHost->clientHandle, usbHost->deviceHandle, usbHost->usbInterface[i]);
-        usbHost->usbInterface[i] = 0;
+#if USB_HOST_PROFILE_CACHE
+  if (!dev.profilePending) {
+    return;
+  }
+  dev.profilePending = false;
+
+  UsbDeviceProfile profile;
+  memset(&profile, 0, sizeof(profile));
+  profile.version = USB_PROFILE_VERSION;
+  profile.vendorId = dev.vendorId;
+  profile.productId = dev.productId;
+  profile.bcdDevice = dev.bcdDevice;
+  profile.configTotalLength = dev.configTotalLength;
+  profile.interfaceCount = dev.interfaceCount;
+  memcpy(profile.interfaces, dev.interfaces, sizeof(profile.interfaces));
+  profile.endpointCount = dev.transferCount;
+  for (int i = 0; i < dev.transferCount; i++) {
+    const usb_transfer_t *transfer = dev.transfers[i];
+    profile.endpoints[i].address = transfer->bEndpointAddress;
+    profile.endpoints[i].maxPacket = transfer->num_bytes;
+    profile.endpoints[i].data = dev.endpoint_data_list[transfer->bEndpointAddress & 0x0F];
+  }
+  memcpy(profile.reportRoutes, dev.reportRoutes, sizeof(profile.reportRoutes));
+  memcpy(profile.gamepadLayout, dev.gamepadLayout, sizeof(profile.gamepadLayout));
+  UsbProfileCache::save(profile);
+#endif
+}
+
+// 外れたデバイスの転送を止めてDRAININGにする（他のデバイスはそのまま動き続ける）
+// 送信中の転送はhalt/flushでキャンセルして戻させ、解放は全部戻ってからtask()で行う。
+void EspUsbHost::_drainDevice(usb_device_handle_t handle) {
+  uint8_t address = 0;
+  UsbDeviceContext *dev = nullptr;
+  if (usb_host_device_addr(handle, &address) == ESP_OK) {
+    dev = findDevice(address);
+    // まだ開いていない（スロット待ちの）デバイスが抜かれたら、待ちから外す
+    _forgetPendingOpen(address);
+  }
+  if (dev == nullptr || dev->handle != handle) {
+    // アドレスが引けない場合はハンドルで探す（接続数ぶんだけ）
+    dev = nullptr;
+    for (int i = 0; i < USB_HOST_MAX_DEVICES; i++) {
+      if (devices[i].isOpen() && devices[i].handle == handle) {
+        dev = &devices[i];
+        break;
       }
-      usbHost->usbInterfaceSize = 0;
-      
-      usbHost->isReady = false;
-      usb_host_device_close(usbHost->clientHandle, usbHost->deviceHandle);
-      
-      usbHost->onGone(eventMsg);
-      break;
+    }
+  }
+  if (dev == nullptr) {
+    ESP_LOGI("EspUsbHost", "DEV_GONE for unknown device");
+    return;
+  }
 
-    default:
-      ESP_LOGI("EspUsbHost", "Unknown event: %d", eventMsg->event);
-      break;
+  dev->state = USB_DEVICE_DRAINING;
+  dev->isReady = false;
+  dev->drainStart = millis();
+  // 同じアドレスで次のデバイスが来てもよいように、アドレスの対応はすぐ外す
+  slotByAddress[dev->address] = 0;
+  // 送っていないコントロール要求は捨てる（送信中の1つは戻るのを待つ）
+  dev->ctrlCount = dev->ctrlBusy ? 1 : 0;
+
+  _haltTransfers(*dev);
+  ESP_LOGI("EspUsbHost", "device draining addr=%d slot=%d inFlight=0x%02X ctrl=%d",
+           dev->address, dev->slot, dev->inFlight, dev->ctrlBusy);
+}
+
+// 送信中の割り込み転送をキャンセルする（キャンセルされた転送は_onReceiveに戻る）
+void EspUsbHost::_haltTransfers(UsbDeviceContext &dev) {
+  for (int i = 0; i < dev.transferCount; i++) {
+    if (!(dev.inFlight & (1 << i))) {
+      continue;
+    }
+    uint8_t bEndpointAddress = dev.transfers[i]->bEndpointAddress;
+    esp_err_t err = usb_host_endpoint_halt(dev.handle, bEndpointAddress);
+    if (err == ESP_OK) {
+      err = usb_host_endpoint_flush(dev.handle, bEndpointAddress);
+    }
+    if (err != ESP_OK) {
+      ESP_LOGI("EspUsbHost", "halt/flush EP=0x%02X err=%x", bEndpointAddress, err);
+    }
+  }
+}
+
+void EspUsbHost::_freeTransfers(UsbDeviceContext &dev) {
+  for (int i = 0; i < dev.transferCount; i++) {
+    if (dev.transfers[i] != NULL) {
+      usb_host_transfer_free(dev.transfers[i]);
+      dev.transfers[i] = NULL;
+      liveTransfers--;
+    }
   }
+  dev.transferCount = 0;
+  dev.inFlight = 0;
+}
+
+// DRAININGのデバイスの転送が全部戻っていれば、転送とインターフェースを解放して閉じる
+bool EspUsbHost::_closeDevice(UsbDeviceContext &dev) {
+  if (dev.inFlight != 0 || dev.ctrlBusy) {
+    if (millis() - dev.drainStart > USB_HOST_DRAIN_TIMEOUT_MS) {
+      // 戻ってこない転送は解放できないので、キャンセルをやり直して待ち続ける
+      drainTimeouts++;
+      dev.drainStart = millis();
+      ESP_LOGI("EspUsbHost", "drain timeout addr=%d inFlight=0x%02X ctrl=%d, halting again",
+               dev.address, dev.inFlight, dev.ctrlBusy);
+      _haltTransfers(dev);
+    }
+    return false;
+  }
+
+  _freeTransfers(dev);
+  if (dev.ctrlTransfer != NULL) {
+    usb_host_transfer_free(dev.ctrlTransfer);
+    dev.ctrlTransfer = NULL;
+    liveTransfers--;
+  }
+
+  for (int i = 0; i < dev.interfaceCount; i++) {
+    usb_host_interface_release(this->clientHandle, dev.handle, dev.interfaces[i].number);
+  }
+  dev.interfaceCount = 0;
+
+  usb_host_device_close(this->clientHandle, dev.handle);
+  ESP_LOGI("EspUsbHost", "device closed addr=%d slot=%d (%lu ms)",
+           dev.address, dev.slot, millis() - dev.drainStart);
+
+  // 表示・BLEの後始末は転送を片付け終えてから（onGoneの中で時間がかかってもUSB側は安全）
+  onGone(dev);
+
+  uint8_t slot = dev.slot;
+  dev = UsbDeviceContext();
+  dev.host = this;
+  dev.slot = slot;
+  return true;
 }
 
 void EspUsbHost::task(void) {
@@ -140,22 +424,55 @@ void EspUsbHost::task(void) {
     ESP_LOGI("EspUsbHost", "usb_host_client_handle_events() err=%x", err);
   }
 
-  // USB転送処理（頻度を制限）
-  if (this->isReady) {
-    unsigned long now = millis();
-    if ((now - this->lastCheck) > this->interval) {
-      this->lastCheck = now;
+  // USB転送処理（デバイスごとにエンドポイントの間隔で）
+  unsigned long now = millis();
 
-      for (int i = 0; i < this->usbTransferSize; i++) {
-        if (this->usbTransfer[i] == NULL) {
-          continue;
+  // デコーダに届いたレポート数を1秒ごとに集計
+  if (now - reportWindowStart >= 1000) {
+    reportsPerSecond = reportCount;
+    unchangedPerSecond = unchangedCount;
+    reportCount = 0;
+    unchangedCount = 0;
+    reportWindowStart = now;
+  }
+  for (int d = 0; d < USB_HOST_MAX_DEVICES; d++) {
+    UsbDeviceContext &dev = this->devices[d];
+    if (dev.state == USB_DEVICE_DRAINING) {
+      // 転送が戻りきったら閉じ、待っていた接続があれば空いたスロットで開く
+      // （待っている間に抜かれて開けなければ次の接続を試す）
+      if (_closeDevice(dev)) {
+        while (pendingOpenCount > 0) {
+          uint8_t address = pendingOpens[0];
+          pendingOpenCount--;
+          memmove(pendingOpens, pendingOpens + 1, pendingOpenCount);
+          if (_openDevice(address)) {
+            break;
+          }
         }
+      }
+      continue;
+    }
+    if (!dev.isOpen() || !dev.isReady) {
+      continue;
+    }
 
-        esp_err_t err = usb_host_transfer_submit(this->usbTransfer[i]);
-        if (err != ESP_OK && err != ESP_ERR_NOT_FINISHED && err != ESP_ERR_INVALID_STATE) {
-          // エラーログは頻繁になるため抑制
-        }
+    for (int i = 0; i < dev.transferCount; i++) {
+      // 送信中の転送は戻るまで出し直さない
+      if (dev.transfers[i] == NULL || (dev.inFlight & (1 << i))) {
+        continue;
+      }
+      // エンドポイントごとのbIntervalで出す
+      uint8_t interval = dev.endpoint_data_list[dev.transfers[i]->bEndpointAddress & 0x0F].interval;
+      if ((now - dev.lastCheck[i]) <= interval) {
+        continue;
       }
+      dev.lastCheck[i] = now;
+
+      esp_err_t err = usb_host_transfer_submit(dev.transfers[i]);
+      if (err == ESP_OK) {
+        dev.inFlight |= 1 << i;
+      }
+      // エラーログは頻繁になるため抑制
     }
   }
 }
@@ -198,7 +515,7 @@ uint8_t EspUsbHost::getKeycodeToAscii(uint8_t keycode, uint8_t shift) {
   return 0;
 }
 
-void EspUsbHost::onKeyboard(hid_keyboard_report_t report, hid_keyboard_report_t last_report) {
+void EspUsbHost::onKeyboard(const UsbDeviceContext &dev, hid_keyboard_report_t report, hid_keyboard_report_t last_report) {
   // 基本的なキーボード処理の実装
   for (int i = 0; i < 6; i++) {
     if (report.keycode[i] != 0) {
@@ -223,7 +540,13 @@ void EspUsbHost::onKeyboardKey(uint8_t ascii, uint8_t keycode, uint8_t modifier)
 }
 
 void EspUsbHost::onMouse(hid_mouse_report_t report, uint8_t last_buttons) {
-  // マウス処理の基本実装
+  // マウス処理の基本実装（ボタンの変化と移動に分けて渡す）
+  if (report.buttons != last_buttons) {
+    onMouseButtons(report, last_buttons);
+  }
+  if (report.x != 0 || report.y != 0 || report.wheel != 0 || report.pan != 0) {
+    onMouseMove(report);
+  }
 }
 
 void EspUsbHost::onMouseButtons(hid_mouse_report_t report, uint8_t last_buttons) {
@@ -234,25 +557,61 @@ void EspUsbHost::onMouseMove(hid_mouse_report_t report) {
   // マウス移動処理の基本実装
 }
 
-void EspUsbHost::_onDataGamepad() {
-  // ゲームパッド処理の基本実装
+// ゲームパッドのレポートをレイアウトに従ってデコードする（変化した時だけ）
+void EspUsbHost::_onDataGamepad(UsbDeviceContext &dev, const endpoint_data_t &ep, const uint8_t *data, int length) {
+  uint8_t *last = dev.lastReport[ep.transferIndex];
+  uint8_t &lastLength = dev.lastReportLength[ep.transferIndex];
+  int n = length < USB_HOST_REPORT_MAX ? length : USB_HOST_REPORT_MAX;
+  if (n == lastLength && memcmp(last, data, n) == 0) {
+    unchangedCount++;
+    return;
+  }
+  memcpy(last, data, n);
+  lastLength = n;
+
+  GamepadState state;
+  if (hidDecodeGamepad(dev.gamepadLayout[ep.transferIndex], data, length, state)) {
+    onGamepad(dev, state);
+  }
+}
+
+void EspUsbHost::onReportDescriptor(UsbDeviceContext &dev, const UsbHidInterface &intf, const uint8_t *desc, int length) {
+  if (intf.endpoint == 0) {
+    return;
+  }
+  endpoint_data_t &ep = dev.endpoint_data_list[intf.endpoint & 0x0F];
+  HidGamepadLayout &layout = dev.gamepadLayout[ep.transferIndex];
+  if (!hidParseGamepadLayout(desc, length, layout)) {
+    ESP_LOGI("EspUsbHost", "Interface=%d is not a gamepad, keeping decoder=%d", intf.number, ep.decoder);
+    return;
+  }
+
+  // ゲームパッドのレポートだけをゲームパッドとしてデコードする（他のレポートIDは振り分けない）
+  if (layout.reportId != 0) {
+    ep.decoder = USB_DECODER_NONE;
+    setReportRoute(dev, intf.endpoint, layout.reportId, USB_DECODER_GAMEPAD);
+  } else {
+    ep.decoder = USB_DECODER_GAMEPAD;
+  }
+  ESP_LOGI("EspUsbHost", "Gamepad on Interface=%d ReportId=%d buttons=%d hat=%d",
+           intf.number, layout.reportId, layout.buttonCount, layout.hat.present);
 }
 
 void EspUsbHost::setHIDLocal(hid_local_enum_t code) {
   hidLocal = code;
 }
 
-void EspUsbHost::processRawReport16Bytes(const uint8_t* data) {
-  // デフォルトの16バイトレポート処理（継承クラスでオーバーライド）
-  ESP_LOGI("EspUsbHost", "Default 16-byte report processing");
+void EspUsbHost::onNkroReport(const UsbDeviceContext &dev, const uint8_t* data, int length) {
+  // デフォルトのNKROレポート処理（継承クラスでオーバーライド）
+  ESP_LOGI("EspUsbHost", "Default NKRO report processing");
   
   // 16進数でログ出力
   String hex_data = "";
-  for (int i = 0; i < 16; i++) {
+  for (int i = 0; i < length; i++) {
     if (data[i] < 16) hex_data += "0";
     hex_data += String(data[i], HEX) + " ";
   }
-  ESP_LOGI("EspUsbHost", "16-byte data: %s", hex_data.c_str());
+  ESP_LOGI("EspUsbHost", "NKRO data: %s", hex_data.c_str());
 }
 
 void EspUsbHost::_printPcapText(const char *title, uint16_t function, uint8_t direction, uint8_t endpoint, uint8_t type, uint8_t size, uint8_t stage, const uint8_t *data) {
@@ -267,85 +626,345 @@ void EspUsbHost::_printPcapText(const char *title, uint16_t function, uint8_t di
   ESP_LOGI("EspUsbHost", "[PCAP] %s: %s", title, data_str.c_str());
 }
 
-esp_err_t EspUsbHost::submitControl(const uint8_t bmRequestType, const uint8_t bDescriptorIndex, const uint8_t bDescriptorType, const uint16_t wInterfaceNumber, const uint16_t wDescriptorLength) {
-  // コントロール転送の実装
+// コントロール要求を待ち行列に積み、送信中でなければすぐ送る
+esp_err_t EspUsbHost::submitControl(UsbDeviceContext &dev, const UsbControlRequest &request) {
+  if (request.setup.wLength > USB_HOST_CONTROL_MAX ||
+      (!(request.setup.bmRequestType & 0x80) && request.setup.wLength > USB_HOST_CONTROL_DATA_MAX)) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  if (dev.ctrlCount >= USB_HOST_CONTROL_QUEUE) {
+    ESP_LOGI("EspUsbHost", "control queue full, request 0x%02X dropped", request.setup.bRequest);
+    return ESP_ERR_NO_MEM;
+  }
+  dev.ctrlQueue[(dev.ctrlHead + dev.ctrlCount) % USB_HOST_CONTROL_QUEUE] = request;
+  dev.ctrlCount++;
+  if (!dev.ctrlBusy) {
+    _startNextControl(dev);
+  }
   return ESP_OK;
 }
 
+// 待ち行列の先頭を送る（送れなかった要求は捨てて次へ進む）
+void EspUsbHost::_startNextControl(UsbDeviceContext &dev) {
+  while (dev.ctrlCount > 0 && !dev.ctrlBusy) {
+    const UsbControlRequest &req = dev.ctrlQueue[dev.ctrlHead];
+    if (dev.ctrlTransfer == NULL) {
+      esp_err_t err = usb_host_transfer_alloc(USB_SETUP_PACKET_SIZE + USB_HOST_CONTROL_MAX, 0, &dev.ctrlTransfer);
+      if (err != ESP_OK) {
+        ESP_LOGI("EspUsbHost", "usb_host_transfer_alloc() for control FAILED err=%x", err);
+        dev.ctrlTransfer = NULL;
+        dev.ctrlCount = 0;
+        return;
+      }
+      liveTransfers++;
+    }
+
+    usb_transfer_t *transfer = dev.ctrlTransfer;
+    memcpy(transfer->data_buffer, &req.setup, USB_SETUP_PACKET_SIZE);
+    if (!(req.setup.bmRequestType & 0x80) && req.setup.wLength > 0) {
+      memcpy(transfer->data_buffer + USB_SETUP_PACKET_SIZE, req.data, req.setup.wLength);
+    }
+    transfer->device_handle = dev.handle;
+    transfer->bEndpointAddress = 0x00;
+    transfer->callback = this->_onReceiveControl;
+    transfer->context = &dev;
+    transfer->num_bytes = USB_SETUP_PACKET_SIZE + req.setup.wLength;
+
+    esp_err_t err = usb_host_transfer_submit_control(this->clientHandle, transfer);
+    if (err == ESP_OK) {
+      dev.ctrlBusy = true;
+      return;
+    }
+    ESP_LOGI("EspUsbHost", "usb_host_transfer_submit_control() request=0x%02X err=%x", req.setup.bRequest, err);
+    if (req.kind == USB_CONTROL_GET_REPORT_DESC) {
+      // 読めなかったのと同じ扱い（標準キーボードに戻し、保存しない）
+      uint8_t endpoint = dev.interfaces[req.interfaceIndex].endpoint;
+      if (endpoint != 0) {
+        dev.endpoint_data_list[endpoint & 0x0F].decoder = USB_DECODER_KEYBOARD;
+      }
+#if USB_HOST_PROFILE_CACHE
+      dev.profilePending = false;
+#endif
+    }
+    dev.ctrlHead = (dev.ctrlHead + 1) % USB_HOST_CONTROL_QUEUE;
+    dev.ctrlCount--;
+  }
+}
+
 void EspUsbHost::_onReceiveControl(usb_transfer_t *transfer) {
-  // コントロール転送受信処理
+  UsbDeviceContext *dev = (UsbDeviceContext *)transfer->context;
+  EspUsbHost *usbHost = dev->host;
+  UsbControlRequest req = dev->ctrlQueue[dev->ctrlHead];
+  dev->ctrlHead = (dev->ctrlHead + 1) % USB_HOST_CONTROL_QUEUE;
+  dev->ctrlCount--;
+  dev->ctrlBusy = false;
+  if (dev->state == USB_DEVICE_DRAINING) {
+    // 外れたデバイスの要求は結果を使わない（閉じるのはtask()）
+    return;
+  }
+
+  const UsbHidInterface &intf = dev->interfaces[req.interfaceIndex];
+  bool ok = transfer->status == USB_TRANSFER_STATUS_COMPLETED;
+  switch (req.kind) {
+    case USB_CONTROL_GET_REPORT_DESC:
+      {
+        // 読んでいる間止めていたレポートを標準キーボードとして扱う設定に戻す（ゲームパッドならonReportDescriptorが切り替える）
+        if (intf.endpoint != 0) {
+          dev->endpoint_data_list[intf.endpoint & 0x0F].decoder = USB_DECODER_KEYBOARD;
+        }
+        int length = transfer->actual_num_bytes - USB_SETUP_PACKET_SIZE;
+        if (ok && length > 0) {
+          ESP_LOGI("EspUsbHost", "Report descriptor Interface=%d %d bytes", intf.number, length);
+          usbHost->onReportDescriptor(*dev, intf, transfer->data_buffer + USB_SETUP_PACKET_SIZE, length);
+        } else {
+          ESP_LOGI("EspUsbHost", "Report descriptor Interface=%d FAILED status=%d", intf.number, transfer->status);
+#if USB_HOST_PROFILE_CACHE
+          // 読めなかった時の標準キーボード扱いは保存しない（次に挿した時にもう一度読む）
+          dev->profilePending = false;
+#endif
+        }
+      }
+      break;
+
+    default:
+      // SET_IDLEなどは任意の要求なので、STALLされても転送はそのまま続ける
+      ESP_LOGI("EspUsbHost", "Control request=0x%02X wValue=0x%04X Interface=%d %s (status=%d)",
+               req.setup.bRequest, req.setup.wValue, intf.number, ok ? "OK" : "FAILED", transfer->status);
+      break;
+  }
+  usbHost->_startNextControl(*dev);
+  usbHost->_finishEnumeration(*dev);
 }
 
-void EspUsbHost::_onReceive(usb_transfer_t *transfer) {
-  EspUsbHost *usbHost = (EspUsbHost *)transfer->context;
-  
-  // 受信データサイズをチェック
-  if (transfer->actual_num_bytes > 0) {
-    ESP_LOGI("EspUsbHost", "*** USB DATA RECEIVED *** Bytes: %d", transfer->actual_num_bytes);
-    
-    // 受信データをログ出力（16進数）
-    String hex_data = "";
-    for (int i = 0; i < transfer->actual_num_bytes; i++) {
-      if (transfer->data_buffer[i] < 16) hex_data += "0";
-      hex_data += String(transfer->data_buffer[i], HEX) + " ";
+// 接続時のHIDクラス要求を積む
+// SET_IDLE(0)で変化の無いレポートの再送を止め、ブートインターフェースはデコード方法に合わせてプロトコルを決める
+void EspUsbHost::_configureInterfaces(UsbDeviceContext &dev) {
+  for (uint8_t i = 0; i < dev.interfaceCount; i++) {
+    const UsbHidInterface &intf = dev.interfaces[i];
+    UsbControlRequest req = {};
+    req.interfaceIndex = i;
+    req.setup.wIndex = intf.number;
+
+#if USB_HOST_SET_IDLE
+    // bmRequestType: ホスト→デバイス, クラス, インターフェース宛て。wValue = 期間(上位, 0=無期限) | レポートID(下位, 0=全部)
+    req.kind = USB_CONTROL_SET_IDLE;
+    req.setup.bmRequestType = 0x21;
+    req.setup.bRequest = HID_REQ_SET_IDLE;
+    req.setup.wValue = 0;
+    req.setup.wLength = 0;
+    submitControl(dev, req);
+#endif
+
+    if (intf.protocol == HID_ITF_PROTOCOL_KEYBOARD || intf.protocol == HID_ITF_PROTOCOL_MOUSE) {
+      // ブート形式でデコードするのでブートプロトコルにする。
+      // KB16はNKROをQMKの共有エンドポイントで受けるのでレポートプロトコルのまま（ブートにするとNKROが止まる）
+      req.kind = USB_CONTROL_SET_PROTOCOL;
+      req.setup.bmRequestType = 0x21;
+      req.setup.bRequest = HID_REQ_SET_PROTOCOL;
+      req.setup.wValue = dev.isKB16() ? HID_PROTOCOL_REPORT : HID_PROTOCOL_BOOT;
+      req.setup.wLength = 0;
+      submitControl(dev, req);
     }
-    ESP_LOGI("EspUsbHost", "Raw data: %s", hex_data.c_str());
-    
-    // VID/PIDチェック
-    ESP_LOGI("EspUsbHost", "Device: VID=0x%04X, PID=0x%04X", 
-             usbHost->device_vendor_id, usbHost->device_product_id);
-    
-    // DOIO KB16の16バイトレポート処理
-    if (transfer->actual_num_bytes == 16) {
-      // 16バイト全体をチェック
-      static uint8_t last_16byte_report[16] = {0};
-      
-      // データが変化した場合のみ処理
-      if (memcmp(last_16byte_report, transfer->data_buffer, 16) != 0) {
-        ESP_LOGI("EspUsbHost", "DOIO KB16 16-byte report detected and changed");
-        
-        // Pythonアナライザーと同様の16バイトレポート解析
-        usbHost->processRawReport16Bytes(transfer->data_buffer);
-        
-        // 現在のレポートを保存
-        memcpy(last_16byte_report, transfer->data_buffer, 16);
+
+    if (intf.protocol == HID_ITF_PROTOCOL_KEYBOARD) {
+      // wValue = レポート種別(上位) | レポートID(下位)。データはLEDの1バイト
+      req.kind = USB_CONTROL_SET_REPORT;
+      req.setup.bmRequestType = 0x21;
+      req.setup.bRequest = HID_REQ_SET_REPORT;
+      req.setup.wValue = HID_REPORT_TYPE_OUTPUT << 8;
+      req.setup.wLength = 1;
+      req.data[0] = keyboardLeds;
+      submitControl(dev, req);
+    }
+
+    // ブート以外はレポート記述子を読んでからデコード方法を決める（KB16はQMKの振り分け表があるので読まない。
+    // 保存済みの解析結果で開いた時はデコード方法も保存済み）
+    if (intf.protocol == 0 && intf.endpoint != 0 && intf.reportDescLength > 0 && !dev.isKB16() && !dev.profileFromCache) {
+      // bmRequestType: デバイス→ホスト, 標準, インターフェース宛て
+      req.kind = USB_CONTROL_GET_REPORT_DESC;
+      req.setup.bmRequestType = 0x81;
+      req.setup.bRequest = 0x06;   // GET_DESCRIPTOR
+      req.setup.wValue = USB_HID_REPORT_DESC << 8;
+      req.setup.wLength = intf.reportDescLength < USB_HOST_CONTROL_MAX ? intf.reportDescLength : USB_HOST_CONTROL_MAX;
+      if (submitControl(dev, req) == ESP_OK) {
+        // 読み終わるまではレポートを処理しない（ゲームパッドのレポートをキーとして打たない）
+        dev.endpoint_data_list[intf.endpoint & 0x0F].decoder = USB_DECODER_NONE;
+      } else {
+#if USB_HOST_PROFILE_CACHE
+        dev.profilePending = false;
+#endif
       }
     }
-    // 標準8バイトHIDレポート処理
-    else if (transfer->actual_num_bytes >= 8) {
-      static hid_keyboard_report_t last_report = {};
-      
-      // レポートデータが変化した場合のみ処理
-      if (memcmp(&last_report, transfer->data_buffer, sizeof(last_report))) {
-        ESP_LOGI("EspUsbHost", "Standard 8-byte HID report detected");
-        
-        hid_keyboard_report_t report = {};
-        report.modifier = transfer->data_buffer[0];
-        report.reserved = transfer->data_buffer[1];
-        report.keycode[0] = transfer->data_buffer[2];
-        report.keycode[1] = transfer->data_buffer[3];
-        report.keycode[2] = transfer->data_buffer[4];
-        report.keycode[3] = transfer->data_buffer[5];
-        report.keycode[4] = transfer->data_buffer[6];
-        report.keycode[5] = transfer->data_buffer[7];
+  }
+}
 
-        // キーボード処理を呼び出し
-        usbHost->onKeyboard(report, last_report);
-        
-        memcpy(&last_report, &report, sizeof(last_report));
+void EspUsbHost::setKeyboardLeds(uint8_t leds) {
+  keyboardLeds = leds;
+  for (int d = 0; d < USB_HOST_MAX_DEVICES; d++) {
+    UsbDeviceContext &dev = devices[d];
+    if (!dev.isOpen()) {
+      continue;
+    }
+    for (uint8_t i = 0; i < dev.interfaceCount; i++) {
+      if (dev.interfaces[i].protocol != HID_ITF_PROTOCOL_KEYBOARD) {
+        continue;
       }
-    } else {
-      ESP_LOGI("EspUsbHost", "Unknown report size: %d bytes", transfer->actual_num_bytes);
+      UsbControlRequest req = {};
+      req.kind = USB_CONTROL_SET_REPORT;
+      req.interfaceIndex = i;
+      req.setup.bmRequestType = 0x21;
+      req.setup.bRequest = HID_REQ_SET_REPORT;
+      req.setup.wValue = HID_REPORT_TYPE_OUTPUT << 8;
+      req.setup.wIndex = dev.interfaces[i].number;
+      req.setup.wLength = 1;
+      req.data[0] = leds;
+      submitControl(dev, req);
     }
-    
-    // 継承クラスのonReceiveメソッドを呼び出し
-    usbHost->onReceive(transfer);
-  } else {
+  }
+}
+
+void EspUsbHost::_onReceive(usb_transfer_t *transfer) {
+  // contextは転送を用意したデバイスの状態（探索しない）
+  UsbDeviceContext *dev = (UsbDeviceContext *)transfer->context;
+  EspUsbHost *usbHost = dev->host;
+
+  // 転送が戻ったので送信中の印を外す（DRAININGではこれが揃うのを待って解放する）
+  for (int i = 0; i < dev->transferCount; i++) {
+    if (dev->transfers[i] == transfer) {
+      dev->inFlight &= ~(1 << i);
+      break;
+    }
+  }
+  if (!dev->isOpen() || transfer->status != USB_TRANSFER_STATUS_COMPLETED) {
+    return;
+  }
+  
+  // 受信データサイズをチェック
+  if (transfer->actual_num_bytes <= 0) {
     ESP_LOGI("EspUsbHost", "Received empty transfer");
+    return;
+  }
+  ESP_LOGI("EspUsbHost", "*** USB DATA RECEIVED *** addr=%d EP=0x%02X Bytes: %d",
+           dev->address, transfer->bEndpointAddress, transfer->actual_num_bytes);
+
+  // 接続から最初のレポートまでの時間（保存済みの解析結果を使ったかどうかで比べる）
+  if (!dev->firstReportSeen) {
+    dev->firstReportSeen = true;
+    usbHost->lastEnumerationUs = (uint32_t)(esp_timer_get_time() - dev->openedUs);
+    usbHost->lastEnumerationCached = dev->profileFromCache;
+    ESP_LOGI("EspUsbHost", "first report %lu us after plug-in (%s) addr=%d",
+             (unsigned long)usbHost->lastEnumerationUs, dev->profileFromCache ? "profile cache" : "full walk", dev->address);
   }
+
+  // エンドポイント番号でonConfigが記録した情報を引き、デコーダを1つに決める
+  const endpoint_data_t &ep = dev->endpoint_data_list[transfer->bEndpointAddress & 0x0F];
+  const uint8_t *data = transfer->data_buffer;
+  int length = transfer->actual_num_bytes;
+  UsbReportDecoder decoder = ep.decoder;
+  if (ep.hasReportId) {
+    uint8_t reportId = data[0];
+    decoder = reportId < USB_HOST_MAX_REPORT_ID ? dev->reportRoutes[ep.transferIndex][reportId] : USB_DECODER_NONE;
+    // NKROはID込みの形式で扱い、それ以外はIDを外して渡す
+    if (decoder != USB_DECODER_NKRO) {
+      data++;
+      length--;
+    }
+  }
+
+  if (decoder == USB_DECODER_NONE) {
+    ESP_LOGI("EspUsbHost", "Unrouted report: Interface=%d Protocol=%d first=0x%02X",
+             ep.bInterfaceNumber, ep.bInterfaceProtocol, transfer->data_buffer[0]);
+    usbHost->onReceive(*dev, transfer);
+    return;
+  }
+  usbHost->_dispatchReport(*dev, ep, decoder, data, length);
 }
 
-void EspUsbHost::_configCallback(const usb_config_desc_t *config_desc) {
+void EspUsbHost::_dispatchReport(UsbDeviceContext &dev, const endpoint_data_t &ep, UsbReportDecoder decoder, const uint8_t *data, int length) {
+  uint8_t *last = dev.lastReport[ep.transferIndex];
+  uint8_t &lastLength = dev.lastReportLength[ep.transferIndex];
+  reportCount++;
+
+  switch (decoder) {
+    case USB_DECODER_KEYBOARD:
+      {
+        if (length < (int)sizeof(hid_keyboard_report_t)) {
+          ESP_LOGI("EspUsbHost", "Short keyboard report: %d bytes", length);
+          return;
+        }
+        hid_keyboard_report_t last_report = {};
+        if (lastLength == sizeof(last_report)) {
+          memcpy(&last_report, last, sizeof(last_report));
+        }
+        // レポートデータが変化した場合のみ処理
+        if (memcmp(&last_report, data, sizeof(last_report)) == 0) {
+          unchangedCount++;
+          return;
+        }
+        hid_keyboard_report_t report;
+        memcpy(&report, data, sizeof(report));
+        memcpy(last, &report, sizeof(report));
+        lastLength = sizeof(report);
+
+        // キーボード処理を呼び出し
+        onKeyboard(dev, report, last_report);
+      }
+      break;
+
+    case USB_DECODER_NKRO:
+      {
+        if (length > USB_HOST_REPORT_MAX) length = USB_HOST_REPORT_MAX;
+        // データが変化した場合のみ処理（前回値はエンドポイントごと）
+        if (lastLength == length && memcmp(last, data, length) == 0) {
+          unchangedCount++;
+          return;
+        }
+        memcpy(last, data, length);
+        lastLength = length;
+
+        // Pythonアナライザーと同様のレポート解析
+        onNkroReport(dev, data, length);
+      }
+      break;
+
+    case USB_DECODER_CONSUMER:
+      if (length >= 2) {
+        onConsumer(dev, (uint16_t)(data[0] | (data[1] << 8)));
+      }
+      break;
+
+    case USB_DECODER_MOUSE:
+      if (length >= 3) {
+        hid_mouse_report_t report = {};
+        report.buttons = data[0];
+        report.x = (int8_t)data[1];
+        report.y = (int8_t)data[2];
+        report.wheel = length >= 4 ? (int8_t)data[3] : 0;
+        report.pan = length >= 5 ? (int8_t)data[4] : 0;
+        onMouse(report, dev.lastMouseButtons);
+        dev.lastMouseButtons = report.buttons;
+      }
+      break;
+
+    case USB_DECODER_GAMEPAD:
+      _onDataGamepad(dev, ep, data, length);
+      break;
+
+    default:
+      break;
+  }
+}
+
+void EspUsbHost::setReportRoute(UsbDeviceContext &dev, uint8_t bEndpointAddress, uint8_t reportId, UsbReportDecoder decoder) {
+  endpoint_data_t &ep = dev.endpoint_data_list[bEndpointAddress & 0x0F];
+  if (reportId >= USB_HOST_MAX_REPORT_ID || ep.transferIndex >= USB_HOST_MAX_TRANSFERS) {
+    return;
+  }
+  ep.hasReportId = true;
+  dev.reportRoutes[ep.transferIndex][reportId] = decoder;
+}
+
+void EspUsbHost::_configCallback(UsbDeviceContext &dev, const usb_config_desc_t *config_desc) {
   const uint8_t *p = &config_desc->val[0];
   uint8_t bLength;
 
@@ -353,48 +972,51 @@ void EspUsbHost::_configCallback(const usb_config_desc_t *config_desc) {
     bLength = *p;
     if ((i + bLength) <= config_desc->wTotalLength) {
       const uint8_t bDescriptorType = *(p + 1);
-      this->onConfig(bDescriptorType, p);
+      this->onConfig(dev, bDescriptorType, p);
     } else {
       return;
     }
   }
 }
 
-void EspUsbHost::onConfig(const uint8_t bDescriptorType, const uint8_t *p) {
-  static uint8_t _bInterfaceNumber = 0;
-  static uint8_t _bInterfaceClass = 0;
-  static uint8_t _bInterfaceSubClass = 0;
-  static uint8_t _bInterfaceProtocol = 0;
-  static uint8_t _bCountryCode = 0;
-  
+void EspUsbHost::onConfig(UsbDeviceContext &dev, const uint8_t bDescriptorType, const uint8_t *p) {
   switch (bDescriptorType) {
     case USB_INTERFACE_DESC:
       {
         const usb_intf_desc_t *intf_desc = (const usb_intf_desc_t *)p;
-        _bInterfaceNumber = intf_desc->bInterfaceNumber;
-        _bInterfaceClass = intf_desc->bInterfaceClass;
-        _bInterfaceSubClass = intf_desc->bInterfaceSubClass;
-        _bInterfaceProtocol = intf_desc->bInterfaceProtocol;
+        dev.curInterfaceNumber = intf_desc->bInterfaceNumber;
+        dev.curInterfaceClass = intf_desc->bInterfaceClass;
+        dev.curInterfaceSubClass = intf_desc->bInterfaceSubClass;
+        dev.curInterfaceProtocol = intf_desc->bInterfaceProtocol;
+        dev.curCountryCode = 0;
         
         ESP_LOGI("EspUsbHost", "USB_INTERFACE_DESC Interface=%d Class=0x%02X SubClass=0x%02X Protocol=0x%02X", 
-                 _bInterfaceNumber, _bInterfaceClass, _bInterfaceSubClass, _bInterfaceProtocol);
+                 dev.curInterfaceNumber, dev.curInterfaceClass, dev.curInterfaceSubClass, dev.curInterfaceProtocol);
         
         // HIDインターフェースの場合はクレーム
-        if (_bInterfaceClass == USB_CLASS_HID) {
+        if (dev.curInterfaceClass == USB_CLASS_HID) {
+          if (dev.interfaceCount >= USB_HOST_MAX_INTERFACES) {
+            ESP_LOGI("EspUsbHost", "Too many HID interfaces, skipping Interface=%d", dev.curInterfaceNumber);
+            dev.claimErr = ESP_ERR_NO_MEM;
+            return;
+          }
           ESP_LOGI("EspUsbHost", "Found HID interface! Attempting to claim...");
-          esp_err_t err = usb_host_interface_claim(this->clientHandle, this->deviceHandle, _bInterfaceNumber, 0);
+          esp_err_t err = usb_host_interface_claim(this->clientHandle, dev.handle, dev.curInterfaceNumber, 0);
           if (err != ESP_OK) {
             ESP_LOGI("EspUsbHost", "usb_host_interface_claim() FAILED err=%x", err);
-            this->claim_err = err;
+            dev.claimErr = err;
             return;
           } else {
-            ESP_LOGI("EspUsbHost", "usb_host_interface_claim() SUCCESS Interface=%d", _bInterfaceNumber);
-            this->usbInterface[this->usbInterfaceSize] = _bInterfaceNumber;
-            this->usbInterfaceSize++;
-            this->claim_err = ESP_OK;
+            ESP_LOGI("EspUsbHost", "usb_host_interface_claim() SUCCESS Interface=%d", dev.curInterfaceNumber);
+            UsbHidInterface &intf = dev.interfaces[dev.interfaceCount++];
+            intf.number = dev.curInterfaceNumber;
+            intf.protocol = dev.curInterfaceProtocol;
+            intf.endpoint = 0;
+            intf.reportDescLength = 0;
+            dev.claimErr = ESP_OK;
           }
         } else {
-          ESP_LOGI("EspUsbHost", "Non-HID interface detected: Class=0x%02X", _bInterfaceClass);
+          ESP_LOGI("EspUsbHost", "Non-HID interface detected: Class=0x%02X", dev.curInterfaceClass);
         }
       }
       break;
@@ -407,39 +1029,57 @@ void EspUsbHost::onConfig(const uint8_t bDescriptorType, const uint8_t *p) {
                  ep_desc->bEndpointAddress, ep_desc->bmAttributes, ep_desc->wMaxPacketSize);
         
         // HIDクラスかつINT転送のエンドポイントをセットアップ
-        if (_bInterfaceClass == USB_CLASS_HID && 
+        if (dev.curInterfaceClass == USB_CLASS_HID && 
             (ep_desc->bmAttributes & USB_BM_ATTRIBUTES_XFERTYPE_MASK) == USB_BM_ATTRIBUTES_XFER_INT &&
             (ep_desc->bEndpointAddress & USB_B_ENDPOINT_ADDRESS_EP_DIR_MASK)) {
           
           ESP_LOGI("EspUsbHost", "Setting up HID interrupt endpoint...");
           
-          if (this->claim_err != ESP_OK) {
-            ESP_LOGI("EspUsbHost", "Skipping endpoint due to claim error: %x", this->claim_err);
+          if (dev.claimErr != ESP_OK) {
+            ESP_LOGI("EspUsbHost", "Skipping endpoint due to claim error: %x", dev.claimErr);
+            return;
+          }
+          if (dev.transferCount >= USB_HOST_MAX_TRANSFERS) {
+            ESP_LOGI("EspUsbHost", "Too many interrupt endpoints, skipping 0x%02X", ep_desc->bEndpointAddress);
             return;
           }
 
-          // 転送バッファを割り当て
-          esp_err_t err = usb_host_transfer_alloc(ep_desc->wMaxPacketSize + 1, 0, &this->usbTransfer[this->usbTransferSize]);
-          if (err != ESP_OK) {
-            this->usbTransfer[this->usbTransferSize] = NULL;
-            ESP_LOGI("EspUsbHost", "usb_host_transfer_alloc() FAILED err=%x", err);
+          uint8_t transferIndex = dev.transferCount;
+          if (!_addTransfer(dev, ep_desc->bEndpointAddress, ep_desc->wMaxPacketSize, ep_desc->bInterval)) {
             return;
-          } else {
-            ESP_LOGI("EspUsbHost", "usb_host_transfer_alloc() SUCCESS size=%d", ep_desc->wMaxPacketSize + 1);
           }
 
-          // 転送設定
-          this->usbTransfer[this->usbTransferSize]->device_handle = this->deviceHandle;
-          this->usbTransfer[this->usbTransferSize]->bEndpointAddress = ep_desc->bEndpointAddress;
-          this->usbTransfer[this->usbTransferSize]->callback = this->_onReceive;
-          this->usbTransfer[this->usbTransferSize]->context = this;
-          this->usbTransfer[this->usbTransferSize]->num_bytes = ep_desc->wMaxPacketSize;
-          this->interval = ep_desc->bInterval;
-          this->isReady = true;
-          this->usbTransferSize++;
+          // エンドポイントとインターフェースの対応を記録し、デコーダを決める
+          endpoint_data_t &ep = dev.endpoint_data_list[ep_desc->bEndpointAddress & 0x0F];
+          ep.bInterfaceNumber = dev.curInterfaceNumber;
+          ep.bInterfaceClass = dev.curInterfaceClass;
+          ep.bInterfaceSubClass = dev.curInterfaceSubClass;
+          ep.bInterfaceProtocol = dev.curInterfaceProtocol;
+          ep.bCountryCode = dev.curCountryCode;
+          ep.transferIndex = transferIndex;
+          ep.hasReportId = false;
+          if (dev.interfaceCount > 0 && dev.interfaces[dev.interfaceCount - 1].number == dev.curInterfaceNumber) {
+            UsbHidInterface &intf = dev.interfaces[dev.interfaceCount - 1];
+            if (intf.endpoint == 0) intf.endpoint = ep_desc->bEndpointAddress;
+          }
+          if (dev.curInterfaceProtocol == HID_ITF_PROTOCOL_KEYBOARD) {
+            ep.decoder = USB_DECODER_KEYBOARD;
+          } else if (dev.curInterfaceProtocol == HID_ITF_PROTOCOL_MOUSE) {
+            ep.decoder = USB_DECODER_MOUSE;
+          } else if (dev.isKB16()) {
+            // KB16のブート以外のインターフェースはQMKの共有エンドポイント（先頭がレポートID）
+            ep.decoder = USB_DECODER_NONE;
+            setReportRoute(dev, ep_desc->bEndpointAddress, QMK_REPORT_ID_KEYBOARD, USB_DECODER_KEYBOARD);
+            setReportRoute(dev, ep_desc->bEndpointAddress, QMK_REPORT_ID_MOUSE, USB_DECODER_MOUSE);
+            setReportRoute(dev, ep_desc->bEndpointAddress, QMK_REPORT_ID_CONSUMER, USB_DECODER_CONSUMER);
+            setReportRoute(dev, ep_desc->bEndpointAddress, QMK_REPORT_ID_NKRO, USB_DECODER_NKRO);
+          } else {
+            // レポート記述子を読まない間は、ブート以外のインターフェースも標準キーボードとして扱う
+            ep.decoder = USB_DECODER_KEYBOARD;
+          }
           
-          ESP_LOGI("EspUsbHost", "HID endpoint configured successfully! MaxPacket=%d, Interval=%d", 
-                   ep_desc->wMaxPacketSize, ep_desc->bInterval);
+          ESP_LOGI("EspUsbHost", "HID endpoint configured successfully! Interface=%d MaxPacket=%d, Interval=%d, Decoder=%d, ReportId=%d", 
+                   ep.bInterfaceNumber, ep_desc->wMaxPacketSize, ep_desc->bInterval, ep.decoder, ep.hasReportId);
         } else {
           ESP_LOGI("EspUsbHost", "Skipping non-HID interrupt endpoint");
         }
@@ -448,7 +1088,17 @@ void EspUsbHost::onConfig(const uint8_t bDescriptorType, const uint8_t *p) {
 
     case USB_HID_DESC:
       {
-        ESP_LOGI("EspUsbHost", "USB_HID_DESC detected");
+        // HID記述子: [bLength, bDescriptorType, bcdHID(2), bCountryCode, bNumDescriptors, bDescriptorType, wDescriptorLength(2), ...]
+        dev.curCountryCode = p[4];
+        uint16_t reportDescLength = 0;
+        if (p[0] >= 9 && p[6] == USB_HID_REPORT_DESC) {
+          reportDescLength = p[7] | (p[8] << 8);
+        }
+        if (dev.claimErr == ESP_OK && dev.interfaceCount > 0 &&
+            dev.interfaces[dev.interfaceCount - 1].number == dev.curInterfaceNumber) {
+          dev.interfaces[dev.interfaceCount - 1].reportDescLength = reportDescLength;
+        }
+        ESP_LOGI("EspUsbHost", "USB_HID_DESC detected CountryCode=%d ReportDescLength=%d", dev.curCountryCode, reportDescLength);
       }
       break;
 
@@ -0,0 +1,145 @@
+#include "FeedbackBus.h"
+#include "Peripherals.h"
+#include "SpecialKeyHandler.h"
+
+// グローバルインスタンスの定義
+FeedbackBus feedbackBus;
+
+bool FeedbackBus::begin(U8G2* disp, BaseType_t core) {
+    display = disp;
+    channels[FEEDBACK_LED].minIntervalMs = FEEDBACK_LED_MIN_INTERVAL_MS;
+    channels[FEEDBACK_SOUND].minIntervalMs = FEEDBACK_SOUND_MIN_INTERVAL_MS;
+    channels[FEEDBACK_DISPLAY].minIntervalMs = FEEDBACK_DISPLAY_MIN_INTERVAL_MS;
+
+    queue = xQueueCreate(FEEDBACK_QUEUE_LENGTH, sizeof(FeedbackEvent));
+    if (queue == nullptr) {
+        ESP_LOGI("FeedbackBus", "queue create failed, feedback disabled");
+        return false;
+    }
+    // BLE送信より後回しでよいので最低優先度で動かす
+    BaseType_t ok = xTaskCreatePinnedToCore(feedbackTask, "feedbackTask", 4096, this, 1, NULL, core);
+    if (ok != pdPASS) {
+        vQueueDelete(queue);
+        queue = nullptr;
+        ESP_LOGI("FeedbackBus", "feedback task create failed, feedback disabled");
+        return false;
+    }
+    return true;
+}
+
+bool FeedbackBus::publish(const FeedbackEvent& event) {
+    if (queue == nullptr) return false;
+    if (xQueueSend(queue, &event, 0) != pdTRUE) {
+        dropped++;
+        return false;
+    }
+    published++;
+    return true;
+}
+
+void FeedbackBus::setChannelEnabled(FeedbackChannel channel, bool enabled) {
+    if (channel >= FEEDBACK_CHANNEL_COUNT) return;
+    channels[channel].enabled = enabled;
+}
+
+void FeedbackBus::setChannelMinInterval(FeedbackChannel channel, uint16_t intervalMs) {
+    if (channel >= FEEDBACK_CHANNEL_COUNT) return;
+    channels[channel].minIntervalMs = intervalMs;
+}
+
+void FeedbackBus::feedbackTask(void* pvParameters) {
+    static_cast<FeedbackBus*>(pvParameters)->run();
+}
+
+void FeedbackBus::run() {
+    FeedbackEvent event;
+    for (;;) {
+        // まとめた画面更新があれば、間隔が明けるまでだけ待つ
+        TickType_t wait = portMAX_DELAY;
+        if (displayPending) {
+            uint32_t ms = msUntilDisplayDue(millis());
+            wait = (ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+        }
+
+        if (xQueueReceive(queue, &event, wait) == pdTRUE) {
+            dispatch(event, millis());
+        }
+
+        uint32_t now = millis();
+        if (displayPending && msUntilDisplayDue(now) == 0) {
+            displayPending = false;
+            ChannelState& ch = channels[FEEDBACK_DISPLAY];
+            ch.lastOutputMs = now;
+            ch.hasOutput = true;
+            showKeys(pendingDisplay, pendingPrevKeycode);
+        }
+    }
+}
+
+void FeedbackBus::dispatch(const FeedbackEvent& event, uint32_t now) {
+    if ((event.flags & FEEDBACK_KEY_PRESS) && admit(FEEDBACK_LED, now)) {
+        ledController.keyPressed();
+    }
+    if ((event.flags & (FEEDBACK_KEY_PRESS | FEEDBACK_KEY_REPEAT)) && admit(FEEDBACK_SOUND, now)) {
+        speakerController.playKeySound();
+    }
+
+    if (event.flags & FEEDBACK_KEYS_CHANGED) {
+        // 連続ルールの判定元は表示しなかったイベントでも進める
+        uint8_t prevKeycode = lastSingleKeycode;
+        if (strcmp(event.characters, "None") != 0) {
+            lastSingleKeycode = event.shift ? 0 : event.keycode;
+        }
+
+        ChannelState& ch = channels[FEEDBACK_DISPLAY];
+        if (!ch.enabled) {
+            ch.suppressed++;
+            return;
+        }
+        if (displayPending) {
+            // まだ描いていない更新は最新で置き換える
+            ch.suppressed++;
+        }
+        pendingDisplay = event;
+        pendingPrevKeycode = prevKeycode;
+        displayPending = true;
+    }
+}
+
+// LED・音の可否（間隔内なら出さない）
+bool FeedbackBus::admit(FeedbackChannel channel, uint32_t now) {
+    ChannelState& ch = channels[channel];
+    if (!ch.enabled || (ch.hasOutput && now - ch.lastOutputMs < ch.minIntervalMs)) {
+        ch.suppressed++;
+        return false;
+    }
+    ch.lastOutputMs = now;
+    ch.hasOutput = true;
+    return true;
+}
+
+uint32_t FeedbackBus::msUntilDisplayDue(uint32_t now) const {
+    const ChannelState& ch = channels[FEEDBACK_DISPLAY];
+    if (!ch.hasOutput) return 0;
+    uint32_t elapsed = now - ch.lastOutputMs;
+    return elapsed >= ch.minIntervalMs ? 0 : ch.minIntervalMs - elapsed;
+}
+
+// キー押下時のディスプレイ更新
+void FeedbackBus::showKeys(const FeedbackEvent& event, uint8_t prevKeycode) {
+    if (!display) return;
+
+    // 特別表示はhandleSpecialKeyDisplayでキューに入る（キーコードで直接テーブルを引く）
+    if (handleSpecialKeyDisplay(display, event.keycode, event.shift, prevKeycode)) {
+        return;
+    }
+
+    // 通常表示要求をキューに入れる（2行表示対応）
+    DisplayRequest req;
+    req.type = DISPLAY_NORMAL;
+    req.display = display;
+    req.setText1(event.characters[0] ? event.characters : "---"); // メイン
+    req.setText2(event.keyNames);                                  // サブ（バイトキー名）
+    req.font = u8g2_font_fub25_tr;
+    requestDisplay(req);
+}
@@ -0,0 +1,54 @@
+#include "FrameCache.h"
+
+// グローバルインスタンスの定義
+FrameCache frameCache;
+
+bool FrameCache::allocate() {
+    if (frames) return true;
+    if (allocFailed) return false;
+
+    #ifdef BOARD_HAS_PSRAM
+    if (psramFound()) {
+        frames = (uint8_t*)ps_malloc(FRAME_CACHE_CAPACITY * FRAME_CACHE_FRAME_BYTES);
+    }
+    #endif
+
+    if (!frames) {
+        // PSRAMが無い場合は内部RAMを消費しないようキャッシュを無効にする
+        allocFailed = true;
+        ESP_LOGI("FrameCache", "PSRAM unavailable, frame cache disabled");
+        return false;
+    }
+    ESP_LOGI("FrameCache", "frame cache allocated: %d frames", FRAME_CACHE_CAPACITY);
+    return true;
+}
+
+int FrameCache::find(const void* owner, int32_t variant) const {
+    for (int i = 0; i < count; i++) {
+        if (entries[i].owner == owner && entries[i].variant == variant) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool FrameCache::blit(U8G2* display, const void* owner, int32_t variant) {
+    int i = find(owner, variant);
+    if (i < 0) {
+        misses++;
+        return false;
+    }
+    memcpy(display->getBufferPtr(), frames + i * FRAME_CACHE_FRAME_BYTES, FRAME_CACHE_FRAME_BYTES);
+    hits++;
+    return true;
+}
+
+void FrameCache::store(U8G2* display, const void* owner, int32_t variant) {
+    if (count >= FRAME_CACHE_CAPACITY || !allocate()) return;
+    if (find(owner, variant) >= 0) return;
+
+    memcpy(frames + count * FRAME_CACHE_FRAME_BYTES, display->getBufferPtr(), FRAME_CACHE_FRAME_BYTES);
+    entries[count].owner = owner;
+    entries[count].variant = variant;
+    count++;
+}
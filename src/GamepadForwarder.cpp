@@ -0,0 +1,91 @@
+#include "GamepadForwarder.h"
+
+// グローバルインスタンスの定義
+GamepadForwarder gamepadForwarder;
+
+bool GamepadForwarder::begin(BleKeyboard* kbd, BaseType_t core) {
+    keyboard = kbd;
+    BaseType_t ok = xTaskCreatePinnedToCore(gamepadTask, "gamepadTask", 3072, this, 1, &task, core);
+    if (ok != pdPASS) {
+        task = nullptr;
+        ESP_LOGI("GamepadForwarder", "gamepad task create failed, gamepad disabled");
+        return false;
+    }
+    return true;
+}
+
+void GamepadForwarder::applyDeadband(GamepadState& state) const {
+    for (int a = 0; a < GAMEPAD_AXIS_COUNT; a++) {
+        if (abs(state.axes[a]) < deadband) state.axes[a] = 0;
+    }
+}
+
+bool GamepadForwarder::isSignificant(const GamepadState& next, const GamepadState& last) const {
+    if (next.buttons != last.buttons || next.hat != last.hat) return true;
+    for (int a = 0; a < GAMEPAD_AXIS_COUNT; a++) {
+        if (next.axes[a] == last.axes[a]) continue;
+        // 中立への復帰は小さな変化でも送る（止まれなくならないように）
+        if (next.axes[a] == 0) return true;
+        if (abs(next.axes[a] - last.axes[a]) >= changeThreshold) return true;
+    }
+    return false;
+}
+
+void GamepadForwarder::update(const GamepadState& state) {
+    if (task == nullptr) return;
+    received++;
+
+    GamepadState next = state;
+    applyDeadband(next);
+
+    bool wake = false;
+    portENTER_CRITICAL(&lock);
+    if (isSignificant(next, lastSent)) {
+        // 送信待ちを最新で置き換える（間隔内の途中の状態は送らない）
+        if (dirty) filtered++;
+        wake = !dirty;
+        dirty = true;
+    } else {
+        filtered++;
+    }
+    latest = next;
+    portEXIT_CRITICAL(&lock);
+
+    if (wake) xTaskNotifyGive(task);
+}
+
+void GamepadForwarder::reset() {
+    GamepadState neutral = {};
+    update(neutral);
+}
+
+void GamepadForwarder::gamepadTask(void* pvParameters) {
+    static_cast<GamepadForwarder*>(pvParameters)->run();
+}
+
+void GamepadForwarder::run() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        // 最初の1回はすぐ送り、以降は最小間隔ごとに最新の状態を送る
+        for (;;) {
+            GamepadState state;
+            portENTER_CRITICAL(&lock);
+            bool send = dirty;
+            state = latest;
+            dirty = false;
+            if (send) lastSent = state;
+            portEXIT_CRITICAL(&lock);
+            if (!send) break;
+
+            if (keyboard && keyboard->isConnected()) {
+                BLEGamepadReport report;
+                report.buttons = state.buttons;
+                report.hat = state.hat;
+                for (int a = 0; a < GAMEPAD_AXIS_COUNT; a++) report.axes[a] = state.axes[a];
+                keyboard->sendReport(&report);
+                sent++;
+            }
+            vTaskDelay(pdMS_TO_TICKS(minIntervalMs));
+        }
+    }
+}
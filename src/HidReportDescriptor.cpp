@@ -0,0 +1,232 @@
+#include "HidReportDescriptor.h"
+#include <string.h>
+
+// 短い項目の種類とタグ（HID 1.11 6.2.2）
+#define HID_TYPE_MAIN    0
+#define HID_TYPE_GLOBAL  1
+#define HID_TYPE_LOCAL   2
+
+#define HID_MAIN_INPUT           0x8
+#define HID_MAIN_COLLECTION      0xA
+#define HID_MAIN_END_COLLECTION  0xC
+#define HID_GLOBAL_USAGE_PAGE    0x0
+#define HID_GLOBAL_LOGICAL_MIN   0x1
+#define HID_GLOBAL_LOGICAL_MAX   0x2
+#define HID_GLOBAL_REPORT_SIZE   0x7
+#define HID_GLOBAL_REPORT_ID     0x8
+#define HID_GLOBAL_REPORT_COUNT  0x9
+#define HID_LOCAL_USAGE          0x0
+#define HID_LOCAL_USAGE_MIN      0x1
+#define HID_LOCAL_USAGE_MAX      0x2
+
+#define HID_PAGE_GENERIC_DESKTOP 0x01
+#define HID_PAGE_BUTTON          0x09
+#define HID_USAGE_JOYSTICK       0x04
+#define HID_USAGE_GAMEPAD        0x05
+#define HID_USAGE_HAT_SWITCH     0x39
+
+#define HID_MAX_LOCAL_USAGES     16
+#define HID_MAX_REPORT_IDS       16
+
+// Generic Desktopの使用法（0x30〜0x35）から軸の添字へ
+static int axisFromUsage(uint32_t usage) {
+  switch (usage) {
+    case 0x30: return GAMEPAD_AXIS_X;
+    case 0x31: return GAMEPAD_AXIS_Y;
+    case 0x32: return GAMEPAD_AXIS_Z;
+    case 0x33: return GAMEPAD_AXIS_RX;
+    case 0x34: return GAMEPAD_AXIS_RY;
+    case 0x35: return GAMEPAD_AXIS_RZ;
+    default:   return -1;
+  }
+}
+
+bool hidParseGamepadLayout(const uint8_t *desc, int length, HidGamepadLayout &layout) {
+  memset(&layout, 0, sizeof(layout));
+
+  // グローバル状態
+  uint16_t usagePage = 0;
+  int32_t logicalMin = 0;
+  int32_t logicalMax = 0;
+  uint8_t reportSize = 0;
+  uint8_t reportCount = 0;
+  uint8_t reportId = 0;
+  // ローカル状態（Main項目ごとにリセット）
+  uint32_t usages[HID_MAX_LOCAL_USAGES];
+  uint8_t usageCount = 0;
+  uint32_t usageMin = 0;
+  uint32_t usageMax = 0;
+  bool hasUsageRange = false;
+
+  // レポートIDごとのビット位置（IDなしは0番）
+  uint16_t bitPos[HID_MAX_REPORT_IDS] = {};
+  int depth = 0;
+  int gamepadDepth = 0;             // Joystick/Gamepadコレクションの深さ（0なら外）
+  bool found = false;
+
+  int i = 0;
+  while (i < length) {
+    uint8_t prefix = desc[i++];
+    if (prefix == 0xFE) {
+      // 長い項目は読み飛ばす
+      if (i + 1 >= length) break;
+      i += 2 + desc[i];
+      continue;
+    }
+    uint8_t size = prefix & 0x03;
+    if (size == 3) size = 4;
+    uint8_t type = (prefix >> 2) & 0x03;
+    uint8_t tag = prefix >> 4;
+    if (i + size > length) break;
+
+    uint32_t uvalue = 0;
+    for (int b = 0; b < size; b++) {
+      uvalue |= (uint32_t)desc[i + b] << (8 * b);
+    }
+    int32_t svalue = (int32_t)uvalue;
+    if (size == 1) svalue = (int8_t)uvalue;
+    else if (size == 2) svalue = (int16_t)uvalue;
+    i += size;
+
+    if (type == HID_TYPE_GLOBAL) {
+      switch (tag) {
+        case HID_GLOBAL_USAGE_PAGE:   usagePage = uvalue; break;
+        case HID_GLOBAL_LOGICAL_MIN:  logicalMin = svalue; break;
+        case HID_GLOBAL_LOGICAL_MAX:
+          // 最小値が0以上なら最大値は符号なしとして読む
+          logicalMax = logicalMin >= 0 ? (int32_t)uvalue : svalue;
+          break;
+        case HID_GLOBAL_REPORT_SIZE:  reportSize = uvalue > 0xFF ? 0xFF : uvalue; break;
+        case HID_GLOBAL_REPORT_COUNT: reportCount = uvalue; break;
+        case HID_GLOBAL_REPORT_ID:    reportId = uvalue; break;
+        default: break;
+      }
+    } else if (type == HID_TYPE_LOCAL) {
+      // 4バイトの使用法は上位16ビットが使用法ページ（ここではページ込みの値のまま持つ）
+      uint32_t usage = size == 4 ? uvalue : ((uint32_t)usagePage << 16) | uvalue;
+      switch (tag) {
+        case HID_LOCAL_USAGE:
+          if (usageCount < HID_MAX_LOCAL_USAGES) usages[usageCount++] = usage;
+          break;
+        case HID_LOCAL_USAGE_MIN: usageMin = usage; hasUsageRange = true; break;
+        case HID_LOCAL_USAGE_MAX: usageMax = usage; hasUsageRange = true; break;
+        default: break;
+      }
+    } else if (type == HID_TYPE_MAIN) {
+      if (tag == HID_MAIN_COLLECTION) {
+        depth++;
+        uint32_t usage = usageCount > 0 ? usages[0] : 0;
+        if (gamepadDepth == 0 && !found && uvalue == 0x01 &&
+            (usage == ((HID_PAGE_GENERIC_DESKTOP << 16) | HID_USAGE_JOYSTICK) ||
+             usage == ((HID_PAGE_GENERIC_DESKTOP << 16) | HID_USAGE_GAMEPAD))) {
+          gamepadDepth = depth;
+        }
+      } else if (tag == HID_MAIN_END_COLLECTION) {
+        if (depth == gamepadDepth) {
+          gamepadDepth = 0;
+          found = layout.valid;
+        }
+        if (depth > 0) depth--;
+      } else if (tag == HID_MAIN_INPUT) {
+        uint8_t idIndex = reportId < HID_MAX_REPORT_IDS ? reportId : 0;
+        bool constant = uvalue & 0x01;
+        bool inGamepad = gamepadDepth > 0 && !found && reportId < HID_MAX_REPORT_IDS &&
+                         (!layout.valid || layout.reportId == reportId);
+        // Report Size 0や32ビットを超えるフィールドは読めないので使わない（位置だけ進める）
+        bool readable = reportSize > 0 && reportSize <= 32;
+        for (int f = 0; f < reportCount; f++) {
+          uint16_t offset = bitPos[idIndex] + f * reportSize;
+          if (!inGamepad || constant || !readable) continue;
+          uint32_t usage;
+          if (hasUsageRange) {
+            usage = usageMin + f;
+            if (usage > usageMax) usage = usageMax;
+          } else if (usageCount > 0) {
+            usage = usages[f < usageCount ? f : usageCount - 1];
+          } else {
+            continue;
+          }
+          uint16_t page = usage >> 16;
+          uint16_t id = usage & 0xFFFF;
+
+          HidReportField field = { true, offset, reportSize, logicalMin, logicalMax };
+          if (page == HID_PAGE_BUTTON && reportSize == 1) {
+            if (layout.buttonCount == 0) layout.buttonOffset = offset;
+            // 連続したボタンだけを使う
+            if (offset == layout.buttonOffset + layout.buttonCount && layout.buttonCount < GAMEPAD_MAX_BUTTONS) {
+              layout.buttonCount++;
+            }
+          } else if (page == HID_PAGE_GENERIC_DESKTOP && id == HID_USAGE_HAT_SWITCH) {
+            if (!layout.hat.present) layout.hat = field;
+          } else if (page == HID_PAGE_GENERIC_DESKTOP) {
+            int axis = axisFromUsage(id);
+            if (axis >= 0 && !layout.axes[axis].present && reportSize <= 16) {
+              layout.axes[axis] = field;
+            } else {
+              continue;
+            }
+          } else {
+            continue;
+          }
+          layout.valid = true;
+          layout.reportId = reportId;
+        }
+        bitPos[idIndex] += reportSize * reportCount;
+      }
+      // Main項目ごとにローカル状態を捨てる
+      usageCount = 0;
+      hasUsageRange = false;
+      usageMin = usageMax = 0;
+    }
+  }
+  return layout.valid;
+}
+
+// ビット位置から値を取り出す（リトルエンディアン）
+static uint32_t readBits(const uint8_t *data, int length, uint16_t bitOffset, uint8_t bitSize) {
+  uint32_t value = 0;
+  for (int b = 0; b < bitSize; b++) {
+    int bit = bitOffset + b;
+    if ((bit >> 3) >= length) break;
+    if (data[bit >> 3] & (1 << (bit & 7))) value |= (uint32_t)1 << b;
+  }
+  return value;
+}
+
+static int32_t readField(const HidReportField &field, const uint8_t *data, int length) {
+  if (field.bitSize == 0) return 0;
+  uint32_t raw = readBits(data, length, field.bitOffset, field.bitSize);
+  if (field.logicalMin < 0 && field.bitSize < 32 && (raw & ((uint32_t)1 << (field.bitSize - 1)))) {
+    raw |= ~(((uint32_t)1 << field.bitSize) - 1);   // 符号拡張
+  }
+  return (int32_t)raw;
+}
+
+bool hidDecodeGamepad(const HidGamepadLayout &layout, const uint8_t *data, int length, GamepadState &state) {
+  if (!layout.valid) return false;
+  memset(&state, 0, sizeof(state));
+
+  for (int a = 0; a < GAMEPAD_AXIS_COUNT; a++) {
+    const HidReportField &field = layout.axes[a];
+    if (!field.present || field.logicalMax <= field.logicalMin) continue;
+    int32_t v = readField(field, data, length);
+    if (v < field.logicalMin) v = field.logicalMin;
+    if (v > field.logicalMax) v = field.logicalMax;
+    // 論理範囲を-127〜127へ
+    int64_t span = (int64_t)field.logicalMax - field.logicalMin;
+    state.axes[a] = (int8_t)(((int64_t)(v - field.logicalMin) * 254 + span / 2) / span - 127);
+  }
+
+  if (layout.hat.present) {
+    int32_t v = readField(layout.hat, data, length);
+    // 範囲外はヌル状態（中立）
+    if (v >= layout.hat.logicalMin && v <= layout.hat.logicalMax && v - layout.hat.logicalMin < 8) {
+      state.hat = (uint8_t)(v - layout.hat.logicalMin + 1);
+    }
+  }
+
+  for (int b = 0; b < layout.buttonCount; b++) {
+    if (readBits(data, length, layout.buttonOffset + b, 1)) state.buttons |= (uint16_t)1 << b;
+  }
+  return true;
+}
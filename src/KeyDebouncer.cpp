@@ -0,0 +1,93 @@
+#include "KeyDebouncer.h"
+
+void KeyDebouncer::reset() {
+    memset(raw, 0, sizeof(raw));
+    memset(stable, 0, sizeof(stable));
+    memset(pending, 0, sizeof(pending));
+    pendingCount = 0;
+}
+
+void KeyDebouncer::countChatter(int key) {
+    if (chatter[key] < 0xFFFF) chatter[key]++;
+    totalChatter++;
+}
+
+bool KeyDebouncer::filter(const uint8_t next[KEY_BITMAP_BYTES], uint32_t nowMs, uint8_t out[KEY_BITMAP_BYTES]) {
+    uint16_t now = (uint16_t)nowMs;
+    bool changed = settle(now);
+
+    for (int byte = 0; byte < KEY_BITMAP_BYTES; byte++) {
+        uint8_t diff = next[byte] ^ raw[byte];
+        if (diff == 0) continue;
+        for (int bit = 0; bit < 8; bit++) {
+            if (!(diff & (1 << bit))) continue;
+            int key = byte * 8 + bit;
+            bool down = next[byte] & (1 << bit);
+
+            if (windowMs == 0) {
+                setBit(stable, key, down);
+                changed = true;
+                continue;
+            }
+            if (getBit(pending, key)) {
+                // 窓の中でまた変わった（EAGERは確定済みの変化の跳ね返り、DEFERREDは確定前の揺れ）
+                countChatter(key);
+                if (mode == KEY_DEBOUNCE_DEFERRED) edgeMs[key] = now;   // 揺れが収まってから窓を数え直す
+                continue;
+            }
+            setBit(pending, key, true);
+            pendingCount++;
+            edgeMs[key] = now;
+            if (mode == KEY_DEBOUNCE_EAGER) {
+                setBit(stable, key, down);
+                changed = true;
+            }
+        }
+        raw[byte] = next[byte];
+    }
+
+    memcpy(out, stable, KEY_BITMAP_BYTES);
+    return changed;
+}
+
+bool KeyDebouncer::poll(uint32_t nowMs, uint8_t out[KEY_BITMAP_BYTES]) {
+    if (pendingCount == 0) return false;
+    bool changed = settle((uint16_t)nowMs);
+    memcpy(out, stable, KEY_BITMAP_BYTES);
+    return changed;
+}
+
+bool KeyDebouncer::settle(uint16_t now) {
+    if (pendingCount == 0) return false;
+    bool changed = false;
+    for (int byte = 0; byte < KEY_BITMAP_BYTES; byte++) {
+        if (pending[byte] == 0) continue;
+        for (int bit = 0; bit < 8; bit++) {
+            int key = byte * 8 + bit;
+            if (!getBit(pending, key) || (uint16_t)(now - edgeMs[key]) < windowMs) continue;
+
+            setBit(pending, key, false);
+            pendingCount--;
+            bool down = getBit(raw, key);
+            if (down == getBit(stable, key)) continue;   // 元の状態に戻った（短いパルスは出さない）
+
+            // 窓が閉じた時点の生の状態に合わせる。EAGERは新しい変化なので、また窓を開く
+            setBit(stable, key, down);
+            changed = true;
+            if (mode == KEY_DEBOUNCE_EAGER) {
+                setBit(pending, key, true);
+                pendingCount++;
+                edgeMs[key] = now;
+            }
+        }
+    }
+    return changed;
+}
+
+uint8_t KeyDebouncer::getWorstKey() const {
+    uint8_t worst = 0;
+    for (int key = 1; key < 256; key++) {
+        if (chatter[key] > chatter[worst]) worst = key;
+    }
+    return chatter[worst] > 0 ? worst : 0;
+}
@@ -0,0 +1,236 @@
+#include "KeyLayers.h"
+
+// グローバルインスタンスの定義
+KeyLayers keyLayers;
+
+// KB16の既定のキーマップ（キーコードはKEYCODE_MAPと同じKB16基準）
+// PrintScreenはタップでPrintScreen、ホールドでレイヤー1（ファンクション）。
+// レイヤー1では数字1〜4がF1〜F4、矢印がHome/End/PageUp/PageDown、Escでレイヤー1を固定/解除する。
+// S/H/Bはマクロ（S: 保存、H: 押している間スクリーンショット、B: 再生中のマクロを止める）。
+const KeymapEntry KB16_KEYMAP[] = {
+    {0, 0x4A, LT(1, 0x4A)},   // PrintScreen
+
+    {1, 0x22, KC(0x3E)},      // 1 -> F1
+    {1, 0x23, KC(0x3F)},      // 2 -> F2
+    {1, 0x24, KC(0x40)},      // 3 -> F3
+    {1, 0x25, KC(0x41)},      // 4 -> F4
+    {1, 0x56, KC(0x4F)},      // Up -> PageUp
+    {1, 0x55, KC(0x52)},      // Down -> PageDown
+    {1, 0x54, KC(0x4E)},      // Left -> Home
+    {1, 0x53, KC(0x51)},      // Right -> End
+    {1, 0x2D, TG(1)},         // Esc -> レイヤー1の固定/解除
+    {1, 0x1A, MC(0)},         // S -> マクロ0
+    {1, 0x0F, MC(1)},         // H -> マクロ1
+    {1, 0x09, MC_STOP},       // B -> マクロを止める
+};
+const int KB16_KEYMAP_SIZE = sizeof(KB16_KEYMAP) / sizeof(KeymapEntry);
+
+void KeyLayers::compile(const KeymapEntry* entries, int count) {
+    // 基本レイヤーはそのまま、上のレイヤーは透過から始める
+    for (int k = 0; k < 256; k++) {
+        table[0][k] = KC(k);
+        for (int l = 1; l < KEYMAP_LAYERS; l++) table[l][k] = KC_TRANS;
+    }
+    for (int i = 0; i < count; i++) {
+        if (entries[i].layer < KEYMAP_LAYERS) table[entries[i].layer][entries[i].keycode] = entries[i].action;
+    }
+    // 透過を下のレイヤーの動作で埋める（押下時は1回引くだけにする）
+    for (int l = 1; l < KEYMAP_LAYERS; l++) {
+        for (int k = 0; k < 256; k++) {
+            if (KEY_ACTION_KIND(table[l][k]) == KA_TRANSPARENT) table[l][k] = table[l - 1][k];
+        }
+    }
+    for (int k = 0; k < 256; k++) {
+        if (KEY_ACTION_KIND(table[0][k]) == KA_TRANSPARENT) table[0][k] = KC(k);
+    }
+    reset();
+}
+
+bool KeyLayers::begin() {
+    const esp_timer_create_args_t args = {
+        .callback = &KeyLayers::onTimer,
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "keyLayers",
+        .skip_unhandled_events = false,
+    };
+    return esp_timer_create(&args, &timer) == ESP_OK;
+}
+
+void KeyLayers::reset() {
+    if (timer) esp_timer_stop(timer);
+    portENTER_CRITICAL(&lock);
+    memset(pressed, 0, sizeof(pressed));
+    memset(layerHeld, 0, sizeof(layerHeld));
+    layerToggled = 0;
+    tapPending = false;
+    eventHead = 0;
+    eventCount = 0;
+    portEXIT_CRITICAL(&lock);
+}
+
+uint8_t KeyLayers::activeLayerLocked() const {
+    uint8_t mask = layerToggled | 1;
+    for (int l = 1; l < KEYMAP_LAYERS; l++) {
+        if (layerHeld[l] > 0) mask |= 1 << l;
+    }
+    return 31 - __builtin_clz(mask);
+}
+
+uint8_t KeyLayers::getActiveLayer() const {
+    portENTER_CRITICAL(&lock);
+    uint8_t layer = activeLayerLocked();
+    portEXIT_CRITICAL(&lock);
+    return layer;
+}
+
+void KeyLayers::emit(uint8_t keycode, bool down, bool macro) {
+    if (keycode == 0 && !macro) return;
+    if (eventCount >= KEYMAP_EVENT_QUEUE) {
+        droppedEvents++;
+        return;
+    }
+    KeyEvent& e = events[(eventHead + eventCount) % KEYMAP_EVENT_QUEUE];
+    e.keycode = keycode;
+    e.down = down;
+    e.macro = macro;
+    eventCount++;
+}
+
+bool KeyLayers::pollEvent(KeyEvent& event) {
+    portENTER_CRITICAL(&lock);
+    bool ok = eventCount > 0;
+    if (ok) {
+        event = events[eventHead];
+        eventHead = (eventHead + 1) % KEYMAP_EVENT_QUEUE;
+        eventCount--;
+    }
+    portEXIT_CRITICAL(&lock);
+    return ok;
+}
+
+// 判定中のタップ/ホールドをホールドに決める
+void KeyLayers::decideHoldLocked() {
+    if (!tapPending) return;
+    tapPending = false;
+    KeyAction action = pressedAction[tapKey];
+    if (KEY_ACTION_KIND(action) == KA_LAYER_TAP) {
+        layerHeld[KEY_ACTION_ARG(action) % KEYMAP_LAYERS]++;
+    } else {
+        emit(0xE0 + (KEY_ACTION_ARG(action) & 0x07), true);
+    }
+    holds++;
+}
+
+void KeyLayers::press(uint8_t keycode, uint32_t nowMs) {
+    portENTER_CRITICAL(&lock);
+    pressLocked(keycode, nowMs);
+    bool arm = tapPending && tapKey == keycode;
+    portEXIT_CRITICAL(&lock);
+    if (arm) armTimer(KEYMAP_TAPPING_TERM_MS);
+}
+
+void KeyLayers::pressLocked(uint8_t keycode, uint32_t nowMs) {
+    if (pressed[keycode >> 3] & (1 << (keycode & 7))) return;
+    // 判定中に他のキーが押されたらホールド（レイヤーを有効にしてからこのキーを引く）
+    decideHoldLocked();
+
+    KeyAction action = table[activeLayerLocked()][keycode];
+    pressed[keycode >> 3] |= 1 << (keycode & 7);
+    pressedAction[keycode] = action;
+
+    switch (KEY_ACTION_KIND(action)) {
+        case KA_KEY:
+            emit(KEY_ACTION_KEYCODE(action), true);
+            break;
+        case KA_LAYER_HOLD:
+            layerHeld[KEY_ACTION_ARG(action) % KEYMAP_LAYERS]++;
+            break;
+        case KA_LAYER_TOGGLE:
+            layerToggled ^= 1 << (KEY_ACTION_ARG(action) % KEYMAP_LAYERS);
+            break;
+        case KA_LAYER_TAP:
+        case KA_MOD_TAP:
+            tapPending = true;
+            tapKey = keycode;
+            tapDeadline = nowMs + KEYMAP_TAPPING_TERM_MS;
+            break;
+        case KA_MACRO:
+            emit(KEY_ACTION_KEYCODE(action), true, true);
+            break;
+        default:
+            break;
+    }
+}
+
+void KeyLayers::release(uint8_t keycode, uint32_t nowMs) {
+    bool cancel = false;
+    portENTER_CRITICAL(&lock);
+    if (pressed[keycode >> 3] & (1 << (keycode & 7))) {
+        pressed[keycode >> 3] &= ~(1 << (keycode & 7));
+        KeyAction action = pressedAction[keycode];
+        switch (KEY_ACTION_KIND(action)) {
+            case KA_KEY:
+                emit(KEY_ACTION_KEYCODE(action), false);
+                break;
+            case KA_LAYER_HOLD:
+                if (layerHeld[KEY_ACTION_ARG(action) % KEYMAP_LAYERS] > 0) layerHeld[KEY_ACTION_ARG(action) % KEYMAP_LAYERS]--;
+                break;
+            case KA_LAYER_TAP:
+            case KA_MOD_TAP:
+                if (tapPending && tapKey == keycode) {
+                    // 期限内に離した: タップ
+                    tapPending = false;
+                    cancel = true;
+                    emit(KEY_ACTION_KEYCODE(action), true);
+                    emit(KEY_ACTION_KEYCODE(action), false);
+                    taps++;
+                } else if (KEY_ACTION_KIND(action) == KA_LAYER_TAP) {
+                    if (layerHeld[KEY_ACTION_ARG(action) % KEYMAP_LAYERS] > 0) layerHeld[KEY_ACTION_ARG(action) % KEYMAP_LAYERS]--;
+                } else {
+                    emit(0xE0 + (KEY_ACTION_ARG(action) & 0x07), false);
+                }
+                break;
+            case KA_MACRO:
+                emit(KEY_ACTION_KEYCODE(action), false, true);
+                break;
+            default:
+                break;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    if (cancel && timer) esp_timer_stop(timer);
+}
+
+void KeyLayers::timeout(uint32_t nowMs) {
+    uint32_t remaining = 0;
+    portENTER_CRITICAL(&lock);
+    if (tapPending) {
+        int32_t left = (int32_t)(tapDeadline - nowMs);
+        if (left <= 0) {
+            decideHoldLocked();
+        } else {
+            remaining = left;   // msの丸めで早く来た時は残りを待つ
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    if (remaining > 0) armTimer(remaining);
+}
+
+bool KeyLayers::getDeadline(uint32_t& deadlineMs) const {
+    portENTER_CRITICAL(&lock);
+    bool pending = tapPending;
+    deadlineMs = tapDeadline;
+    portEXIT_CRITICAL(&lock);
+    return pending;
+}
+
+void KeyLayers::armTimer(uint32_t delayMs) {
+    if (!timer) return;
+    esp_timer_stop(timer);
+    esp_timer_start_once(timer, (uint64_t)delayMs * 1000);
+}
+
+void KeyLayers::onTimer(void* arg) {
+    static_cast<KeyLayers*>(arg)->timeout(millis());
+}
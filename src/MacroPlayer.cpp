@@ -0,0 +1,194 @@
+#include "MacroPlayer.h"
+
+// グローバルインスタンスの定義
+MacroPlayer macroPlayer;
+
+// マクロの定義
+// 0: 保存（Ctrl+S）
+static const uint8_t MACRO_SAVE[] = {
+    M_MODS(0x01), M_TAP('s'), M_MODS(0x00),
+    MACRO_END
+};
+// 1: スクリーンショットを1秒おきに3回（押している間だけ。離すと止まる）
+static const uint8_t MACRO_SCREENSHOTS[] = {
+    M_TAP(KEY_PRTSC), M_WAIT_MS(1000),
+    M_TAP(KEY_PRTSC), M_WAIT_MS(1000),
+    M_TAP(KEY_PRTSC),
+    MACRO_END
+};
+
+const MacroDef MACROS[] = {
+    {"SAVE", MACRO_SAVE, 0},
+    {"SCREENSHOTS", MACRO_SCREENSHOTS, MACRO_FLAG_HOLD},
+};
+const int MACRO_COUNT = sizeof(MACROS) / sizeof(MacroDef);
+
+bool MacroPlayer::begin(BleKeyboard* kbd, BaseType_t core) {
+    keyboard = kbd;
+    // 待ち時間はタイマーで起こしてもらうので、タイマーが無ければタスクも作らない（play()はfalseを返す）
+    const esp_timer_create_args_t args = {
+        .callback = &MacroPlayer::onTimer,
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "macro",
+        .skip_unhandled_events = false,
+    };
+    esp_err_t err = esp_timer_create(&args, &timer);
+    if (err != ESP_OK) {
+        timer = nullptr;
+        ESP_LOGI("MacroPlayer", "macro timer create failed err=%x, macros disabled", err);
+        return false;
+    }
+    BaseType_t ok = xTaskCreatePinnedToCore(macroTask, "macroTask", 3072, this, 1, &task, core);
+    if (ok != pdPASS) {
+        task = nullptr;
+        esp_timer_delete(timer);
+        timer = nullptr;
+        ESP_LOGI("MacroPlayer", "macro task create failed, macros disabled");
+        return false;
+    }
+    return true;
+}
+
+bool MacroPlayer::play(uint8_t index) {
+    if (task == nullptr || index >= MACRO_COUNT) return false;
+    portENTER_CRITICAL(&lock);
+    requested = index;
+    abortRequested = playing >= 0;   // 再生中のマクロは止めてから次へ
+    portEXIT_CRITICAL(&lock);
+    xTaskNotifyGive(task);
+    return true;
+}
+
+void MacroPlayer::triggerReleased(uint8_t index) {
+    if (index < MACRO_COUNT && (MACROS[index].flags & MACRO_FLAG_HOLD) && playing == index) stop();
+}
+
+void MacroPlayer::stop() {
+    if (task == nullptr) return;
+    portENTER_CRITICAL(&lock);
+    requested = -1;
+    bool wake = playing >= 0;
+    if (wake) abortRequested = true;
+    portEXIT_CRITICAL(&lock);
+    // 待っている途中でも起こして止めさせる
+    if (wake) xTaskNotifyGive(task);
+}
+
+void MacroPlayer::onTimer(void* arg) {
+    MacroPlayer* self = static_cast<MacroPlayer*>(arg);
+    xTaskNotifyGive(self->task);
+}
+
+void MacroPlayer::macroTask(void* pvParameters) {
+    static_cast<MacroPlayer*>(pvParameters)->run();
+}
+
+void MacroPlayer::run() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        for (;;) {
+            portENTER_CRITICAL(&lock);
+            int16_t index = requested;
+            requested = -1;
+            abortRequested = false;
+            playing = index;
+            portEXIT_CRITICAL(&lock);
+            if (index < 0) break;
+
+            played++;
+            bool done = runMacro(MACROS[index].code);
+            releaseHeld();
+            if (done) completed++;
+            else interrupted++;
+            ESP_LOGI("MacroPlayer", "macro %s %s", MACROS[index].name, done ? "done" : "interrupted");
+            playing = -1;
+        }
+    }
+}
+
+bool MacroPlayer::runMacro(const uint8_t* pc) {
+    for (;;) {
+        if (abortRequested || !keyboard || !keyboard->isConnected()) return false;
+        uint8_t op = *pc++;
+        switch (op) {
+            case MACRO_END:
+                return true;
+            case MACRO_PRESS:
+                if (!pressKey(*pc++)) return false;
+                break;
+            case MACRO_RELEASE:
+                if (!releaseKey(*pc++)) return false;
+                break;
+            case MACRO_TAP:
+                if (!pressKey(*pc) || !releaseKey(*pc)) return false;
+                pc++;
+                break;
+            case MACRO_WAIT_US: {
+                uint32_t us = pc[0] | ((uint32_t)pc[1] << 8) | ((uint32_t)pc[2] << 16);
+                pc += 3;
+                if (!waitUs(us)) return false;
+                break;
+            }
+            case MACRO_MODS:
+                if (!setMods(*pc++)) return false;
+                break;
+            default:
+                ESP_LOGI("MacroPlayer", "bad macro opcode 0x%02X", op);
+                return false;
+        }
+    }
+}
+
+// レポートを1つ送ったら、次のレポートまで接続間隔ぶん空ける
+bool MacroPlayer::pressKey(uint8_t key) {
+    keyboard->press(key);
+    if (heldCount < sizeof(held)) held[heldCount++] = key;
+    return waitUs(MACRO_REPORT_GAP_US);
+}
+
+bool MacroPlayer::releaseKey(uint8_t key) {
+    keyboard->release(key);
+    for (int i = 0; i < heldCount; i++) {
+        if (held[i] == key) {
+            held[i] = held[--heldCount];
+            break;
+        }
+    }
+    return waitUs(MACRO_REPORT_GAP_US);
+}
+
+bool MacroPlayer::setMods(uint8_t mods) {
+    uint8_t diff = mods ^ heldMods;
+    for (int bit = 0; bit < 8; bit++) {
+        if (!(diff & (1 << bit))) continue;
+        if (mods & (1 << bit)) keyboard->press(KEY_LEFT_CTRL + bit);
+        else keyboard->release(KEY_LEFT_CTRL + bit);
+        heldMods ^= 1 << bit;
+        if (!waitUs(MACRO_REPORT_GAP_US)) return false;
+    }
+    return true;
+}
+
+void MacroPlayer::releaseHeld() {
+    if (!keyboard) return;
+    for (int i = 0; i < heldCount; i++) keyboard->release(held[i]);
+    heldCount = 0;
+    for (int bit = 0; bit < 8; bit++) {
+        if (heldMods & (1 << bit)) keyboard->release(KEY_LEFT_CTRL + bit);
+    }
+    heldMods = 0;
+}
+
+bool MacroPlayer::waitUs(uint32_t us) {
+    int64_t deadline = esp_timer_get_time() + us;
+    while (!abortRequested) {
+        int64_t left = deadline - esp_timer_get_time();
+        if (left <= 0) return true;
+        // タイマーかstop()に起こされるまで止まる（取り残した通知で早く起きた時は残りを待ち直す）
+        esp_timer_start_once(timer, left);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        esp_timer_stop(timer);
+    }
+    return false;
+}
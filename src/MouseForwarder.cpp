@@ -0,0 +1,139 @@
+#include "MouseForwarder.h"
+
+// グローバルインスタンスの定義
+MouseForwarder mouseForwarder;
+
+bool MouseForwarder::begin(BleKeyboard* kbd, BaseType_t core) {
+    keyboard = kbd;
+    BaseType_t ok = xTaskCreatePinnedToCore(mouseTask, "mouseTask", 3072, this, 1, &task, core);
+    if (ok != pdPASS) {
+        task = nullptr;
+        ESP_LOGI("MouseForwarder", "mouse task create failed, mouse disabled");
+        return false;
+    }
+    return true;
+}
+
+void MouseForwarder::add(uint8_t buttons, int8_t x, int8_t y, int8_t wheel, int8_t pan) {
+    if (task == nullptr) return;
+    received++;
+
+    bool wake = false;
+    portENTER_CRITICAL(&lock);
+    if (buttons != open.buttons) {
+        // 移動中にボタンが変わったら、そこまでを前のボタン状態の区切りとして閉じる
+        if (open.hasMotion() || open.buttons != sentButtons || closedCount > 0) {
+            if (closedCount < MOUSE_SEGMENT_QUEUE_SIZE) {
+                closed[closedCount++] = open;
+            } else {
+                // あふれたら最後の区切りに移動量だけ足す（ボタン状態の途中経過は失う）
+                Segment& last = closed[closedCount - 1];
+                last.x += open.x; last.y += open.y; last.wheel += open.wheel; last.pan += open.pan;
+                dropped++;
+            }
+        }
+        open = Segment();
+        open.buttons = buttons;
+    }
+    open.x += x;
+    open.y += y;
+    open.wheel += wheel;
+    open.pan += pan;
+
+    bool has = closedCount > 0 || open.hasMotion() || open.buttons != sentButtons;
+    wake = has && !pending;
+    pending = has;
+    portEXIT_CRITICAL(&lock);
+
+    // 送信待ちが空だった時だけ起こす（送信中なら次の間隔でまとめて送られる）
+    if (wake) xTaskNotifyGive(task);
+}
+
+void MouseForwarder::reset() {
+    add(0, 0, 0, 0, 0);
+}
+
+void MouseForwarder::mouseTask(void* pvParameters) {
+    static_cast<MouseForwarder*>(pvParameters)->run();
+}
+
+void MouseForwarder::run() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        // 最初の1回はすぐ送り、以降は接続間隔ごとに溜まった分を送る
+        while (flush()) {
+            vTaskDelay(pdMS_TO_TICKS(MOUSE_FLUSH_INTERVAL_MS));
+        }
+    }
+}
+
+bool MouseForwarder::flush() {
+    Segment segs[MOUSE_SEGMENT_QUEUE_SIZE + 1];
+    int count = 0;
+    bool connected = keyboard && keyboard->isConnected();
+
+    // 区切り済みの分と、いま積んでいる分を取り出す
+    portENTER_CRITICAL(&lock);
+    for (int i = 0; i < closedCount; i++) segs[count++] = closed[i];
+    closedCount = 0;
+    if (open.hasMotion() || open.buttons != sentButtons) segs[count++] = open;
+    open.x = open.y = open.wheel = open.pan = 0;
+    pending = false;
+    portEXIT_CRITICAL(&lock);
+
+    if (count == 0) return false;
+    if (!connected) {
+        // つながっていない間の移動は後から送らない
+        dropped += count;
+        return false;
+    }
+
+    int reports = 0;
+    for (int i = 0; i < count; i++) {
+        // ボタン変化の区切りは上限に関係なく送り切る。最後（いま積んでいる分）だけ上限で打ち切る
+        bool last = (i == count - 1);
+        int limit = last ? max(MOUSE_MAX_REPORTS_PER_FLUSH - reports, 1) : 0;
+        reports += sendSegment(segs[i], limit);
+        if (last && segs[i].hasMotion()) {
+            // 送り切れなかった移動量を戻す（次の間隔で送る）
+            portENTER_CRITICAL(&lock);
+            if (closedCount == 0 && open.buttons == segs[i].buttons) {
+                open.x += segs[i].x; open.y += segs[i].y; open.wheel += segs[i].wheel; open.pan += segs[i].pan;
+            } else if (closedCount < MOUSE_SEGMENT_QUEUE_SIZE) {
+                // その間にボタンが変わっていたら、先頭の区切りとして差し込む
+                memmove(&closed[1], &closed[0], sizeof(Segment) * closedCount);
+                closed[0] = segs[i];
+                closedCount++;
+            } else {
+                dropped++;
+            }
+            pending = true;
+            portEXIT_CRITICAL(&lock);
+        }
+    }
+    // 送れたボタン状態を覚える（つながっていなくて捨てた分は覚えないので、次の変化は必ず送る）
+    portENTER_CRITICAL(&lock);
+    sentButtons = segs[count - 1].buttons;
+    portEXIT_CRITICAL(&lock);
+    sent += reports;
+    return true;
+}
+
+int MouseForwarder::sendSegment(Segment& seg, int maxReports) {
+    int reports = 0;
+    do {
+        BLEMouseReport report;
+        report.buttons = seg.buttons;
+        report.x = (int8_t)constrain(seg.x, -127, 127);
+        report.y = (int8_t)constrain(seg.y, -127, 127);
+        report.wheel = (int8_t)constrain(seg.wheel, -127, 127);
+        report.pan = (int8_t)constrain(seg.pan, -127, 127);
+        seg.x -= report.x;
+        seg.y -= report.y;
+        seg.wheel -= report.wheel;
+        seg.pan -= report.pan;
+        keyboard->sendReport(&report);
+        reports++;
+    } while (seg.hasMotion() && (maxReports == 0 || reports < maxReports));
+    return reports;
+}
@@ -1,146 +1,315 @@
 #include "Peripherals.h"
+#include <driver/ledc.h>
 
 // グローバルインスタンスの定義
 LEDController ledController;
 SpeakerController speakerController;
 
-// LEDController実装
+// LEDエフェクト定義
+static const LedStep stepsOff[] = { {0, 0, 0} };
+static const LedStep stepsOn[] = { {LED_DUTY_MAX, 0, 0} };
+static const LedStep stepsBlink[] = { {LED_DUTY_MAX, 0, BLE_BLINK_INTERVAL}, {0, 0, BLE_BLINK_INTERVAL} };
+static const LedStep stepsBreathe[] = { {LED_DUTY_MAX, 1000, 200}, {0, 1000, 300} };
+static const LedStep stepsFlash[] = { {LED_DUTY_MAX, 0, 60}, {0, 40, 0} };
+static const LedStep stepsOverflow[] = {
+    {LED_DUTY_MAX, 0, 80}, {0, 0, 80},
+    {LED_DUTY_MAX, 0, 80}, {0, 0, 80},
+    {LED_DUTY_MAX, 0, 80}, {0, 0, 680},
+};
+static const LedStep stepsLatency[] = {
+    {LED_DUTY_MAX, 0, 250}, {0, 0, 250},
+    {LED_DUTY_MAX, 0, 250}, {0, 0, 1000},
+};
 
-void LEDController::begin() {
-    // 内蔵LEDのピン設定
-    pinMode(INTERNAL_LED_PIN, OUTPUT);
-    digitalWrite(INTERNAL_LED_PIN, LOW);
-    
-    // 外部ステータスLEDのピン設定
-    pinMode(STATUS_LED_PIN, OUTPUT);
-    digitalWrite(STATUS_LED_PIN, HIGH); // 電源投入時に点灯
-    
-    // 初期状態設定
-    bleConnected = false;
-    blinkState = false;
-    lastBlinkTime = 0;
-    lastKeyPressTime = 0;
+#define LED_STEPS(a) a, (uint8_t)(sizeof(a) / sizeof(LedStep))
+const LedEffect LED_EFFECT_OFF = { LED_STEPS(stepsOff), false };
+const LedEffect LED_EFFECT_ON = { LED_STEPS(stepsOn), false };
+const LedEffect LED_EFFECT_BLINK = { LED_STEPS(stepsBlink), true };
+const LedEffect LED_EFFECT_BREATHE = { LED_STEPS(stepsBreathe), true };
+const LedEffect LED_EFFECT_FLASH = { LED_STEPS(stepsFlash), false };
+const LedEffect LED_EFFECT_ERROR_OVERFLOW = { LED_STEPS(stepsOverflow), true };
+const LedEffect LED_EFFECT_ERROR_LATENCY = { LED_STEPS(stepsLatency), true };
+
+// LedChannel実装
+
+bool LedChannel::begin(uint8_t pin, uint8_t ledcChannel, const char* name) {
+    channel = ledcChannel;
+    ledcSetup(channel, LED_LEDC_FREQ, LED_LEDC_BITS);
+    ledcAttachPin(pin, channel);
+    ledcWrite(channel, 0);
+
+    const esp_timer_create_args_t args = {
+        .callback = &LedChannel::onTimer,
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = name,
+        .skip_unhandled_events = false,
+    };
+    esp_err_t err = esp_timer_create(&args, &timer);
+    if (err != ESP_OK) {
+        timer = nullptr;
+        ESP_LOGI("LEDController", "%s timer create failed err=%x, effects disabled", name, err);
+        return false;
+    }
+    return true;
 }
 
-void LEDController::keyPressed() {
-    // シリアルにデバッグ出力を追加
-    Serial.println("LED: Key pressed!");
-    
-    // LEDを確実にONにする
-    pinMode(INTERNAL_LED_PIN, OUTPUT); // 念のためピンモードを再設定
-    digitalWrite(INTERNAL_LED_PIN, HIGH);
-    lastKeyPressTime = millis();
-}
-
-void LEDController::updateKeyLED() {
-    // キーLEDの自動消灯
-    if (lastKeyPressTime > 0 && millis() - lastKeyPressTime > keyLedDuration) {
-        digitalWrite(INTERNAL_LED_PIN, LOW);
-        lastKeyPressTime = 0;
+void LedChannel::setBase(const LedEffect* effect, bool immediate) {
+    bool restart = false;
+    portENTER_CRITICAL(&lock);
+    if (immediate || !running) {
+        base = effect;
+        nextBase = nullptr;
+        if (!overlay) {
+            step = 0;
+            restart = true;
+        }
+    } else {
+        nextBase = effect;
     }
+    portEXIT_CRITICAL(&lock);
+    if (restart) kick();
 }
 
-void LEDController::setStatusLED(bool on) {
-    digitalWrite(STATUS_LED_PIN, on ? HIGH : LOW);
+void LedChannel::play(const LedEffect* effect) {
+    // タイマーが無ければ1回だけのエフェクトは出さない（戻せないので）
+    if (!timer) return;
+    portENTER_CRITICAL(&lock);
+    overlay = effect;
+    step = 0;
+    portEXIT_CRITICAL(&lock);
+    kick();
 }
 
-void LEDController::updateStatusLED() {
-    unsigned long currentMillis = millis();
+// 再生位置を変えたのでタイマーを掛け直す（LEDCはタイマー側で書く）
+void LedChannel::kick() {
+    if (!timer) {
+        // タイマーが無ければ動かさず、基本エフェクトの最初の明るさのまま点けておく
+        ledcWrite(channel, base->count > 0 ? base->steps[0].duty : 0);
+        return;
+    }
+    portENTER_CRITICAL(&lock);
+    running = true;
+    portEXIT_CRITICAL(&lock);
+    esp_timer_stop(timer);
+    esp_timer_start_once(timer, 1);
+}
 
-    if (bleConnected) {
-        // BLE接続中は常時点灯
-        setStatusLED(true);
-    } else {
-        // BLE未接続時は点滅
-        if (currentMillis - lastBlinkTime > BLE_BLINK_INTERVAL) {
-            lastBlinkTime = currentMillis;
-            blinkState = !blinkState;
-            setStatusLED(blinkState);
+void LedChannel::onTimer(void* arg) {
+    ((LedChannel*)arg)->advance();
+}
+
+void LedChannel::advance() {
+    LedStep s;
+    bool idle = false;
+    portENTER_CRITICAL(&lock);
+    const LedEffect* effect = overlay ? overlay : base;
+    if (step >= effect->count) {
+        // 1周終わり：重ねたエフェクトは基本へ戻り、保留中の切り替えはここで反映する
+        if (overlay) {
+            overlay = nullptr;
+        } else if (nextBase) {
+            base = nextBase;
+            nextBase = nullptr;
         }
+        effect = base;
+        step = 0;
     }
+    s = effect->steps[step++];
+    // 繰り返さない基本エフェクトは最後のステップを書いたら止まる
+    if (step >= effect->count && effect == base && !overlay && !effect->loop && !nextBase) {
+        running = false;
+        idle = true;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    // フェード時間0なら即座にそのデューティになる
+    ledc_set_fade_time_and_start(LEDC_LOW_SPEED_MODE, (ledc_channel_t)channel, s.duty, s.fadeMs, LEDC_FADE_NO_WAIT);
+    if (idle) return;
+
+    uint32_t waitMs = (uint32_t)s.fadeMs + s.holdMs;
+    esp_timer_start_once(timer, waitMs > 0 ? (uint64_t)waitMs * 1000 : 1);
+}
+
+// LEDController実装
+
+bool LEDController::begin() {
+    // ハードウェアフェードを使う（割り込みはフェード完了の通知だけ）
+    ledc_fade_func_install(0);
+
+    bool ok = keyLed.begin(INTERNAL_LED_PIN, KEY_LED_LEDC_CHANNEL, "keyLed");
+    ok &= statusLed.begin(STATUS_LED_PIN, STATUS_LED_LEDC_CHANNEL, "statusLed");
+
+    // 初期状態設定
+    bleConnected = false;
+    bleStopped = false;
+    alarms = 0;
+    keyLed.setBase(&LED_EFFECT_OFF);
+    statusLed.setBase(&LED_EFFECT_ON);  // 電源投入時に点灯
+    return ok;
+}
+
+void LEDController::keyPressed() {
+    keyLed.play(&LED_EFFECT_FLASH);
 }
 
 void LEDController::setBleConnected(bool connected) {
-    if (bleConnected != connected) {
-        bleConnected = connected;
-        
-        // 接続状態が変わった場合、即時LEDを更新
-        if (bleConnected) {
-            setStatusLED(true);  // 接続時は点灯
-        } else {
-            // 切断時は点滅状態にセット
-            blinkState = true;
-            setStatusLED(true);
-            lastBlinkTime = millis();
-        }
+    if (bleConnected == connected) return;
+    bleConnected = connected;
+    // 接続状態が変わった場合、即時LEDを更新
+    updateStatusEffect(true);
+}
+
+void LEDController::setBleStopped(bool stopped) {
+    if (bleStopped == stopped) return;
+    bleStopped = stopped;
+    updateStatusEffect(true);
+}
+
+void LEDController::setAlarm(LedAlarm alarm, bool active) {
+    // 変化が無ければ何もしない（送信ごとに呼ばれる）
+    if (((alarms & alarm) != 0) == active) return;
+    portENTER_CRITICAL(&lock);
+    alarms = active ? (alarms | alarm) : (alarms & ~alarm);
+    portEXIT_CRITICAL(&lock);
+    // 発生はすぐに見せ、解除は今のパターンを1周見せきってから戻す
+    updateStatusEffect(active);
+}
+
+void LEDController::updateStatusEffect(bool immediate) {
+    const LedEffect* effect;
+    uint8_t a = alarms;
+    if (a & LED_ALARM_QUEUE_OVERFLOW) {
+        effect = &LED_EFFECT_ERROR_OVERFLOW;
+    } else if (a & LED_ALARM_HIGH_LATENCY) {
+        effect = &LED_EFFECT_ERROR_LATENCY;
+    } else if (bleStopped) {
+        effect = &LED_EFFECT_BREATHE;
+    } else if (bleConnected) {
+        effect = &LED_EFFECT_ON;        // BLE接続中は常時点灯
+    } else {
+        effect = &LED_EFFECT_BLINK;     // BLE未接続時は点滅
     }
+    statusLed.setBase(effect, immediate);
 }
 
 // SpeakerController実装
 
-void SpeakerController::begin() {
+bool SpeakerController::begin() {
+    #if SOUND_ENABLED
+    // LEDCは一度だけ設定して繋いだままにする（デューティ0で無音）
+    ledcSetup(BUZZER_LEDC_CHANNEL, KEY_FREQ, BUZZER_LEDC_BITS);
+    ledcAttachPin(BUZZER_PIN, BUZZER_LEDC_CHANNEL);
+    ledcWrite(BUZZER_LEDC_CHANNEL, 0);
+
+    const esp_timer_create_args_t args = {
+        .callback = &SpeakerController::onTimer,
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "speaker",
+        .skip_unhandled_events = false,
+    };
+    esp_err_t err = esp_timer_create(&args, &timer);
+    if (err != ESP_OK) {
+        // タイマーが無ければ音は出さない（enqueue()が積まずに捨てる）
+        timer = nullptr;
+        ESP_LOGI("SpeakerController", "speaker timer create failed err=%x, sound disabled", err);
+        return false;
+    }
+    #else
     pinMode(BUZZER_PIN, OUTPUT);
-    noTone();
+    digitalWrite(BUZZER_PIN, LOW);
+    #endif
+    return true;
 }
 
-void SpeakerController::tone(unsigned int frequency, unsigned long duration) {
+bool SpeakerController::enqueue(const SpeakerNote* notes, int n, bool droppable) {
     #if SOUND_ENABLED
-    // 指定した周波数で音を鳴らす
-    ledcSetup(0, frequency, 8); // チャネル0、8ビット分解能
-    ledcAttachPin(BUZZER_PIN, 0);
-    ledcWrite(0, 128); // 50%デューティサイクル
-    
-    // 指定した時間が経過したら音を止める（非ブロッキング版）
-    delay(duration);
-    noTone();
+    if (!timer) return false;
+    bool kick = false;
+    bool accepted = true;
+    portENTER_CRITICAL(&lock);
+    if (droppable && busy) {
+        // キー音は鳴っている音を邪魔しない（連打中は間引かれる）
+        droppedClicks = droppedClicks + 1;
+        accepted = false;
+    } else if (count + n > SPEAKER_QUEUE_SIZE) {
+        droppedNotes = droppedNotes + n;
+        accepted = false;
+    } else {
+        for (int i = 0; i < n; i++) {
+            queue[(head + count) % SPEAKER_QUEUE_SIZE] = notes[i];
+            count++;
+        }
+        if (!busy) {
+            busy = true;
+            kick = true;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    // 停止中ならタイマーを起こす（発音はタイマー側でのみ行うので、ここでLEDCは触らない）
+    if (kick) esp_timer_start_once(timer, 1);
+    return accepted;
+    #else
+    return false;
     #endif
 }
 
-void SpeakerController::noTone() {
-    #if SOUND_ENABLED
-    ledcDetachPin(BUZZER_PIN);
-    digitalWrite(BUZZER_PIN, LOW);
-    #endif
+void SpeakerController::onTimer(void* arg) {
+    ((SpeakerController*)arg)->advance();
+}
+
+void SpeakerController::advance() {
+    SpeakerNote note;
+    bool have = false;
+    portENTER_CRITICAL(&lock);
+    if (count > 0) {
+        note = queue[head];
+        head = (head + 1) % SPEAKER_QUEUE_SIZE;
+        count--;
+        have = true;
+    } else {
+        busy = false;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if (!have) {
+        ledcWrite(BUZZER_LEDC_CHANNEL, 0);
+        return;
+    }
+    if (note.frequency > 0) {
+        ledcChangeFrequency(BUZZER_LEDC_CHANNEL, note.frequency, BUZZER_LEDC_BITS);
+        ledcWrite(BUZZER_LEDC_CHANNEL, 1 << (BUZZER_LEDC_BITS - 1)); // 50%デューティサイクル
+    } else {
+        ledcWrite(BUZZER_LEDC_CHANNEL, 0);
+    }
+    esp_timer_start_once(timer, (uint64_t)note.durationMs * 1000);
 }
 
 void SpeakerController::playKeySound() {
-    #if SOUND_ENABLED
-    // デバッグ出力を追加
-    Serial.println("SPEAKER: Playing key sound");
-    
-    // 確実に音を鳴らすために念のためpinModeを再設定
-    pinMode(BUZZER_PIN, OUTPUT);
-    tone(KEY_FREQ, KEY_DURATION);
-    #endif
+    static const SpeakerNote click[] = { {KEY_FREQ, KEY_DURATION} };
+    enqueue(click, 1, true);
 }
 
 void SpeakerController::playStartupMelody() {
-    #if SOUND_ENABLED
     // 起動音（短めのメロディ）
-    tone(NOTE_C5, 100);
-    delay(20);
-    tone(NOTE_E5, 100);
-    delay(20);
-    tone(NOTE_G5, 100);
-    delay(20);
-    tone(NOTE_C6, 200);
-    #endif
+    static const SpeakerNote melody[] = {
+        {NOTE_C5, 100}, {0, 20},
+        {NOTE_E5, 100}, {0, 20},
+        {NOTE_G5, 100}, {0, 20},
+        {NOTE_C6, 200},
+    };
+    enqueue(melody, sizeof(melody) / sizeof(SpeakerNote), false);
 }
 
 void SpeakerController::playConnectedSound() {
-    #if SOUND_ENABLED
     // 接続音（上昇音）
-    tone(NOTE_C5, 80);
-    delay(50);
-    tone(NOTE_G5, 150);
-    #endif
+    static const SpeakerNote notes[] = { {NOTE_C5, 80}, {0, 50}, {NOTE_G5, 150} };
+    enqueue(notes, sizeof(notes) / sizeof(SpeakerNote), false);
 }
 
 void SpeakerController::playDisconnectedSound() {
-    #if SOUND_ENABLED
     // 切断音（下降音）
-    tone(NOTE_G5, 80);
-    delay(50);
-    tone(NOTE_C5, 150);
-    #endif
+    static const SpeakerNote notes[] = { {NOTE_G5, 80}, {0, 50}, {NOTE_C5, 150} };
+    enqueue(notes, sizeof(notes) / sizeof(SpeakerNote), false);
 }
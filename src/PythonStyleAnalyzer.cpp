@@ -1,5 +1,13 @@
 #include "PythonStyleAnalyzer.h"
 #include "SpecialKeyHandler.h"
+#include "Animation.h"
+#include "FrameCache.h"
+#include "DisplayFlush.h"
+#include "SystemStatus.h"
+#include "FeedbackBus.h"
+#include "ConsumerForwarder.h"
+#include "MouseForwarder.h"
+#include "GamepadForwarder.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
 
@@ -87,7 +95,6 @@ const int KEYCODE_MAP_SIZE = sizeof(KEYCODE_MAP) / sizeof(KeycodeMapping);
 
 PythonStyleAnalyzer::PythonStyleAnalyzer(U8G2* disp, BleKeyboard* bleKbd) 
     : display(disp), bleKeyboard(bleKbd) {
-    memset(&report_format, 0, sizeof(report_format));
 }
 
 // アイドル状態のディスプレイ更新（publicメソッド）
@@ -106,11 +113,10 @@ void PythonStyleAnalyzer::updateDisplayIdle() {
             DisplayRequest req;
             req.display = display;
             req.type = DISPLAY_ANIMATION;
-            req.text1 = "READY";
+            req.setText1("READY");
             req.font = u8g2_font_fub14_tr;
-            req.frames = 5;         // 1文字ずつホップ
-            req.frameDelay = 120;   // ms
-            req.jumpHeight = 8;     // ピクセル
+            req.clip = &CLIP_READY_HOP; // 1文字ずつホップ（120ms/文字）
+            req.jumpHeight = 8;         // ピクセル
             requestDisplay(req);
         } else {
             // WAITは通常の中央表示
@@ -118,73 +124,43 @@ void PythonStyleAnalyzer::updateDisplayIdle() {
             req.display = display;
             req.type = DISPLAY_TEXT;
             req.font = u8g2_font_fub14_tr;
-            req.text1 = "WAIT";
-            req.text2 = "";
+            req.setText1("WAIT");
             requestDisplay(req);
         }
     }
 }
 
 // ディスプレイ更新用のヘルパー関数
+// USBコールバックから直接描画せず、表示タスクへ要求だけを渡す
 void PythonStyleAnalyzer::updateDisplayForDevice(const String& deviceType) {
     if (!display) return;
-    
-    display->clearBuffer();
-    
-    // 中央に大きく接続表示（左右中央に配置）
-    String displayText = "CONNECT";
-    display->setFont(u8g2_font_fub14_tr);
-    int totalWidth = display->getStrWidth(displayText.c_str());
-    int xPos = (SCREEN_WIDTH - totalWidth) / 2;
-    int yPos = SCREEN_HEIGHT / 2; // 画面の縦中央
-    display->drawStr(xPos, yPos, displayText.c_str());
-    
-    // 下部に状態情報
-    display->setFont(u8g2_font_6x10_tr);
-    display->drawStr(0, 48, "USB: ");
-    display->println(deviceType);
-    
-    display->drawStr(0, 55, "BLE:");
-    if (bleKeyboard && bleKeyboard->isConnected()) {
-        display->print("OK");
-    } else {
-        display->print("--");
-    }
-    
-    display->setCursor(70, 55);
-    display->print("SHIFT:--");
-    
-    display->setCursor(0, 62);
-    display->print("Initializing...");
-    
-    display->sendBuffer();
-}
 
-// キー押下時のディスプレイ更新
-void PythonStyleAnalyzer::updateDisplayWithKeys(const String& hexData, const String& keyNames, const String& characters, bool shiftPressed) {
-    if (!display) return;
+    DisplayRequest req;
+    req.type = DISPLAY_DEVICE;
+    req.display = display;
+    req.setText1(deviceType.c_str());   // BLEの状態はステータスバーが表示する
+    requestDisplay(req);
+}
 
-    lastHexData = hexData;
-    lastKeyPresses = keyNames;
-    String prevCharacters = lastCharacters;
-    if (characters != "None") {
-        lastCharacters = characters;
-    }
+// キーの変化をフィードバックイベントとして積む
+// 表示要求の組み立て・LED・ブザーはfeedbackBusのタスクが行うので、ここではコピーして積むだけ
+void PythonStyleAnalyzer::publishKeyFeedback(const String& keyNames, const String& characters, bool shiftPressed, uint8_t keycode, bool newPress) {
     lastKeyEventTime = millis();
 
-    // 特別表示はhandleSpecialKeyDisplayでキューに入る
-    if (handleSpecialKeyDisplay(display, characters, prevCharacters)) {
-        return;
-    }
+    FeedbackEvent event;
+    event.flags = FEEDBACK_KEYS_CHANGED | (newPress ? FEEDBACK_KEY_PRESS : 0);
+    event.keycode = keycode;
+    event.shift = shiftPressed;
+    event.setCharacters(characters.c_str());
+    event.setKeyNames(keyNames.c_str());
+    feedbackBus.publish(event);
+}
 
-    // 通常表示要求をキューに入れる（2行表示対応）
-    DisplayRequest req;
-    req.type = DISPLAY_NORMAL;
-    req.display = display;
-    req.text1 = characters.length() > 0 ? characters : "---"; // メイン
-    req.text2 = keyNames.length() > 0 ? keyNames : "";        // サブ（バイトキー名）
-    req.font = u8g2_font_fub25_tr;
-    requestDisplay(req);
+// 長押しリピートはキー音だけ（画面は押下時のまま）
+void PythonStyleAnalyzer::publishRepeatFeedback() {
+    FeedbackEvent event;
+    event.flags = FEEDBACK_KEY_REPEAT;
+    feedbackBus.publish(event);
 }
 
 // Pythonのkeycode_to_string関数を完全移植
@@ -192,6 +168,10 @@ String PythonStyleAnalyzer::keycodeToString(uint8_t keycode, bool shift) {
     #if SERIAL_OUTPUT_ENABLED && DEBUG_ENABLED
     Serial.printf("    keycodeToString呼び出し: keycode=0x%02X, shift=%s\n", keycode, shift ? "true" : "false");
     #endif
+
+    // 設定ファイルのキー名が優先（無ければKEYCODE_MAP）
+    char configured[DISPLAY_TEXT_MAX];
+    if (configStore.getKeyName(keycode, shift, configured, sizeof(configured))) return String(configured);
     
     for (int i = 0; i < KEYCODE_MAP_SIZE; i++) {
         if (KEYCODE_MAP[i].keycode == keycode) {
@@ -213,27 +193,28 @@ String PythonStyleAnalyzer::keycodeToString(uint8_t keycode, bool shift) {
 
 // Pythonの_analyze_report_format関数を完全移植
 ReportFormat PythonStyleAnalyzer::analyzeReportFormat(const uint8_t* report_data, int data_size) {
-    if (!report_format_initialized) {
+    // 同じデバイスでもブート（8バイト）とNKROのインターフェースで形式が違うので、長さが変わったら解析し直す
+    if (!current->report_format_initialized || current->report_format.size != data_size) {
         // 最初のレポートから形式を推測（Pythonと同じロジック）
-        report_format.size = data_size;
+        current->report_format.size = data_size;
         
         if (data_size == 8) {
             // 8バイトレポート：標準キーボード
-            report_format.modifier_index = 0;  // バイト0が修飾キー
-            report_format.reserved_index = 1;  // バイト1は予約
+            current->report_format.modifier_index = 0;  // バイト0が修飾キー
+            current->report_format.reserved_index = 1;  // バイト1は予約
         } else {
             // 16バイト等：DOIO KB16など
-            report_format.modifier_index = 1;  // 修飾キーは1バイト目
-            report_format.reserved_index = 0;  // 0バイト目は予約または無視
+            current->report_format.modifier_index = 1;  // 修飾キーは1バイト目
+            current->report_format.reserved_index = 0;  // 0バイト目は予約または無視
         }
         
-        report_format.key_indices[0] = 2;  // 標準的な6KROレイアウト
-        report_format.key_indices[1] = 3;
-        report_format.key_indices[2] = 4;
-        report_format.key_indices[3] = 5;
-        report_format.key_indices[4] = 6;
-        report_format.key_indices[5] = 7;
-        report_format.format = "Standard";
+        current->report_format.key_indices[0] = 2;  // 標準的な6KROレイアウト
+        current->report_format.key_indices[1] = 3;
+        current->report_format.key_indices[2] = 4;
+        current->report_format.key_indices[3] = 5;
+        current->report_format.key_indices[4] = 6;
+        current->report_format.key_indices[5] = 7;
+        current->report_format.format = "Standard";
         
         // NKROの検出（Pythonと同じ）
         int non_zero_count = 0;
@@ -242,25 +223,242 @@ ReportFormat PythonStyleAnalyzer::analyzeReportFormat(const uint8_t* report_data
         }
         
         if (non_zero_count > 6 || data_size > 8) {
-            report_format.format = "NKRO";
+            current->report_format.format = "NKRO";
             // NKROでは通常、各ビットが1つのキーに対応
             for (int i = 0; i < 6; i++) {
-                report_format.key_indices[i] = i + 2;
+                current->report_format.key_indices[i] = i + 2;
             }
         }
         
-        report_format_initialized = true;
+        current->report_format_initialized = true;
         
         #if SERIAL_OUTPUT_ENABLED && DEBUG_ENABLED
         Serial.printf("レポート形式解析完了: サイズ=%d, 形式=%s\n", 
-                     report_format.size, report_format.format.c_str());
+                     current->report_format.size, current->report_format.format.c_str());
         Serial.printf("modifier_index=%d, 修飾キー処理: %s\n", 
-                     report_format.modifier_index, 
-                     (report_format.format == "Standard" || report_format.format == "NKRO") ? "有効" : "無効");
+                     current->report_format.modifier_index, 
+                     (current->report_format.format == "Standard" || current->report_format.format == "NKRO") ? "有効" : "無効");
         #endif
     }
     
-    return report_format;
+    return current->report_format;
+}
+
+// レポートのキーを1台分のキー状態（ビット列）にする。修飾キーは0xE0〜0xE7
+static void reportToKeys(const ReportFormat& format, const uint8_t* report_data, int data_size, uint8_t keys[KEY_BITMAP_BYTES]) {
+    memset(keys, 0, KEY_BITMAP_BYTES);
+    uint8_t modifier = report_data[format.modifier_index];
+    keys[0xE0 >> 3] = modifier;
+    if (format.format == "NKRO") {
+        for (int i = 2; i < data_size; i++) {
+            for (int bit = 0; bit < 8; bit++) {
+                if (!(report_data[i] & (1 << bit))) continue;
+                int keycode = (i - 2) * 8 + bit + 4;
+                if (keycode < 0xE0) keys[keycode >> 3] |= 1 << (keycode & 7);
+            }
+        }
+    } else {
+        for (int i = 2; i < data_size && i < 8; i++) {
+            uint8_t keycode = report_data[i];
+            if (keycode != 0) keys[keycode >> 3] |= 1 << (keycode & 7);
+        }
+    }
+}
+
+void PythonStyleAnalyzer::buildDebouncedReport(const uint8_t keys[KEY_BITMAP_BYTES], uint8_t* filtered) {
+    const ReportFormat& format = current->report_format;
+    const uint8_t* raw = current->raw_report;
+    int size = current->raw_length;
+    memcpy(filtered, raw, size);
+    filtered[format.modifier_index] = keys[0xE0 >> 3];
+
+    if (format.format == "NKRO") {
+        for (int i = 2; i < size; i++) {
+            uint8_t b = 0;
+            for (int bit = 0; bit < 8; bit++) {
+                int keycode = (i - 2) * 8 + bit + 4;
+                if (keycode < 0xE0 && (keys[keycode >> 3] & (1 << (keycode & 7)))) b |= 1 << bit;
+            }
+            filtered[i] = b;
+        }
+        return;
+    }
+
+    // 6KROは生レポートの並び順を残し、窓の間押したままにしているキーを空きに足す
+    uint8_t added[KEY_BITMAP_BYTES] = {0};
+    int n = 2;
+    for (int i = 2; i < size && i < 8; i++) {
+        uint8_t keycode = raw[i];
+        if (keycode != 0 && (keys[keycode >> 3] & (1 << (keycode & 7))) && !(added[keycode >> 3] & (1 << (keycode & 7)))) {
+            filtered[n++] = keycode;
+            added[keycode >> 3] |= 1 << (keycode & 7);
+        }
+    }
+    for (int keycode = 1; keycode < 0xE0 && n < 8 && n < size; keycode++) {
+        if ((keys[keycode >> 3] & (1 << (keycode & 7))) && !(added[keycode >> 3] & (1 << (keycode & 7)))) {
+            filtered[n++] = keycode;
+        }
+    }
+    while (n < size && n < 8) filtered[n++] = 0;
+}
+
+bool PythonStyleAnalyzer::debounceReport(const uint8_t* report_data, int data_size, uint8_t keys[KEY_BITMAP_BYTES]) {
+    ReportFormat format = analyzeReportFormat(report_data, data_size);
+    memcpy(current->raw_report, report_data, data_size);
+    current->raw_length = data_size;
+
+    reportToKeys(format, report_data, data_size, keys);
+    return current->debouncer.filter(keys, millis(), keys);
+}
+
+// 除去後のキー状態を処理する（KB16はキーマップを通し、それ以外はそのままレポートに戻す）
+void PythonStyleAnalyzer::processKeys(const uint8_t keys[KEY_BITMAP_BYTES]) {
+#if KEYMAP_ENABLED
+    if (current->is_doio_kb16) {
+        // 物理キーの変化をキーマップへ入れ、出てきたキーの変化を1件ずつ処理する
+        uint32_t now = millis();
+        for (int byte = 0; byte < KEY_BITMAP_BYTES; byte++) {
+            uint8_t diff = keys[byte] ^ current->physical_keys[byte];
+            for (int bit = 0; diff != 0 && bit < 8; bit++) {
+                if (!(diff & (1 << bit))) continue;
+                uint8_t keycode = byte * 8 + bit;
+                if (keys[byte] & (1 << bit)) keyLayers.press(keycode, now);
+                else keyLayers.release(keycode, now);
+            }
+        }
+        memcpy(current->physical_keys, keys, KEY_BITMAP_BYTES);
+        keymapSlot = current - analyzerDevices;
+        drainKeymap();
+        return;
+    }
+#endif
+    uint8_t filtered[32];
+    buildDebouncedReport(keys, filtered);
+    prettyPrintReport(filtered, current->raw_length);
+}
+
+// キーマップが出したキーの変化を、1件ごとにレポートにして処理する（タップは押下・リリースの2回）
+void PythonStyleAnalyzer::drainKeymap() {
+    KeyEvent event;
+    while (keyLayers.pollEvent(event)) {
+        if (event.macro) {
+            // マクロは再生タスクに任せて、このキーのレポートは作らない
+            if (!event.down) macroPlayer.triggerReleased(event.keycode);
+            else if (event.keycode == MACRO_STOP_INDEX) macroPlayer.stop();
+            else macroPlayer.play(event.keycode);
+            continue;
+        }
+        uint8_t* keys = current->keymap_keys;
+        if (event.down) keys[event.keycode >> 3] |= 1 << (event.keycode & 7);
+        else keys[event.keycode >> 3] &= ~(1 << (event.keycode & 7));
+        if (current->raw_length == 0) continue;
+
+        uint8_t filtered[32];
+        buildDebouncedReport(keys, filtered);
+        prettyPrintReport(filtered, current->raw_length);
+    }
+}
+
+// タイマーで決まったホールド（修飾キーの押下）をUSBタスクで処理する
+void PythonStyleAnalyzer::handleKeymap() {
+#if KEYMAP_ENABLED
+    if (!keyLayers.hasEvents()) return;
+    current = &analyzerDevices[keymapSlot];
+    drainKeymap();
+#endif
+}
+
+// BLEの出力レポートはBLEスタックのタスクで届くので、ここ（USBタスク）で変化を見てSET_REPORTを積む
+void PythonStyleAnalyzer::handleHostLeds() {
+    if (!bleKeyboard) return;
+    uint8_t leds = bleKeyboard->getLedState();
+    if (leds != getKeyboardLeds()) {
+        setKeyboardLeds(leds);
+    }
+}
+
+// 時間窓が過ぎて確定したキーの変化を、最後の生レポートの形式で処理し直す
+void PythonStyleAnalyzer::handleDebounce() {
+    for (int i = 0; i < USB_HOST_MAX_DEVICES; i++) {
+        AnalyzerDevice& d = analyzerDevices[i];
+        if (!d.connected || !d.debouncer.isPending()) continue;
+        uint8_t keys[KEY_BITMAP_BYTES];
+        if (!d.debouncer.poll(millis(), keys)) continue;
+
+        current = &d;
+        #if SERIAL_OUTPUT_ENABLED
+        Serial.printf("\nチャタリング除去: 時間窓が過ぎたキーを確定 (スロット %d)\n", i);
+        #endif
+        processKeys(keys);
+    }
+}
+
+// 全デバイスでキーが離れているか（物理キー・キーマップの判定中のタップも見る）
+bool PythonStyleAnalyzer::keysReleased() const {
+    for (int i = 0; i < USB_HOST_MAX_DEVICES; i++) {
+        const AnalyzerDevice& d = analyzerDevices[i];
+        if (!d.connected) continue;
+        if (d.pressed_chars.length() > 0 || d.debouncer.isPending()) return false;
+        for (int b = 0; b < KEY_BITMAP_BYTES; b++) {
+            if (d.physical_keys[b]) return false;
+        }
+    }
+    uint32_t deadline;
+    return !keyLayers.getDeadline(deadline) && !keyLayers.hasEvents();
+}
+
+// 全デバイスで押されているキーをまとめる（デバイスの並び順）
+String PythonStyleAnalyzer::combinedPressedChars() const {
+    String all = "";
+    for (int i = 0; i < USB_HOST_MAX_DEVICES; i++) {
+        const AnalyzerDevice& d = analyzerDevices[i];
+        if (!d.connected || d.pressed_chars.length() == 0) continue;
+        if (all.length() > 0) all += ", ";
+        all += d.pressed_chars;
+    }
+    return all;
+}
+
+bool PythonStyleAnalyzer::updateTeleop(bool& newPress) {
+    uint8_t moves = 0;
+    uint8_t stops = 0;
+    bool other = false;
+    for (int i = 0; i < USB_HOST_MAX_DEVICES; i++) {
+        const AnalyzerDevice& d = analyzerDevices[i];
+        if (!d.connected) continue;
+        moves |= d.teleop_moves;
+        stops |= d.teleop_stops;
+        other |= d.teleop_other;
+    }
+    // 他のキーと一緒の時（Shift+矢印など）・テレオペを用意できなかった時は今まで通り送る
+    bool owned = teleopStreamer.isAvailable() && !other && (moves || stops);
+    newPress = teleopStreamer.update(owned ? moves : 0, owned ? stops : 0);
+    return owned;
+}
+
+uint8_t PythonStyleAnalyzer::combinedModifiers() const {
+    uint8_t mods = 0;
+    for (int i = 0; i < USB_HOST_MAX_DEVICES; i++) {
+        if (analyzerDevices[i].connected) mods |= analyzerDevices[i].modifier;
+    }
+    return mods;
+}
+
+// KB16が1台でもあればKB16、それ以外のキーボードだけならKEYBOARD
+void PythonStyleAnalyzer::updateUsbDeviceStatus() {
+    UsbDeviceKind kind = USB_DEVICE_NONE;
+    isConnected = false;
+    for (int i = 0; i < USB_HOST_MAX_DEVICES; i++) {
+        const AnalyzerDevice& d = analyzerDevices[i];
+        if (!d.connected) continue;
+        isConnected = true;
+        if (d.is_doio_kb16) {
+            kind = USB_DEVICE_KB16;
+        } else if (kind == USB_DEVICE_NONE) {
+            kind = USB_DEVICE_KEYBOARD;
+        }
+    }
+    systemStatus.setUsbDevice(kind);
 }
 
 // Pythonのpretty_print_report関数を完全移植
@@ -319,6 +517,8 @@ void PythonStyleAnalyzer::prettyPrintReport(const uint8_t* report_data, int data
             altPressed = true;
         }
         if (modifier & 0x80) mod_str += "R-GUI ";
+        current->modifier = modifier;
+        systemStatus.setModifiers(combinedModifiers());
         
         #if SERIAL_OUTPUT_ENABLED
         Serial.printf("修飾キー: %s\n", mod_str.length() > 0 ? mod_str.c_str() : "なし");
@@ -326,6 +526,8 @@ void PythonStyleAnalyzer::prettyPrintReport(const uint8_t* report_data, int data
         #endif
     } else {
         // DOIO KB16等では修飾キー処理を完全にスキップ（Pythonと同じ）
+        current->modifier = 0;
+        systemStatus.setModifiers(combinedModifiers());
         #if SERIAL_OUTPUT_ENABLED
         Serial.printf("修飾キー: 処理なし (%s)\n", format.format.c_str());
         Serial.printf("shift_pressed設定: false (固定)\n");
@@ -340,6 +542,8 @@ void PythonStyleAnalyzer::prettyPrintReport(const uint8_t* report_data, int data
     // 押されているキー（Pythonと同じロジック）
     String pressed_keys = "";
     String pressed_chars = "";
+    int pressed_count = 0;          // 押されているキーの数
+    uint8_t first_keycode = 0;      // 最初に見つかったキーコード（特別表示用）
     
     if (format.format == "Standard" || format.format == "NKRO") {
         if (format.format == "Standard") {
@@ -353,6 +557,7 @@ void PythonStyleAnalyzer::prettyPrintReport(const uint8_t* report_data, int data
             for (int i = 2; i < max_key_index; i++) {
                 if (i < format.size && report_data[i] != 0) {
                     uint8_t keycode = report_data[i];
+                    if (pressed_count++ == 0) first_keycode = keycode;
                     if (pressed_keys.length() > 0) pressed_keys += ", ";
                     pressed_keys += "0x" + String(keycode, HEX);
                     
@@ -377,6 +582,7 @@ void PythonStyleAnalyzer::prettyPrintReport(const uint8_t* report_data, int data
                 for (int bit = 0; bit < 8; bit++) {
                     if (b & (1 << bit)) {
                         uint8_t keycode = (i - 2) * 8 + bit + 4;
+                        if (pressed_count++ == 0) first_keycode = keycode;
                         if (pressed_keys.length() > 0) pressed_keys += ", ";
                         pressed_keys += "0x" + String(keycode, HEX);
                         
@@ -424,38 +630,51 @@ void PythonStyleAnalyzer::prettyPrintReport(const uint8_t* report_data, int data
         return;
     }
     
-    // ディスプレイ更新（リアルタイム表示）
-    String display_hex = hex_data;
-    String display_keys = pressed_keys.length() > 0 ? pressed_keys : "None";
-    String display_chars = pressed_chars.length() > 0 ? pressed_chars : "None";
-    updateDisplayWithKeys(display_hex, display_keys, display_chars, shift_pressed);
-    
     // BLE送信処理（長押し対応版）
+    // ハブ経由で複数台つながっている時は、全デバイスで押されているキーをまとめて送る
+    current->pressed_chars = pressed_chars;
+    bool newPress = false;
+    bool teleopOwned = false;
+    #if TELEOP_ENABLED
+    // 移動キー・停止キーだけが押されている時はteleopStreamerが一定周期で送る
+    uint8_t keys[KEY_BITMAP_BYTES];
+    reportToKeys(format, report_data, data_size, keys);
+    TeleopStreamer::classify(keys, current->teleop_moves, current->teleop_stops, current->teleop_other);
+    teleopOwned = updateTeleop(newPress);
+    #endif
     if (bleKeyboard && bleKeyboard->isConnected() && bleStackInitialized) {
+        String all_chars = combinedPressedChars();
         #if SERIAL_OUTPUT_ENABLED
-        Serial.printf("BLE送信チェック（長押し対応）: 現在='%s'\n", pressed_chars.c_str());
+        Serial.printf("BLE送信チェック（長押し対応）: 現在='%s'\n", all_chars.c_str());
         #endif
         
-        // 長押し処理を実行
-        processKeyPress(pressed_chars);
+        // 長押し処理を実行（テレオペで送るキーは長押しリピートに回さない）
+        if (teleopOwned) processKeyPress("");
+        else newPress = processKeyPress(all_chars);
         
     } else {
         #if SERIAL_OUTPUT_ENABLED
         Serial.println("BLE送信スキップ: BLE未接続またはスタック停止中");
         #endif
     }
+
+    // LED・音・画面は送信を積んだ後にイベント1件で渡す（リアルタイム表示）
+    String display_keys = pressed_keys.length() > 0 ? pressed_keys : "None";
+    String display_chars = pressed_chars.length() > 0 ? pressed_chars : "None";
+    publishKeyFeedback(display_keys, display_chars, shift_pressed,
+                       pressed_count == 1 ? first_keycode : 0, newPress);
     
     // 変更の検出（Pythonと同じロジック）
-    if (has_last_report) {
+    if (current->has_last_report) {
         bool has_changes = false;
         #if SERIAL_OUTPUT_ENABLED
         Serial.println("変更点:");
         #endif
         for (int i = 0; i < data_size; i++) {
-            if (last_report[i] != report_data[i]) {
+            if (current->last_report[i] != report_data[i]) {
                 has_changes = true;
                 #if SERIAL_OUTPUT_ENABLED
-                Serial.printf("  バイト%d: 0x%02X -> 0x%02X\n", i, last_report[i], report_data[i]);
+                Serial.printf("  バイト%d: 0x%02X -> 0x%02X\n", i, current->last_report[i], report_data[i]);
                 #endif
             }
         }
@@ -468,8 +687,8 @@ void PythonStyleAnalyzer::prettyPrintReport(const uint8_t* report_data, int data
     }
     
     // 現在のレポートを保存（Pythonと同じ）
-    memcpy(last_report, report_data, data_size);
-    has_last_report = true;
+    memcpy(current->last_report, report_data, data_size);
+    current->has_last_report = true;
 }
 
 // BLE送信用のヘルパー関数
@@ -774,7 +993,10 @@ void PythonStyleAnalyzer::sendSingleCharacterFast(const String& character) {
 }
 
 // デバイス接続時の処理（元のプログラムと同じ処理を追加）
-void PythonStyleAnalyzer::onNewDevice(const usb_device_info_t &dev_info) {
+void PythonStyleAnalyzer::onNewDevice(const UsbDeviceContext &dev, const usb_device_info_t &dev_info) {
+    selectDevice(dev);
+    *current = AnalyzerDevice();
+
     #if SERIAL_OUTPUT_ENABLED
     Serial.println("\n=== USB デバイス接続 ===");
     
@@ -786,16 +1008,16 @@ void PythonStyleAnalyzer::onNewDevice(const usb_device_info_t &dev_info) {
     Serial.printf("製造元: %s\n", manufacturer.length() > 0 ? manufacturer.c_str() : "不明");
     Serial.printf("製品名: %s\n", product.length() > 0 ? product.c_str() : "不明");
     Serial.printf("シリアル: %s\n", serialNum.length() > 0 ? serialNum.c_str() : "不明");
-    Serial.printf("VID: 0x%04X, PID: 0x%04X\n", device_vendor_id, device_product_id);
+    Serial.printf("VID: 0x%04X, PID: 0x%04X (アドレス %d, スロット %d)\n", dev.vendorId, dev.productId, dev.address, dev.slot);
     Serial.printf("速度: %s\n", dev_info.speed == USB_SPEED_LOW ? "Low" : 
                               dev_info.speed == USB_SPEED_FULL ? "Full" : "High");
     #endif
     
     // DOIO KB16の検出（Pythonと同じ処理）
-    if (device_vendor_id == DOIO_VID && device_product_id == DOIO_PID) {
-        is_doio_kb16 = true;
-        isConnected = true;
-        report_size = 16;  // DOIO KB16は16バイト固定
+    current->connected = true;
+    if (dev.vendorId == DOIO_VID && dev.productId == DOIO_PID) {
+        current->is_doio_kb16 = true;
+        current->report_size = 16;  // DOIO KB16は16バイト固定
         #if SERIAL_OUTPUT_ENABLED
         Serial.println("✓ DOIO KB16を検出: 16バイト固定レポートサイズ");
         Serial.println("✓ Pythonアナライザーと同じ処理：16バイトのStandardフォーマット");
@@ -806,9 +1028,8 @@ void PythonStyleAnalyzer::onNewDevice(const usb_device_info_t &dev_info) {
         // DOIO KB16専用の初期化処理
         updateDisplayForDevice("DOIO KB16");
     } else {
-        is_doio_kb16 = false;
-        isConnected = true;
-        report_size = 8;   // 標準キーボードは8バイト
+        current->is_doio_kb16 = false;
+        current->report_size = 8;   // 標準キーボードは8バイト
         #if SERIAL_OUTPUT_ENABLED
         Serial.println("標準キーボードとして処理 (8バイトレポート)");
         Serial.println("修飾キー処理が有効です（バイト0をチェック）");
@@ -818,55 +1039,77 @@ void PythonStyleAnalyzer::onNewDevice(const usb_device_info_t &dev_info) {
         // 標準キーボード用の初期化処理
         updateDisplayForDevice("Standard Keyboard");
     }
-    
-    // レポート形式を初期化
-    report_format_initialized = false;
-    has_last_report = false;
+    updateUsbDeviceStatus();
     
     #if SERIAL_OUTPUT_ENABLED
     Serial.println("========================\n");
     #endif
 }
 
-// デバイス切断時の処理
-void PythonStyleAnalyzer::onGone(const usb_host_client_event_msg_t *eventMsg) {
+// デバイス切断時の処理（他のデバイスの状態には触れない）
+void PythonStyleAnalyzer::onGone(const UsbDeviceContext &dev) {
     #if SERIAL_OUTPUT_ENABLED
-    Serial.println("USBデバイスが切断されました");
+    Serial.printf("USBデバイスが切断されました (アドレス %d)\n", dev.address);
     #endif
-    is_doio_kb16 = false;
-    isConnected = false;
-    has_last_report = false;
-    report_format_initialized = false;
+    // ゲームパッドが外れたら中立を送る（ロボットが最後の入力のまま動き続けないように）
+    for (int i = 0; i < USB_HOST_MAX_TRANSFERS; i++) {
+        if (dev.gamepadLayout[i].valid) {
+            gamepadForwarder.reset();
+            break;
+        }
+    }
+    // マウスのボタンを押したまま抜かれたら離す
+    if (dev.lastMouseButtons != 0) {
+        mouseForwarder.reset();
+    }
+
+    selectDevice(dev);
+    bool hadKeys = current->pressed_chars.length() > 0;
+    #if KEYMAP_ENABLED
+    // 押さえていたレイヤー・判定中のタップを捨て、再生中のマクロを止める（起動キーのリリースはもう来ない）
+    if (current->is_doio_kb16) {
+        keyLayers.reset();
+        macroPlayer.stop();
+    }
+    #endif
+    *current = AnalyzerDevice();
+    updateUsbDeviceStatus();
+    systemStatus.setModifiers(combinedModifiers());
+    #if TELEOP_ENABLED
+    // 外れたデバイスの移動キーはリリースとして扱う（すぐ止める）
+    bool teleopNew;
+    updateTeleop(teleopNew);
+    #endif
+
+    if (isConnected) {
+        // 残ったデバイスは動き続ける。外れたデバイスで押されていたキーだけを長押しの対象から外す
+        if (hadKeys) {
+            currentPressedChars = combinedPressedChars();
+            lastSentChars = currentPressedChars;
+            if (currentPressedChars.length() == 0) isRepeating = false;
+        }
+        return;
+    }
 
     // BLEキーボードのキーをすべてリリース
     if (bleKeyboard) {
         bleKeyboard->releaseAll();
     }
 
-    // ディスプレイを元の状態に戻す（u8g2用に修正）
+    // ディスプレイを元の状態に戻す（描画は表示タスクで行う）
     if (display) {
-        display->clearBuffer();
-        display->setFont(u8g2_font_6x10_tr);
-        display->drawStr(0, 10, "USB->BLE Bridge");
-        display->drawStr(0, 22, "");
-        display->drawStr(0, 34, "Device");
-        display->drawStr(0, 46, "DISCONNECTED");
-        display->drawStr(0, 58, "");
-        display->drawStr(0, 70, "BLE still active");
-        display->drawStr(0, 82, "Waiting for USB");
-        display->drawStr(0, 94, "device...");
-        display->sendBuffer();
+        DisplayRequest req;
+        req.type = DISPLAY_GONE;
+        req.display = display;
+        requestDisplay(req);
     }
 }
 
 // 標準キーボード処理（8バイトレポート）
-void PythonStyleAnalyzer::onKeyboard(hid_keyboard_report_t report, hid_keyboard_report_t last_report) {
-    if (is_doio_kb16) {
-        // DOIO KB16の場合は16バイトレポート処理を優先
-        return;
-    }
+void PythonStyleAnalyzer::onKeyboard(const UsbDeviceContext &dev, hid_keyboard_report_t report, hid_keyboard_report_t last_report) {
+    selectDevice(dev);
     
-    // 標準8バイトレポートをPythonスタイルで処理
+    // 標準8バイトレポートをPythonスタイルで処理（KB16のブートインターフェースもここに来る）
     uint8_t current_report[8] = {0};
     current_report[0] = report.modifier;
     current_report[1] = report.reserved;
@@ -880,7 +1123,7 @@ void PythonStyleAnalyzer::onKeyboard(hid_keyboard_report_t report, hid_keyboard_
     Serial.println("╚══════════════════════════════════════╝");
     Serial.printf("受信時刻: %lu ms\n", millis());
     Serial.printf("受信バイト数: 8\n");
-    Serial.printf("デバイス: 標準キーボード\n");
+    Serial.printf("デバイス: %s (アドレス %d)\n", current->is_doio_kb16 ? "DOIO KB16" : "標準キーボード", dev.address);
     
     // 生データを16進数で表示
     Serial.print("生データ: ");
@@ -893,17 +1136,58 @@ void PythonStyleAnalyzer::onKeyboard(hid_keyboard_report_t report, hid_keyboard_
     Serial.println("──────────────────────────────────────");
     #endif
     
-    // Pythonのpretty_print_reportを呼び出し
-    prettyPrintReport(current_report, 8);
+    // チャタリング除去で変化が無くなったレポートはBLE・表示に流さない
+    uint8_t keys[KEY_BITMAP_BYTES];
+    if (!debounceReport(current_report, 8, keys)) {
+        #if SERIAL_OUTPUT_ENABLED
+        Serial.println("チャタリング除去: キーの変化なし");
+        #endif
+        return;
+    }
+
+    // Pythonのpretty_print_reportを呼び出す（KB16はキーマップを通してから）
+    processKeys(keys);
     
     #if SERIAL_OUTPUT_ENABLED
     Serial.println("════════════════════════════════════════");
     #endif
 }
 
-// USBデータ受信時の処理（Pythonのread処理と同等）
-void PythonStyleAnalyzer::onReceive(const usb_transfer_t *transfer) {
-    if (transfer->actual_num_bytes == 0) return;
+// コンシューマーコントロール受信時の処理（KB16のノブなど）
+// QMKは1ステップごとに使用法→0（リリース）を送ってくるので、押下の立ち上がりを1ステップとして積む。
+// リリースはConsumerForwarderが押下と対で送る
+void PythonStyleAnalyzer::onConsumer(const UsbDeviceContext &dev, uint16_t usage) {
+    selectDevice(dev);
+    uint16_t last = current->consumer_usage;
+    current->consumer_usage = usage;
+    if (usage == 0 || usage == last) return;
+
+    bool forwarded = consumerForwarder.step(usage);
+    #if SERIAL_OUTPUT_ENABLED
+    Serial.printf("コンシューマーコントロール: 0x%04X%s (アドレス %d)\n", usage, forwarded ? "" : " (未対応)", dev.address);
+    #endif
+}
+
+// マウスレポート受信時の処理（ブートマウス・KB16のマウスキー）
+// 1msごとのレポートをそのままBLEへは送らず、MouseForwarderが接続間隔ごとに合計して送る
+void PythonStyleAnalyzer::onMouse(hid_mouse_report_t report, uint8_t last_buttons) {
+    mouseForwarder.add(report.buttons, report.x, report.y, report.wheel, report.pan);
+    #if SERIAL_OUTPUT_ENABLED
+    if (report.buttons != last_buttons) {
+        Serial.printf("マウスボタン: 0x%02X -> 0x%02X\n", last_buttons, report.buttons);
+    }
+    #endif
+}
+
+// ゲームパッドのレポート受信時の処理（レポート記述子でデコード済み、軸は-127〜127）
+void PythonStyleAnalyzer::onGamepad(const UsbDeviceContext &dev, const GamepadState &state) {
+    gamepadForwarder.update(state);
+}
+
+// NKROレポート受信時の処理（Pythonのread処理と同等）
+void PythonStyleAnalyzer::onNkroReport(const UsbDeviceContext &dev, const uint8_t* data, int length) {
+    if (length == 0) return;
+    selectDevice(dev);
     
     // Pythonアナライザーのメイン処理と同じフロー
     #if SERIAL_OUTPUT_ENABLED
@@ -911,39 +1195,44 @@ void PythonStyleAnalyzer::onReceive(const usb_transfer_t *transfer) {
     Serial.println("║           USB データ受信             ║");
     Serial.println("╚══════════════════════════════════════╝");
     Serial.printf("受信時刻: %lu ms\n", millis());
-    Serial.printf("受信バイト数: %d\n", transfer->actual_num_bytes);
-    Serial.printf("デバイス: %s\n", is_doio_kb16 ? "DOIO KB16" : "標準キーボード");
-    Serial.printf("期待サイズ: %d バイト\n", report_size);
+    Serial.printf("受信バイト数: %d\n", length);
+    Serial.printf("デバイス: %s (アドレス %d)\n", current->is_doio_kb16 ? "DOIO KB16" : "標準キーボード", dev.address);
+    Serial.printf("期待サイズ: %d バイト\n", current->report_size);
     
     // 生データを16進数で表示
     Serial.print("生データ: ");
-    for (int i = 0; i < transfer->actual_num_bytes; i++) {
-        if (transfer->data_buffer[i] < 16) Serial.print("0");
-        Serial.print(transfer->data_buffer[i], HEX);
+    for (int i = 0; i < length; i++) {
+        if (data[i] < 16) Serial.print("0");
+        Serial.print(data[i], HEX);
         Serial.print(" ");
     }
     Serial.println();
     Serial.println("──────────────────────────────────────");
     #endif
     
-    // Pythonのpretty_print_reportを呼び出し
-    prettyPrintReport(transfer->data_buffer, transfer->actual_num_bytes);
+    // 想定より長いレポートはチャタリング除去・キーマップを通さない
+    if (length > (int)sizeof(current->raw_report)) {
+        prettyPrintReport(data, length);
+        return;
+    }
+
+    // チャタリング除去で変化が無くなったレポートはBLE・表示に流さない
+    uint8_t keys[KEY_BITMAP_BYTES];
+    if (!debounceReport(data, length, keys)) {
+        #if SERIAL_OUTPUT_ENABLED
+        Serial.println("チャタリング除去: キーの変化なし");
+        #endif
+        return;
+    }
+
+    // Pythonのpretty_print_reportを呼び出す（KB16はキーマップを通してから）
+    processKeys(keys);
     
     #if SERIAL_OUTPUT_ENABLED
     Serial.println("════════════════════════════════════════");
     #endif
 }
 
-// 16バイトレポート処理（DOIO KB16専用）
-void PythonStyleAnalyzer::processRawReport16Bytes(const uint8_t* data) {
-    #if SERIAL_OUTPUT_ENABLED && DEBUG_ENABLED
-    Serial.println("16バイトDOIO KB16レポート処理");
-    #endif
-    
-    // Pythonと同じ処理フローを呼び出し
-    prettyPrintReport(data, 16);
-}
-
 // 長押しリピート処理
 void PythonStyleAnalyzer::handleKeyRepeat() {
     if (currentPressedChars.length() == 0) {
@@ -967,8 +1256,10 @@ void PythonStyleAnalyzer::handleKeyRepeat() {
     }
     
     // 複数キー時は少し遅延を長くして安定化
-    unsigned long effectiveRepeatDelay = isMultipleKeys ? REPEAT_DELAY + (keyCount * 10) : REPEAT_DELAY;
-    unsigned long effectiveRepeatRate = isMultipleKeys ? REPEAT_RATE + (keyCount * 5) : REPEAT_RATE;
+    unsigned long repeatDelay = configStore.getRepeatDelayMs(REPEAT_DELAY);
+    unsigned long repeatRate = configStore.getRepeatRateMs(REPEAT_RATE);
+    unsigned long effectiveRepeatDelay = isMultipleKeys ? repeatDelay + (keyCount * 10) : repeatDelay;
+    unsigned long effectiveRepeatRate = isMultipleKeys ? repeatRate + (keyCount * 5) : repeatRate;
     
     if (!isRepeating) {
         // 長押し開始判定
@@ -983,7 +1274,7 @@ void PythonStyleAnalyzer::handleKeyRepeat() {
             #endif
             
             // 長押し開始時に音を鳴らす
-            speakerController.playKeySound();
+            publishRepeatFeedback();
             
             // 長押し開始時に即座に1回送信
             sendString(currentPressedChars);
@@ -1002,7 +1293,7 @@ void PythonStyleAnalyzer::handleKeyRepeat() {
             #endif
             
             // リピート送信時に音を鳴らす
-            speakerController.playKeySound();
+            publishRepeatFeedback();
             
             // 現在押されているキーを送信
             sendString(currentPressedChars);
@@ -1011,7 +1302,7 @@ void PythonStyleAnalyzer::handleKeyRepeat() {
 }
 
 // キー押下処理（長押し対応）
-void PythonStyleAnalyzer::processKeyPress(const String& pressed_chars) {
+bool PythonStyleAnalyzer::processKeyPress(const String& pressed_chars) {
     if (pressed_chars.length() == 0) {
         // キーリリース
         if (currentPressedChars.length() > 0) {
@@ -1023,7 +1314,7 @@ void PythonStyleAnalyzer::processKeyPress(const String& pressed_chars) {
             // キーリリース時に即座にlastSentCharsをクリア（高速連続押し対応）
             lastSentChars = "";
         }
-        return;
+        return false;
     }
     
     // 新しいキー押下または継続
@@ -1037,10 +1328,6 @@ void PythonStyleAnalyzer::processKeyPress(const String& pressed_chars) {
         Serial.printf("🔑 新しいキー押下: '%s' (開始時刻: %lu ms)\n", pressed_chars.c_str(), keyPressStartTime);
         #endif
         
-        // LEDとスピーカーを制御
-        ledController.keyPressed();
-        speakerController.playKeySound();
-        
         // 初回送信（常に送信する - 高速化）
         #if SERIAL_OUTPUT_ENABLED
         Serial.printf("🔑 初回送信: '%s'\n", pressed_chars.c_str());
@@ -1048,11 +1335,16 @@ void PythonStyleAnalyzer::processKeyPress(const String& pressed_chars) {
         // BLE送信要求をキューに追加
         if (bleSendQueue != NULL) {
             String charsToSend = pressed_chars;
-            xQueueSend(bleSendQueue, &charsToSend, 0);
+            if (xQueueSend(bleSendQueue, &charsToSend, 0) != pdTRUE) {
+                // 送信が追いついていない（送信タスクがキューを空にしたら解除される）
+                ledController.setAlarm(LED_ALARM_QUEUE_OVERFLOW, true);
+            }
+            systemStatus.setQueueDepth(uxQueueMessagesWaiting(bleSendQueue));
         }
         
         // 送信後に即座に履歴を更新（高速連続押し対応）
         lastSentChars = pressed_chars;
+        return true;
     } else {
         // 同じキーの継続 - handleKeyRepeat()で処理される
         #if SERIAL_OUTPUT_ENABLED
@@ -1065,6 +1357,7 @@ void PythonStyleAnalyzer::processKeyPress(const String& pressed_chars) {
         }
         #endif
     }
+    return false;
 }
 
 // パフォーマンス統計レポート
@@ -1084,10 +1377,67 @@ void PythonStyleAnalyzer::reportPerformanceStats() {
     Serial.printf("    - 最大間隔: %lu ms\n", maxTransmissionInterval);
     Serial.printf("    - 平均間隔: %lu ms\n", avgInterval);
     Serial.printf("  長押しリピート設定:\n");
-    Serial.printf("    - 単一キー初期遅延: %lu ms\n", REPEAT_DELAY);
-    Serial.printf("    - 単一キーリピート間隔: %lu ms\n", REPEAT_RATE);
+    Serial.printf("    - 単一キー初期遅延: %u ms\n", configStore.getRepeatDelayMs(REPEAT_DELAY));
+    Serial.printf("    - 単一キーリピート間隔: %u ms\n", configStore.getRepeatRateMs(REPEAT_RATE));
     Serial.printf("    - 複数キー時は追加遅延あり\n");
     Serial.printf("  BLEライブラリ遅延: 1 ms\n");
+    Serial.printf("  未描画で上書きされた表示要求: %lu 件\n", (unsigned long)getDisplayDroppedCount());
+    Serial.printf("  フレームキャッシュ: ヒット %lu / ミス %lu\n",
+                  (unsigned long)frameCache.getHits(), (unsigned long)frameCache.getMisses());
+    Serial.printf("  ディスプレイ転送: 平均 %lu us / 最大 %lu us / 直近 %lu us (%lu 回, 上書き %lu, エラー %lu)\n",
+                  (unsigned long)displayFlush.getAvgFlushUs(), (unsigned long)displayFlush.getMaxFlushUs(),
+                  (unsigned long)displayFlush.getLastFlushUs(), (unsigned long)displayFlush.getFlushCount(),
+                  (unsigned long)displayFlush.getSkippedFrames(), (unsigned long)displayFlush.getErrorCount());
+    Serial.printf("  ブザー: 間引いたキー音 %lu / あふれたノート %lu\n",
+                  (unsigned long)speakerController.getDroppedClicks(), (unsigned long)speakerController.getDroppedNotes());
+    Serial.printf("  フィードバック: 発行 %lu / あふれ %lu / 抑制 LED %lu・音 %lu・画面 %lu\n",
+                  (unsigned long)feedbackBus.getPublished(), (unsigned long)feedbackBus.getDropped(),
+                  (unsigned long)feedbackBus.getSuppressed(FEEDBACK_LED),
+                  (unsigned long)feedbackBus.getSuppressed(FEEDBACK_SOUND),
+                  (unsigned long)feedbackBus.getSuppressed(FEEDBACK_DISPLAY));
+    Serial.printf("  メディアキー: 受信 %lu / 送信 %lu ステップ (%lu 回) / 打ち消し %lu / 破棄 %lu\n",
+                  (unsigned long)consumerForwarder.getReceived(), (unsigned long)consumerForwarder.getSentSteps(),
+                  (unsigned long)consumerForwarder.getFlushes(), (unsigned long)consumerForwarder.getCancelled(),
+                  (unsigned long)consumerForwarder.getDropped());
+    Serial.printf("  マウス: 受信 %lu / 送信 %lu レポート / 破棄 %lu\n",
+                  (unsigned long)mouseForwarder.getReceived(), (unsigned long)mouseForwarder.getSent(),
+                  (unsigned long)mouseForwarder.getDropped());
+    Serial.printf("  ゲームパッド: 受信 %lu / 送信 %lu / 間引き %lu\n",
+                  (unsigned long)gamepadForwarder.getReceived(), (unsigned long)gamepadForwarder.getSent(),
+                  (unsigned long)gamepadForwarder.getFiltered());
+    Serial.printf("  USBレポート: %lu 件/秒（うち前回と同じ %lu 件/秒, SET_IDLE %s）\n",
+                  (unsigned long)getReportsPerSecond(), (unsigned long)getUnchangedPerSecond(),
+                  USB_HOST_SET_IDLE ? "あり" : "なし");
+    Serial.printf("  USB接続: 最初のレポートまで %lu us（%s）\n",
+                  (unsigned long)getLastEnumerationUs(), wasLastEnumerationCached() ? "保存済みの解析結果" : "記述子を解析");
+    for (int i = 0; i < USB_HOST_MAX_DEVICES; i++) {
+        const KeyDebouncer& db = analyzerDevices[i].debouncer;
+        if (!analyzerDevices[i].connected || db.getTotalChatter() == 0) continue;
+        uint8_t worst = db.getWorstKey();
+        Serial.printf("  チャタリング (スロット %d): 計 %lu 回 / 最多 0x%02X %s %u 回\n",
+                      i, (unsigned long)db.getTotalChatter(), worst, keycodeToString(worst).c_str(), db.getChatter(worst));
+    }
+    #if KEYMAP_ENABLED
+    Serial.printf("  キーマップ: レイヤー %u / タップ %lu / ホールド %lu / 出力あふれ %lu\n",
+                  keyLayers.getActiveLayer(), (unsigned long)keyLayers.getTaps(),
+                  (unsigned long)keyLayers.getHolds(), (unsigned long)keyLayers.getDroppedEvents());
+    Serial.printf("  マクロ: 再生 %lu / 完了 %lu / 中断 %lu%s\n",
+                  (unsigned long)macroPlayer.getPlayed(), (unsigned long)macroPlayer.getCompleted(),
+                  (unsigned long)macroPlayer.getInterrupted(), macroPlayer.isPlaying() ? "（再生中）" : "");
+    #endif
+    Serial.printf("  設定ファイル: %s (切り替え %lu 回 / 不正 %lu)\n",
+                  configStore.getGeneration() > 0 ? "使用中" : "組み込み",
+                  (unsigned long)configStore.getGeneration(), (unsigned long)configStore.getRejected());
+    #if TELEOP_ENABLED
+    Serial.printf("  テレオペ: %d Hz / 送信 %lu / 停止キー %lu / 期限超過 %lu / 最大遅れ %lu us\n",
+                  TELEOP_RATE_HZ, (unsigned long)teleopStreamer.getSent(), (unsigned long)teleopStreamer.getStops(),
+                  (unsigned long)teleopStreamer.getMissedDeadlines(), (unsigned long)teleopStreamer.getMaxLatencyUs());
+    #endif
+    Serial.printf("  USB抜き差し: 解放待ちの超過 %lu 回 / 未解放の転送 %ld\n",
+                  (unsigned long)getDrainTimeouts(), (long)getLiveTransfers());
+    StatusSnapshot st = systemStatus.read();
+    Serial.printf("  BLE送信キュー: 滞留 %u 件 / 直近の送信 %lu us (状態バージョン %lu)\n",
+                  st.queueDepth, (unsigned long)st.lastLatencyUs, (unsigned long)st.version);
     Serial.println("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━");
     #endif
     
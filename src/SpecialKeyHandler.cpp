@@ -1,316 +1,287 @@
 #include "SpecialKeyHandler.h"
-#include "BitmapImages.h"
+#include "DisplayRender.h"
+#include "BitmapImagesRle.h"
+#include "FrameCache.h"
+#include "DisplayFlush.h"
+#include "Animation.h"
+#include "StartupAnimation.h"
+#include "ConfigStore.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/queue.h>
+#include <atomic>
 
-// 画面表示キュー（定義はmain.cppのみ、ここではextern宣言）
+// 画面表示メールボックス（定義はmain.cppのみ、ここではextern宣言）
+// 長さ1のキューをxQueueOverwriteで使い、常に最新の要求だけを保持する
 extern QueueHandle_t displayQueue;
 
+// 要求の通し番号（複数のタスクから要求されるのでatomicで採番する）
+static std::atomic<uint32_t> displayRequestSeq{0};
+// 描画されずに上書きされた要求数（displayTaskだけが書く: 受け取った最大の番号 - 受け取った数）
+static volatile uint32_t displayDroppedCount = 0;
+static uint32_t displayReceived = 0;
+static uint32_t displayMaxSeq = 0;
+
+// ステータスバーの状態確認間隔（ms）。バージョン比較だけなので、変化が無ければ描画も転送もしない
+#define STATUS_BAR_POLL_MS 100
+
+// 現在の画面にステータスバーがあるか、最後に描いた時の状態バージョン（displayTaskからのみ触る）
+static bool statusBarShown = false;
+static uint32_t statusBarVersion = 0;
+static U8G2* statusBarDisplay = nullptr;
+
+// 描画済みの画面の最下行に最新のステータスバーを重ねる（送出は呼び出し側）
+static void overlayStatusBar(U8G2* display) {
+    StatusSnapshot st = systemStatus.read();
+    drawStatusBar(display, st);
+    statusBarShown = true;
+    statusBarVersion = st.version;
+    statusBarDisplay = display;
+}
+
+// ビットマップを縦オフセット付きで表示（キャッシュ済みならmemcpyのみ）
+static void showBitmapFrame(U8G2* display, const unsigned char* bitmap, int bmp_w, int bmp_h, int yOffset) {
+    if (!frameCache.blit(display, bitmap, yOffset)) {
+        display->clearBuffer();
+        display->drawXBMP(0, yOffset, bmp_w, bmp_h, bitmap);
+        frameCache.store(display, bitmap, yOffset);
+    }
+    displayFlush.submit(display);
+}
+
+// 圧縮ビットマップをU8G2バッファへ直接展開して表示（キャッシュ済みならmemcpyのみ）
+static void showRleFrame(U8G2* display, const RleBitmap* bmp, int yOffset) {
+    if (!frameCache.blit(display, bmp, yOffset)) {
+        uint8_t* buf = display->getBufferPtr();
+        rleDecodeTiles(*bmp, buf);
+        shiftTiles(buf, yOffset);
+        frameCache.store(display, bmp, yOffset);
+    }
+    displayFlush.submit(display);
+}
+
 // ディスプレイ専用タスク
 void displayTask(void* pvParameters) {
     DisplayRequest req;
     static int lastDisplayType = -1; // 直前の表示タイプを記憶
-    static String lastText1 = "";    // 前回のtext1を記憶
-    static String lastText2 = "";    // 前回のtext2を記憶
-    static unsigned long lastTextChangeTime = 0; // 最後にキーが変わった時刻
-    const unsigned long TEXT_CHANGE_INTERVAL = 1000; // 500ms以上変化がなければdelay
+    static Animator animator;
 
     for (;;) {
-        if (xQueueReceive(displayQueue, &req, portMAX_DELAY) == pdTRUE) {
-            // 特別キー表示の直後はDISPLAY_NORMALをスキップ
-            if (req.type == DISPLAY_NORMAL && 
-                (lastDisplayType == DISPLAY_TEXT || lastDisplayType == DISPLAY_ANIMATION)) {
-                // DISPLAY_NORMAL表示要求を無視して特別表示を維持
-                // 必要なら一定時間後に解除するロジックも追加可能
-                continue;
-            }
-            if (req.type == DISPLAY_NORMAL) {
-                // 2行表示（メイン＋サブ）
-                req.display->clearBuffer();
-                req.display->setFont(req.font);
-                // メイン文字（中央上部）
-                int textWidth1 = req.display->getStrWidth(req.text1.c_str());
-                int xPos1 = (128 - textWidth1) / 2;
-                int fontHeight1 = req.display->getFontAscent() - req.display->getFontDescent();
-                int yPos1 = 16 + fontHeight1 / 2;
-                req.display->drawStr(xPos1, yPos1, req.text1.c_str());
-                req.display->setFont(u8g2_font_6x10_tr);
-                // 下部情報（BLE/SHIFT/Key名）
-                req.display->drawStr(0, 52, "BLE: --");
-                req.display->drawStr(70, 52, "SHIFT: --");
-                req.display->drawStr(0, 62, "Key:");
-                req.display->drawStr(30, 62, req.text2.c_str());
-                req.display->sendBuffer();
-            } else if (req.type == DISPLAY_TEXT) {
-                req.display->clearBuffer();
-                req.display->setFont(req.font);
-                drawCenteredText(req.display, req.text1.c_str(), req.font);
-                if (!req.text2.isEmpty()) {
-                    req.display->setFont(u8g2_font_6x10_tr);
-                    int textWidth2 = req.display->getStrWidth(req.text2.c_str());
-                    int xPos2 = (128 - textWidth2) / 2;
-                    int fontHeight2 = req.display->getFontAscent() - req.display->getFontDescent();
-                    int yPos2 = 52 + fontHeight2 / 1.5; // 少し下に配置
-                    req.display->drawStr(xPos2, yPos2, req.text2.c_str());
-                }
-                req.display->sendBuffer();
-
-                unsigned long now = millis();
-                // キーが切り替わった場合はdelayなし
-                if (req.text1 != lastText1 || req.text2 != lastText2) {
-                    lastTextChangeTime = now;
-                    // 上書き表示（delayなし）
-                } else {
-                    // 前回の表示から一定時間以上経過していればdelay
-                    if (now - lastTextChangeTime > TEXT_CHANGE_INTERVAL) {
-                        vTaskDelay(1000 / portTICK_PERIOD_MS); // 1秒間表示
-                        lastTextChangeTime = now;
-                    }
-                }
-                lastText1 = req.text1;
-                lastText2 = req.text2;
-            } else if (req.type == DISPLAY_ANIMATION) {
-                // "READY"ホップアニメーション
-                if (req.text1 == "READY") {
-                    showHoppingTextAnimation(
-                        req.display,
-                        "READY",
-                        req.font ? req.font : u8g2_font_fub14_tr,
-                        req.jumpHeight > 0 ? req.jumpHeight : 8,
-                        req.frameDelay > 0 ? req.frameDelay : 120
-                    );
-                } else {
-                    int baseY = 0;
-                    for (int i = 0; i < req.frames; ++i) {
-                        int yOffset = baseY;
-                        if (i % 2 == 1) yOffset -= req.jumpHeight;
-                        req.display->clearBuffer();
-                        req.display->drawXBMP(0, yOffset, req.bmp_w, req.bmp_h, req.bitmap);
-                        req.display->sendBuffer();
-                        vTaskDelay(req.frameDelay / portTICK_PERIOD_MS); // フレーム間の遅延
-                    }
-                    req.display->clearBuffer();
-                    req.display->drawXBMP(0, baseY, req.bmp_w, req.bmp_h, req.bitmap);
-                    req.display->sendBuffer();
-                }
+        // アニメーション再生中は次のフレームの期限までだけ待つ（新しい要求が来ればその場で起きる）
+        TickType_t wait = portMAX_DELAY;
+        if (animator.isActive()) {
+            // 切り捨てで0tickになると期限前に空回りするので切り上げる
+            wait = (animator.msUntilNextFrame(millis()) + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+        }
+        if (statusBarShown && wait > pdMS_TO_TICKS(STATUS_BAR_POLL_MS)) {
+            wait = pdMS_TO_TICKS(STATUS_BAR_POLL_MS);
+        }
+        if (xQueueReceive(displayQueue, &req, wait) != pdTRUE) {
+            animator.tick(millis());
+            // 状態が変わっていればステータスバーだけ描き直す
+            if (statusBarShown && systemStatus.getVersion() != statusBarVersion) {
+                overlayStatusBar(statusBarDisplay);
+                displayFlush.submit(statusBarDisplay);
             }
-            lastDisplayType = req.type; // 表示タイプを記憶
+            continue;
+        }
+        // 受け取らなかった番号は上書きで失われた要求
+        displayReceived++;
+        if (req.seq > displayMaxSeq) displayMaxSeq = req.seq;
+        displayDroppedCount = displayMaxSeq - displayReceived;
+        if (req.display == nullptr) continue;
+        // 特別キー表示の直後はDISPLAY_NORMALをスキップ
+        if (req.type == DISPLAY_NORMAL && 
+            (lastDisplayType == DISPLAY_TEXT || lastDisplayType == DISPLAY_ANIMATION)) {
+            // DISPLAY_NORMAL表示要求を無視して特別表示を維持
+            // 必要なら一定時間後に解除するロジックも追加可能
+            continue;
         }
-        vTaskDelay(1); // 負荷軽減のための短い待機
+        // 新しい内容を描くので再生中のアニメーションは即中断
+        animator.stop();
+        statusBarShown = false;
+        if (req.type == DISPLAY_NORMAL) {
+            drawNormalScreen(req);
+            overlayStatusBar(req.display);
+            displayFlush.submit(req.display);
+        } else if (req.type == DISPLAY_TEXT) {
+            // 表示を保持するための待機はしない（次の要求は上書きで届くので常に最新を描く）
+            drawTextScreen(req);
+            displayFlush.submit(req.display);
+        } else if (req.type == DISPLAY_ANIMATION) {
+            // 最初のフレームはすぐ描き、以降はループ先頭の待ち時間で進める
+            animator.start(req, millis());
+            animator.tick(millis());
+        } else if (req.type == DISPLAY_DEVICE) {
+            drawDeviceScreen(req);
+            overlayStatusBar(req.display);
+            displayFlush.submit(req.display);
+        } else if (req.type == DISPLAY_GONE) {
+            drawGoneScreen(req);
+            displayFlush.submit(req.display);
+        }
+        lastDisplayType = req.type; // 表示タイプを記憶
     }
 }
 
-// 画面表示要求をキューに入れる関数
+// 画面表示要求をメールボックスに入れる関数（呼び出し側は決してブロックしない）
 void requestDisplay(DisplayRequest& req) {
     if (displayQueue != NULL) {
-        xQueueSend(displayQueue, &req, 0);
+        // 上書きで失われた要求はdisplayTaskが番号の抜けで数える（ここで待ち件数を見ると競合する）
+        req.seq = displayRequestSeq.fetch_add(1) + 1;
+        xQueueOverwrite(displayQueue, &req);
     }
 }
 
-// 画面中央にテキストを表示する関数（既存のまま）
-void drawCenteredText(U8G2* display, const char* text, const uint8_t* font) {
-    display->setFont(font);
-    int textWidth = display->getStrWidth(text);
-    int xPos = (128 - textWidth) / 2;
-    int fontHeight = display->getFontAscent() - display->getFontDescent();
-    int yPos = (64 + fontHeight) / 2.4 - display->getFontDescent();
-    display->drawStr(xPos, yPos, text);
+uint32_t getDisplayDroppedCount() {
+    return displayDroppedCount;
 }
 
-// 1文字ずつホップするテキストアニメーション
-void showHoppingTextAnimation(U8G2* display, const char* text, const uint8_t* font, int hopHeight, int frameDelay) {
-    const int titleLen = strlen(text);
-    const int normalY = 32;
-    const int hopY = normalY - hopHeight;
+// ホップアニメーションの1フレームを表示（キャッシュ済みならmemcpyのみ）
+static void showHopFrame(U8G2* display, const char* text, const uint8_t* font, int hopHeight, int hopIdx) {
+    const int32_t variant = (hopHeight << 8) | (hopIdx & 0xFF);
+    if (!frameCache.blit(display, text, variant)) {
+        renderHopFrame(display, text, font, hopHeight, hopIdx);
+        frameCache.store(display, text, variant);
+    }
+    overlayStatusBar(display);
+    displayFlush.submit(display);
+}
 
-    // 文字ごとの幅を計算
-    int charWidths[16] = {0};
-    int totalWidth = 0;
-    display->setFont(font);
-    for (int i = 0; i < titleLen; i++) {
-        char c[2] = { text[i], '\0' };
-        charWidths[i] = display->getStrWidth(c);
-        totalWidth += charWidths[i];
+// アニメーションの1フレームを描いて送出する
+void renderAnimationFrame(const DisplayRequest& req, const AnimationClip& clip, int8_t pose, uint8_t loopsLeft) {
+    U8G2* display = req.display;
+    statusBarShown = false;
+    switch (clip.kind) {
+    case ANIM_BITMAP_BOUNCE: {
+        int yOffset = -pose * req.jumpHeight;
+        if (req.rle) {
+            showRleFrame(display, req.rle, yOffset);
+        } else {
+            showBitmapFrame(display, req.bitmap, req.bmp_w, req.bmp_h, yOffset);
+        }
+        break;
+    }
+    case ANIM_HOP_TEXT:
+        showHopFrame(display, clip.text,
+                     req.font ? req.font : u8g2_font_fub14_tr,
+                     req.jumpHeight > 0 ? req.jumpHeight : 8,
+                     pose);
+        break;
+    case ANIM_STARTUP:
+        // 起動時に一度だけ流れるのでフレームキャッシュには入れない
+        StartupAnimation(display).renderFrame(pose, loopsLeft);
+        displayFlush.submit(display);
+        break;
     }
-    int x = (128 - totalWidth) / 2;
+}
 
-    for (int idx = 0; idx < titleLen; idx++) {
-        // アニメーション中に新しいリクエストが来ていれば即中断
-        if (uxQueueMessagesWaiting(displayQueue) > 0) return;
+// 特別表示テーブル（キーコードはKEYCODE_MAPと同じDOIO KB16基準）
+// shiftInvariant: Shift押下中でも同じ文字になるキー（テンキー・矢印など）
+// seqPrev/seqBitmap: 直前のキーがseqPrevだった場合に差し替えるビットマップ
+static const SpecialKeyEntry SPECIAL_KEY_TABLE[] = {
+    // 顔アニメーション（数字キー / テンキー）
+    {0x22, DISPLAY_ANIMATION, &rle_bitmap_faces_1, nullptr, nullptr, nullptr, false, 0x00, nullptr},
+    {0x23, DISPLAY_ANIMATION, &rle_bitmap_faces_2, nullptr, nullptr, nullptr, false, 0x00, nullptr},
+    {0x24, DISPLAY_ANIMATION, &rle_bitmap_faces_3, nullptr, nullptr, nullptr, false, 0x1A, &rle_bitmap_faces_3_5},
+    {0x25, DISPLAY_ANIMATION, &rle_bitmap_faces_4, nullptr, nullptr, nullptr, false, 0x00, nullptr},
+    {0x5D, DISPLAY_ANIMATION, &rle_bitmap_faces_1, nullptr, nullptr, nullptr, true,  0x00, nullptr},
+    {0x5E, DISPLAY_ANIMATION, &rle_bitmap_faces_2, nullptr, nullptr, nullptr, true,  0x00, nullptr},
+    {0x5F, DISPLAY_ANIMATION, &rle_bitmap_faces_3, nullptr, nullptr, nullptr, true,  0x1A, &rle_bitmap_faces_3_5},
+    {0x60, DISPLAY_ANIMATION, &rle_bitmap_faces_4, nullptr, nullptr, nullptr, true,  0x00, nullptr},
 
-        display->clearBuffer();
-        display->setFont(font);
-        int charX = x;
-        for (int i = 0; i < titleLen; i++) {
-            int y = (i == idx) ? hopY : normalY;
-            char c[2] = { text[i], '\0' };
-            display->drawStr(charX, y, c);
-            charX += charWidths[i];
-        }
-        // 下部情報
-        display->setFont(u8g2_font_6x10_tr);
-        display->drawStr(0, 52, "USB: Connected");
-        display->drawStr(0, 62, "BLE: OK");
-        display->drawStr(70, 62, "SHIFT: --");
-        display->sendBuffer();
+    // 文字表示
+    {0x1A, DISPLAY_TEXT, nullptr, "SHIFT ON",  nullptr,               u8g2_font_fub14_tr, false, 0x00, nullptr}, // s
+    {0x0C, DISPLAY_TEXT, nullptr, "INTRO",     "Japanese or English", u8g2_font_fub14_tr, false, 0x00, nullptr}, // e
+    {0x09, DISPLAY_TEXT, nullptr, "BARK",      nullptr,               u8g2_font_fub14_tr, false, 0x00, nullptr}, // b
+    {0x0F, DISPLAY_TEXT, nullptr, "HAZARD",    nullptr,               u8g2_font_fub14_tr, false, 0x00, nullptr}, // h
+    {0x1B, DISPLAY_TEXT, nullptr, "AT/MT",     "TOGGLE",              u8g2_font_fub14_tr, false, 0x00, nullptr}, // t
+    {0x56, DISPLAY_TEXT, nullptr, "MOVE FWD",  nullptr,               u8g2_font_fub14_tr, true,  0x00, nullptr}, // Up
+    {0x55, DISPLAY_TEXT, nullptr, "MOVE BKWD", nullptr,               u8g2_font_fub14_tr, true,  0x00, nullptr}, // Down
+    {0x54, DISPLAY_TEXT, nullptr, "TURN LEFT", nullptr,               u8g2_font_fub14_tr, true,  0x00, nullptr}, // Left
+    {0x53, DISPLAY_TEXT, nullptr, "TURN RIGHT",nullptr,               u8g2_font_fub14_tr, true,  0x00, nullptr}, // Right
+    {0x2D, DISPLAY_TEXT, nullptr, "ESCAPE",    nullptr,               u8g2_font_fub14_tr, false, 0x00, nullptr}, // Esc
+    {0x4A, DISPLAY_TEXT, nullptr, "SCRNSHOT",  nullptr,               u8g2_font_fub14_tr, true,  0x00, nullptr}, // PrintScreen
+    {0x3A, DISPLAY_TEXT, nullptr, "STOP",      "LINEAR SPEED",        u8g2_font_fub14_tr, false, 0x00, nullptr}, // ,
+    {0x3B, DISPLAY_TEXT, nullptr, "STOP",      "ANGULAR SPEED",       u8g2_font_fub14_tr, false, 0x00, nullptr}, // .
+    {0x67, DISPLAY_TEXT, nullptr, "STOP",      "ANGULAR SPEED",       u8g2_font_fub14_tr, true,  0x00, nullptr}, // テンキー.
+};
+static const int SPECIAL_KEY_TABLE_SIZE = sizeof(SPECIAL_KEY_TABLE) / sizeof(SpecialKeyEntry);
+
+// キーコード -> テーブル位置+1（0は該当なし）。initSpecialKeyLayouts()で構築
+static uint8_t specialKeyIndex[256] = {0};
+// テーブル各要素の描画位置（起動時に一度だけ計算）
+static SpecialKeyLayout specialKeyLayouts[sizeof(SPECIAL_KEY_TABLE) / sizeof(SpecialKeyEntry)];
+
+// 特別表示テーブルの索引と描画位置を事前計算する（setup()で一度だけ呼ぶ）
+void initSpecialKeyLayouts(U8G2* display) {
+    for (int i = 0; i < SPECIAL_KEY_TABLE_SIZE; i++) {
+        const SpecialKeyEntry& e = SPECIAL_KEY_TABLE[i];
+        specialKeyIndex[e.keycode] = i + 1;
+
+        SpecialKeyLayout& l = specialKeyLayouts[i];
+        l.x1 = l.y1 = l.x2 = l.y2 = 0;
+        if (e.type != DISPLAY_TEXT || !display) continue;
 
-        // より即座な割り込みのため、短い遅延を複数回に分割
-        int totalDelay = frameDelay;
-        const int slice = 10; // 10msごとに割り込みチェック
-        while (totalDelay > 0) {
-            if (uxQueueMessagesWaiting(displayQueue) > 0) return;
-            int d = (totalDelay > slice) ? slice : totalDelay;
-            vTaskDelay(d / portTICK_PERIOD_MS);
-            totalDelay -= d;
+        // drawCenteredText()と同じ配置
+        display->setFont(e.font);
+        int fontHeight = display->getFontAscent() - display->getFontDescent();
+        l.x1 = (128 - display->getStrWidth(e.text1)) / 2;
+        l.y1 = (64 + fontHeight) / 2.4 - display->getFontDescent();
+        if (e.text2) {
+            display->setFont(u8g2_font_6x10_tr);
+            int fontHeight2 = display->getFontAscent() - display->getFontDescent();
+            l.x2 = (128 - display->getStrWidth(e.text2)) / 2;
+            l.y2 = 52 + fontHeight2 / 1.5; // 少し下に配置
         }
     }
-    // 最後に全て通常高さで表示（中断時も中央揃えで）
-    display->clearBuffer();
-    display->setFont(font);
-    int charX = x;
-    for (int i = 0; i < titleLen; i++) {
-        int y = normalY;
-        char c[2] = { text[i], '\0' };
-        display->drawStr(charX, y, c);
-        charX += charWidths[i];
-    }
-    display->setFont(u8g2_font_6x10_tr);
-    display->drawStr(0, 52, "USB: Connected");
-    display->drawStr(0, 62, "BLE: OK");
-    display->drawStr(70, 62, "SHIFT: --");
-    display->sendBuffer();
-    // 最後も割り込み可能に
-    int totalDelay = 400;
-    const int slice = 10;
-    while (totalDelay > 0) {
-        if (uxQueueMessagesWaiting(displayQueue) > 0) return;
-        int d = (totalDelay > slice) ? slice : totalDelay;
-        vTaskDelay(d / portTICK_PERIOD_MS);
-        totalDelay -= d;
-    }
 }
 
 // 画面表示要求を統一的に使う
-bool handleSpecialKeyDisplay(U8G2* display, const String& characters, const String& prevCharacters) {
+// keycode: 単独で押されたキー（0なら特別表示なし）、prevKeycode: 直前に単独で押されたキー
+bool handleSpecialKeyDisplay(U8G2* display, uint8_t keycode, bool shift, uint8_t prevKeycode) {
     if (!display) return false;
 
+    // 設定ファイルの文字表示が優先（描画位置は表示タスクが計算する）
     DisplayRequest req;
-    req.display = display;
-    // デフォルト値をまとめて設定
-    req.jumpHeight = 4;
-    req.frames = 6;
-    req.frameDelay = 60;
-    req.bmp_w = 128;
-    req.bmp_h = 64;
-
-    if (prevCharacters == "s" && characters != "s") {
-        if (characters == "3") {
-            req.type = DISPLAY_ANIMATION;
-            req.bitmap = epd_bitmap_faces_3_5;
-            requestDisplay(req);
-            return true;
-        }
-    }
-
-    if (characters == "1") {
-        req.type = DISPLAY_ANIMATION;
-        req.bitmap = epd_bitmap_faces_1;
-        requestDisplay(req);
-        return true;
-    } else if (characters == "2") {
-        req.type = DISPLAY_ANIMATION;
-        req.bitmap = epd_bitmap_faces_2;
-        requestDisplay(req);
-        return true;
-    } else if (characters == "3") {
-        req.type = DISPLAY_ANIMATION;
-        req.bitmap = epd_bitmap_faces_3;
-        requestDisplay(req);
-        return true;
-    } else if (characters == "4") {
-        req.type = DISPLAY_ANIMATION;
-        req.bitmap = epd_bitmap_faces_4;
-        requestDisplay(req);
-        return true;
-    } else if (characters == "s") {
-        req.type = DISPLAY_TEXT;
-        req.text1 = "SHIFT ON";
-        req.font = u8g2_font_fub14_tr;
-        requestDisplay(req);
-        return true;
-    } else if (characters == "e") {
-        req.type = DISPLAY_TEXT;
-        req.text1 = "INTRO";
-        req.text2 = "Japanese or English";
-        req.font = u8g2_font_fub14_tr;
-        requestDisplay(req);
-        return true;
-    } else if (characters == "b") {
-        req.type = DISPLAY_TEXT;
-        req.text1 = "BARK";
-        req.font = u8g2_font_fub14_tr;
-        requestDisplay(req);
-        return true;
-    } else if (characters == "h") {
+    bool shiftInvariant;
+    if (configStore.getDisplayText(keycode, req.text1, sizeof(req.text1), req.text2, sizeof(req.text2), shiftInvariant)) {
+        if (shift && !shiftInvariant) return false;
+        req.display = display;
         req.type = DISPLAY_TEXT;
-        req.text1 = "HAZARD";
         req.font = u8g2_font_fub14_tr;
         requestDisplay(req);
         return true;
-    } else if (characters == "t") {
-        req.type = DISPLAY_TEXT;
-        req.text1 = "AT/MT";
-        req.text2 = "TOGGLE";
-        req.font = u8g2_font_fub14_tr;
-        requestDisplay(req);
-        return true;
-    } else if (characters == "Up") {
-        req.type = DISPLAY_TEXT;
-        req.text1 = "MOVE FWD";
-        req.font = u8g2_font_fub14_tr;
-        requestDisplay(req);
-    } else if (characters == "Down") {
-        req.type = DISPLAY_TEXT;
-        req.text1 = "MOVE BKWD";
-        req.font = u8g2_font_fub14_tr;
-        requestDisplay(req);
-    } else if (characters == "Left") {
-        req.type = DISPLAY_TEXT;
-        req.text1 = "TURN LEFT";
-        req.font = u8g2_font_fub14_tr;
-        requestDisplay(req);
-    } else if (characters == "Right") {
-        req.type = DISPLAY_TEXT;
-        req.text1 = "TURN RIGHT";
-        req.font = u8g2_font_fub14_tr;
-        requestDisplay(req);
-    } else if (characters == "Esc") {
-        req.type = DISPLAY_TEXT;
-        req.text1 = "ESCAPE";
-        req.font = u8g2_font_fub14_tr;
-        requestDisplay(req);
-    } else if (characters == "PrintScreen") {
-        req.type = DISPLAY_TEXT;
-        req.text1 = "SCRNSHOT";
-        req.font = u8g2_font_fub14_tr;
-        requestDisplay(req);
-    } else if (characters == ",") {
-        req.type = DISPLAY_TEXT;
-        req.text1 = "STOP";
-        req.text2 = "LINEAR SPEED";
-        req.font = u8g2_font_fub14_tr;
-        requestDisplay(req);
-    } else if (characters == ".") {
-        req.type = DISPLAY_TEXT;
-        req.text1 = "STOP";
-        req.text2 = "ANGULAR SPEED";
-        req.font = u8g2_font_fub14_tr;
-        requestDisplay(req);
-    }    
-    return false;
+    }
+
+    uint8_t idx = specialKeyIndex[keycode];
+    if (idx == 0) return false;
+    const SpecialKeyEntry& e = SPECIAL_KEY_TABLE[idx - 1];
+    if (shift && !e.shiftInvariant) return false;
+
+    req.display = display;
+    req.type = e.type;
+    if (e.type == DISPLAY_ANIMATION) {
+        req.jumpHeight = 4;
+        req.clip = &CLIP_BITMAP_BOUNCE;
+        req.bmp_w = 128;
+        req.bmp_h = 64;
+        req.rle = (e.seqBitmap && prevKeycode == e.seqPrev) ? e.seqBitmap : e.bitmap;
+    } else {
+        const SpecialKeyLayout& l = specialKeyLayouts[idx - 1];
+        req.setText1(e.text1);
+        req.setText2(e.text2);
+        req.font = e.font;
+        req.hasLayout = true;
+        req.x1 = l.x1;
+        req.y1 = l.y1;
+        req.x2 = l.x2;
+        req.y2 = l.y2;
+    }
+    requestDisplay(req);
+    return true;
 }
 
-// setup()でディスプレイタスクとキューを初期化してください
-// displayQueue = xQueueCreate(4, sizeof(DisplayRequest));
+// setup()でディスプレイタスクとメールボックスを初期化してください
+// displayQueue = xQueueCreate(1, sizeof(DisplayRequest));
 // xTaskCreatePinnedToCore(displayTask, "displayTask", 4096, NULL, 1, NULL, 0);
\ No newline at end of file
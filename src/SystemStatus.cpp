@@ -0,0 +1,20 @@
+#include "SystemStatus.h"
+
+SystemStatus systemStatus;
+
+StatusSnapshot SystemStatus::read() const {
+    StatusSnapshot s;
+    // 読んでいる間に書き込みがあればバージョンがずれるので読み直す（書き込みは稀なので通常1回）
+    for (int retry = 0; retry < 4; retry++) {
+        uint32_t before = version.load(std::memory_order_acquire);
+        s.bleConnected = bleConnected.load(std::memory_order_relaxed);
+        s.usbDevice = (UsbDeviceKind)usbDevice.load(std::memory_order_relaxed);
+        s.modifiers = modifiers.load(std::memory_order_relaxed);
+        s.queueDepth = queueDepth.load(std::memory_order_relaxed);
+        s.lastLatencyUs = lastLatencyUs.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        s.version = before;
+        if (version.load(std::memory_order_relaxed) == before) break;
+    }
+    return s;
+}
@@ -0,0 +1,168 @@
+#include "TeleopStreamer.h"
+
+// グローバルインスタンスの定義
+TeleopStreamer teleopStreamer;
+
+// タスクへの通知（ビット）
+#define TELEOP_NOTIFY_URGENT 0x01   // リリース・停止キー（最優先）
+#define TELEOP_NOTIFY_START  0x02   // 押した・組み合わせが変わった（すぐ送って周期を数え直す）
+#define TELEOP_NOTIFY_TICK   0x04   // 周期タイマー
+
+// BLEへ送るキー（BleKeyboard::press()と同じ: 矢印はKEY_*、停止キーはASCII）
+#define TELEOP_KEY_COMMA  ','
+#define TELEOP_KEY_PERIOD '.'
+
+bool TeleopStreamer::begin(BleKeyboard* kbd, BaseType_t core) {
+    keyboard = kbd;
+    // 周期タイマーが無ければタスクも作らない（update()はfalseを返し、矢印は長押しリピートのまま）
+    const esp_timer_create_args_t args = {
+        .callback = &TeleopStreamer::onTimer,
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "teleop",
+        .skip_unhandled_events = false,
+    };
+    esp_err_t err = esp_timer_create(&args, &timer);
+    if (err != ESP_OK) {
+        timer = nullptr;
+        ESP_LOGI("TeleopStreamer", "teleop timer create failed err=%x, teleop disabled", err);
+        return false;
+    }
+    BaseType_t ok = xTaskCreatePinnedToCore(teleopTask, "teleopTask", 3072, this, TELEOP_TASK_PRIORITY, &task, core);
+    if (ok != pdPASS) {
+        task = nullptr;
+        esp_timer_delete(timer);
+        timer = nullptr;
+        ESP_LOGI("TeleopStreamer", "teleop task create failed, teleop disabled");
+        return false;
+    }
+    return true;
+}
+
+void TeleopStreamer::classify(const uint8_t* keys, uint8_t& moves, uint8_t& stops, bool& other) {
+    moves = 0;
+    stops = 0;
+    other = false;
+    for (int byte = 0; byte < 32; byte++) {
+        if (keys[byte] == 0) continue;
+        for (int bit = 0; bit < 8; bit++) {
+            if (!(keys[byte] & (1 << bit))) continue;
+            switch (byte * 8 + bit) {
+                case 0x56: moves |= TELEOP_MOVE_UP; break;
+                case 0x55: moves |= TELEOP_MOVE_DOWN; break;
+                case 0x54: moves |= TELEOP_MOVE_LEFT; break;
+                case 0x53: moves |= TELEOP_MOVE_RIGHT; break;
+                case 0x3A: stops |= TELEOP_STOP_LINEAR; break;
+                case 0x3B: stops |= TELEOP_STOP_ANGULAR; break;
+                default: other = true; break;
+            }
+        }
+    }
+}
+
+bool TeleopStreamer::update(uint8_t nextMoves, uint8_t nextStops) {
+    if (task == nullptr) return false;
+    uint32_t bits = 0;
+
+    portENTER_CRITICAL(&lock);
+    bool pressed = (nextMoves & ~moves) || (nextStops & ~stops);
+    uint8_t newStops = nextStops & ~stops;
+    if (newStops) {
+        pendingStops |= newStops;
+        halted = true;
+        bits |= TELEOP_NOTIFY_URGENT;
+    }
+    if (nextMoves == 0) halted = false;
+    bool next = nextMoves != 0 && !halted;
+    if (streaming && !next) {
+        bits |= TELEOP_NOTIFY_URGENT;
+    } else if (next && (!streaming || nextMoves != moves)) {
+        bits |= TELEOP_NOTIFY_START;
+    }
+    moves = nextMoves;
+    stops = nextStops;
+    streaming = next;
+    portEXIT_CRITICAL(&lock);
+
+    if (bits) xTaskNotify(task, bits, eSetBits);
+    return pressed;
+}
+
+void TeleopStreamer::onTimer(void* arg) {
+    TeleopStreamer* self = static_cast<TeleopStreamer*>(arg);
+    // 前の周期をまだ送っていない
+    if (self->tickPending) self->missedDeadlines++;
+    self->tickUs = esp_timer_get_time();
+    self->tickPending = true;
+    xTaskNotify(self->task, TELEOP_NOTIFY_TICK, eSetBits);
+}
+
+void TeleopStreamer::teleopTask(void* pvParameters) {
+    static_cast<TeleopStreamer*>(pvParameters)->run();
+}
+
+void TeleopStreamer::run() {
+    for (;;) {
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+
+        // リリース・停止キーが先（同時に来た周期の送信は、止まっていれば捨てる）
+        if (bits & TELEOP_NOTIFY_URGENT) {
+            portENTER_CRITICAL(&lock);
+            uint8_t stopKeys = pendingStops;
+            pendingStops = 0;
+            bool running = streaming;
+            portEXIT_CRITICAL(&lock);
+            if (!running) {
+                esp_timer_stop(timer);
+                tickPending = false;
+            }
+            if (stopKeys & TELEOP_STOP_LINEAR) sendTap(TELEOP_KEY_COMMA);
+            if (stopKeys & TELEOP_STOP_ANGULAR) sendTap(TELEOP_KEY_PERIOD);
+        }
+
+        if (!(bits & (TELEOP_NOTIFY_START | TELEOP_NOTIFY_TICK))) continue;
+        portENTER_CRITICAL(&lock);
+        uint8_t held = moves;
+        bool running = streaming;
+        portEXIT_CRITICAL(&lock);
+        if (!running) {
+            tickPending = false;
+            continue;
+        }
+
+        if (bits & TELEOP_NOTIFY_START) {
+            // すぐ送り、ここから周期を数え直す
+            esp_timer_stop(timer);
+            tickPending = false;
+            sendMoves(held);
+            esp_timer_start_periodic(timer, periodUs);
+        } else {
+            uint32_t latency = (uint32_t)(esp_timer_get_time() - tickUs);
+            tickPending = false;
+            sendMoves(held);
+            if (latency > maxLatencyUs) maxLatencyUs = latency;
+        }
+    }
+}
+
+// 共有のレポートに足して送り、足したキーだけ引いて送る（他のタスクが押しているキーは消さない）
+void TeleopStreamer::sendMoves(uint8_t held) {
+    if (!keyboard || !keyboard->isConnected()) return;
+    uint8_t keys[4];
+    size_t n = 0;
+    if (held & TELEOP_MOVE_UP) keys[n++] = KEY_UP_ARROW;
+    if (held & TELEOP_MOVE_DOWN) keys[n++] = KEY_DOWN_ARROW;
+    if (held & TELEOP_MOVE_LEFT) keys[n++] = KEY_LEFT_ARROW;
+    if (held & TELEOP_MOVE_RIGHT) keys[n++] = KEY_RIGHT_ARROW;
+    if (n == 0) return;
+    keyboard->pressKeys(keys, n);
+    keyboard->releaseKeys(keys, n);
+    sent++;
+}
+
+void TeleopStreamer::sendTap(uint8_t key) {
+    if (!keyboard || !keyboard->isConnected()) return;
+    keyboard->write(key);
+    stopsSent++;
+}
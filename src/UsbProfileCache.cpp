@@ -0,0 +1,66 @@
+#include "UsbProfileCache.h"
+#include <nvs.h>
+
+#define USB_PROFILE_NAMESPACE "usbprof"
+
+// NVSのキー（15文字まで）: VID・PID・bcdDeviceの16進12文字
+static void makeKey(char *key, size_t size, uint16_t vendorId, uint16_t productId, uint16_t bcdDevice) {
+  snprintf(key, size, "%04x%04x%04x", vendorId, productId, bcdDevice);
+}
+
+bool UsbProfileCache::load(uint16_t vendorId, uint16_t productId, uint16_t bcdDevice, UsbDeviceProfile &profile) {
+  nvs_handle_t handle;
+  if (nvs_open(USB_PROFILE_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+    return false;   // まだ何も保存していない
+  }
+  char key[16];
+  makeKey(key, sizeof(key), vendorId, productId, bcdDevice);
+  size_t size = sizeof(profile);
+  esp_err_t err = nvs_get_blob(handle, key, &profile, &size);
+  nvs_close(handle);
+
+  if (err != ESP_OK || size != sizeof(profile)) {
+    return false;
+  }
+  if (profile.version != USB_PROFILE_VERSION || profile.vendorId != vendorId ||
+      profile.productId != productId || profile.bcdDevice != bcdDevice ||
+      profile.interfaceCount > USB_HOST_MAX_INTERFACES || profile.endpointCount > USB_HOST_MAX_TRANSFERS) {
+    ESP_LOGI("UsbProfileCache", "stale profile %s ignored", key);
+    return false;
+  }
+  return true;
+}
+
+bool UsbProfileCache::save(const UsbDeviceProfile &profile) {
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(USB_PROFILE_NAMESPACE, NVS_READWRITE, &handle);
+  if (err != ESP_OK) {
+    ESP_LOGI("UsbProfileCache", "nvs_open() err=%x", err);
+    return false;
+  }
+  char key[16];
+  makeKey(key, sizeof(key), profile.vendorId, profile.productId, profile.bcdDevice);
+  err = nvs_set_blob(handle, key, &profile, sizeof(profile));
+  if (err == ESP_OK) {
+    err = nvs_commit(handle);
+  }
+  nvs_close(handle);
+  if (err != ESP_OK) {
+    ESP_LOGI("UsbProfileCache", "save %s err=%x", key, err);
+    return false;
+  }
+  ESP_LOGI("UsbProfileCache", "saved profile %s (%d bytes)", key, (int)sizeof(profile));
+  return true;
+}
+
+void UsbProfileCache::erase(uint16_t vendorId, uint16_t productId, uint16_t bcdDevice) {
+  nvs_handle_t handle;
+  if (nvs_open(USB_PROFILE_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+    return;
+  }
+  char key[16];
+  makeKey(key, sizeof(key), vendorId, productId, bcdDevice);
+  nvs_erase_key(handle, key);
+  nvs_commit(handle);
+  nvs_close(handle);
+}
@@ -33,7 +33,13 @@
 
 #include "PythonStyleAnalyzer.h"
 #include "Peripherals.h"
-#include "StartupAnimation.h"
+#include "Animation.h"
+#include "DisplayFlush.h"
+#include "SystemStatus.h"
+#include "FeedbackBus.h"
+#include "ConsumerForwarder.h"
+#include "MouseForwarder.h"
+#include "GamepadForwarder.h"
 
 // SSD1306ディスプレイ設定
 #define SCREEN_WIDTH 128
@@ -41,6 +47,13 @@
 #define OLED_RESET -1
 #define SCREEN_ADDRESS 0x3C
 
+// USBホスト開始前の書き込み待ち時間（ms）
+// USBホストを開始するとUSBシリアル経由の書き込みができなくなるので、必要ならビルドフラグで待ち時間を設ける。
+// 待つのはUSBホストだけで、BLEと起動画面はその間も動く
+#ifndef BOOT_PROGRAMMING_WINDOW_MS
+#define BOOT_PROGRAMMING_WINDOW_MS 0
+#endif
+
 // Seeed XIAO ESP32S3のI2Cピン設定
 #define SDA_PIN 5
 #define SCL_PIN 6
@@ -64,6 +77,11 @@ void stopBleConnection();
 QueueHandle_t bleSendQueue;
 QueueHandle_t displayQueue;
 
+// 起動時間の計測（起動からのms）
+static uint32_t bootAdvertisingMs = 0;     // BLEアドバタイズ開始
+static uint32_t bootUsbHostMs = 0;         // USBホスト開始
+static uint32_t bootFirstKeyMs = 0;        // 最初のキーをBLEへ転送
+
 // BLE送信タスク
 void bleSendTask(void* pvParameters) {
     PythonStyleAnalyzer* analyzer = (PythonStyleAnalyzer*)pvParameters;
@@ -71,7 +89,27 @@ void bleSendTask(void* pvParameters) {
     for (;;) {
         // キューから送信要求を受け取る
         if (xQueueReceive(bleSendQueue, &sendChars, portMAX_DELAY) == pdTRUE) {
+            uint32_t startUs = micros();
             analyzer->sendString(sendChars);
+            uint32_t latencyUs = micros() - startUs;
+            UBaseType_t depth = uxQueueMessagesWaiting(bleSendQueue);
+            systemStatus.setLastLatencyUs(latencyUs);
+            systemStatus.setQueueDepth(depth);
+
+            // ステータスLEDのアラーム（変化した時だけLEDのエフェクトが切り替わる）
+            if (latencyUs > LED_LATENCY_ALARM_US) {
+                ledController.setAlarm(LED_ALARM_HIGH_LATENCY, true);
+            } else if (latencyUs < LED_LATENCY_ALARM_US / 2) {
+                ledController.setAlarm(LED_ALARM_HIGH_LATENCY, false);
+            }
+            if (depth == 0) {
+                ledController.setAlarm(LED_ALARM_QUEUE_OVERFLOW, false);
+            }
+            if (bootFirstKeyMs == 0) {
+                bootFirstKeyMs = millis();
+                Serial.printf("起動時間: 最初のキー転送 %lu ms（アドバタイズ開始 %lu ms）\n",
+                              (unsigned long)bootFirstKeyMs, (unsigned long)bootAdvertisingMs);
+            }
         }
         vTaskDelay(1); // 負荷軽減
     }
@@ -80,10 +118,8 @@ void bleSendTask(void* pvParameters) {
 void setup() {
     setCpuFrequencyMhz(240);
 
+    // シリアルモニタの接続は待たない（起動直後のログは失われるが、計測値はあとで統計表示にも出る）
     Serial.begin(115200);
-    while (!Serial && millis() < 2000) {
-        delay(100);
-    }
 
     Serial.println("=======================================");
     Serial.println("DOIO KB16 USB-to-BLE Bridge System");
@@ -93,66 +129,82 @@ void setup() {
 
     Wire.begin(SDA_PIN, SCL_PIN);
     Wire.setClock(400000);
-    delay(100);
 
     ledController.begin();
     speakerController.begin();
+    // 起動音（キューに積むだけで待たない）
     speakerController.playStartupMelody();
 
     // U8G2初期化
     display.begin();
+    // 特別キー表示の描画位置を事前計算（以降は描画時に幅を測らない）
+    initSpecialKeyLayouts(&display);
 
-    // 起動画面アニメーション
-    StartupAnimation startupAnim(&display);
-    startupAnim.showStartupScreen();
+    // ディスプレイ転送タスク（描画と転送を並行させる）
+    displayFlush.begin(SCREEN_ADDRESS, 0);
+    Serial.printf("ディスプレイI2Cクロック: %lu Hz\n", (unsigned long)displayFlush.getBusClock());
 
-    Serial.println("Programming mode finished. Starting Bridge mode...");
+    // ディスプレイ表示メールボックス（最新の1件のみ保持）とタスク初期化
+    displayQueue = xQueueCreate(1, sizeof(DisplayRequest));
+    xTaskCreatePinnedToCore(displayTask, "displayTask", 4096, NULL, 1, NULL, 0);
 
-    // プログラミングモード終了の表示
-    // display.clearBuffer();
-    // display.setFont(u8g2_font_6x10_tr);
-    // display.drawStr(0, 10, "USB->BLE Bridge");
-    // display.drawStr(0, 22, "===============");
-    // display.drawStr(0, 34, "Bridge Mode");
-    // display.drawStr(0, 46, "ACTIVATED!");
-    // display.drawStr(0, 58, "Initializing...");
-    // display.sendBuffer();
-    // delay(1000);
+    // キー入力のLED・音・画面更新はフィードバックタスクがまとめて行う（USB→BLEの経路から外す）
+    feedbackBus.begin(&display, 0);
 
+    // 起動画面アニメーションは表示タスクで再生する
+    // USBデバイスが接続されると接続画面の表示要求で即座に打ち切られる
+    DisplayRequest startupReq;
+    startupReq.type = DISPLAY_ANIMATION;
+    startupReq.display = &display;
+    startupReq.clip = &CLIP_STARTUP;
+    requestDisplay(startupReq);
+
+    // BLE（アドバタイズ開始まで）
     bleKeyboard.begin();
     bleKeyboard.setDelay(1);
 
     bleAutoReconnect = true;
     bleStackInitialized = true;
+    bootAdvertisingMs = millis();
 
     Serial.println("✓ BLEキーボードを初期化しました（自動接続モード）");
     Serial.println("  - 起動時は自動接続有効");
     Serial.println("  - Ctrl+Alt+Bで手動制御に切り替え可能");
 
-    // delay(500);
-
-    // display.clearBuffer();
-    // display.setFont(u8g2_font_6x10_tr);
-    // display.drawStr(0, 10, "USB->BLE Bridge");
-    // display.drawStr(0, 22, "===============");
-    // display.drawStr(0, 34, "BLE: Ready");
-    // display.drawStr(0, 46, "USB: Waiting...");
-    // display.drawStr(0, 58, "Connect keyboard");
-    // display.sendBuffer();
-
-    // delay(1000);
-
+    // USBホスト
+#if BOOT_PROGRAMMING_WINDOW_MS > 0
+    Serial.printf("書き込み待ち: %d ms\n", BOOT_PROGRAMMING_WINDOW_MS);
+    delay(BOOT_PROGRAMMING_WINDOW_MS);
+#endif
+    // ノブなどのメディアキーとマウスの移動は接続間隔ごとにまとめて送る
+    consumerForwarder.begin(&bleKeyboard, 1);
+    mouseForwarder.begin(&bleKeyboard, 1);
+    // ゲームパッドは最小間隔ごとに最新の状態だけ送る
+    gamepadForwarder.begin(&bleKeyboard, 1);
+#if TELEOP_ENABLED
+    // 矢印キーは周期タイマーごとに送る（リリース・停止キーは優先）
+    teleopStreamer.begin(&bleKeyboard, 1);
+#endif
+    // LittleFSの設定（キーマップ・リピート・表示）を読む。無ければ組み込みの設定
+    configStore.begin();
+#if KEYMAP_ENABLED
+    // KB16のキーマップを平らな表にして、タップ/ホールドのタイマーを用意する
+    configStore.compileKeymap();
+    keyLayers.begin();
+    // マクロは専用タスクで再生する（待ち時間はタイマーで起こしてもらう）
+    macroPlayer.begin(&bleKeyboard, 1);
+#endif
     analyzer = new PythonStyleAnalyzer(&display, &bleKeyboard);
     analyzer->begin();
+    bootUsbHostMs = millis();
 
     // BLE送信キュー作成
     bleSendQueue = xQueueCreate(8, sizeof(String));
     // BLE送信タスク開始
     xTaskCreatePinnedToCore(bleSendTask, "bleSendTask", 4096, analyzer, 1, NULL, 1);
 
-    // ディスプレイ表示キューとタスク初期化
-    displayQueue = xQueueCreate(4, sizeof(DisplayRequest));
-    xTaskCreatePinnedToCore(displayTask, "displayTask", 4096, NULL, 1, NULL, 0);
+    Serial.printf("起動時間: アドバタイズ開始 %lu ms / USBホスト開始 %lu ms\n",
+                  (unsigned long)bootAdvertisingMs, (unsigned long)bootUsbHostMs);
 
     Serial.println("システム初期化完了");
     Serial.println("USBキーボードを接続してください...");
@@ -183,12 +235,20 @@ void loop() {
     // USBタスクの実行（PythonアナライザーとBLE転送処理が内部で行われる）
     analyzer->task();
     
+    // チャタリング除去の時間窓が過ぎたキーを確定させる（リピートより先に）
+    analyzer->handleDebounce();
+    analyzer->handleKeymap();
+    // BLEホストのCapsLockなどをUSBキーボードのLEDへ
+    analyzer->handleHostLeds();
+
     // 長押しリピート処理を高頻度で実行（重要！）
     analyzer->handleKeyRepeat();
-    
-    // LEDの更新処理
-    ledController.updateKeyLED();
-    ledController.updateStatusLED();
+
+    // シリアルからの設定の読み直し・受信。切り替えはキーが全部離れている時だけ
+    configStore.pollSerial(Serial);
+    if (configStore.hasPending() && analyzer->keysReleased()) {
+        configStore.apply();
+    }
     
     // BLE接続状態の監視とLED制御
     static bool lastBleConnected = false;
@@ -203,6 +263,7 @@ void loop() {
     if (lastBleConnected != currentBleConnected) {
         lastBleConnected = currentBleConnected;
         ledController.setBleConnected(currentBleConnected);
+        systemStatus.setBleConnected(currentBleConnected);
         
         if (currentBleConnected) {
             Serial.println("BLE接続しました");
@@ -228,6 +289,7 @@ void loop() {
                     esp_bt_controller_deinit();
                     
                     bleStackInitialized = false;
+                    ledController.setBleStopped(true);
                     Serial.println("✓ BLEスタックを完全に停止しました");
                 }
             } else {
@@ -267,6 +329,7 @@ void startBleConnection() {
         bleManualConnect = true;
         bleAutoReconnect = true;  // 手動接続時は自動再接続を有効にする
         bleStackInitialized = true;
+        ledController.setBleStopped(false);
         
         Serial.println("BLE接続を開始しました（自動再接続有効）");
     } else if (!bleKeyboard.isConnected()) {
@@ -295,6 +358,7 @@ void stopBleConnection() {
         esp_bt_controller_deinit();
         
         bleStackInitialized = false;
+        ledController.setBleStopped(true);
         
         Serial.println("BLE接続を完全に停止しました");
         Serial.println("再接続するにはCtrl+Alt+Bを押してください");